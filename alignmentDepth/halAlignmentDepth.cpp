@@ -38,12 +38,12 @@ using namespace hal;
 
 /** Print the alignment depth wiggle for a subrange of a given sequence to
  * the output stream. */
-static void printSequence(ostream &outStream, const Sequence *sequence, const set<const Genome *> &targetSet, hal_size_t start,
+static void printSequence(TextWriter &outStream, const Sequence *sequence, const set<const Genome *> &targetSet, hal_size_t start,
                           hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors);
 
 /** If given genome-relative coordinates, map them to a series of
  * sequence subranges */
-static void printGenome(ostream &outStream, const Genome *genome, const Sequence *sequence,
+static void printGenome(TextWriter &outStream, const Genome *genome, const Sequence *sequence,
                         const set<const Genome *> &targetSet, hal_size_t start, hal_size_t length, hal_size_t step,
                         bool countDupes, bool noAncestors);
 
@@ -188,7 +188,6 @@ int main(int argc, char **argv) {
         }
 
         ofstream ofile;
-        ostream &outStream = wigPath == "stdout" ? cout : ofile;
         if (wigPath != "stdout") {
             ofile.open(wigPath.c_str());
             if (!ofile) {
@@ -196,7 +195,9 @@ int main(int argc, char **argv) {
             }
         }
 
-        printGenome(outStream, refGenome, refSequence, targetSet, start, length, step, countDupes, noAncestors);
+        TextWriter outWriter(wigPath == "stdout" ? cout : ofile, true);
+        printGenome(outWriter, refGenome, refSequence, targetSet, start, length, step, countDupes, noAncestors);
+        outWriter.flush();
 
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
@@ -212,7 +213,7 @@ int main(int argc, char **argv) {
 /** Given a Sequence (chromosome) and a (sequence-relative) coordinate
  * range, print the alignmability wiggle with respect to the genomes
  * in the target set */
-void printSequence(ostream &outStream, const Sequence *sequence, const set<const Genome *> &targetSet, hal_size_t start,
+void printSequence(TextWriter &outStream, const Sequence *sequence, const set<const Genome *> &targetSet, hal_size_t start,
                    hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors) {
     hal_size_t seqLen = sequence->getSequenceLength();
     if (seqLen == 0) {
@@ -315,7 +316,7 @@ void printSequence(ostream &outStream, const Sequence *sequence, const set<const
  * for the hal::Sequence interface.  We can convert between the two by
  * adding or subtracting the sequence start position (in the example it woudl
  * be 0 for ChrA and 500 for ChrB) */
-void printGenome(ostream &outStream, const Genome *genome, const Sequence *sequence, const set<const Genome *> &targetSet,
+void printGenome(TextWriter &outStream, const Genome *genome, const Sequence *sequence, const set<const Genome *> &targetSet,
                  hal_size_t start, hal_size_t length, hal_size_t step, bool countDupes, bool noAncestors) {
     if (sequence != NULL) {
         printSequence(outStream, sequence, targetSet, start, length, step, countDupes, noAncestors);
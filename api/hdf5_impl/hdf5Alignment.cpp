@@ -48,6 +48,7 @@ const hsize_t Hdf5Alignment::DefaultCacheRDCElems = 521;
 const hsize_t Hdf5Alignment::DefaultCacheRDCBytes = 1048576;
 const double Hdf5Alignment::DefaultCacheW0 = 0.75;
 const bool Hdf5Alignment::DefaultInMemory = false;
+const hal_size_t Hdf5Alignment::DefaultGenomeCacheBytes = 0;
 
 /* check if first bit of file has HDF5 header */
 bool hal::Hdf5Alignment::isHdf5File(const std::string &initialBytes) {
@@ -70,7 +71,8 @@ Hdf5Alignment::Hdf5Alignment(const string &alignmentPath, unsigned mode, const H
                              const H5::FileAccPropList &fileAccessProps, const H5::DSetCreatPropList &datasetCreateProps,
                              bool inMemory)
     : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _file(NULL), _flags(hdf5DefaultFlags(_mode)),
-      _inMemory(inMemory), _metaData(NULL), _tree(NULL), _dirty(false) {
+      _inMemory(inMemory), _metaData(NULL), _tree(NULL), _dirty(false), _genomeCacheBytes(DefaultGenomeCacheBytes),
+      _genomeUseClock(0) {
     _cprops.copy(fileCreateProps);
     _aprops.copy(fileAccessProps);
     _dcprops.copy(datasetCreateProps);
@@ -86,7 +88,8 @@ Hdf5Alignment::Hdf5Alignment(const string &alignmentPath, unsigned mode, const H
 
 Hdf5Alignment::Hdf5Alignment(const std::string &alignmentPath, unsigned mode, const CLParser *parser)
     : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _file(NULL), _flags(hdf5DefaultFlags(_mode)),
-      _inMemory(false), _metaData(NULL), _tree(NULL), _dirty(false) {
+      _inMemory(false), _metaData(NULL), _tree(NULL), _dirty(false), _genomeCacheBytes(DefaultGenomeCacheBytes),
+      _genomeUseClock(0) {
     initializeFromOptions(parser);
     if (_inMemory) {
         setInMemory();
@@ -126,6 +129,11 @@ void Hdf5Alignment::defineOptions(CLParser *parser, unsigned mode) {
 
     parser->addOptionFlag("hdf5InMemory", "load all data in memory (and disable hdf5 cache)", DefaultInMemory);
     parser->addOptionFlag("inMemory", "obsolete name for --hdf5InMemory", DefaultInMemory);
+
+    parser->addOption("hdf5GenomeCacheBytes", "memory budget in bytes for open genomes.  When exceeded, "
+                                              "buffers of the least recently used genomes not being iterated "
+                                              "over are released and reloaded on demand [0: no limit]",
+                      DefaultGenomeCacheBytes);
 }
 
 /* initialize class from options */
@@ -134,6 +142,7 @@ void Hdf5Alignment::initializeFromOptions(const CLParser *parser) {
     _dcprops.copy(hdf5DefaultDSetCreatPropList());
     _aprops.copy(hdf5DefaultFileAccPropList());
     _inMemory = parser->getFlagAlt("hdf5InMemory", "inMemory");
+    _genomeCacheBytes = parser->getOption<hal_size_t>("hdf5GenomeCacheBytes");
     if ((_mode & CREATE_ACCESS) || (_mode & WRITE_ACCESS)) {
         // these are only available on create
         hsize_t chunk = parser->getOptionAlt<hsize_t>("hdf5Chunk", "chunk");
@@ -415,16 +424,46 @@ const Genome *Hdf5Alignment::openGenome(const string &name) const {
 Genome *Hdf5Alignment::openGenome(const string &name) {
     map<string, Hdf5Genome *>::iterator mapit = _openGenomes.find(name);
     if (mapit != _openGenomes.end()) {
+        mapit->second->touch();
         return mapit->second;
     }
     Hdf5Genome *genome = NULL;
     if (_nodeMap.find(name) != _nodeMap.end()) {
         genome = new Hdf5Genome(name, this, _file, _dcprops, _inMemory);
         _openGenomes.insert(pair<string, Hdf5Genome *>(name, genome));
+        genome->touch();
+        enforceGenomeCacheBudget(genome);
     }
     return genome;
 }
 
+void Hdf5Alignment::enforceGenomeCacheBudget(const Hdf5Genome *keep) const {
+    if (_genomeCacheBytes == 0) {
+        return;
+    }
+    // each open dataset has its own chunk cache
+    int mdc;
+    size_t rdc, rdcBytes;
+    double w0;
+    const_cast<H5::FileAccPropList &>(_aprops).getCache(mdc, rdc, rdcBytes, w0);
+
+    hal_size_t totalBytes = 0;
+    vector<Hdf5Genome *> candidates;
+    for (map<string, Hdf5Genome *>::iterator i = _openGenomes.begin(); i != _openGenomes.end(); ++i) {
+        Hdf5Genome *genome = i->second;
+        totalBytes += genome->getLoadedBytes(rdcBytes);
+        if (genome != keep && not genome->isHeld() && not genome->isReleased()) {
+            candidates.push_back(genome);
+        }
+    }
+    sort(candidates.begin(), candidates.end(),
+         [](const Hdf5Genome *a, const Hdf5Genome *b) { return a->getLastUse() < b->getLastUse(); });
+    for (size_t i = 0; i < candidates.size() && totalBytes > _genomeCacheBytes; ++i) {
+        totalBytes -= candidates[i]->getLoadedBytes(rdcBytes);
+        candidates[i]->releaseArrays();
+    }
+}
+
 void Hdf5Alignment::closeGenome(const Genome *genome) const {
     string name = genome->getName();
     map<string, Hdf5Genome *>::iterator mapIt = _openGenomes.find(name);
@@ -83,6 +83,24 @@ namespace hal {
 
         void replaceNewickTree(const std::string &newNewickString);
 
+        // HDF5 SPECIFIC
+
+        /** Limit the memory used by open genomes.  When exceeded, the
+         * arrays of the least recently used genomes that have no live
+         * segments are released.  Released genomes remain open and reload
+         * on access, so Genome pointers stay valid.
+         * @param genomeCacheBytes budget in bytes, 0 for no limit */
+        void setGenomeCacheBytes(hal_size_t genomeCacheBytes) {
+            _genomeCacheBytes = genomeCacheBytes;
+        }
+
+        hal_size_t nextGenomeUse() const {
+            return ++_genomeUseClock;
+        }
+
+        /* release genomes until under budget, never releasing keep */
+        void enforceGenomeCacheBudget(const Hdf5Genome *keep) const;
+
       private:
         // FIXME: should these be private?
         void loadTree();
@@ -109,6 +127,7 @@ namespace hal {
         static const hsize_t DefaultCacheRDCBytes;
         static const double DefaultCacheW0;
         static const bool DefaultInMemory;
+        static const hal_size_t DefaultGenomeCacheBytes;
 
         static const H5std_string MetaGroupName;
         static const H5std_string TreeGroupName;
@@ -130,6 +149,8 @@ namespace hal {
         mutable std::map<std::string, stTree *> _nodeMap;
         bool _dirty;
         mutable std::map<std::string, Hdf5Genome *> _openGenomes;
+        hal_size_t _genomeCacheBytes;
+        mutable hal_size_t _genomeUseClock;
     };
 }
 #endif
@@ -25,6 +25,15 @@ const size_t Hdf5BottomSegment::totalSize(hal_size_t numChildren) {
 
 Hdf5BottomSegment::Hdf5BottomSegment(Hdf5Genome *genome, Hdf5ExternalArray *array, hal_index_t index)
     : BottomSegment(genome, index), _array(array) {
+    if (genome != NULL) {
+        _genomeHolds = genome->holdSegment();
+    }
+}
+
+Hdf5BottomSegment::~Hdf5BottomSegment() {
+    if (_genomeHolds) {
+        --*_genomeHolds;
+    }
 }
 
 hal_size_t Hdf5BottomSegment::numChildrenFromDataType(const H5::DataType &dataType) {
@@ -23,6 +23,13 @@ void HDF5DnaAccess::flush() {
     _dirty = false;
 }
 
+void HDF5DnaAccess::release() {
+    flush();
+    _startIndex = 0;
+    _endIndex = 0;
+    _buffer = NULL;
+}
+
 void HDF5DnaAccess::fetch(hal_index_t index) const {
     if (_dirty) {
         _dnaArray->setDirty();
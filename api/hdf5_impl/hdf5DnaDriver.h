@@ -24,6 +24,10 @@ namespace hal {
 
         void flush();
 
+        /* flush and forget the buffer, so the next access re-fetches
+         * after the DNA array has been released */
+        void release();
+
       protected:
         virtual void fetch(hal_index_t index) const;
 
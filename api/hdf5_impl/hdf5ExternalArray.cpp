@@ -122,6 +122,12 @@ void Hdf5ExternalArray::write() {
 
 // Page chunk containing index i into memory
 void Hdf5ExternalArray::page(hsize_t i) {
+    if (_buf == NULL) {
+        // reopen after release()
+        _dataSet = _file->openDataSet(_path);
+        initBuf();
+        _chunkSpace = DataSpace(1, &_bufSize);
+    }
     if (_dirty) {
         write();
     }
@@ -139,3 +145,17 @@ void Hdf5ExternalArray::page(hsize_t i) {
     _dirty = false;
     assert(_bufSize > 0 || _size == 0);
 }
+
+// Free the buffer and dataset until the next access
+void Hdf5ExternalArray::release() {
+    if (_buf == NULL) {
+        return;
+    }
+    write();
+    delete[] _buf;
+    _buf = NULL;
+    _dataSet.close();
+    // out of range for every index, so the next get() pages
+    _bufStart = 1;
+    _bufEnd = 0;
+}
@@ -131,6 +131,21 @@ namespace hal {
         /** Read chunk from file */
         void page(hsize_t i);
 
+        /** Write any changes, then free the memory buffer and close the
+         * dataset (releasing its HDF5 chunk cache).  The dataset is reopened
+         * by the next access. */
+        void release();
+
+        /** Is the dataset open with its buffer in memory? */
+        bool isLoaded() const {
+            return _buf != NULL;
+        }
+
+        /** Size in bytes of the in-memory buffer */
+        hsize_t getBufferBytes() const {
+            return _buf != NULL ? _bufSize * _dataSize : 0;
+        }
+
       private:
         void initBuf();
 
@@ -20,6 +20,7 @@
 #include "hdf5TopSegment.h"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 
 using namespace hal;
@@ -31,6 +32,7 @@ const string Hdf5Genome::topArrayName = "TOP_ARRAY";
 const string Hdf5Genome::bottomArrayName = "BOTTOM_ARRAY";
 const string Hdf5Genome::sequenceIdxArrayName = "SEQIDX_ARRAY";
 const string Hdf5Genome::sequenceNameArrayName = "SEQNAME_ARRAY";
+const string Hdf5Genome::sequenceNameIndexArrayName = "SEQNAMEIDX_ARRAY";
 const string Hdf5Genome::metaGroupName = "Meta";
 const string Hdf5Genome::rupGroupName = "Rup";
 const double Hdf5Genome::dnaChunkScale = 10.;
@@ -38,8 +40,10 @@ const hal_size_t Hdf5Genome::maxPosCache = 1000;
     
 Hdf5Genome::Hdf5Genome(const string &name, Hdf5Alignment *alignment, PortableH5Location *h5Parent,
                        const DSetCreatPropList &dcProps, bool inMemory)
-    : Genome(alignment, name), _alignment(alignment), _h5Parent(h5Parent), _name(name), _numChildrenInBottomArray(0),
-      _totalSequenceLength(0), _numChunksInArrayBuffer(inMemory ? 0 : 1) {
+    : Genome(alignment, name), _alignment(alignment), _h5Parent(h5Parent), _name(name), _sequenceNameIndexDirty(false),
+      _numChildrenInBottomArray(0), _totalSequenceLength(0), _numChunksInArrayBuffer(inMemory ? 0 : 1),
+      _sequencePosCacheLoaded(false), _sequenceNameCacheLoaded(false), _segmentHolds(new hal_size_t(0)), _lastUse(0),
+      _released(false) {
     _dcprops.copy(dcProps);
     assert(!name.empty());
     assert(alignment != NULL && h5Parent != NULL);
@@ -112,6 +116,12 @@ void Hdf5Genome::setDimensions(const vector<Sequence::Info> &sequenceDimensions,
         _group.unlink(sequenceNameArrayName);
     } catch (H5::Exception &) {
     }
+    try {
+        HDF5DisableExceptionPrinting prDisable;
+        DataSet d = _group.openDataSet(sequenceNameIndexArrayName);
+        _group.unlink(sequenceNameIndexArrayName);
+    } catch (H5::Exception &) {
+    }
 
     if (_totalSequenceLength > 0 && storeDNAArrays) {
         hal_size_t arrayLength = _totalSequenceLength / 2;
@@ -172,7 +182,7 @@ void Hdf5Genome::updateTopDimensions(const vector<Sequence::UpdateInfo> &topDime
     // segment (these can get muddled as we add the new ones in the next
     // loop to be sure by getting them in one shot)
     // Note to self: iterating the map in this way skips zero-length
-    // sequences (which are in the separate vector).  This is fine
+    // sequences (which aren't in the position cache).  This is fine
     // here since we will never update them, but seems like it could be
     // dangerous if something were to change
     map<hal_size_t, Hdf5Sequence *>::iterator posCacheIt;
@@ -187,7 +197,7 @@ void Hdf5Genome::updateTopDimensions(const vector<Sequence::UpdateInfo> &topDime
     // scan through existing sequences, updating as necessary
     // build summary of all new and unchanged dimensions in newDimensions
     // Note to self: iterating the map in this way skips zero-length
-    // sequences (which are in the separate vector).  This is fine
+    // sequences (which aren't in the position cache).  This is fine
     // here since we will never update them, but seems like it could be
     // dangerous if something were to change
     map<string, hal_size_t>::iterator currentIt;
@@ -236,7 +246,7 @@ void Hdf5Genome::updateBottomDimensions(const vector<Sequence::UpdateInfo> &bott
     // segment (these can get muddled as we add the new ones in the next
     // loop to be sure by getting them in one shot)
     // Note to self: iterating the map in this way skips zero-length
-    // sequences (which are in the separate vector).  This is fine
+    // sequences (which aren't in the position cache).  This is fine
     // here since we will never update them, but seems like it could be
     // dangerous if something were to change
     map<hal_size_t, Hdf5Sequence *>::iterator posCacheIt;
@@ -251,7 +261,7 @@ void Hdf5Genome::updateBottomDimensions(const vector<Sequence::UpdateInfo> &bott
     // scan through existing sequences, updating as necessary
     // build summary of all new and unchanged dimensions in newDimensions
     // Note to self: iterating the map in this way skips zero-length
-    // sequences (which are in the separate vector).  This is fine
+    // sequences (which aren't in the position cache).  This is fine
     // here since we will never update them, but seems like it could be
     // dangerous if something were to change
     map<string, hal_size_t>::iterator currentIt;
@@ -327,12 +337,25 @@ hal_size_t Hdf5Genome::getNumSequences() const {
 }
 
 Sequence *Hdf5Genome::getSequence(const string &name) {
-    loadSequenceNameCache();
-    Sequence *sequence = NULL;
     map<string, Hdf5Sequence *>::iterator mapIt = _sequenceNameCache.find(name);
     if (mapIt != _sequenceNameCache.end()) {
-        sequence = mapIt->second;
+        return mapIt->second;
+    }
+    if (_sequenceNameCacheLoaded) {
+        return NULL;
+    }
+    if (_sequenceNameIndexDirty || _sequenceNameIndexArray.getSize() != getNumSequences()) {
+        // no usable index on disk, fall back on reading all the names
+        loadSequenceNameCache();
+        mapIt = _sequenceNameCache.find(name);
+        return mapIt != _sequenceNameCache.end() ? mapIt->second : NULL;
+    }
+    hal_index_t index = findSequenceIndexByName(name);
+    if (index == NULL_INDEX) {
+        return NULL;
     }
+    Hdf5Sequence *sequence = getSequenceByIndex(index);
+    _sequenceNameCache.insert(pair<string, Hdf5Sequence *>(name, sequence));
     return sequence;
 }
 
@@ -345,7 +368,7 @@ Sequence *Hdf5Genome::getSequenceBySite(hal_size_t position) {
     if (numSequences <= maxPosCache) {
         loadSequencePosCache();
     }
-    
+
     // check the cache
     map<hal_size_t, Hdf5Sequence *>::iterator i;
     i = _sequencePosCache.upper_bound(position);
@@ -354,27 +377,22 @@ Sequence *Hdf5Genome::getSequenceBySite(hal_size_t position) {
             return i->second;
         }
     }
-    
+
     // it wasn't in the pos cache.  we dig it out of the array using binary search
     hal_index_t low_idx = 0;
     hal_index_t high_idx = (hal_index_t)numSequences - 1;
-    
+
     while (low_idx <= high_idx) {
         hal_index_t mid_idx = (low_idx + high_idx) / 2;
-        Hdf5Sequence *seq =
-            new Hdf5Sequence(const_cast<Hdf5Genome *>(this), const_cast<Hdf5ExternalArray *>(&_sequenceIdxArray),
-                             const_cast<Hdf5ExternalArray *>(&_sequenceNameArray), mid_idx);
-        if (position >= seq->getStartPosition() && position <= seq->getEndPosition()) {
-            _sequencePosCache[seq->getStartPosition() + seq->getSequenceLength()] = seq;
-            return seq;
+        Hdf5Sequence seq(this, &_sequenceIdxArray, &_sequenceNameArray, mid_idx);
+        if (position >= (hal_size_t)seq.getStartPosition() && position <= (hal_size_t)seq.getEndPosition()) {
+            Hdf5Sequence *sequence = getSequenceByIndex(mid_idx);
+            _sequencePosCache[sequence->getStartPosition() + sequence->getSequenceLength()] = sequence;
+            return sequence;
+        } else if (position < (hal_size_t)seq.getStartPosition()) {
+            high_idx = mid_idx - 1;
         } else {
-            bool less = position < seq->getStartPosition();
-            delete seq;
-            if (less) {
-                high_idx = mid_idx - 1;
-            } else {
-                low_idx = mid_idx + 1;
-            }
+            low_idx = mid_idx + 1;
         }
     }
 
@@ -558,6 +576,9 @@ GappedBottomSegmentIteratorPtr Hdf5Genome::getGappedBottomSegmentIterator(hal_in
 // LOCAL NON-INTERFACE METHODS
 
 void Hdf5Genome::write() {
+    if (_sequenceNameIndexDirty) {
+        writeSequenceNameIndex();
+    }
     _dnaArray.write();
     _topArray.write();
     _bottomArray.write();
@@ -565,6 +586,7 @@ void Hdf5Genome::write() {
     _rup->write();
     _sequenceIdxArray.write();
     _sequenceNameArray.write();
+    _sequenceNameIndexArray.write();
 }
 
 void Hdf5Genome::read() {
@@ -604,6 +626,16 @@ void Hdf5Genome::read() {
         _sequenceNameArray.load(&_group, sequenceNameArrayName, _numChunksInArrayBuffer);
     } catch (H5::Exception &) {
     }
+    try {
+        HDF5DisableExceptionPrinting prDisable;
+        _group.openDataSet(sequenceNameIndexArrayName);
+        _sequenceNameIndexArray.load(&_group, sequenceNameIndexArrayName, _numChunksInArrayBuffer);
+    } catch (H5::Exception &) {
+    }
+    // files written before the name index existed get one when they are
+    // next written (lookups fall back on the name cache until then)
+    _sequenceNameIndexDirty =
+        not _alignment->isReadOnly() && _sequenceNameIndexArray.getSize() != _sequenceNameArray.getSize();
 
     readSequences();
     if (dnaLoaded) {
@@ -616,57 +648,93 @@ void Hdf5Genome::readSequences() {
 }
 
 void Hdf5Genome::deleteSequenceCache() {
-    if (_sequencePosCache.size() > 0 || _zeroLenPosCache.size() > 0) {
-        map<hal_size_t, Hdf5Sequence *>::iterator i;
-        for (i = _sequencePosCache.begin(); i != _sequencePosCache.end(); ++i) {
-            delete i->second;
+    map<hal_size_t, Hdf5Sequence *>::iterator i;
+    for (i = _sequenceIdxCache.begin(); i != _sequenceIdxCache.end(); ++i) {
+        delete i->second;
+    }
+    // the other caches share their pointers with the index cache
+    _sequenceIdxCache.clear();
+    _sequencePosCache.clear();
+    _sequenceNameCache.clear();
+    _sequencePosCacheLoaded = false;
+    _sequenceNameCacheLoaded = false;
+}
+
+Hdf5Sequence *Hdf5Genome::getSequenceByIndex(hal_size_t index) const {
+    assert(index < _sequenceNameArray.getSize());
+    map<hal_size_t, Hdf5Sequence *>::iterator i = _sequenceIdxCache.find(index);
+    if (i != _sequenceIdxCache.end()) {
+        return i->second;
+    }
+    Hdf5Sequence *seq = new Hdf5Sequence(const_cast<Hdf5Genome *>(this), const_cast<Hdf5ExternalArray *>(&_sequenceIdxArray),
+                                         const_cast<Hdf5ExternalArray *>(&_sequenceNameArray), index);
+    _sequenceIdxCache.insert(pair<hal_size_t, Hdf5Sequence *>(index, seq));
+    return seq;
+}
+
+/* binary search of the name index.  Duplicate names resolve to the
+ * lowest sequence index, as they do in the name cache. */
+hal_index_t Hdf5Genome::findSequenceIndexByName(const string &name) const {
+    Hdf5ExternalArray &nameIndex = const_cast<Hdf5ExternalArray &>(_sequenceNameIndexArray);
+    Hdf5ExternalArray &names = const_cast<Hdf5ExternalArray &>(_sequenceNameArray);
+    hal_size_t low = 0;
+    hal_size_t high = nameIndex.getSize();
+    while (low < high) {
+        hal_size_t mid = low + (high - low) / 2;
+        hal_size_t seqIdx = nameIndex.getValue<hal_size_t>(mid, 0);
+        if (strcmp(names.get(seqIdx), name.c_str()) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
-        vector<Hdf5Sequence *>::iterator z;
-        for (z = _zeroLenPosCache.begin(); z != _zeroLenPosCache.end(); ++z) {
-            delete *z;
+    }
+    if (low < nameIndex.getSize()) {
+        hal_size_t seqIdx = nameIndex.getValue<hal_size_t>(low, 0);
+        if (name == names.get(seqIdx)) {
+            return (hal_index_t)seqIdx;
         }
-    } else if (_sequenceNameCache.size() > 0) {
-        map<string, Hdf5Sequence *>::iterator i;
-        for (i = _sequenceNameCache.begin(); i != _sequenceNameCache.end(); ++i) {
-            delete i->second;
+    }
+    return NULL_INDEX;
+}
+
+void Hdf5Genome::writeSequenceNameIndex() {
+    hal_size_t numSequences = _sequenceNameArray.getSize();
+    vector<string> names(numSequences);
+    vector<hal_size_t> order(numSequences);
+    for (hal_size_t i = 0; i < numSequences; ++i) {
+        names[i] = _sequenceNameArray.get(i);
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&names](hal_size_t a, hal_size_t b) { return names[a] < names[b]; });
+
+    try {
+        HDF5DisableExceptionPrinting prDisable;
+        DataSet d = _group.openDataSet(sequenceNameIndexArrayName);
+        _group.unlink(sequenceNameIndexArrayName);
+    } catch (H5::Exception &) {
+    }
+    if (numSequences > 0) {
+        _sequenceNameIndexArray.create(&_group, sequenceNameIndexArrayName, PredType::NATIVE_HSIZE, numSequences, &_dcprops,
+                                       _numChunksInArrayBuffer);
+        for (hal_size_t i = 0; i < numSequences; ++i) {
+            _sequenceNameIndexArray.setValue<hal_size_t>(i, 0, order[i]);
         }
     }
-    _sequencePosCache.clear();
-    _zeroLenPosCache.clear();
-    _sequenceNameCache.clear(); // I share my pointers with above.
+    _sequenceNameIndexDirty = false;
 }
 
 void Hdf5Genome::loadSequencePosCache() const {
-    if (_sequencePosCache.size() > 0 || _zeroLenPosCache.size() > 0) {
+    if (_sequencePosCacheLoaded) {
         return;
     }
     hal_size_t totalReadLen = 0;
     hal_size_t numSequences = _sequenceNameArray.getSize();
-
-    if (_sequenceNameCache.size() > 0) {
-        assert(_sequenceNameCache.size() == numSequences);
-        map<std::string, Hdf5Sequence *>::const_iterator i;
-        for (i = _sequenceNameCache.begin(); i != _sequenceNameCache.end(); ++i) {
-            if (i->second->getSequenceLength() > 0) {
-                _sequencePosCache.insert(pair<hal_size_t, Hdf5Sequence *>(
-                    i->second->getStartPosition() + i->second->getSequenceLength(), i->second));
-                totalReadLen += i->second->getSequenceLength();
-            } else {
-                // FIXME: _zeroLenPosCache.push_back(i->second);
-            }
-        }
-    } else {
-        for (hal_size_t i = 0; i < numSequences; ++i) {
-            Hdf5Sequence *seq =
-                new Hdf5Sequence(const_cast<Hdf5Genome *>(this), const_cast<Hdf5ExternalArray *>(&_sequenceIdxArray),
-                                 const_cast<Hdf5ExternalArray *>(&_sequenceNameArray), i);
-            if (seq->getSequenceLength() > 0) {
-                _sequencePosCache.insert(
-                    pair<hal_size_t, Hdf5Sequence *>(seq->getStartPosition() + seq->getSequenceLength(), seq));
-                totalReadLen += seq->getSequenceLength();
-            } else {
-                // FIXME: _zeroLenPosCache.push_back(seq);
-            }
+    _sequencePosCache.clear();
+    for (hal_size_t i = 0; i < numSequences; ++i) {
+        Hdf5Sequence *seq = getSequenceByIndex(i);
+        if (seq->getSequenceLength() > 0) {
+            _sequencePosCache.insert(pair<hal_size_t, Hdf5Sequence *>(seq->getStartPosition() + seq->getSequenceLength(), seq));
+            totalReadLen += seq->getSequenceLength();
         }
     }
     if (_totalSequenceLength > 0 && totalReadLen != _totalSequenceLength) {
@@ -674,37 +742,20 @@ void Hdf5Genome::loadSequencePosCache() const {
                             " but the (non-zero) DNA array contains " + std::to_string(_totalSequenceLength) +
                             " elements. This is an internal error " + "or the file is corrupt.");
     }
+    _sequencePosCacheLoaded = true;
 }
 
 void Hdf5Genome::loadSequenceNameCache() const {
-    if (_sequenceNameCache.size() > 0) {
+    if (_sequenceNameCacheLoaded) {
         return;
     }
     hal_size_t numSequences = _sequenceNameArray.getSize();
-
-    // load what we can from the pos cache (which can be partial)
-    map<hal_size_t, Hdf5Sequence *>::iterator i;
-    for (i = _sequencePosCache.begin(); i != _sequencePosCache.end(); ++i) {
-        _sequenceNameCache.insert(pair<string, Hdf5Sequence *>(i->second->getName(), i->second));
-    }
-    vector<Hdf5Sequence *>::iterator z;
-    for (z = _zeroLenPosCache.begin(); z != _zeroLenPosCache.end(); ++z) {
-        _sequenceNameCache.insert(pair<string, Hdf5Sequence *>((*z)->getName(), (*z)));
-    }
-    // load everything else
-    if (_sequenceNameCache.size() < numSequences) {        
-        for (hal_size_t i = 0; i < numSequences; ++i) {
-            Hdf5Sequence *seq =
-                new Hdf5Sequence(const_cast<Hdf5Genome *>(this), const_cast<Hdf5ExternalArray *>(&_sequenceIdxArray),
-                                 const_cast<Hdf5ExternalArray *>(&_sequenceNameArray), i);
-            if (!_sequenceNameCache.count(seq->getName())) {
-                _sequenceNameCache.insert(pair<string, Hdf5Sequence *>(seq->getName(), seq));
-            } else {
-                delete seq;
-            }
-        }
+    _sequenceNameCache.clear();
+    for (hal_size_t i = 0; i < numSequences; ++i) {
+        Hdf5Sequence *seq = getSequenceByIndex(i);
+        _sequenceNameCache.insert(pair<string, Hdf5Sequence *>(seq->getName(), seq));
     }
-    assert(_sequenceNameCache.size() == numSequences);
+    _sequenceNameCacheLoaded = true;
 }
 
 void Hdf5Genome::writeSequences(const vector<Sequence::Info> &sequenceDimensions) {
@@ -715,20 +766,60 @@ void Hdf5Genome::writeSequences(const vector<Sequence::Info> &sequenceDimensions
     hal_size_t bottomArrayIndex = 0;
     for (i = sequenceDimensions.begin(); i != sequenceDimensions.end(); ++i) {
         // Copy segment into HDF5 array
-        Hdf5Sequence *seq = new Hdf5Sequence(this, &_sequenceIdxArray, &_sequenceNameArray, i - sequenceDimensions.begin());
+        Hdf5Sequence *seq = getSequenceByIndex(i - sequenceDimensions.begin());
         // write all the Sequence::Info into the hdf5 sequence record
         seq->set(startPosition, *i, topArrayIndex, bottomArrayIndex);
         // Keep the object pointer in our caches
         if (seq->getSequenceLength() > 0) {
             _sequencePosCache.insert(pair<hal_size_t, Hdf5Sequence *>(startPosition + i->_length, seq));
-        } else {
-            // FIXME: _zeroLenPosCache.push_back(seq);
         }
         _sequenceNameCache.insert(pair<string, Hdf5Sequence *>(i->_name, seq));
         startPosition += i->_length;
         topArrayIndex += i->_numTopSegments;
         bottomArrayIndex += i->_numBottomSegments;
     }
+    _sequencePosCacheLoaded = true;
+    _sequenceNameCacheLoaded = true;
+    writeSequenceNameIndex();
+}
+
+shared_ptr<hal_size_t> Hdf5Genome::holdSegment() const {
+    touch();
+    ++*_segmentHolds;
+    return _segmentHolds;
+}
+
+void Hdf5Genome::touch() const {
+    _lastUse = _alignment->nextGenomeUse();
+    if (_released) {
+        _released = false;
+        _alignment->enforceGenomeCacheBudget(this);
+    }
+}
+
+hal_size_t Hdf5Genome::getLoadedBytes(hal_size_t datasetCacheBytes) const {
+    const Hdf5ExternalArray *arrays[] = {&_dnaArray,         &_topArray,          &_bottomArray,
+                                         &_sequenceIdxArray, &_sequenceNameArray, &_sequenceNameIndexArray};
+    hal_size_t bytes = 0;
+    for (const Hdf5ExternalArray *array : arrays) {
+        if (array->isLoaded()) {
+            bytes += array->getBufferBytes() + datasetCacheBytes;
+        }
+    }
+    return bytes;
+}
+
+void Hdf5Genome::releaseArrays() {
+    if (_dnaAccess) {
+        static_cast<HDF5DnaAccess *>(_dnaAccess.get())->release();
+    }
+    _dnaArray.release();
+    _topArray.release();
+    _bottomArray.release();
+    _sequenceIdxArray.release();
+    _sequenceNameArray.release();
+    _sequenceNameIndexArray.release();
+    _released = true;
 }
 
 void Hdf5Genome::resetBranchCaches() {
@@ -753,6 +844,9 @@ void Hdf5Genome::renameSequence(const string &oldName, size_t index, const strin
     char *arrayBuffer = _sequenceNameArray.getUpdate(index);
     strcpy(arrayBuffer, newName.c_str());
     _sequenceNameArray.write();
+    // the name index is rebuilt once when the genome is written, not
+    // after each rename
+    _sequenceNameIndexDirty = true;
     readSequences();
 }
 
@@ -123,10 +123,40 @@ namespace hal {
         void resetBranchCaches();
         void renameSequence(const std::string &oldName, size_t index, const std::string &newName);
 
+        /* Register a live segment on this genome.  The count is shared
+         * with the segment so it can be released after the genome is
+         * closed.  The alignment's genome cache doesn't release the arrays
+         * of a genome with live segments. */
+        std::shared_ptr<hal_size_t> holdSegment() const;
+        bool isHeld() const {
+            return *_segmentHolds > 0;
+        }
+
+        /* Mark the genome as most recently used, reloading it into the
+         * alignment's genome cache if its arrays were released */
+        void touch() const;
+        hal_size_t getLastUse() const {
+            return _lastUse;
+        }
+
+        /* Bytes of memory held by the open arrays, counting
+         * datasetCacheBytes for the HDF5 chunk cache of each */
+        hal_size_t getLoadedBytes(hal_size_t datasetCacheBytes) const;
+
+        /* Write and free all array buffers and close their datasets.  The
+         * genome stays valid; arrays are reopened when next accessed. */
+        void releaseArrays();
+        bool isReleased() const {
+            return _released;
+        }
+
       private:
         void readSequences();
         void writeSequences(const std::vector<hal::Sequence::Info> &sequenceDimensions);
         void deleteSequenceCache();
+        Hdf5Sequence *getSequenceByIndex(hal_size_t index) const;
+        hal_index_t findSequenceIndexByName(const std::string &name) const;
+        void writeSequenceNameIndex();
         void loadSequencePosCache() const;
         void loadSequenceNameCache() const;
         void setGenomeTopDimensions(const std::vector<hal::Sequence::UpdateInfo> &sequenceDimensions);
@@ -146,6 +176,10 @@ namespace hal {
         Hdf5ExternalArray _bottomArray;
         Hdf5ExternalArray _sequenceIdxArray;
         Hdf5ExternalArray _sequenceNameArray;
+        // sequence indexes sorted by name, so names can be found by binary
+        // search without reading the whole name array.  Absent in older files.
+        Hdf5ExternalArray _sequenceNameIndexArray;
+        bool _sequenceNameIndexDirty;
 
         // FIXME: every DNAIteratorPtr uses the same DNAAccess. This causes
         // thrashing when multiple DNAIterators are used concurrently
@@ -157,15 +191,25 @@ namespace hal {
         hal_size_t _totalSequenceLength;
         hal_size_t _numChunksInArrayBuffer;
 
+        // sequences are created on demand and owned by _sequenceIdxCache.
+        // the position and name caches share its pointers and are only
+        // complete once the corresponding loaded flag is set.
+        mutable std::map<hal_size_t, Hdf5Sequence *> _sequenceIdxCache;
         mutable std::map<hal_size_t, Hdf5Sequence *> _sequencePosCache;
-        mutable std::vector<Hdf5Sequence *> _zeroLenPosCache;
         mutable std::map<std::string, Hdf5Sequence *> _sequenceNameCache;
+        mutable bool _sequencePosCacheLoaded;
+        mutable bool _sequenceNameCacheLoaded;
+
+        std::shared_ptr<hal_size_t> _segmentHolds;
+        mutable hal_size_t _lastUse;
+        mutable bool _released;
 
         static const std::string dnaArrayName;
         static const std::string topArrayName;
         static const std::string bottomArrayName;
         static const std::string sequenceIdxArrayName;
         static const std::string sequenceNameArrayName;
+        static const std::string sequenceNameIndexArrayName;
         static const std::string metaGroupName;
         static const std::string rupGroupName;
         static const hal_size_t maxPosCache;
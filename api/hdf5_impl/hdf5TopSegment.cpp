@@ -25,6 +25,15 @@ const size_t Hdf5TopSegment::totalSize = parentReversedOffset + sizeof(bool);
 
 Hdf5TopSegment::Hdf5TopSegment(Hdf5Genome *genome, Hdf5ExternalArray *array, hal_index_t index)
     : TopSegment(genome, index), _array(array) {
+    if (genome != NULL) {
+        _genomeHolds = genome->holdSegment();
+    }
+}
+
+Hdf5TopSegment::~Hdf5TopSegment() {
+    if (_genomeHolds) {
+        --*_genomeHolds;
+    }
 }
 
 void Hdf5TopSegment::setCoordinates(hal_index_t startPos, hal_size_t length) {
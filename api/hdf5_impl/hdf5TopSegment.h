@@ -23,6 +23,8 @@ namespace hal {
          * @param index Index of segment in the array */
         Hdf5TopSegment(Hdf5Genome *genome, Hdf5ExternalArray *array, hal_index_t index);
 
+        ~Hdf5TopSegment();
+
         // SEGMENT INTERFACE
         void setArrayIndex(Genome *genome, hal_index_t arrayIndex);
         const Sequence *getSequence() const;
@@ -68,13 +70,21 @@ namespace hal {
         static const size_t totalSize;
 
         Hdf5ExternalArray *_array;
+        std::shared_ptr<hal_size_t> _genomeHolds;
     };
 
     // INLINE members
     inline void Hdf5TopSegment::setArrayIndex(Genome *genome, hal_index_t arrayIndex) {
-        _genome = dynamic_cast<Hdf5Genome *>(genome);
-        assert(_genome != NULL);
-        _array = &dynamic_cast<Hdf5Genome *>(_genome)->_topArray;
+        if (genome != _genome) {
+            Hdf5Genome *h5Genome = dynamic_cast<Hdf5Genome *>(genome);
+            assert(h5Genome != NULL);
+            if (_genomeHolds) {
+                --*_genomeHolds;
+            }
+            _genomeHolds = h5Genome->holdSegment();
+            _genome = h5Genome;
+            _array = &h5Genome->_topArray;
+        }
         assert(arrayIndex < (hal_index_t)_array->getSize());
         _index = arrayIndex;
     }
@@ -131,10 +131,47 @@ void hdf5ExternalArrayTestCompression(CuTest *testCase) {
     }
 }
 
+void hdf5ExternalArrayTestRelease(CuTest *testCase) {
+    for (hsize_t chunkIdx = 0; chunkIdx < numSizes; ++chunkIdx) {
+        hsize_t chunkSize = chunkSizes[chunkIdx];
+        setup();
+        try {
+            IntType datatype(PredType::NATIVE_HSIZE);
+            H5File file(H5std_string(fileName), H5F_ACC_TRUNC);
+            Hdf5ExternalArray myArray;
+            DSetCreatPropList cparms;
+            if (chunkSize > 0) {
+                cparms.setChunk(1, &chunkSize);
+            }
+            myArray.create(&file, datasetName, datatype, N, &cparms);
+            // unwritten changes must survive the release
+            for (hsize_t i = 0; i < N; ++i) {
+                hsize_t *block = reinterpret_cast<hsize_t *>(myArray.getUpdate(i));
+                *block = i;
+            }
+            myArray.release();
+            CuAssertTrue(testCase, !myArray.isLoaded());
+            CuAssertTrue(testCase, myArray.getBufferBytes() == 0);
+            for (hsize_t i = 0; i < N; ++i) {
+                const int64_t *val = reinterpret_cast<const int64_t *>(myArray.get(N - 1 - i));
+                CuAssertTrue(testCase, *val == numbers[N - 1 - i]);
+            }
+            CuAssertTrue(testCase, myArray.isLoaded());
+        } catch (Exception &exception) {
+            cerr << exception.getCDetailMsg() << endl;
+            CuAssertTrue(testCase, 0);
+        } catch (...) {
+            CuAssertTrue(testCase, 0);
+        }
+        teardown();
+    }
+}
+
 CuSuite *hdf5ExternalArrayTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, hdf5ExternalArrayTestCreate);
     SUITE_ADD_TEST(suite, hdf5ExternalArrayTestLoad);
     SUITE_ADD_TEST(suite, hdf5ExternalArrayTestCompression);
+    SUITE_ADD_TEST(suite, hdf5ExternalArrayTestRelease);
     return suite;
 }
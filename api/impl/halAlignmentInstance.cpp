@@ -163,3 +163,65 @@ AlignmentPtr hal::openHalAlignment(const std::string &path, const CLParser *opti
                             STORAGE_FORMAT_MMAP);
     }
 }
+
+/* get the mmap implementation of an alignment that must have embedded levels
+ * of detail */
+static MMapAlignment *getLodContainer(const Alignment *alignment) {
+    const MMapAlignment *mmapAlignment = dynamic_cast<const MMapAlignment *>(alignment);
+    if (mmapAlignment == NULL) {
+        throw hal_exception("embedded levels of detail require " + STORAGE_FORMAT_MMAP + " storage format, not " +
+                            alignment->getStorageFormat());
+    }
+    return const_cast<MMapAlignment *>(mmapAlignment);
+}
+
+std::map<hal_size_t, size_t> hal::getEmbeddedLodLevels(AlignmentConstPtr alignment, hal_size_t &outMaxLodLowerBound) {
+    outMaxLodLowerBound = 0;
+    if (alignment->getStorageFormat() != STORAGE_FORMAT_MMAP) {
+        return std::map<hal_size_t, size_t>();
+    }
+    return getLodContainer(alignment.get())->getLodLevels(outMaxLodLowerBound);
+}
+
+AlignmentConstPtr hal::openEmbeddedLodLevel(AlignmentConstPtr alignment, size_t offset) {
+    MMapAlignment *level = new MMapAlignment(getLodContainer(alignment.get()), offset);
+    // the level holds a reference to the full alignment, whose file it uses
+    return AlignmentConstPtr(level, [alignment](const Alignment *level) { delete level; });
+}
+
+void hal::embedLodLevel(AlignmentPtr alignment, AlignmentConstPtr level, hal_size_t minQueryLength) {
+    getLodContainer(alignment.get())->addLodLevel(level.get(), minQueryLength);
+}
+
+void hal::setEmbeddedLodLimit(AlignmentPtr alignment, hal_size_t maxLodLowerBound) {
+    getLodContainer(alignment.get())->setLodLimit(maxLodLowerBound);
+}
+
+void hal::compactHalAlignment(AlignmentConstPtr alignment, const std::string &outPath) {
+    const MMapAlignment *source = dynamic_cast<const MMapAlignment *>(alignment.get());
+    if (source == NULL) {
+        throw hal_exception("compacting requires " + STORAGE_FORMAT_MMAP + " storage format, not " +
+                            alignment->getStorageFormat() + "; halExtract copies other formats");
+    }
+    // the copy takes no more than the source uses, and the file is cut
+    // down to what was used when it's closed
+    MMapAlignment compacted(outPath, READ_ACCESS | WRITE_ACCESS | CREATE_ACCESS, source->getUsedFileSize() + GIGABYTE);
+    compacted.copyCompacted(source);
+    compacted.close();
+}
+
+std::vector<AlignmentConstPtr> hal::openHalAlignmentPerThread(AlignmentConstPtr alignment, const std::string &path,
+                                                              const CLParser *options, hal_size_t numThreads) {
+    std::vector<AlignmentConstPtr> alignments(1, alignment);
+    if (alignment->getStorageFormat() == STORAGE_FORMAT_HDF5) {
+        hbool_t threadSafe = false;
+        H5is_library_threadsafe(&threadSafe);
+        if (!threadSafe) {
+            return alignments;
+        }
+    }
+    while (alignments.size() < numThreads) {
+        alignments.push_back(openHalAlignment(path, options, READ_ACCESS, alignment->getStorageFormat()));
+    }
+    return alignments;
+}
@@ -7,10 +7,13 @@
 #include "halCommon.h"
 #include "halAlignment.h"
 #include "halGenome.h"
+#include <algorithm>
 #include <cassert>
+#include <exception>
 #include <map>
 #include <sstream>
 #include <sys/stat.h>
+#include <thread>
 
 using namespace std;
 using namespace hal;
@@ -220,6 +223,30 @@ size_t hal::getFileStatSize(int fd) {
     return fileStat.st_size;
 }
 
+void hal::runThreads(hal_size_t numThreads, const std::function<void(hal_size_t)> &fn) {
+    vector<exception_ptr> errors(max(numThreads, hal_size_t(1)));
+    auto runOne = [&fn, &errors](hal_size_t threadNum) {
+        try {
+            fn(threadNum);
+        } catch (...) {
+            errors[threadNum] = current_exception();
+        }
+    };
+    vector<thread> threads;
+    for (hal_size_t i = 1; i < numThreads; ++i) {
+        threads.push_back(thread(runOne, i));
+    }
+    runOne(0);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    for (size_t i = 0; i < errors.size(); ++i) {
+        if (errors[i]) {
+            rethrow_exception(errors[i]);
+        }
+    }
+}
+
 /* map of character to encoding for both upper and lower case */
 const uint8_t hal::dnaPackMap[256] = {
     4, 4, 4, 4, 4,  4, 4, 4, 4, 4, 4,  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,  4, 4,
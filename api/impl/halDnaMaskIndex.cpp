@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halDnaMaskIndex.h"
+#include "halCommon.h"
+#include "halGenome.h"
+#include <algorithm>
+#include <string>
+
+using namespace std;
+using namespace hal;
+
+// DNA is read a chunk at a time rather than through a DnaIterator
+static const hal_size_t ChunkSize = 1 << 20;
+
+DnaMaskIndex::DnaMaskIndex(const Genome *genome) {
+    hal_size_t length = genome->getSequenceLength();
+    string chunk;
+    for (hal_size_t chunkStart = 0; chunkStart < length; chunkStart += ChunkSize) {
+        genome->getSubString(chunk, chunkStart, min(ChunkSize, length - chunkStart));
+        for (size_t i = 0; i < chunk.length(); ++i) {
+            char c = chunk[i];
+            if (isMasked(c)) {
+                addBase(_maskedRuns, chunkStart + i);
+            }
+            if (isMissingData(c)) {
+                addBase(_missingRuns, chunkStart + i);
+            }
+        }
+    }
+    _maskedRuns.shrink_to_fit();
+    _missingRuns.shrink_to_fit();
+    indexRuns(_maskedRuns, _maskedBefore);
+    indexRuns(_missingRuns, _missingBefore);
+}
+
+void DnaMaskIndex::addBase(RunVector &runs, hal_index_t pos) {
+    if (!runs.empty() && runs.back()._end == pos) {
+        ++runs.back()._end;
+    } else {
+        Run run = {pos, pos + 1};
+        runs.push_back(run);
+    }
+}
+
+void DnaMaskIndex::indexRuns(const RunVector &runs, vector<hal_size_t> &before) {
+    before.resize(runs.size() + 1);
+    before[0] = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        before[i + 1] = before[i] + (runs[i]._end - runs[i]._start);
+    }
+}
+
+hal_size_t DnaMaskIndex::countBases(const RunVector &runs, const vector<hal_size_t> &before, hal_index_t start,
+                                    hal_size_t length) {
+    hal_index_t end = start + (hal_index_t)length;
+    // runs are disjoint, so sorted by both start and end
+    RunVector::const_iterator first =
+        upper_bound(runs.begin(), runs.end(), start, [](hal_index_t pos, const Run &run) { return pos < run._end; });
+    RunVector::const_iterator last =
+        lower_bound(first, runs.end(), end, [](const Run &run, hal_index_t pos) { return run._start < pos; });
+    if (first == last) {
+        return 0;
+    }
+    hal_size_t count = before[last - runs.begin()] - before[first - runs.begin()];
+    count -= max(start, first->_start) - first->_start;
+    count -= (last - 1)->_end - min(end, (last - 1)->_end);
+    return count;
+}
+
+void DnaMaskIndex::getRuns(const RunVector &runs, hal_index_t start, hal_index_t end, RunVector &outRuns) {
+    outRuns.clear();
+    RunVector::const_iterator i =
+        upper_bound(runs.begin(), runs.end(), start, [](hal_index_t pos, const Run &run) { return pos < run._end; });
+    for (; i != runs.end() && i->_start < end; ++i) {
+        Run run = {max(start, i->_start), min(end, i->_end)};
+        outRuns.push_back(run);
+    }
+}
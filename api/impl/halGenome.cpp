@@ -12,6 +12,13 @@
 using namespace std;
 using namespace hal;
 
+const DnaMaskIndex *hal::Genome::getDnaMaskIndex() const {
+    if (_dnaMaskIndex.get() == NULL && getAlignment()->isReadOnly() && containsDNAArray()) {
+        _dnaMaskIndex.reset(new DnaMaskIndex(this));
+    }
+    return _dnaMaskIndex.get();
+}
+
 void hal::Genome::copy(Genome *dest) const {
     copyDimensions(dest);
     copySequence(dest);
@@ -11,9 +11,13 @@
 using namespace hal;
 
 bool Segment::isMissingData(double nThreshold) const {
-    DnaIteratorPtr dnaIt(getGenome()->getDnaIterator(getStartPosition()));
     size_t length = getLength();
     size_t maxNs = nThreshold * (double)length;
+    const DnaMaskIndex *maskIndex = getGenome()->getDnaMaskIndex();
+    if (maskIndex != NULL) {
+        return maskIndex->getNumMissing(getStartPosition(), length) > maxNs;
+    }
+    DnaIteratorPtr dnaIt(getGenome()->getDnaIterator(getStartPosition()));
     size_t Ns = 0;
     char c;
     for (size_t i = 0; i < length; ++i, dnaIt->toRight()) {
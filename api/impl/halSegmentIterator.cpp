@@ -6,6 +6,7 @@
  */
 #include "halSegmentIterator.h"
 #include "halCommon.h"
+#include "halDnaIterator.h"
 #include "halGenome.h"
 #include "halMappedSegment.h"
 #include <algorithm>
@@ -75,6 +76,18 @@ void SegmentIterator::getString(std::string &outString) const {
     outString = outString.substr(_startOffset, getLength());
 }
 
+void SegmentIterator::compareBases(const SegmentIterator &other, BaseComparison &counts) const {
+    assert(inRange() && other.inRange());
+    if (getLength() != other.getLength()) {
+        throw hal_exception("SegmentIterator::compareBases: segments have different lengths");
+    }
+    DnaIteratorPtr dnaIt(getGenome()->getDnaIterator(getStartPosition()));
+    dnaIt->setReversed(_reversed);
+    DnaIteratorPtr otherDnaIt(other.getGenome()->getDnaIterator(other.getStartPosition()));
+    otherDnaIt->setReversed(other._reversed);
+    dnaIt->compareBases(*otherDnaIt, getLength(), counts);
+}
+
 void SegmentIterator::setCoordinates(hal_index_t startPos, hal_size_t length) {
     getSegment()->setCoordinates(startPos, length);
 }
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halTextWriter.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+using namespace hal;
+
+const size_t TextWriter::DefaultBufferSize;
+
+/* the two digit strings for 00 to 99, so numbers are formatted two digits
+ * per division */
+static const char digitPairs[] = "00010203040506070809"
+                                 "10111213141516171819"
+                                 "20212223242526272829"
+                                 "30313233343536373839"
+                                 "40414243444546474849"
+                                 "50515253545556575859"
+                                 "60616263646566676869"
+                                 "70717273747576777879"
+                                 "80818283848586878889"
+                                 "90919293949596979899";
+
+TextWriter::TextWriter(ostream &os, bool backgroundFlush, size_t bufferSize)
+    : _os(os), _backgroundFlush(backgroundFlush), _current(0) {
+    // room for the longest formatted number
+    bufferSize = max(bufferSize, size_t(64));
+    _buffers[0].resize(bufferSize);
+    if (_backgroundFlush) {
+        _buffers[1].resize(bufferSize);
+    }
+    _pos = _buffers[0].data();
+    _end = _pos + bufferSize;
+}
+
+TextWriter::~TextWriter() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+TextWriter &TextWriter::operator<<(double value) {
+    char number[32];
+    int length = snprintf(number, sizeof(number), "%g", value);
+    write(number, length);
+    return *this;
+}
+
+void TextWriter::flush() {
+    writeBuffered();
+    _os.flush();
+    if (!_os) {
+        throw hal_exception("error writing output");
+    }
+}
+
+void TextWriter::writeBuffered() {
+    writeBuffer();
+    waitForWrite();
+}
+
+char *TextWriter::formatDigits(hal_size_t value, char *last) {
+    char *pos = last;
+    while (value >= 100) {
+        const char *pair = digitPairs + 2 * (value % 100);
+        value /= 100;
+        *--pos = pair[1];
+        *--pos = pair[0];
+    }
+    if (value >= 10) {
+        const char *pair = digitPairs + 2 * value;
+        *--pos = pair[1];
+        *--pos = pair[0];
+    } else {
+        *--pos = char('0' + value);
+    }
+    return pos;
+}
+
+/* text that doesn't fit in what is left of the buffer */
+void TextWriter::writeLong(const char *data, size_t length) {
+    while (length > 0) {
+        if (_pos == _end) {
+            writeBuffer();
+        }
+        size_t chunk = min(length, size_t(_end - _pos));
+        memcpy(_pos, data, chunk);
+        _pos += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+/* hand the current buffer to the stream, on another thread if background
+ * flushing, and start filling the other one */
+void TextWriter::writeBuffer() {
+    vector<char> &buffer = _buffers[_current];
+    size_t length = _pos - buffer.data();
+    if (length > 0) {
+        if (_backgroundFlush) {
+            // the other buffer is reused once its write is done
+            waitForWrite();
+            _pending = async(launch::async, [this, &buffer, length]() {
+                if (!_os.write(buffer.data(), length)) {
+                    throw hal_exception("error writing output");
+                }
+            });
+            _current = 1 - _current;
+        } else if (!_os.write(buffer.data(), length)) {
+            throw hal_exception("error writing output");
+        }
+    }
+    _pos = _buffers[_current].data();
+    _end = _pos + _buffers[_current].size();
+}
+
+void TextWriter::waitForWrite() {
+    if (_pending.valid()) {
+        _pending.get();
+    }
+}
+
+// Local Variables:
+// mode: c++
+// End:
@@ -13,9 +13,12 @@
 #include "halSequenceIterator.h"
 #include "halTopSegment.h"
 #include "halTopSegmentIterator.h"
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <deque>
 #include <iostream>
+#include <numeric>
 #include <vector>
 
 using namespace std;
@@ -251,56 +254,441 @@ void hal::validateDuplications(const Genome *genome) {
 }
 
 void hal::validateGenome(const Genome *genome) {
-    // first we check the sequence coverage
-    hal_size_t totalTop = 0;
-    hal_size_t totalBottom = 0;
-    hal_size_t totalLength = 0;
+    GenomeValidation validation = checkGenome(genome, 1);
+    if (!validation._violations.empty()) {
+        throw hal_exception(validation._violations[0]);
+    }
+}
 
-    for (SequenceIteratorPtr seqIt = genome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
-        const Sequence *sequence = seqIt->getSequence();
-        validateSequence(sequence);
+namespace {
+    /* top segment array of a genome, read with one pass of an iterator */
+    struct TopArrays {
+        vector<hal_index_t> _starts;
+        vector<hal_size_t> _lengths;
+        vector<hal_index_t> _parents;
+        vector<char> _reversed;
+        vector<hal_index_t> _parseIndices;
+        vector<hal_index_t> _paralogies;
+    };
 
-        totalTop += sequence->getNumTopSegments();
-        totalBottom += sequence->getNumBottomSegments();
-        totalLength += sequence->getSequenceLength();
+    /* bottom segment array of a genome, with the links to child i of
+     * segment j at j * _numChildren + i */
+    struct BottomArrays {
+        hal_size_t _numChildren;
+        vector<hal_index_t> _starts;
+        vector<hal_size_t> _lengths;
+        vector<hal_index_t> _children;
+        vector<char> _reversed;
+        vector<hal_index_t> _parseIndices;
+    };
 
-        // make sure it doesn't overlap any other sequences;
-        if (sequence->getSequenceLength() > 0) {
-            const Sequence *s1 = genome->getSequenceBySite(sequence->getStartPosition());
+    void readTopArrays(const Genome *genome, TopArrays &arrays) {
+        hal_size_t numSegments = genome->getNumTopSegments();
+        arrays._starts.resize(numSegments);
+        arrays._lengths.resize(numSegments);
+        arrays._parents.resize(numSegments);
+        arrays._reversed.resize(numSegments);
+        arrays._parseIndices.resize(numSegments);
+        arrays._paralogies.resize(numSegments);
+        if (numSegments == 0) {
+            return;
+        }
+        TopSegmentIteratorPtr topIt = genome->getTopSegmentIterator();
+        for (hal_size_t i = 0; i < numSegments; ++i, topIt->toRight()) {
+            const TopSegment *topSegment = topIt->getTopSegment();
+            arrays._starts[i] = topSegment->getStartPosition();
+            arrays._lengths[i] = topSegment->getLength();
+            arrays._parents[i] = topSegment->getParentIndex();
+            arrays._reversed[i] = topSegment->getParentReversed();
+            arrays._parseIndices[i] = topSegment->getBottomParseIndex();
+            arrays._paralogies[i] = topSegment->getNextParalogyIndex();
+        }
+    }
 
-            if (s1 == NULL || s1->getName() != sequence->getName()) {
-                throw hal_exception("Sequence " + sequence->getName() + " has a bad overlap in " + genome->getName());
+    void readBottomArrays(const Genome *genome, BottomArrays &arrays, bool withLinks) {
+        hal_size_t numSegments = genome->getNumBottomSegments();
+        arrays._numChildren = genome->getNumChildren();
+        arrays._starts.resize(numSegments);
+        arrays._lengths.resize(numSegments);
+        if (withLinks) {
+            arrays._children.resize(numSegments * arrays._numChildren);
+            arrays._reversed.resize(numSegments * arrays._numChildren);
+            arrays._parseIndices.resize(numSegments);
+        }
+        if (numSegments == 0) {
+            return;
+        }
+        BottomSegmentIteratorPtr bottomIt = genome->getBottomSegmentIterator();
+        for (hal_size_t i = 0; i < numSegments; ++i, bottomIt->toRight()) {
+            const BottomSegment *bottomSegment = bottomIt->getBottomSegment();
+            arrays._starts[i] = bottomSegment->getStartPosition();
+            arrays._lengths[i] = bottomSegment->getLength();
+            if (withLinks) {
+                for (hal_size_t child = 0; child < arrays._numChildren; ++child) {
+                    arrays._children[i * arrays._numChildren + child] = bottomSegment->getChildIndex(child);
+                    arrays._reversed[i * arrays._numChildren + child] = bottomSegment->getChildReversed(child);
+                }
+                arrays._parseIndices[i] = bottomSegment->getTopParseIndex();
             }
-            const Sequence *s2 = genome->getSequenceBySite(sequence->getStartPosition() + sequence->getSequenceLength() - 1);
-            if (s2 == NULL || s2->getName() != sequence->getName()) {
-                throw hal_exception("Sequence " + sequence->getName() + " has a bad overlap in " + genome->getName());
+        }
+    }
+
+    /* Checks of validateGenome() and the functions it calls, made as passes
+     * over whole segment arrays.  Links are checked by indexing the arrays
+     * they point into instead of opening an iterator for each. */
+    class GenomeChecker {
+      public:
+        GenomeChecker(const Genome *genome, hal_size_t maxViolations, vector<string> &violations)
+            : _genome(genome), _maxViolations(max(maxViolations, (hal_size_t)1)), _violations(violations) {
+        }
+
+        void check();
+
+      private:
+        bool full() const {
+            return _violations.size() >= _maxViolations;
+        }
+        void add(const string &violation) {
+            if (!full()) {
+                _violations.push_back(violation);
+            }
+        }
+        static string name(const Genome *genome, hal_index_t index) {
+            return genome->getName() + "[" + std::to_string(index) + "]";
+        }
+
+        void checkDna();
+        void checkTopSegments();
+        void checkBottomSegments();
+        void checkChild(hal_size_t child);
+        void checkSequences();
+        void checkDuplications();
+
+        const Genome *_genome;
+        hal_size_t _maxViolations;
+        vector<string> &_violations;
+        TopArrays _top;
+        BottomArrays _bottom;
+    };
+
+    void GenomeChecker::check() {
+        readTopArrays(_genome, _top);
+        readBottomArrays(_genome, _bottom, true);
+        checkDna();
+        if (!full()) {
+            checkTopSegments();
+        }
+        if (!full()) {
+            checkBottomSegments();
+        }
+        for (hal_size_t child = 0; child < _bottom._numChildren && !full(); ++child) {
+            checkChild(child);
+        }
+        if (!full()) {
+            checkSequences();
+        }
+        if (!full()) {
+            checkDuplications();
+        }
+    }
+
+    void GenomeChecker::checkDna() {
+        hal_size_t length = _genome->getSequenceLength();
+        if (!_genome->containsDNAArray() || length == 0) {
+            return;
+        }
+        DnaIteratorPtr dnaIt = _genome->getDnaIterator(0);
+        for (hal_size_t position = 0; !full();) {
+            position += dnaIt->findNonNucleotide(length - position);
+            if (position >= length) {
+                break;
             }
+            dnaIt->jumpTo(position);
+            const Sequence *sequence = _genome->getSequenceBySite(position);
+            add("Non-nucleotide character discoverd at position " +
+                std::to_string(position - sequence->getStartPosition()) + " of sequence " + sequence->getName() + ": " +
+                dnaIt->getBase());
+            dnaIt->jumpTo(++position);
         }
     }
 
-    hal_size_t genomeLength = genome->getSequenceLength();
-    hal_size_t genomeTop = genome->getNumTopSegments();
-    hal_size_t genomeBottom = genome->getNumBottomSegments();
+    void GenomeChecker::checkTopSegments() {
+        const Genome *parentGenome = _genome->getParent();
+        if (parentGenome == NULL) {
+            // top segments are only checked in the context of sequences
+            // that have them, as in validateSequence()
+            return;
+        }
+        BottomArrays parent;
+        readBottomArrays(parentGenome, parent, false);
+        hal_index_t numTop = _top._starts.size();
+        hal_index_t numBottom = _bottom._starts.size();
+        hal_index_t numParent = parent._starts.size();
+        for (hal_index_t i = 0; i < numTop && !full(); ++i) {
+            if (_top._lengths[i] < 1) {
+                add("Top segment " + std::to_string(i) + " in genome " + _genome->getName() +
+                    " has length 0 which is not currently supported");
+            }
+            if (i > 0 && _top._starts[i] <= _top._starts[i - 1]) {
+                add("Top segment " + std::to_string(i) + " in genome " + _genome->getName() + " starts at " +
+                    std::to_string(_top._starts[i]) + ", not after the previous segment");
+            }
 
-    if (genomeLength != totalLength) {
-        throw hal_exception("Problem: genome has length " + std::to_string(genomeLength) + ", however sequences total " +
-                            std::to_string(totalLength));
+            hal_index_t parentIndex = _top._parents[i];
+            if (parentIndex != NULL_INDEX) {
+                if (parentIndex < 0 || parentIndex >= numParent) {
+                    add("Parent index " + std::to_string(parentIndex) + " of segment " + std::to_string(i) +
+                        " out of range in genome " + parentGenome->getName());
+                } else if (_top._lengths[i] != parent._lengths[parentIndex]) {
+                    add("Parent length of segment " + std::to_string(i) + " in genome " + _genome->getName() +
+                        " has length " + std::to_string(parent._lengths[parentIndex]) + " which does not match " +
+                        std::to_string(_top._lengths[i]));
+                }
+            }
+
+            hal_index_t parseIndex = _top._parseIndices[i];
+            if (parseIndex == NULL_INDEX) {
+                if (_genome->getNumChildren() != 0) {
+                    add("Top Segment " + std::to_string(i) + " in genome " + _genome->getName() + " has null parse index");
+                }
+            } else if (parseIndex < 0 || parseIndex >= numBottom) {
+                add("Top Segment " + std::to_string(i) + " in genome " + _genome->getName() + " has parse index " +
+                    std::to_string(parseIndex) + " which is out of range since genome has " +
+                    std::to_string(numBottom) + " bottom segments");
+            } else if (_top._starts[i] < _bottom._starts[parseIndex] ||
+                       _top._starts[i] >= _bottom._starts[parseIndex] + (hal_index_t)_bottom._lengths[parseIndex]) {
+                add("parse index broken in top segment in genome " + _genome->getName());
+            }
+
+            hal_index_t paralogyIndex = _top._paralogies[i];
+            if (paralogyIndex != NULL_INDEX) {
+                if (paralogyIndex < 0 || paralogyIndex >= numTop) {
+                    add("Top segment " + std::to_string(i) + " has paralogy index " + std::to_string(paralogyIndex) +
+                        " out of range in genome " + _genome->getName());
+                } else if (paralogyIndex == i) {
+                    add("Top segment " + std::to_string(i) + " has paralogy index " + std::to_string(paralogyIndex) +
+                        " which isn't allowed");
+                } else if (_top._parents[paralogyIndex] != parentIndex) {
+                    add("Top segment " + std::to_string(i) + " has parent index " + std::to_string(parentIndex) +
+                        ", but next paraglog " + std::to_string(paralogyIndex) + " has parent Index " +
+                        std::to_string(_top._parents[paralogyIndex]) +
+                        ". Paralogous top segments must share same parent.");
+                }
+            }
+        }
     }
-    if (genomeTop != totalTop) {
-        throw hal_exception("Problem: genome has " + std::to_string(genomeTop) + " top segments but " + "sequences have " +
-                            std::to_string(totalTop) + " top segments");
+
+    void GenomeChecker::checkBottomSegments() {
+        if (_genome->getNumChildren() == 0) {
+            return;
+        }
+        hal_index_t numTop = _top._starts.size();
+        hal_index_t numBottom = _bottom._starts.size();
+        for (hal_index_t i = 0; i < numBottom && !full(); ++i) {
+            if (_bottom._lengths[i] < 1) {
+                add("Bottom segment " + std::to_string(i) + " in genome " + _genome->getName() +
+                    " has length 0 which is not currently supported");
+            }
+            if (i > 0 && _bottom._starts[i] <= _bottom._starts[i - 1]) {
+                add("Bottom segment " + std::to_string(i) + " in genome " + _genome->getName() + " starts at " +
+                    std::to_string(_bottom._starts[i]) + ", not after the previous segment");
+            }
+
+            hal_index_t parseIndex = _bottom._parseIndices[i];
+            if (parseIndex == NULL_INDEX) {
+                if (_genome->getParent() != NULL) {
+                    add("Bottom segment " + std::to_string(i) + " in genome " + _genome->getName() +
+                        " has null parse index");
+                }
+            } else if (parseIndex < 0 || parseIndex >= numTop) {
+                add("BottomSegment " + std::to_string(i) + " in genome " + _genome->getName() + " has parse index " +
+                    std::to_string(parseIndex) + " greater than the number of top segments, " + std::to_string(numTop));
+            } else if (_bottom._starts[i] < _top._starts[parseIndex] ||
+                       _bottom._starts[i] >= _top._starts[parseIndex] + (hal_index_t)_top._lengths[parseIndex]) {
+                add("parse index broken in bottom segment in genome " + _genome->getName());
+            }
+        }
     }
-    if (genomeBottom != totalBottom) {
-        throw hal_exception("Problem: genome has " + std::to_string(genomeBottom) + " bottom segments but " +
-                            "sequences have " + std::to_string(totalBottom) + " bottom segments");
+
+    void GenomeChecker::checkChild(hal_size_t child) {
+        const Genome *childGenome = _genome->getChild(child);
+        if (childGenome == NULL) {
+            return;
+        }
+        TopArrays childTop;
+        readTopArrays(childGenome, childTop);
+        hal_index_t numChildTop = childTop._starts.size();
+        hal_index_t numBottom = _bottom._starts.size();
+        for (hal_index_t i = 0; i < numBottom && !full(); ++i) {
+            hal_index_t childIndex = _bottom._children[i * _bottom._numChildren + child];
+            if (childIndex == NULL_INDEX) {
+                continue;
+            }
+            if (childIndex < 0 || childIndex >= numChildTop) {
+                add("Child " + std::to_string(child) + " index " + std::to_string(childIndex) + " of segment " +
+                    std::to_string(i) + " out of range in genome " + childGenome->getName());
+                continue;
+            }
+            if (childTop._lengths[childIndex] != _bottom._lengths[i]) {
+                add("Child " + std::to_string(child) + " with index " + std::to_string(childIndex) +
+                    " and start position " + std::to_string(childTop._starts[childIndex]) + " has length " +
+                    std::to_string(childTop._lengths[childIndex]) + " but parent with index " + std::to_string(i) +
+                    " and start position " + std::to_string(_bottom._starts[i]) + " has length " +
+                    std::to_string(_bottom._lengths[i]));
+            }
+            if (childTop._paralogies[childIndex] == NULL_INDEX && childTop._parents[childIndex] != i) {
+                add("Parent / child index mismatch:\n" + name(_genome, i) + " links to " + name(childGenome, childIndex) +
+                    " but \n" + name(childGenome, childIndex) + " links to " +
+                    name(_genome, childTop._parents[childIndex]));
+            }
+            if (childTop._reversed[childIndex] != _bottom._reversed[i * _bottom._numChildren + child]) {
+                add("parent / child reversal mismatch (parent=" + _genome->getName() + " parentSegNum=" +
+                    std::to_string(i) + " child=" + childGenome->getName() + " childSegNum=" +
+                    std::to_string(childIndex) + ")");
+            }
+        }
     }
 
-    if (genomeLength > 0 && genomeTop == 0 && genomeBottom == 0) {
-        throw hal_exception("Problem: genome " + genome->getName() + " has length " + std::to_string(genomeLength) +
-                            "but no segments");
+    void GenomeChecker::checkSequences() {
+        hal_size_t totalTop = 0;
+        hal_size_t totalBottom = 0;
+        hal_size_t totalLength = 0;
+        for (SequenceIteratorPtr seqIt = _genome->getSequenceIterator(); not seqIt->atEnd() && !full();
+             seqIt->toNext()) {
+            const Sequence *sequence = seqIt->getSequence();
+            hal_size_t length = sequence->getSequenceLength();
+            hal_size_t numTop = sequence->getNumTopSegments();
+            hal_size_t numBottom = sequence->getNumBottomSegments();
+
+            if (_genome->getParent() != NULL) {
+                hal_size_t first = sequence->getTopSegmentArrayIndex();
+                if (first + numTop > _top._lengths.size()) {
+                    add("Sequence " + sequence->getName() + " has top segments out of range");
+                } else {
+                    hal_size_t totalTopLength = accumulate(_top._lengths.begin() + first,
+                                                           _top._lengths.begin() + first + numTop, (hal_size_t)0);
+                    if (totalTopLength != length) {
+                        add("Sequence " + sequence->getName() + " has length " + std::to_string(length) +
+                            " but its top segments add up to " + std::to_string(totalTopLength));
+                    }
+                }
+            }
+            if (_genome->getNumChildren() > 0) {
+                hal_size_t first = sequence->getBottomSegmentArrayIndex();
+                if (first + numBottom > _bottom._lengths.size()) {
+                    add("Sequence " + sequence->getName() + " has bottom segments out of range");
+                } else {
+                    hal_size_t totalBottomLength = accumulate(
+                        _bottom._lengths.begin() + first, _bottom._lengths.begin() + first + numBottom, (hal_size_t)0);
+                    if (totalBottomLength != length) {
+                        add("Sequence " + sequence->getName() + " has length " + std::to_string(length) +
+                            " but its bottom segments add up to " + std::to_string(totalBottomLength));
+                    }
+                }
+            }
+
+            totalTop += numTop;
+            totalBottom += numBottom;
+            totalLength += length;
+
+            // make sure it doesn't overlap any other sequences;
+            if (length > 0) {
+                const Sequence *s1 = _genome->getSequenceBySite(sequence->getStartPosition());
+                const Sequence *s2 = _genome->getSequenceBySite(sequence->getStartPosition() + length - 1);
+                if (s1 == NULL || s1->getName() != sequence->getName() || s2 == NULL ||
+                    s2->getName() != sequence->getName()) {
+                    add("Sequence " + sequence->getName() + " has a bad overlap in " + _genome->getName());
+                }
+            }
+        }
+        if (full()) {
+            return;
+        }
+
+        hal_size_t genomeLength = _genome->getSequenceLength();
+        hal_size_t genomeTop = _top._starts.size();
+        hal_size_t genomeBottom = _bottom._starts.size();
+        if (genomeLength != totalLength) {
+            add("Problem: genome has length " + std::to_string(genomeLength) + ", however sequences total " +
+                std::to_string(totalLength));
+        }
+        if (genomeTop != totalTop) {
+            add("Problem: genome has " + std::to_string(genomeTop) + " top segments but " + "sequences have " +
+                std::to_string(totalTop) + " top segments");
+        }
+        if (genomeBottom != totalBottom) {
+            add("Problem: genome has " + std::to_string(genomeBottom) + " bottom segments but " + "sequences have " +
+                std::to_string(totalBottom) + " bottom segments");
+        }
+        if (genomeLength > 0 && genomeTop == 0 && genomeBottom == 0) {
+            add("Problem: genome " + _genome->getName() + " has length " + std::to_string(genomeLength) +
+                " but no segments");
+        }
+    }
+
+    void GenomeChecker::checkDuplications() {
+        const Genome *parentGenome = _genome->getParent();
+        if (parentGenome == NULL) {
+            return;
+        }
+        hal_index_t numParent = parentGenome->getNumBottomSegments();
+        vector<unsigned char> pcount(numParent, 0);
+        for (hal_index_t parentIndex : _top._parents) {
+            if (parentIndex >= 0 && parentIndex < numParent && pcount[parentIndex] < 250) {
+                ++pcount[parentIndex];
+            }
+        }
+        hal_index_t numTop = _top._parents.size();
+        for (hal_index_t i = 0; i < numTop && !full(); ++i) {
+            hal_index_t parentIndex = _top._parents[i];
+            if (parentIndex >= 0 && parentIndex < numParent && _top._paralogies[i] == NULL_INDEX &&
+                pcount[parentIndex] > 1) {
+                add("Top Segment " + std::to_string(i) + " in genome " + _genome->getName() + " is not marked as a" +
+                    " duplication but it shares its parent " + std::to_string(parentIndex) + " with at least " +
+                    std::to_string(pcount[parentIndex] - 1) + " other segments in the same genome");
+            }
+        }
+    }
+}
+
+GenomeValidation hal::checkGenome(const Genome *genome, hal_size_t maxViolations) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    GenomeValidation validation;
+    validation._genomeName = genome->getName();
+    GenomeChecker checker(genome, maxViolations, validation._violations);
+    try {
+        checker.check();
+    } catch (const hal_exception &e) {
+        // data bad enough that the api can't read it
+        validation._violations.push_back(e.what());
     }
+    validation._seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return validation;
+}
 
-    validateDuplications(genome);
+vector<GenomeValidation> hal::checkAlignment(const vector<AlignmentConstPtr> &alignments, hal_size_t maxViolations) {
+    vector<string> names;
+    names.push_back(alignments[0]->getRootName());
+    for (size_t i = 0; i < names.size(); ++i) {
+        vector<string> childNames = alignments[0]->getChildNames(names[i]);
+        names.insert(names.end(), childNames.begin(), childNames.end());
+    }
+
+    vector<GenomeValidation> validations(names.size());
+    atomic<size_t> nextGenome(0);
+    runThreads(min(alignments.size(), names.size()), [&](hal_size_t threadNum) {
+        for (size_t i = nextGenome++; i < names.size(); i = nextGenome++) {
+            const Genome *genome = alignments[threadNum]->openGenome(names[i]);
+            if (genome == NULL) {
+                validations[i]._genomeName = names[i];
+                validations[i]._violations.push_back("Failure to open genome " + names[i]);
+                validations[i]._seconds = 0;
+            } else {
+                validations[i] = checkGenome(genome, maxViolations);
+            }
+        }
+    });
+    return validations;
 }
 
 void hal::validateAlignment(const Alignment *alignment) {
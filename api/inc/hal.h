@@ -68,6 +68,7 @@
 #include "halCommon.h"
 #include "halDefs.h"
 #include "halDnaIterator.h"
+#include "halDnaMaskIndex.h"
 #include "halGappedBottomSegmentIterator.h"
 #include "halGappedTopSegmentIterator.h"
 #include "halGenome.h"
@@ -82,6 +83,7 @@
 #include "halSequence.h"
 #include "halSequenceIterator.h"
 #include "halSlicedSegment.h"
+#include "halTextWriter.h"
 #include "halTopSegment.h"
 #include "halTopSegmentIterator.h"
 #include "halValidate.h"
@@ -10,6 +10,7 @@
 
 #include "halAlignment.h"
 #include "halDefs.h"
+#include <map>
 
 /*
  * for HDF5, we don't include hdf5 from our interface headers.
@@ -109,6 +110,51 @@ namespace hal {
      */
     AlignmentPtr openHalAlignment(const std::string &path, const CLParser *options = NULL, unsigned mode = hal::READ_ACCESS,
                                   const std::string &overrideFormat = "");
+
+    /** Open read-only instances of an alignment for use by several threads.
+     * Alignment objects are not thread-safe, so each thread must use its own.
+     * @param alignment Already open instance of path, returned first.
+     * @param numThreads Number of instances wanted.  Only alignment is returned
+     * if the storage format can't be accessed concurrently, which is the case for
+     * HDF5 unless the library was built thread-safe.
+     */
+    std::vector<AlignmentConstPtr> openHalAlignmentPerThread(AlignmentConstPtr alignment, const std::string &path,
+                                                             const CLParser *options, hal_size_t numThreads);
+
+    /** Get the coarser levels of detail embedded in an mmap alignment file
+     * along with the full alignment.  Each is a separate alignment stored
+     * in the same file, found by its offset.
+     * @param alignment Full alignment
+     * @param outMaxLodLowerBound Set to the query length at and above which
+     * queries are disabled, or 0 if there is no limit
+     * @return map of the minimum query length of each level to its offset,
+     * empty if there are none or the alignment isn't mmap */
+    std::map<hal_size_t, size_t> getEmbeddedLodLevels(AlignmentConstPtr alignment, hal_size_t &outMaxLodLowerBound);
+
+    /** Open a level of detail embedded in an mmap alignment file.  It
+     * shares the open file of the full alignment, which is kept open as long
+     * as the level is. */
+    AlignmentConstPtr openEmbeddedLodLevel(AlignmentConstPtr alignment, size_t offset);
+
+    /** Copy an alignment into an mmap alignment file opened for writing, as
+     * the level of detail used for queries at least minQueryLength long.
+     * Genomes with the same sequences as in the full alignment share its
+     * names, sequence tables and DNA rather than storing their own. */
+    void embedLodLevel(AlignmentPtr alignment, AlignmentConstPtr level, hal_size_t minQueryLength);
+
+    /** Disable queries at least maxLodLowerBound long on an mmap alignment
+     * file with embedded levels of detail, or with 0 remove the limit. */
+    void setEmbeddedLodLimit(AlignmentPtr alignment, hal_size_t maxLodLowerBound);
+
+    /** Copy an mmap alignment, with its embedded levels of detail, to a new
+     * mmap file holding only what is still in use.  Changes made in place,
+     * such as renaming or replacing genomes, leave what they replace in
+     * the file, and the copy lays each genome out contiguously in
+     * breadth-first order.
+     * @param alignment Alignment to copy
+     * @param outPath Path of the new file, which mustn't be that of
+     * alignment */
+    void compactHalAlignment(AlignmentConstPtr alignment, const std::string &outPath);
 }
 
 #endif
@@ -10,6 +10,7 @@
 
 #include "halDefs.h"
 #include <cassert>
+#include <functional>
 #include <locale>
 #include <map>
 #include <set>
@@ -155,6 +156,38 @@ namespace hal {
         return dist;
     }
 
+    /** Counts from comparing two aligned DNA sequences base by base,
+     * ignoring case */
+    struct BaseComparison {
+        BaseComparison() : _matches(0), _transitions(0), _transversions(0), _baseN(0), _bothN(0) {
+        }
+
+        hal_size_t _matches;       // same base, neither N
+        hal_size_t _transitions;   // A<->G or C<->T
+        hal_size_t _transversions; // other differences between non-N bases
+        hal_size_t _baseN;         // N against a base
+        hal_size_t _bothN;         // N against N
+
+        /** Number of differences, as counted by isSubstitution() */
+        hal_size_t getSubstitutions() const {
+            return _transitions + _transversions + _baseN;
+        }
+
+        /** Number of positions where neither base is N */
+        hal_size_t getAligned() const {
+            return _matches + _transitions + _transversions;
+        }
+
+        BaseComparison &operator+=(const BaseComparison &other) {
+            _matches += other._matches;
+            _transitions += other._transitions;
+            _transversions += other._transversions;
+            _baseN += other._baseN;
+            _bothN += other._bothN;
+            return *this;
+        }
+    };
+
     const Genome *getLowestCommonAncestor(const std::set<const Genome *> &inputSet);
 
     /* Given a set of genomes (input set) find all genomes in the spanning
@@ -174,6 +207,11 @@ namespace hal {
     /* get the file size from the OS */
     size_t getFileStatSize(int fd);
 
+    /* Call fn(threadNum) from numThreads threads, numbered from 0, with thread
+     * 0 being the calling thread.  Returns once all have finished, rethrowing
+     * the first exception thrown by any of them. */
+    void runThreads(hal_size_t numThreads, const std::function<void(hal_size_t)> &fn);
+
     /* map of character to encoding for both upper and lower case */
     extern const uint8_t dnaPackMap[256];
 
@@ -194,6 +232,47 @@ namespace hal {
         uint8_t code = dnaPackMap[uint8_t(unpackedChar)];
         return (index & 1) ? ((packedChar & 0xF0) | code) : ((packedChar & 0x0F) | (code << 4));
     }
+
+    /* Up to 16 packed DNA codes held in a 64-bit word, first base in the most
+     * significant nibble.  Bit 2 of a code is set only for N, and
+     * complementing a non-N code is flipping its low two bits (a<->t, c<->g),
+     * so bases can be compared 16 at a time with bit operations. */
+    static const uint64_t dnaWordLowBits = 0x1111111111111111ULL;
+    static const uint64_t dnaWordComplement = 0x3333333333333333ULL;
+
+    /** Mask of the low bit of the first count nibbles of a DNA word */
+    inline uint64_t dnaWordLanes(hal_size_t count) {
+        assert(count > 0 && count <= 16);
+        return dnaWordLowBits & (~uint64_t(0) << (64 - 4 * count));
+    }
+
+    /** Reverse the order of the first count nibbles of a DNA word */
+    inline uint64_t dnaWordReverse(uint64_t word, hal_size_t count) {
+        word = __builtin_bswap64(word);
+        word = ((word & 0x0F0F0F0F0F0F0F0FULL) << 4) | ((word >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+        return word << (64 - 4 * count);
+    }
+
+    /** Mask of the low bit of the nibbles among the first count of a DNA
+     * word whose code has bit 2 set along with either low bit, which is
+     * no nucleotide */
+    inline uint64_t dnaWordNonNucleotides(uint64_t word, hal_size_t count) {
+        return (word >> 2) & (word | (word >> 1)) & dnaWordLanes(count);
+    }
+
+    /** Compare the first count bases of two DNA words, adding to counts */
+    inline void compareDnaWords(uint64_t x, uint64_t y, hal_size_t count, BaseComparison &counts) {
+        uint64_t lanes = dnaWordLanes(count);
+        uint64_t xN = (x >> 2) & lanes;
+        uint64_t yN = (y >> 2) & lanes;
+        uint64_t bases = lanes & ~(xN | yN);
+        uint64_t diff = x ^ y;
+        counts._matches += __builtin_popcountll(~(diff | (diff >> 1)) & bases);
+        counts._transitions += __builtin_popcountll((diff >> 1) & ~diff & bases);
+        counts._transversions += __builtin_popcountll(diff & bases);
+        counts._baseN += __builtin_popcountll(xN ^ yN);
+        counts._bothN += __builtin_popcountll(xN & yN);
+    }
 }
 
 #endif
@@ -41,6 +41,37 @@ namespace hal {
             _dirty = true;
         }
 
+        /* Get count (at most 16) bases starting at index as a DNA word (see
+         * halCommon.h), with unused nibbles zero.  If reversed, the bases are
+         * read leftwards from index and complemented. */
+        inline uint64_t getWord(hal_index_t index, hal_size_t count, bool reversed) const {
+            assert(count > 0 && count <= 16);
+            hal_index_t first = reversed ? index - (hal_index_t)count + 1 : index;
+            uint64_t word = 0;
+            hal_index_t relIndex = access(first);
+            if (count == 16 && first + 17 <= _endIndex) {
+                // whole word in the buffer, one extra nibble for odd starts
+                const unsigned char *bytes = reinterpret_cast<const unsigned char *>(_buffer) + relIndex / 2;
+                for (int i = 0; i < 8; ++i) {
+                    word = (word << 8) | bytes[i];
+                }
+                if (relIndex & 1) {
+                    word = (word << 4) | (bytes[8] >> 4);
+                }
+            } else {
+                for (hal_size_t i = 0; i < count; ++i) {
+                    relIndex = access(first + (hal_index_t)i);
+                    unsigned char packedChar = _buffer[relIndex / 2];
+                    uint64_t code = (relIndex & 1) ? (packedChar & 0x0F) : (packedChar >> 4);
+                    word |= code << (60 - 4 * i);
+                }
+            }
+            if (reversed) {
+                word = dnaWordReverse(word, count) ^ (dnaWordComplement & (~uint64_t(0) << (64 - 4 * count)));
+            }
+            return word;
+        }
+
       protected:
         /* constructor */
         DnaAccess(hal_index_t startIndex, hal_index_t endIndex, char *buffer)
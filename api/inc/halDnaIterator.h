@@ -111,6 +111,17 @@ namespace hal {
         /* write a DNA string */
         void writeString(const std::string &inString, hal_size_t length);
 
+        /** Compare the next length bases with those of another iterator,
+         * each read in its own direction, and add the results to counts.
+         * Bases are compared in their packed form, 16 at a time.  Neither
+         * iterator is moved. */
+        void compareBases(const DnaIterator &other, hal_size_t length, BaseComparison &counts) const;
+
+        /** Offset of the first of the next length bases whose packed code
+         * isn't that of a nucleotide, or length if there is none.  Bases
+         * are checked 16 at a time.  The iterator is not moved. */
+        hal_size_t findNonNucleotide(hal_size_t length) const;
+
         /** Compare (array indexes) of two iterators */
         bool equals(DnaIteratorPtr &other) const;
 
@@ -172,10 +183,47 @@ namespace hal {
         }
     }
 
-    inline void DnaIterator::writeString(const std::string &inString, hal_size_t length) {
+    inline void DnaIterator::compareBases(const DnaIterator &other, hal_size_t length, BaseComparison &counts) const {
+        assert(length == 0 || (inRange() && other.inRange()));
+        for (hal_size_t done = 0; done < length; done += 16) {
+            hal_size_t count = std::min(length - done, hal_size_t(16));
+            hal_index_t offset = (hal_index_t)done;
+            uint64_t x = _dnaAccess->getWord(_reversed ? _index - offset : _index + offset, count, _reversed);
+            uint64_t y = other._dnaAccess->getWord(other._reversed ? other._index - offset : other._index + offset, count,
+                                                   other._reversed);
+            compareDnaWords(x, y, count, counts);
+        }
+    }
+
+    inline hal_size_t DnaIterator::findNonNucleotide(hal_size_t length) const {
         assert(length == 0 || inRange());
+        for (hal_size_t done = 0; done < length; done += 16) {
+            hal_size_t count = std::min(length - done, hal_size_t(16));
+            hal_index_t offset = (hal_index_t)done;
+            uint64_t word = _dnaAccess->getWord(_reversed ? _index - offset : _index + offset, count, _reversed);
+            uint64_t lanes = dnaWordNonNucleotides(word, count);
+            if (lanes != 0) {
+                return done + __builtin_clzll(lanes) / 4;
+            }
+        }
+        return length;
+    }
+
+    inline void DnaIterator::writeString(const std::string &inString, hal_size_t length) {
+        if (length == 0) {
+            return;
+        }
+        // check the range once rather than for each base as setBase() does
+        hal_index_t last = _reversed ? _index - (hal_index_t)length + 1 : _index + (hal_index_t)length - 1;
+        if (not inRange() || last < 0 || last >= (hal_index_t)_genome->getSequenceLength()) {
+            throw hal_exception("Trying to set character out of range");
+        }
         for (hal_size_t i = 0; i < length; ++i) {
-            setBase(inString[i]);
+            char c = inString[i];
+            if (not isNucleotide(c)) {
+                throw hal_exception(std::string("Trying to set invalid character: ") + c);
+            }
+            _dnaAccess->setBase(_index, _reversed ? reverseComplement(c) : c);
             toRight();
         }
         flush();
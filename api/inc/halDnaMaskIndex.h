@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALDNAMASKINDEX_H
+#define _HALDNAMASKINDEX_H
+
+#include "halDefs.h"
+#include <vector>
+
+namespace hal {
+    class Genome;
+
+    /** Runs of soft-masked (lower case) bases and of N bases in the DNA of
+     * a genome, in genome coordinates.  Built with one pass over the DNA,
+     * so that counting masked or N bases in a range, or listing the masked
+     * runs, is a search of the runs rather than a scan of the DNA.  The
+     * index doesn't follow changes to the DNA made after it is built; see
+     * Genome::getDnaMaskIndex(). */
+    class DnaMaskIndex {
+      public:
+        /** run of bases [_start, _end) */
+        struct Run {
+            hal_index_t _start;
+            hal_index_t _end;
+        };
+        typedef std::vector<Run> RunVector;
+
+        DnaMaskIndex(const Genome *genome);
+
+        /** number of soft-masked bases in [start, start + length) */
+        hal_size_t getNumMasked(hal_index_t start, hal_size_t length) const {
+            return countBases(_maskedRuns, _maskedBefore, start, length);
+        }
+
+        /** number of N bases (either case) in [start, start + length) */
+        hal_size_t getNumMissing(hal_index_t start, hal_size_t length) const {
+            return countBases(_missingRuns, _missingBefore, start, length);
+        }
+
+        /** soft-masked runs of the genome, sorted */
+        const RunVector &getMaskedRuns() const {
+            return _maskedRuns;
+        }
+
+        /** N runs of the genome, sorted */
+        const RunVector &getMissingRuns() const {
+            return _missingRuns;
+        }
+
+        /** get the runs overlapping [start, end), clipped to it */
+        static void getRuns(const RunVector &runs, hal_index_t start, hal_index_t end, RunVector &outRuns);
+
+      private:
+        static hal_size_t countBases(const RunVector &runs, const std::vector<hal_size_t> &before, hal_index_t start,
+                                     hal_size_t length);
+        static void addBase(RunVector &runs, hal_index_t pos);
+        static void indexRuns(const RunVector &runs, std::vector<hal_size_t> &before);
+
+        RunVector _maskedRuns;
+        RunVector _missingRuns;
+        // total length of the runs before each run
+        std::vector<hal_size_t> _maskedBefore;
+        std::vector<hal_size_t> _missingBefore;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
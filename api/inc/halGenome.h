@@ -10,8 +10,10 @@
 
 #include "halAlignment.h"
 #include "halDefs.h"
+#include "halDnaMaskIndex.h"
 #include "halSegmentedSequence.h"
 #include "halSequence.h"
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -200,11 +202,18 @@ namespace hal {
         /** Rename this genome. */
         virtual void rename(const std::string &name) = 0;
 
+        /** Get the index of the soft-masked and N runs of the genome's DNA,
+         * building it on first use.  Returns NULL if the genome has no DNA,
+         * or if the alignment isn't read-only, since the index isn't updated
+         * when the DNA changes.  Callers then scan the DNA instead. */
+        const DnaMaskIndex *getDnaMaskIndex() const;
+
         /** Reload the genome after some aspect has changed, clearing any caches. */
         void reload() {
             _numChildren = _alignment->getChildNames(_name).size();
             _childCache.empty();
             _parentCache = NULL;
+            _dnaMaskIndex.reset();
         };
 
       protected:
@@ -213,6 +222,7 @@ namespace hal {
         hal_index_t _numChildren;
         mutable Genome *_parentCache;
         mutable std::vector<Genome *> _childCache;
+        mutable std::unique_ptr<DnaMaskIndex> _dnaMaskIndex;
     };
 
     inline Genome *Genome::getChild(hal_size_t childIdx) {
@@ -66,6 +66,12 @@ namespace hal {
             return _target;
         }
 
+        /** Compare the bases of the source and target segments, adding the
+         * results to counts. */
+        void compareBases(BaseComparison &counts) const {
+            _target->compareBases(*_source, counts);
+        }
+
         /** Comparison used to store in stl sets and maps.  We sort based
          * on the coordinate of the mapped segemnt's (target) interval as the primary
          * index and the target genome as the secondary index.  */
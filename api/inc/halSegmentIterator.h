@@ -8,6 +8,7 @@
 #ifndef _HALSEGMENTITERATOR_H
 #define _HALSEGMENTITERATOR_H
 
+#include "halCommon.h"
 #include "halDefs.h"
 #include "halMappedSegmentContainers.h"
 #include "halSlicedSegment.h"
@@ -61,6 +62,13 @@ namespace hal {
             }
         }
 
+        /** Compare the bases of the iterator with those of another of the same
+         * length (typically its homolog in a parent or child), taking each
+         * one's orientation into account, and add the results to counts.
+         * Equivalent to comparing the output of getString, without
+         * unpacking the DNA. */
+        void compareBases(const SegmentIterator &other, BaseComparison &counts) const;
+
         /** Return a pointer to the current Segment.  NOTE: changes when iterator is modified.  */
         virtual Segment *getSegment() = 0;
 
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALTEXTWRITER_H
+#define _HALTEXTWRITER_H
+
+#include "halDefs.h"
+#include <cstring>
+#include <future>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace hal {
+
+    /** Buffered writer for the text formats the tools export (BED, PSL, PAF,
+     * MAF, wiggle).  Numbers are formatted directly into a large buffer
+     * rather than through the iostream operators and their locale and
+     * sentry overhead, and the buffer is only passed to the stream when it
+     * fills.  The text is the same as the stream would produce with its
+     * default formatting.
+     *
+     * With background flushing, a full buffer is written to the stream by
+     * another thread while formatting continues in a second buffer.  The
+     * stream must then not be used by anything else until flush() is
+     * called. */
+    class TextWriter {
+      public:
+        static const size_t DefaultBufferSize = 1 << 20;
+
+        /** @param os stream the text is written to
+         * @param backgroundFlush write full buffers on another thread
+         * @param bufferSize size of each buffer */
+        TextWriter(std::ostream &os, bool backgroundFlush = false, size_t bufferSize = DefaultBufferSize);
+
+        /* flushes what is left, but write errors are only reported by an
+         * explicit call to flush() */
+        ~TextWriter();
+
+        TextWriter &operator<<(char c) {
+            if (_pos == _end) {
+                writeBuffer();
+            }
+            *_pos++ = c;
+            return *this;
+        }
+
+        /* as for a stream, these are characters rather than numbers */
+        TextWriter &operator<<(signed char c) {
+            return *this << char(c);
+        }
+        TextWriter &operator<<(unsigned char c) {
+            return *this << char(c);
+        }
+
+        TextWriter &operator<<(const char *str) {
+            write(str, strlen(str));
+            return *this;
+        }
+
+        TextWriter &operator<<(const std::string &str) {
+            write(str.data(), str.size());
+            return *this;
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value, TextWriter &>::type operator<<(T value) {
+            writeInteger(value);
+            return *this;
+        }
+
+        /* as %g, the stream's default format */
+        TextWriter &operator<<(double value);
+
+        void write(const char *data, size_t length) {
+            if (length <= size_t(_end - _pos)) {
+                memcpy(_pos, data, length);
+                _pos += length;
+            } else {
+                writeLong(data, length);
+            }
+        }
+
+        /** Write everything buffered to the stream and flush it, throwing
+         * if any of the output couldn't be written. */
+        void flush();
+
+        /** Pass what is buffered to the stream, for callers that need the
+         * stream's position to reflect the text written so far.  Waits for
+         * any background write. */
+        void writeBuffered();
+
+      private:
+        TextWriter(const TextWriter &);
+        TextWriter &operator=(const TextWriter &);
+
+        template <typename T> void writeInteger(T value) {
+            typedef typename std::make_unsigned<T>::type Unsigned;
+            // 20 digits of a 64 bit integer and a sign
+            if (_end - _pos < 21) {
+                writeBuffer();
+            }
+            bool negative = std::is_signed<T>::value && value < T(0);
+            Unsigned u = negative ? Unsigned(0) - Unsigned(value) : Unsigned(value);
+            char digits[24];
+            char *first = formatDigits(u, digits + sizeof(digits));
+            if (negative) {
+                *--first = '-';
+            }
+            size_t length = digits + sizeof(digits) - first;
+            memcpy(_pos, first, length);
+            _pos += length;
+        }
+
+        /* write the decimal digits of value so they end at last, returning
+         * the first */
+        static char *formatDigits(hal_size_t value, char *last);
+
+        void writeLong(const char *data, size_t length);
+        void writeBuffer();
+        void waitForWrite();
+
+        std::ostream &_os;
+        bool _backgroundFlush;
+        std::vector<char> _buffers[2];
+        size_t _current;
+        char *_pos;
+        char *_end;
+        std::future<void> _pending;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
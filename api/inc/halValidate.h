@@ -28,7 +28,8 @@ namespace hal {
     void validateSequence(const Sequence *sequence);
 
     /** Go through a genome, and throw an exception if anything
-     * appears out of whack. */
+     * appears out of whack.  Throws the first problem found by
+     * checkGenome(). */
     void validateGenome(const Genome *genome);
 
     /** Go through a genome, and throw an exception if any duplications
@@ -38,6 +39,25 @@ namespace hal {
     /** Go through an alignment, and throw an excpetion if anything
      * appears out of whack. */
     void validateAlignment(const Alignment *alignment);
+
+    /** Problems found checking a genome, and how long it took. */
+    struct GenomeValidation {
+        std::string _genomeName;
+        std::vector<std::string> _violations;
+        double _seconds;
+    };
+
+    /** Check a genome as validateGenome() does, but with passes over its
+     * segment arrays, and those of its parent and children, read in bulk
+     * rather than looking up each segment's links.  Up to maxViolations
+     * problems are recorded rather than throwing the first. */
+    GenomeValidation checkGenome(const Genome *genome, hal_size_t maxViolations);
+
+    /** Check every genome of an alignment, with a thread for each instance
+     * of it (see openHalAlignmentPerThread).  Results are in breadth-first
+     * order from the root. */
+    std::vector<GenomeValidation> checkAlignment(const std::vector<AlignmentConstPtr> &alignments,
+                                                 hal_size_t maxViolations);
 }
 #endif
 
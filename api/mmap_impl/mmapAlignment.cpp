@@ -1,5 +1,6 @@
 #include "mmapAlignment.h"
 #include "halCLParser.h"
+#include "halSequenceIterator.h"
 #include "mmapGenome.h"
 
 using namespace hal;
@@ -8,8 +9,8 @@ using namespace std;
 static const int NAME_HASH_GROWTH_FACTOR = 1024; // allow lots of initial space
 
 MMapAlignment::MMapAlignment(const std::string &alignmentPath, unsigned mode, size_t fileSize)
-    : _alignmentPath(alignmentPath), _mode(mode), _fileSize(fileSize), _file(NULL), _data(NULL), _genomeNameHash(NULL),
-      _tree(NULL) {
+    : _alignmentPath(alignmentPath), _mode(mode), _fileSize(fileSize), _file(NULL), _container(NULL),
+      _rootOffset(MMAP_NULL_OFFSET), _data(NULL), _genomeNameHash(NULL), _tree(NULL) {
     _file = MMapFile::factory(alignmentPath, mode, fileSize);
     if (mode & CREATE_ACCESS) {
         create();
@@ -19,8 +20,8 @@ MMapAlignment::MMapAlignment(const std::string &alignmentPath, unsigned mode, si
 }
 
 MMapAlignment::MMapAlignment(const std::string &alignmentPath, unsigned mode, const CLParser *parser)
-    : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _fileSize(0), _file(NULL), _data(NULL),
-      _genomeNameHash(NULL), _tree(NULL) {
+    : _alignmentPath(alignmentPath), _mode(halDefaultAccessMode(mode)), _fileSize(0), _file(NULL), _container(NULL),
+      _rootOffset(MMAP_NULL_OFFSET), _data(NULL), _genomeNameHash(NULL), _tree(NULL) {
     initializeFromOptions(parser);
     _file = MMapFile::factory(alignmentPath, _mode, _fileSize);
     if (mode & CREATE_ACCESS) {
@@ -30,15 +31,28 @@ MMapAlignment::MMapAlignment(const std::string &alignmentPath, unsigned mode, co
     }
 }
 
+MMapAlignment::MMapAlignment(MMapAlignment *container, size_t rootOffset)
+    : _alignmentPath(container->_alignmentPath), _mode(container->_mode), _fileSize(0), _file(container->_file),
+      _container(container), _rootOffset(rootOffset), _data(NULL), _genomeNameHash(NULL), _tree(NULL) {
+    if (rootOffset == MMAP_NULL_OFFSET) {
+        create();
+    } else {
+        open();
+    }
+}
+
 void MMapAlignment::close() {
     // Free the memory used by all open genomes.
     for (auto kv : _openGenomes) {
         delete kv.second;
     }
-    // Close the actual file.
+    // Close the actual file, which a level of detail shares with the
+    // alignment it is embedded in.
     delete _genomeNameHash;
     _genomeNameHash = NULL;
-    _file->close();
+    if (_container == NULL) {
+        _file->close();
+    }
 }
 
 void MMapAlignment::defineOptions(CLParser *parser, unsigned mode) {
@@ -65,14 +79,17 @@ void MMapAlignment::initializeFromOptions(const CLParser *parser) {
 }
 
 void MMapAlignment::create() {
-    _file->allocMem(sizeof(MMapAlignmentData), true);
-    _data = static_cast<MMapAlignmentData *>(resolveOffset(_file->getRootOffset(), sizeof(MMapAlignmentData)));
+    _rootOffset = _file->allocMem(sizeof(MMapAlignmentData), _container == NULL);
+    _data = static_cast<MMapAlignmentData *>(resolveOffset(_rootOffset, sizeof(MMapAlignmentData)));
     _data->_numGenomes = 0;
     _data->_genomeNameHashOffset = MMAP_NULL_OFFSET;
 }
 
 void MMapAlignment::open() {
-    _data = static_cast<MMapAlignmentData *>(resolveOffset(_file->getRootOffset(), sizeof(MMapAlignmentData)));
+    if (_container == NULL) {
+        _rootOffset = _file->getRootOffset();
+    }
+    _data = static_cast<MMapAlignmentData *>(resolveOffset(_rootOffset, sizeof(MMapAlignmentData)));
     if (_data->_genomeNameHashOffset != MMAP_NULL_OFFSET) {
         _genomeNameHash = new MMapPerfectHashTable(_file, _data->_genomeNameHashOffset, NAME_HASH_GROWTH_FACTOR);
     }
@@ -182,3 +199,174 @@ Genome *MMapAlignment::_openGenome(const string &name) const {
     _openGenomes[name] = genome;
     return genome;
 }
+
+MMapGenome *MMapAlignment::getSharedGenome(const string &name) const {
+    if (_container == NULL) {
+        return NULL;
+    }
+    return static_cast<MMapGenome *>(_container->_openGenome(name));
+}
+
+/* get the table of levels of detail, or NULL if there is none and create
+ * isn't set */
+MMapLodTableData *MMapAlignment::getLodTable(bool create) {
+    size_t tableOffset = _file->getLodTableOffset();
+    if (tableOffset == MMAP_NULL_OFFSET) {
+        if (!create) {
+            return NULL;
+        }
+        tableOffset = allocateNewArray(sizeof(MMapLodTableData));
+        MMapLodTableData *table = static_cast<MMapLodTableData *>(resolveOffset(tableOffset, sizeof(MMapLodTableData)));
+        table->_numLevels = 0;
+        table->_levelsOffset = MMAP_NULL_OFFSET;
+        table->_maxLodLowerBound = 0;
+        _file->setLodTableOffset(tableOffset);
+    }
+    return static_cast<MMapLodTableData *>(resolveOffset(tableOffset, sizeof(MMapLodTableData)));
+}
+
+map<hal_size_t, size_t> MMapAlignment::getLodLevels(hal_size_t &outMaxLodLowerBound) const {
+    map<hal_size_t, size_t> levels;
+    outMaxLodLowerBound = 0;
+    const MMapLodTableData *table = const_cast<MMapAlignment *>(this)->getLodTable(false);
+    if (table != NULL) {
+        const MMapLodLevelData *levelArray = static_cast<const MMapLodLevelData *>(
+            resolveOffset(table->_levelsOffset, table->_numLevels * sizeof(MMapLodLevelData)));
+        for (size_t i = 0; i < table->_numLevels; ++i) {
+            levels[levelArray[i]._minQueryLength] = levelArray[i]._rootOffset;
+        }
+        outMaxLodLowerBound = table->_maxLodLowerBound;
+    }
+    return levels;
+}
+
+void MMapAlignment::addLodLevel(const Alignment *level, hal_size_t minQueryLength) {
+    if (_container != NULL) {
+        throw hal_exception("can't embed a level of detail in another level of detail");
+    }
+    if (minQueryLength == 0) {
+        throw hal_exception("minimum query length of an embedded level of detail must be greater than 0");
+    }
+    hal_size_t maxLodLowerBound;
+    if (getLodLevels(maxLodLowerBound).count(minQueryLength) > 0) {
+        throw hal_exception(_alignmentPath + " already has a level of detail for queries of length " +
+                            std::to_string(minQueryLength));
+    }
+
+    MMapAlignment lodAlignment(this, MMAP_NULL_OFFSET);
+    lodAlignment.copyGenomes(level, lodAlignment.copyTree(level));
+    lodAlignment.close();
+
+    // the table is copied to a larger array, as genomes are
+    MMapLodTableData *table = getLodTable(true);
+    size_t levelsOffset = allocateNewArray((table->_numLevels + 1) * sizeof(MMapLodLevelData));
+    MMapLodLevelData *levelArray =
+        static_cast<MMapLodLevelData *>(resolveOffset(levelsOffset, (table->_numLevels + 1) * sizeof(MMapLodLevelData)));
+    if (table->_numLevels > 0) {
+        memcpy(levelArray, resolveOffset(table->_levelsOffset, table->_numLevels * sizeof(MMapLodLevelData)),
+               table->_numLevels * sizeof(MMapLodLevelData));
+    }
+    levelArray[table->_numLevels]._minQueryLength = minQueryLength;
+    levelArray[table->_numLevels]._rootOffset = lodAlignment._rootOffset;
+    table->_levelsOffset = levelsOffset;
+    ++table->_numLevels;
+}
+
+void MMapAlignment::setLodLimit(hal_size_t maxLodLowerBound) {
+    getLodTable(true)->_maxLodLowerBound = maxLodLowerBound;
+}
+
+/* Add the genomes of source to this empty alignment, writing the tree, the
+ * genome table and the name hash once each rather than growing them a
+ * genome at a time.  Returns the names of the genomes in breadth-first
+ * order, which is their order in the table. */
+vector<string> MMapAlignment::copyTree(const Alignment *source) {
+    assert(_data->_numGenomes == 0);
+    vector<string> names(1, source->getRootName());
+    for (size_t i = 0; i < names.size(); ++i) {
+        vector<string> childNames = source->getChildNames(names[i]);
+        names.insert(names.end(), childNames.begin(), childNames.end());
+    }
+    // children keep their order, which is that of the links to them in
+    // bottom segments
+    _tree = stTree_parseNewickString(source->getNewickTree().c_str());
+    writeTree();
+
+    size_t genomeArraySize = names.size() * sizeof(MMapGenomeData);
+    _data->_genomeArrayOffset = allocateNewArray(genomeArraySize);
+    _data->_numGenomes = names.size();
+    MMapGenomeData *genomeArray = static_cast<MMapGenomeData *>(resolveOffset(_data->_genomeArrayOffset, genomeArraySize));
+    for (size_t i = 0; i < names.size(); ++i) {
+        _openGenomes[names[i]] = new MMapGenome(this, genomeArray + i, i, names[i]);
+    }
+    _genomeNameHash = new MMapPerfectHashTable(_file, MMAP_NULL_OFFSET);
+    _data->_genomeNameHashOffset = _genomeNameHash->addKeys(names);
+    for (size_t i = 0; i < names.size(); ++i) {
+        _genomeNameHash->setIndex(names[i], i);
+    }
+    return names;
+}
+
+/* Copy the genomes of source into those added by copyTree().  The genomes
+ * of another mmap alignment are copied a genome at a time, array by array.
+ * Otherwise segments are copied through the API, which looks up the
+ * sequences of the parent and children, so all the dimensions are set
+ * first. */
+void MMapAlignment::copyGenomes(const Alignment *source, const vector<string> &names) {
+    const MMapAlignment *mmapSource = dynamic_cast<const MMapAlignment *>(source);
+    if (mmapSource != NULL) {
+        for (const string &name : names) {
+            const MMapGenome *inGenome = static_cast<const MMapGenome *>(mmapSource->openGenome(name));
+            if (inGenome == NULL) {
+                throw hal_exception("genome " + name + " of the tree not found in alignment");
+            }
+            MMapGenome *outGenome = static_cast<MMapGenome *>(openGenome(name));
+            // the stored numbers of segments, which copyDimensions() leaves
+            // out for the root and leaves
+            vector<Sequence::Info> dimensions;
+            for (SequenceIteratorPtr seqIt = inGenome->getSequenceIterator(0); not seqIt->atEnd(); seqIt->toNext()) {
+                const Sequence *sequence = seqIt->getSequence();
+                dimensions.push_back(Sequence::Info(sequence->getName(), sequence->getSequenceLength(),
+                                                    sequence->getNumTopSegments(), sequence->getNumBottomSegments()));
+            }
+            outGenome->setDimensions(dimensions, true);
+            outGenome->copyArrays(inGenome);
+            inGenome->copyMetadata(outGenome);
+        }
+        return;
+    }
+    for (const string &name : names) {
+        const Genome *inGenome = source->openGenome(name);
+        inGenome->copyDimensions(openGenome(name));
+        source->closeGenome(inGenome);
+    }
+    for (const string &name : names) {
+        const Genome *inGenome = source->openGenome(name);
+        MMapGenome *outGenome = static_cast<MMapGenome *>(openGenome(name));
+        if (!outGenome->isSharingSequences() && inGenome->containsDNAArray()) {
+            inGenome->copySequence(outGenome);
+        }
+        inGenome->copyTopSegments(outGenome);
+        inGenome->copyBottomSegments(outGenome);
+        inGenome->copyMetadata(outGenome);
+        source->closeGenome(inGenome);
+    }
+}
+
+void MMapAlignment::copyCompacted(const MMapAlignment *source) {
+    if (_data->_numGenomes != 0) {
+        throw hal_exception("can only copy an alignment into an empty one");
+    }
+    copyGenomes(source, copyTree(source));
+    // the levels share the file, and so the genomes copied above
+    hal_size_t maxLodLowerBound;
+    map<hal_size_t, size_t> levels = source->getLodLevels(maxLodLowerBound);
+    for (const auto &level : levels) {
+        MMapAlignment sourceLevel(const_cast<MMapAlignment *>(source), level.second);
+        addLodLevel(&sourceLevel, level.first);
+        sourceLevel.close();
+    }
+    if (maxLodLowerBound != 0) {
+        setLodLimit(maxLodLowerBound);
+    }
+}
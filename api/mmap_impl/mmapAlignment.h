@@ -30,6 +30,24 @@ namespace hal {
         char _reserved[265];   // 256 bytes of reserved added in mmap API 1.1
     };
 
+    /* a level of detail embedded in the file: another alignment tree, used
+     * for queries at least _minQueryLength long */
+    class MMapLodLevelData {
+      public:
+        size_t _minQueryLength;
+        size_t _rootOffset;
+    };
+
+    /* table of the levels of detail embedded in a file, found from the
+     * header */
+    class MMapLodTableData {
+      public:
+        size_t _numLevels;
+        size_t _levelsOffset;
+        size_t _maxLodLowerBound; // queries at least this long are disabled, 0 for no limit
+        char _reserved[256];
+    };
+
     class MMapAlignment : public Alignment {
         friend class MMapAlignmentData;
 
@@ -39,6 +57,11 @@ namespace hal {
 
         /* constructor from command line options */
         MMapAlignment(const std::string &alignmentPath, unsigned mode, const CLParser *parser);
+
+        /* open a level of detail embedded in the file of container, or create
+         * one if rootOffset is MMAP_NULL_OFFSET.  The container must stay open
+         * while the level is used. */
+        MMapAlignment(MMapAlignment *container, size_t rootOffset);
         ~MMapAlignment() {
             if (_tree != NULL) {
                 stTree_destruct(_tree);
@@ -57,6 +80,35 @@ namespace hal {
 
         void close();
 
+        /* get the embedded levels of detail, as minimum query length to
+         * offset of the level */
+        std::map<hal_size_t, size_t> getLodLevels(hal_size_t &outMaxLodLowerBound) const;
+
+        /* copy an alignment into the file as a level of detail.  Genomes
+         * with the same sequences as in this alignment share their names,
+         * sequence tables and DNA with it. */
+        void addLodLevel(const Alignment *level, hal_size_t minQueryLength);
+
+        /* disable queries at least maxLodLowerBound long, 0 for no limit */
+        void setLodLimit(hal_size_t maxLodLowerBound);
+
+        /* copy another mmap alignment, with its levels of detail, into this
+         * newly created one.  Only what is reachable from the roots of the
+         * source is copied, and each object is written once, leaving out
+         * the space lost by modifying the source in place.  Genomes are laid
+         * out in breadth-first order, each with its DNA, sequences and
+         * segments together. */
+        void copyCompacted(const MMapAlignment *source);
+
+        /* number of bytes of the file in use */
+        size_t getUsedFileSize() const {
+            return _file->_header->nextOffset;
+        }
+
+        /* genome of the same name in the alignment this level of detail is
+         * embedded in, or NULL */
+        MMapGenome *getSharedGenome(const std::string &name) const;
+
         const std::string &getStorageFormat() const {
             return STORAGE_FORMAT_MMAP;
         }
@@ -205,6 +257,9 @@ namespace hal {
         void create();
         void open();
         void addGenomeToNameHash(const MMapGenome *genome, vector<string> &existingNames);
+        MMapLodTableData *getLodTable(bool create);
+        std::vector<std::string> copyTree(const Alignment *source);
+        void copyGenomes(const Alignment *source, const std::vector<std::string> &names);
         Genome *_openGenome(const std::string &name) const;
         stTree *getGenomeNode(const std::string &name) const {
             stTree *node = stTree_findChild(_tree, name.c_str());
@@ -233,6 +288,8 @@ namespace hal {
         unsigned _mode;
         size_t _fileSize;
         MMapFile *_file;
+        MMapAlignment *_container; // NULL unless this is an embedded level of detail
+        size_t _rootOffset;
         MMapAlignmentData *_data;
         MMapPerfectHashTable *_genomeNameHash;
         stTree *_tree;
@@ -93,6 +93,9 @@ void hal::MMapFile::loadHeader(bool markDirty) {
     if (_header->rootOffset > _fileSize) {
         throw hal_exception(_alignmentPath + ": header rootOffset field out of bounds, probably file corruption");
     }
+    if (_header->lodTableOffset > _fileSize) {
+        throw hal_exception(_alignmentPath + ": header lodTableOffset field out of bounds, probably file corruption");
+    }
     if (_header->dirty) {
         throw hal_exception(_alignmentPath + ": file is marked as dirty, most likely an inconsistent state.");
     }
@@ -101,6 +104,14 @@ void hal::MMapFile::loadHeader(bool markDirty) {
     }
 }
 
+/* set the offset of the table of embedded levels of detail, which requires
+ * the current version to read */
+void hal::MMapFile::setLodTableOffset(size_t offset) {
+    validateWriteAccess();
+    _header->lodTableOffset = offset;
+    strncpy(_header->mmapVersion, getMmapApiVersion().c_str(), sizeof(_header->mmapVersion) - 1);
+}
+
 /* create the header */
 void hal::MMapFile::createHeader() {
     assert(_mode & WRITE_ACCESS);
@@ -112,6 +123,7 @@ void hal::MMapFile::createHeader() {
     assert(HAL_VERSION.size() < sizeof(_header->halVersion));
     strncpy(_header->halVersion, HAL_VERSION.c_str(), sizeof(_header->halVersion) - 1);
     _header->nextOffset = alignRound(sizeof(MMapHeader));
+    _header->lodTableOffset = MMAP_NULL_OFFSET;
     _header->dirty = true;
     _header->nextOffset = _header->nextOffset;
 }
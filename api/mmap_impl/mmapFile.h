@@ -10,7 +10,7 @@
 namespace hal {
     /* Current API major and minor versions */
     static const unsigned MMAP_API_MAJOR_VERSION = 1;
-    static const unsigned MMAP_API_MINOR_VERSION = 1;
+    static const unsigned MMAP_API_MINOR_VERSION = 2;
 
     /* get current mmap version as a string */
     const std::string& getMmapCurentVersion();
@@ -27,7 +27,8 @@ namespace hal {
         size_t nextOffset;
         size_t rootOffset;
         bool dirty;
-        char _reserved[256];   // 256 bytes of reserved added in mmap API 1.1
+        size_t lodTableOffset; // embedded levels of detail, added in mmap API 1.2
+        char _reserved[256 - sizeof(size_t)];   // 256 bytes of reserved added in mmap API 1.1
     };
     typedef struct MMapHeader MMapHeader;
 
@@ -65,6 +66,10 @@ namespace hal {
         virtual bool isUdcProtocol() const = 0;
 
         inline size_t getRootOffset() const;
+        size_t getLodTableOffset() const {
+            return _header->lodTableOffset;
+        }
+        void setLodTableOffset(size_t offset);
         inline void *toPtr(size_t offset, size_t accessSize);
         inline const void *toPtr(size_t offset, size_t accessSize) const;
         inline size_t allocMem(size_t size, bool isRoot = false);
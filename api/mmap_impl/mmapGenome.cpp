@@ -37,10 +37,21 @@ void MMapGenome::setDimensions(const vector<Sequence::Info> &sequenceDimensions,
         bottomDimensions.push_back(Sequence::UpdateInfo(i->_name, i->_numBottomSegments));
     }
 
+    // A genome in an embedded level of detail with the same sequences as
+    // in the full alignment uses its DNA and sequence tables
+    const MMapGenome *sharedGenome = _alignment->getSharedGenome(_name);
+    if (sharedGenome != NULL && !sharedGenome->hasSameSequences(sequenceDimensions)) {
+        sharedGenome = NULL;
+    }
+
     // Write the new DNA/sequence information, allocating one base per nibble
     hal_size_t dnaLength = (totalSequenceLength + 1) / 2;
     _data->_totalSequenceLength = totalSequenceLength;
-    _data->_dnaOffset = _alignment->allocateNewArray(dnaLength);
+    if (sharedGenome != NULL) {
+        _data->_dnaOffset = sharedGenome->_data->_dnaOffset;
+    } else {
+        _data->_dnaOffset = _alignment->allocateNewArray(dnaLength);
+    }
     // Reverse space for the sequence data (plus an extra at the end
     // to indicate the end position of the sequence iterator).  FIXME: extra no longer needed
     _data->_sequencesOffset = _alignment->allocateNewArray(sizeof(MMapSequenceData) * sequenceDimensions.size() + 1);
@@ -49,7 +60,8 @@ void MMapGenome::setDimensions(const vector<Sequence::Info> &sequenceDimensions,
     hal_index_t topSegmentStartIndex = 0;
     hal_index_t bottomSegmentStartIndex = 0;
     for (size_t i = 0; i < sequenceDimensions.size(); ++i) {
-        setSequenceData(i, startPos, topSegmentStartIndex, bottomSegmentStartIndex, sequenceDimensions[i]);
+        setSequenceData(i, startPos, topSegmentStartIndex, bottomSegmentStartIndex, sequenceDimensions[i],
+                        sharedGenome != NULL ? sharedGenome->getSequenceData(i) : NULL);
         startPos += sequenceDimensions[i]._length;
         topSegmentStartIndex += sequenceDimensions[i]._numTopSegments;
         bottomSegmentStartIndex += sequenceDimensions[i]._numBottomSegments;
@@ -59,8 +71,57 @@ void MMapGenome::setDimensions(const vector<Sequence::Info> &sequenceDimensions,
     updateTopDimensions(topDimensions);
     updateBottomDimensions(bottomDimensions);
 
-    createSequenceNameHash(sequenceDimensions.size());
-    createGenomeSiteMap(sequenceDimensions.size());
+    if (sharedGenome != NULL) {
+        _data->_sequenceHashOffset = sharedGenome->_data->_sequenceHashOffset;
+        _sequenceNameHash = MMapPerfectHashTable(_alignment->getMMapFile(), _data->_sequenceHashOffset);
+        _data->_genomeSiteMapOffset = sharedGenome->_data->_genomeSiteMapOffset;
+        _genomeSiteMap = MMapGenomeSiteMap(_alignment->getMMapFile(), _data->_genomeSiteMapOffset);
+    } else {
+        createSequenceNameHash(sequenceDimensions.size());
+        createGenomeSiteMap(sequenceDimensions.size());
+    }
+}
+
+void MMapGenome::copyArrays(const MMapGenome *inGenome) {
+    size_t bottomSegmentSize = MMapBottomSegmentData::getSize(this);
+    if (_data->_totalSequenceLength != inGenome->_data->_totalSequenceLength ||
+        _data->_numTopSegments != inGenome->_data->_numTopSegments ||
+        _data->_numBottomSegments != inGenome->_data->_numBottomSegments ||
+        bottomSegmentSize != MMapBottomSegmentData::getSize(inGenome)) {
+        throw hal_exception("can't copy arrays of genome " + inGenome->getName() + " to a genome of other dimensions");
+    }
+    if (!isSharingSequences()) {
+        size_t dnaLength = (_data->_totalSequenceLength + 1) / 2;
+        memcpy(_alignment->resolveOffset(_data->_dnaOffset, dnaLength),
+               inGenome->_alignment->resolveOffset(inGenome->_data->_dnaOffset, dnaLength), dnaLength);
+    }
+    // the extra segment at the end of each array holds its end position
+    size_t topLength = (_data->_numTopSegments + 1) * sizeof(MMapTopSegmentData);
+    memcpy(_alignment->resolveOffset(_data->_topSegmentsOffset, topLength),
+           inGenome->_alignment->resolveOffset(inGenome->_data->_topSegmentsOffset, topLength), topLength);
+    size_t bottomLength = (_data->_numBottomSegments + 1) * bottomSegmentSize;
+    memcpy(_alignment->resolveOffset(_data->_bottomSegmentsOffset, bottomLength),
+           inGenome->_alignment->resolveOffset(inGenome->_data->_bottomSegmentsOffset, bottomLength), bottomLength);
+}
+
+/* check if the genome has sequences of the given names and lengths, in the
+ * same order */
+bool MMapGenome::hasSameSequences(const vector<Sequence::Info> &sequenceDimensions) const {
+    if (sequenceDimensions.size() != _data->_numSequences) {
+        return false;
+    }
+    for (size_t i = 0; i < sequenceDimensions.size(); ++i) {
+        const MMapSequenceData *data = getSequenceData(i);
+        if (data->_length != sequenceDimensions[i]._length || sequenceDimensions[i]._name != data->getName(_alignment)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MMapGenome::isSharingSequences() const {
+    const MMapGenome *sharedGenome = _alignment->getSharedGenome(_name);
+    return sharedGenome != NULL && sharedGenome->_data->_dnaOffset == _data->_dnaOffset;
 }
 
 /* must be called after sequences are created */
@@ -85,11 +146,12 @@ void MMapGenome::createGenomeSiteMap(size_t numSequences) {
 }
 
 void MMapGenome::setSequenceData(size_t i, hal_index_t startPos, hal_index_t topSegmentStartIndex,
-                                 hal_index_t bottomSegmentStartIndex, const Sequence::Info &sequenceInfo) {
+                                 hal_index_t bottomSegmentStartIndex, const Sequence::Info &sequenceInfo,
+                                 const MMapSequenceData *sharedData) {
     MMapSequenceData *data = getSequenceData(i);
-    MMapSequence *seq =
-        new MMapSequence(this, data, i, startPos, sequenceInfo._length, topSegmentStartIndex, bottomSegmentStartIndex,
-                         sequenceInfo._numTopSegments, sequenceInfo._numBottomSegments, sequenceInfo._name);
+    MMapSequence *seq = new MMapSequence(this, data, i, startPos, sequenceInfo._length, topSegmentStartIndex,
+                                         bottomSegmentStartIndex, sequenceInfo._numTopSegments,
+                                         sequenceInfo._numBottomSegments, sequenceInfo._name, sharedData);
     _sequenceObjCache[i] = seq;
 }
 
@@ -173,6 +235,11 @@ hal_size_t MMapGenome::getNumSequences() const {
 }
 
 Sequence *MMapGenome::getSequenceByIndex(hal_index_t index) {
+    // sized on first use rather than on open, so opening a genome doesn't
+    // cost anything per sequence
+    if (_sequenceObjCache.empty()) {
+        _sequenceObjCache.resize(_data->_numSequences);
+    }
     if (_sequenceObjCache[index] == NULL) {
         _sequenceObjCache[index] = new MMapSequence(this, getSequenceData(index));
     }
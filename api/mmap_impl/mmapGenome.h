@@ -52,7 +52,6 @@ namespace hal {
               _name(data->getName(_alignment)), _metaData(_alignment, _data->_metadataOffset),
               _sequenceNameHash(alignment->getMMapFile(), data->_sequenceHashOffset),
               _genomeSiteMap(alignment->getMMapFile(), data->_genomeSiteMapOffset) {
-            _sequenceObjCache.resize(data->_numSequences);
         };
         MMapGenome(MMapAlignment *alignment, MMapGenomeData *data, size_t arrayIndex, const std::string &name)
             : Genome(alignment, name), _alignment(alignment), _data(data), _arrayIndex(arrayIndex), _name(name),
@@ -60,7 +59,6 @@ namespace hal {
               _genomeSiteMap(alignment->getMMapFile(), data->_genomeSiteMapOffset) {
             _data->initializeName(_alignment, _name);
             _data->_metadataOffset = _metaData.getOffset();
-            _sequenceObjCache.resize(data->_numSequences);
         };
 
         virtual ~MMapGenome();
@@ -82,8 +80,22 @@ namespace hal {
             return _arrayIndex;
         }
 
+        size_t getNameOffset() const {
+            return _data->_nameOffset;
+        }
+
+        /* check if this genome is in an embedded level of detail and shares
+         * its sequences and DNA with the genome in the full alignment */
+        bool isSharingSequences() const;
+
         void setDimensions(const std::vector<hal::Sequence::Info> &sequenceDimensions, bool storeDNAArrays);
 
+        /* copy the DNA and segment arrays of a genome in another mmap
+         * alignment, as they are stored.  Its dimensions and number of
+         * children must already have been given to this genome.  DNA shared
+         * with the full alignment is left alone. */
+        void copyArrays(const MMapGenome *inGenome);
+
         void updateTopDimensions(const std::vector<hal::Sequence::UpdateInfo> &sequenceDimensions);
 
         void updateBottomDimensions(const std::vector<hal::Sequence::UpdateInfo> &sequenceDimensions);
@@ -168,8 +180,10 @@ namespace hal {
 
       private:
         void createGenomeSiteMap(size_t numSequences);
+        bool hasSameSequences(const std::vector<hal::Sequence::Info> &sequenceDimensions) const;
         void setSequenceData(size_t i, hal_index_t startPos, hal_index_t topSegmentStartIndex,
-                             hal_index_t bottomSegmentStartIndex, const Sequence::Info &sequenceInfo);
+                             hal_index_t bottomSegmentStartIndex, const Sequence::Info &sequenceInfo,
+                             const MMapSequenceData *sharedData);
         std::vector<Sequence::UpdateInfo> getCompleteInputDimensions(const std::vector<Sequence::UpdateInfo> &inputDimensions,
                                                                      bool isTop);
         void deleteSequenceCache();
@@ -189,13 +203,20 @@ namespace hal {
     }
 
     inline void MMapGenomeData::initializeName(MMapAlignment *alignment, const std::string &nameStr) {
-        MMapString name{alignment, nameStr};
-        _nameOffset = name.getOffset();
+        const MMapGenome *sharedGenome = alignment->getSharedGenome(nameStr);
+        if (sharedGenome != NULL) {
+            _nameOffset = sharedGenome->getNameOffset();
+        } else {
+            MMapString name{alignment, nameStr};
+            _nameOffset = name.getOffset();
+        }
     }
 
     inline void MMapGenomeData::setName(MMapAlignment *alignment, const std::string &newName) {
-        MMapString name{alignment, _nameOffset};
-        _nameOffset = name.set(newName);
+        // written to a new string, as the name may be shared with a level
+        // of detail
+        MMapString name{alignment, newName};
+        _nameOffset = name.getOffset();
     }
 
     inline MMapTopSegmentData *MMapGenomeData::getTopSegmentData(MMapAlignment *alignment, hal_index_t index) {
@@ -14,7 +14,8 @@ namespace hal {
 
         MMapSequence(MMapGenome *genome, MMapSequenceData *data, hal_index_t index, hal_index_t startPosition,
                      hal_size_t length, hal_index_t topSegmentStartIndex, hal_index_t bottomSegmentStartIndex,
-                     hal_size_t numTopSegments, hal_size_t numBottomSegments, const std::string &name)
+                     hal_size_t numTopSegments, hal_size_t numBottomSegments, const std::string &name,
+                     const MMapSequenceData *sharedData = NULL)
             : _genome(genome), _data(data) {
             _data->_index = index;
             _data->_startPosition = startPosition;
@@ -23,7 +24,12 @@ namespace hal {
             _data->_bottomSegmentStartIndex = bottomSegmentStartIndex;
             _data->_numTopSegments = numTopSegments;
             _data->_numBottomSegments = numBottomSegments;
-            _data->setName(_genome->_alignment, name);
+            if (sharedData != NULL) {
+                // same sequence in the alignment a level of detail is embedded in
+                _data->shareName(*sharedData);
+            } else {
+                _data->setName(_genome->_alignment, name);
+            }
         };
 
         // SEQUENCE INTERFACE
@@ -16,6 +16,10 @@ namespace hal {
             strncpy((char *)alignment->resolveOffset(_nameOffset, size), newName.c_str(), size);
             _nameLength = size;
         };
+        void shareName(const MMapSequenceData &other) {
+            _nameOffset = other._nameOffset;
+            _nameLength = other._nameLength;
+        }
 
       private:
         hal_index_t _startPosition;
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include "commonC.h"
+}
+
+using namespace std;
+using namespace hal;
+
+static RandNumberGen rng;
+
+static void copyFile(const string &srcPath, const string &destPath) {
+    ifstream src(srcPath.c_str(), ios::binary);
+    ofstream dest(destPath.c_str(), ios::binary);
+    dest << src.rdbuf();
+}
+
+static off_t getFileSize(const string &path) {
+    struct stat fileStat;
+    return stat(path.c_str(), &fileStat) == 0 ? fileStat.st_size : -1;
+}
+
+/* check that the segments of two genomes are the same */
+static void checkSegments(CuTest *testCase, const Genome *genome, const Genome *source) {
+    TopSegmentIteratorPtr topIt = genome->getTopSegmentIterator();
+    TopSegmentIteratorPtr sourceTopIt = source->getTopSegmentIterator();
+    for (; not sourceTopIt->atEnd(); topIt->toRight(), sourceTopIt->toRight()) {
+        const TopSegment *top = topIt->tseg();
+        const TopSegment *sourceTop = sourceTopIt->tseg();
+        CuAssertTrue(testCase, top->getStartPosition() == sourceTop->getStartPosition());
+        CuAssertTrue(testCase, top->getLength() == sourceTop->getLength());
+        CuAssertTrue(testCase, top->getParentIndex() == sourceTop->getParentIndex());
+        CuAssertTrue(testCase, top->getParentReversed() == sourceTop->getParentReversed());
+        CuAssertTrue(testCase, top->getNextParalogyIndex() == sourceTop->getNextParalogyIndex());
+        CuAssertTrue(testCase, top->getBottomParseIndex() == sourceTop->getBottomParseIndex());
+    }
+    BottomSegmentIteratorPtr bottomIt = genome->getBottomSegmentIterator();
+    BottomSegmentIteratorPtr sourceBottomIt = source->getBottomSegmentIterator();
+    for (; not sourceBottomIt->atEnd(); bottomIt->toRight(), sourceBottomIt->toRight()) {
+        const BottomSegment *bottom = bottomIt->bseg();
+        const BottomSegment *sourceBottom = sourceBottomIt->bseg();
+        CuAssertTrue(testCase, bottom->getStartPosition() == sourceBottom->getStartPosition());
+        CuAssertTrue(testCase, bottom->getLength() == sourceBottom->getLength());
+        CuAssertTrue(testCase, bottom->getTopParseIndex() == sourceBottom->getTopParseIndex());
+        for (hal_size_t i = 0; i < sourceBottom->getNumChildren(); ++i) {
+            CuAssertTrue(testCase, bottom->getChildIndex(i) == sourceBottom->getChildIndex(i));
+            CuAssertTrue(testCase, bottom->getChildReversed(i) == sourceBottom->getChildReversed(i));
+        }
+    }
+}
+
+/* check that a compacted alignment has the same genomes as its source */
+static void checkCompacted(CuTest *testCase, const Alignment *alignment, const Alignment *source) {
+    CuAssertTrue(testCase, alignment->getNumGenomes() == source->getNumGenomes());
+    CuAssertTrue(testCase, alignment->getNewickTree() == source->getNewickTree());
+    vector<string> names;
+    names.push_back(source->getRootName());
+    for (size_t i = 0; i < names.size(); ++i) {
+        const Genome *sourceGenome = source->openGenome(names[i]);
+        const Genome *genome = alignment->openGenome(names[i]);
+        CuAssertTrue(testCase, genome != NULL);
+        CuAssertTrue(testCase, genome->getSequenceLength() == sourceGenome->getSequenceLength());
+        CuAssertTrue(testCase, genome->getNumSequences() == sourceGenome->getNumSequences());
+        CuAssertTrue(testCase, genome->getNumTopSegments() == sourceGenome->getNumTopSegments());
+        CuAssertTrue(testCase, genome->getNumBottomSegments() == sourceGenome->getNumBottomSegments());
+        CuAssertTrue(testCase, genome->getMetaData()->getMap() == sourceGenome->getMetaData()->getMap());
+        string dna, sourceDna;
+        genome->getString(dna);
+        sourceGenome->getString(sourceDna);
+        CuAssertTrue(testCase, dna == sourceDna);
+        for (SequenceIteratorPtr seqIt = sourceGenome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
+            const Sequence *sequence = genome->getSequence(seqIt->getSequence()->getName());
+            CuAssertTrue(testCase, sequence != NULL);
+            CuAssertTrue(testCase, sequence->getArrayIndex() == seqIt->getSequence()->getArrayIndex());
+        }
+        checkSegments(testCase, genome, sourceGenome);
+        vector<string> children = source->getChildNames(names[i]);
+        names.insert(names.end(), children.begin(), children.end());
+    }
+}
+
+static void halCompactTest(CuTest *testCase) {
+    string alignmentPath = getTempFile();
+    string levelPath = getTempFile();
+    string compactedPath = getTempFile();
+    try {
+        AlignmentPtr calignment(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, alignmentPath, CREATE_ACCESS));
+        createRandomAlignment(rng, calignment, 0.75, 0.1, 2, 5, 10, 1000, 5, 10);
+        calignment->close();
+        copyFile(alignmentPath, levelPath);
+
+        // changes made in place leave what they replace in the file
+        AlignmentPtr walignment(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, alignmentPath, WRITE_ACCESS));
+        Genome *genome = walignment->openGenome(walignment->getRootName());
+        Sequence *sequence = genome->getSequenceIterator()->getSequence();
+        string newName = sequence->getName() + "_renamed_in_place";
+        sequence->setName(newName);
+        genome->getMetaData()->set("compacted", "yes");
+        AlignmentConstPtr level(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, levelPath, READ_ACCESS));
+        embedLodLevel(walignment, level, 1000);
+        setEmbeddedLodLimit(walignment, 50000);
+        walignment->close();
+        level->close();
+
+        AlignmentConstPtr source(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, alignmentPath, READ_ACCESS));
+        compactHalAlignment(source, compactedPath);
+        CuAssertTrue(testCase, getFileSize(compactedPath) < getFileSize(alignmentPath));
+
+        AlignmentConstPtr compacted(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, compactedPath, READ_ACCESS));
+        checkCompacted(testCase, compacted.get(), source.get());
+        validateAlignment(compacted.get());
+        // the sequence name hash is rebuilt from the names
+        CuAssertTrue(testCase, compacted->openGenome(compacted->getRootName())->getSequence(newName) != NULL);
+
+        hal_size_t maxLodLowerBound = 0, sourceMaxLodLowerBound = 0;
+        map<hal_size_t, size_t> levels = getEmbeddedLodLevels(compacted, maxLodLowerBound);
+        map<hal_size_t, size_t> sourceLevels = getEmbeddedLodLevels(source, sourceMaxLodLowerBound);
+        CuAssertTrue(testCase, levels.size() == 1);
+        CuAssertTrue(testCase, levels.begin()->first == 1000);
+        CuAssertTrue(testCase, maxLodLowerBound == 50000);
+        AlignmentConstPtr embedded(openEmbeddedLodLevel(compacted, levels.begin()->second));
+        AlignmentConstPtr sourceEmbedded(openEmbeddedLodLevel(source, sourceLevels.begin()->second));
+        checkCompacted(testCase, embedded.get(), sourceEmbedded.get());
+        validateAlignment(embedded.get());
+        embedded->close();
+        sourceEmbedded->close();
+        compacted->close();
+        source->close();
+    } catch (const exception &e) {
+        CuFail(testCase, stString_print("Caught exception while testing: %s", e.what()));
+    }
+    ::unlink(alignmentPath.c_str());
+    ::unlink(levelPath.c_str());
+    ::unlink(compactedPath.c_str());
+}
+
+static void halCompactHdf5Test(CuTest *testCase) {
+    string alignmentPath = getTempFile();
+    string compactedPath = getTempFile();
+    AlignmentPtr alignment(getTestAlignmentInstances(STORAGE_FORMAT_HDF5, alignmentPath, CREATE_ACCESS));
+    try {
+        compactHalAlignment(alignment, compactedPath);
+        CuFail(testCase, "compacting hdf5 not rejected");
+    } catch (const hal_exception &e) {
+    }
+    alignment->close();
+    ::unlink(alignmentPath.c_str());
+    ::unlink(compactedPath.c_str());
+}
+
+static CuSuite *halCompactTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halCompactTest);
+    SUITE_ADD_TEST(suite, halCompactHdf5Test);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halCompactTestSuite());
+}
@@ -144,6 +144,61 @@ struct GenomeStringTest : public AlignmentTest {
     }
 };
 
+struct GenomeMaskIndexTest : public AlignmentTest {
+    std::string _string;
+    void createCallBack(AlignmentPtr alignment) {
+        // longer than a chunk of the index build
+        hal_size_t seqLength = 2500000;
+        Genome *ancGenome = alignment->addRootGenome("AncGenome", 0);
+        vector<Sequence::Info> seqVec(1);
+        seqVec[0] = Sequence::Info("Sequence", seqLength, 0, 0);
+        ancGenome->setDimensions(seqVec);
+        _string = randomString(seqLength);
+        ancGenome->setString(_string);
+        // not built while the DNA can change
+        CuAssertTrue(_testCase, ancGenome->getDnaMaskIndex() == NULL);
+    }
+
+    void checkRuns(const DnaMaskIndex::RunVector &runs, bool (*inRun)(char)) {
+        size_t r = 0;
+        for (size_t i = 0; i < _string.length();) {
+            if (!inRun(_string[i])) {
+                ++i;
+                continue;
+            }
+            size_t j = i;
+            while (j < _string.length() && inRun(_string[j])) {
+                ++j;
+            }
+            CuAssertTrue(_testCase, r < runs.size());
+            CuAssertTrue(_testCase, runs[r]._start == (hal_index_t)i && runs[r]._end == (hal_index_t)j);
+            ++r;
+            i = j;
+        }
+        CuAssertTrue(_testCase, r == runs.size());
+    }
+
+    void checkCallBack(AlignmentConstPtr alignment) {
+        const Genome *ancGenome = alignment->openGenome("AncGenome");
+        const DnaMaskIndex *maskIndex = ancGenome->getDnaMaskIndex();
+        CuAssertTrue(_testCase, maskIndex != NULL);
+        CuAssertTrue(_testCase, ancGenome->getDnaMaskIndex() == maskIndex);
+        checkRuns(maskIndex->getMaskedRuns(), isMasked);
+        checkRuns(maskIndex->getMissingRuns(), isMissingData);
+        for (size_t k = 0; k < 100; ++k) {
+            hal_index_t start = rand() % _string.length();
+            hal_size_t length = rand() % min((size_t)10000, _string.length() - start + 1);
+            hal_size_t numMasked = 0, numMissing = 0;
+            for (hal_size_t i = start; i < start + length; ++i) {
+                numMasked += isMasked(_string[i]);
+                numMissing += isMissingData(_string[i]);
+            }
+            CuAssertTrue(_testCase, maskIndex->getNumMasked(start, length) == numMasked);
+            CuAssertTrue(_testCase, maskIndex->getNumMissing(start, length) == numMissing);
+        }
+    }
+};
+
 struct GenomeCopyTest : public AlignmentTest {
     std::string _path;
     AlignmentPtr _secondAlignment;
@@ -556,6 +611,11 @@ static void halGenomeStringTest(CuTest *testCase) {
     tester.check(testCase);
 }
 
+static void halGenomeMaskIndexTest(CuTest *testCase) {
+    GenomeMaskIndexTest tester;
+    tester.check(testCase);
+}
+
 static void halGenomeCopyTest(CuTest *testCase) {
     GenomeCopyTest tester;
     tester.check(testCase);
@@ -578,6 +638,7 @@ static CuSuite *halGenomeTestSuite(void) {
     SUITE_ADD_TEST(suite, halGenomeCreateTest);
     SUITE_ADD_TEST(suite, halGenomeUpdateTest);
     SUITE_ADD_TEST(suite, halGenomeStringTest);
+    SUITE_ADD_TEST(suite, halGenomeMaskIndexTest);
     SUITE_ADD_TEST(suite, halGenomeCopyTest);
     SUITE_ADD_TEST(suite, halGenomeCopySegmentsWhenSequencesOutOfOrderTest);
     SUITE_ADD_TEST(suite, halGenomeDNAPackUnpackTest);
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halApiTestSupport.h"
+#include "halRandNumberGen.h"
+#include "halRandomData.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+extern "C" {
+#include "commonC.h"
+}
+
+using namespace std;
+using namespace hal;
+
+static RandNumberGen rng;
+
+static void copyFile(const string &srcPath, const string &destPath) {
+    ifstream src(srcPath.c_str(), ios::binary);
+    ofstream dest(destPath.c_str(), ios::binary);
+    dest << src.rdbuf();
+}
+
+/* check that a level matches the alignment it was copied from */
+static void checkLevel(CuTest *testCase, const Alignment *level, const Alignment *source) {
+    CuAssertTrue(testCase, level->getNumGenomes() == source->getNumGenomes());
+    CuAssertTrue(testCase, level->getNewickTree() == source->getNewickTree());
+    vector<string> names;
+    names.push_back(source->getRootName());
+    for (size_t i = 0; i < names.size(); ++i) {
+        const Genome *sourceGenome = source->openGenome(names[i]);
+        const Genome *levelGenome = level->openGenome(names[i]);
+        CuAssertTrue(testCase, levelGenome != NULL);
+        CuAssertTrue(testCase, levelGenome->getSequenceLength() == sourceGenome->getSequenceLength());
+        CuAssertTrue(testCase, levelGenome->getNumSequences() == sourceGenome->getNumSequences());
+        CuAssertTrue(testCase, levelGenome->getNumTopSegments() == sourceGenome->getNumTopSegments());
+        CuAssertTrue(testCase, levelGenome->getNumBottomSegments() == sourceGenome->getNumBottomSegments());
+        string levelDna, sourceDna;
+        levelGenome->getString(levelDna);
+        sourceGenome->getString(sourceDna);
+        CuAssertTrue(testCase, levelDna == sourceDna);
+        vector<string> children = source->getChildNames(names[i]);
+        names.insert(names.end(), children.begin(), children.end());
+    }
+}
+
+static void halLodEmbedTest(CuTest *testCase) {
+    string alignmentPath = getTempFile();
+    string levelPath = getTempFile();
+    try {
+        AlignmentPtr calignment(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, alignmentPath, CREATE_ACCESS));
+        createRandomAlignment(rng, calignment, 0.75, 0.1, 2, 5, 10, 1000, 5, 10);
+        calignment->close();
+        // a copy has the same sequences, so shares the DNA of the original
+        copyFile(alignmentPath, levelPath);
+
+        AlignmentPtr walignment(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, alignmentPath, WRITE_ACCESS));
+        AlignmentConstPtr level(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, levelPath, READ_ACCESS));
+        embedLodLevel(walignment, level, 1000);
+        try {
+            embedLodLevel(walignment, level, 1000);
+            CuFail(testCase, "duplicate level not rejected");
+        } catch (const hal_exception &e) {
+        }
+        setEmbeddedLodLimit(walignment, 50000);
+        walignment->close();
+
+        AlignmentConstPtr ralignment(getTestAlignmentInstances(STORAGE_FORMAT_MMAP, alignmentPath, READ_ACCESS));
+        hal_size_t maxLodLowerBound = 0;
+        map<hal_size_t, size_t> levels = getEmbeddedLodLevels(ralignment, maxLodLowerBound);
+        CuAssertTrue(testCase, levels.size() == 1);
+        CuAssertTrue(testCase, levels.begin()->first == 1000);
+        CuAssertTrue(testCase, maxLodLowerBound == 50000);
+        checkLevel(testCase, ralignment.get(), level.get());
+        AlignmentConstPtr embedded(openEmbeddedLodLevel(ralignment, levels.begin()->second));
+        checkLevel(testCase, embedded.get(), level.get());
+        validateAlignment(embedded.get());
+        embedded->close();
+        ralignment->close();
+        level->close();
+    } catch (const exception &e) {
+        CuFail(testCase, stString_print("Caught exception while testing: %s", e.what()));
+    }
+    ::unlink(alignmentPath.c_str());
+    ::unlink(levelPath.c_str());
+}
+
+static void halLodEmbedHdf5Test(CuTest *testCase) {
+    string alignmentPath = getTempFile();
+    AlignmentPtr alignment(getTestAlignmentInstances(STORAGE_FORMAT_HDF5, alignmentPath, CREATE_ACCESS));
+    hal_size_t maxLodLowerBound = 0;
+    CuAssertTrue(testCase, getEmbeddedLodLevels(alignment, maxLodLowerBound).empty());
+    try {
+        embedLodLevel(alignment, alignment, 1000);
+        CuFail(testCase, "embedding in hdf5 not rejected");
+    } catch (const hal_exception &e) {
+    }
+    alignment->close();
+    ::unlink(alignmentPath.c_str());
+}
+
+static CuSuite *halLodEmbedTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halLodEmbedTest);
+    SUITE_ADD_TEST(suite, halLodEmbedHdf5Test);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halLodEmbedTestSuite());
+}
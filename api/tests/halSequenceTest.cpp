@@ -81,6 +81,16 @@ struct SequenceCreateTest : public AlignmentTest {
         seq = ancGenome->getSequenceBySite(45);
         CuAssertTrue(_testCase, seq->getName() == "sequence4");
 
+        // names sort differently from the array order
+        for (hal_size_t i = 0; i < numSequences; i += 7) {
+            seq = ancGenome->getSequence("sequence" + std::to_string(i));
+            CuAssertTrue(_testCase, seq != NULL && seq->getArrayIndex() == (hal_index_t)i);
+        }
+        CuAssertTrue(_testCase, ancGenome->getSequence("sequence") == NULL);
+        CuAssertTrue(_testCase, ancGenome->getSequence("sequence1000") == NULL);
+        CuAssertTrue(_testCase, ancGenome->getSequence("aaa") == NULL);
+        CuAssertTrue(_testCase, ancGenome->getSequence("zzz") == NULL);
+
         CuAssertTrue(_testCase, ancGenome->getSequenceLength() == totalLength);
         CuAssertTrue(_testCase, ancGenome->getNumTopSegments() == numTopSegments);
         CuAssertTrue(_testCase, ancGenome->getNumBottomSegments() == numBottomSegments);
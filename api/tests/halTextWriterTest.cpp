@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halApiTestSupport.h"
+#include "halTextWriter.h"
+#include <limits>
+#include <sstream>
+
+/* write the same values with a TextWriter and a stream, with a small buffer
+ * so it is written many times */
+static void checkValues(CuTest *testCase, bool backgroundFlush) {
+    ostringstream expected;
+    ostringstream result;
+    {
+        TextWriter out(result, backgroundFlush, 64);
+        for (hal_index_t i = -1000; i <= 1000; ++i) {
+            out << i << '\t';
+            expected << i << '\t';
+        }
+        out << numeric_limits<int64_t>::min() << ' ' << numeric_limits<int64_t>::max() << ' '
+            << numeric_limits<uint64_t>::max() << ' ' << numeric_limits<int>::min() << '\n';
+        expected << numeric_limits<int64_t>::min() << ' ' << numeric_limits<int64_t>::max() << ' '
+                 << numeric_limits<uint64_t>::max() << ' ' << numeric_limits<int>::min() << '\n';
+        const double doubles[] = {0.0, -0.5, 1.0 / 3.0, 1e-7, 123456789.0, 2.5e20, 42.0};
+        for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); ++i) {
+            out << doubles[i] << ',';
+            expected << doubles[i] << ',';
+        }
+        string text(1000, 'x');
+        out << "chr1" << text << string("chr2") << (unsigned char)'+';
+        expected << "chr1" << text << string("chr2") << (unsigned char)'+';
+        out.flush();
+        CuAssertTrue(testCase, result.str() == expected.str());
+        out << "end\n";
+        expected << "end\n";
+    }
+    // the destructor writes what was left
+    CuAssertTrue(testCase, result.str() == expected.str());
+}
+
+static void halTextWriterTest(CuTest *testCase) {
+    checkValues(testCase, false);
+}
+
+static void halTextWriterBackgroundTest(CuTest *testCase) {
+    checkValues(testCase, true);
+}
+
+static CuSuite *halTextWriterTestSuite(void) {
+    CuSuite *suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, halTextWriterTest);
+    SUITE_ADD_TEST(suite, halTextWriterBackgroundTest);
+    return suite;
+}
+
+int main(int argc, char *argv[]) {
+    return runHalTestSuite(argc, argv, halTextWriterTestSuite());
+}
@@ -497,6 +497,97 @@ struct TopSegmentIsGapTest : public AlignmentTest {
     }
 };
 
+// string-based reference for compareBases
+static BaseComparison countBaseDifferences(const string &s1, const string &s2) {
+    BaseComparison counts;
+    for (size_t i = 0; i < s1.length(); ++i) {
+        if (isMissingData(s1[i]) && isMissingData(s2[i])) {
+            counts._bothN++;
+        } else if (isMissingData(s1[i]) || isMissingData(s2[i])) {
+            counts._baseN++;
+        } else if (!isSubstitution(s1[i], s2[i])) {
+            counts._matches++;
+        } else if (isTransition(s1[i], s2[i])) {
+            counts._transitions++;
+        } else {
+            counts._transversions++;
+        }
+    }
+    return counts;
+}
+
+struct TopSegmentCompareBasesTest : public AlignmentTest {
+    static const hal_size_t length = 101;
+
+    static string makeDna(hal_size_t seed) {
+        static const char bases[] = "ACGTNacgtn";
+        string dna;
+        for (hal_size_t i = 0; i < length; ++i) {
+            seed = seed * 1103515245 + 12345;
+            dna += bases[(seed >> 16) % 10];
+        }
+        return dna;
+    }
+
+    void createCallBack(AlignmentPtr alignment) {
+        vector<Sequence::Info> seqVec(1);
+        BottomSegmentIteratorPtr bi;
+        BottomSegmentStruct bs;
+        TopSegmentIteratorPtr ti;
+        TopSegmentStruct ts;
+
+        Genome *parent = alignment->addRootGenome("parent");
+        Genome *child = alignment->addLeafGenome("child", "parent", 1);
+        seqVec[0] = Sequence::Info("Sequence", length, 0, 1);
+        parent->setDimensions(seqVec);
+        seqVec[0] = Sequence::Info("Sequence", length, 1, 0);
+        child->setDimensions(seqVec);
+        parent->setString(makeDna(1));
+        child->setString(makeDna(2));
+
+        bi = parent->getBottomSegmentIterator();
+        bs.set(0, length, 0);
+        bs._children.push_back(pair<hal_size_t, bool>(0, true));
+        bs.applyTo(bi);
+        ti = child->getTopSegmentIterator();
+        ts.set(0, length, 0, true, 0);
+        ts.applyTo(ti);
+    }
+
+    void checkSlices(BottomSegmentIteratorPtr bi, TopSegmentIteratorPtr ti) {
+        string bString, tString;
+        for (hal_offset_t start = 0; start < 20; ++start) {
+            for (hal_offset_t end = 0; end < 20; ++end) {
+                bi->slice(start, end);
+                ti->toChild(bi, 0);
+                bi->getString(bString);
+                ti->getString(tString);
+                BaseComparison expected = countBaseDifferences(bString, tString);
+                BaseComparison counts;
+                bi->compareBases(*ti, counts);
+                CuAssertTrue(_testCase, counts._matches == expected._matches);
+                CuAssertTrue(_testCase, counts._transitions == expected._transitions);
+                CuAssertTrue(_testCase, counts._transversions == expected._transversions);
+                CuAssertTrue(_testCase, counts._baseN == expected._baseN);
+                CuAssertTrue(_testCase, counts._bothN == expected._bothN);
+                CuAssertTrue(_testCase, counts.getSubstitutions() == hammingDistance(bString, tString));
+            }
+        }
+    }
+
+    void checkCallBack(AlignmentConstPtr alignment) {
+        const Genome *parent = alignment->openGenome("parent");
+        const Genome *child = alignment->openGenome("child");
+        BottomSegmentIteratorPtr bi = parent->getBottomSegmentIterator();
+        TopSegmentIteratorPtr ti = child->getTopSegmentIterator();
+        // child is reversed relative to parent, then both reversed
+        checkSlices(bi, ti);
+        bi->toReverse();
+        checkSlices(bi, ti);
+        CuAssertTrue(_testCase, ti->getReversed() == false);
+    }
+};
+
 static void halTopSegmentSimpleIteratorTest(CuTest *testCase) {
     TopSegmentSimpleIteratorTest tester;
     tester.check(testCase);
@@ -527,6 +618,11 @@ static void halTopSegmentIsGapTest(CuTest *testCase) {
     tester.check(testCase);
 }
 
+static void halTopSegmentCompareBasesTest(CuTest *testCase) {
+    TopSegmentCompareBasesTest tester;
+    tester.check(testCase);
+}
+
 static CuSuite *halTopSegmentTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, halTopSegmentSimpleIteratorTest);
@@ -535,6 +631,7 @@ static CuSuite *halTopSegmentTestSuite(void) {
     SUITE_ADD_TEST(suite, halTopSegmentIteratorToSiteTest);
     SUITE_ADD_TEST(suite, halTopSegmentIteratorReverseTest);
     SUITE_ADD_TEST(suite, halTopSegmentIsGapTest);
+    SUITE_ADD_TEST(suite, halTopSegmentCompareBasesTest);
     return suite;
 }
 
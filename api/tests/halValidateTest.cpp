@@ -68,6 +68,58 @@ struct ValidateManyGenomesTest : public AlignmentTest {
     }
 };
 
+struct ValidateCorruptTest : public AlignmentTest {
+    string _parentName;
+    string _childName;
+
+    void createCallBack(AlignmentPtr alignment) {
+        createRandomAlignment(rng, alignment, 0.75, 0.1, 2, 5, 10, 1000, 50, 100);
+        _parentName = alignment->getRootName();
+        _childName = alignment->getChildNames(_parentName)[0];
+        Genome *child = alignment->openGenome(_childName);
+        // flipping the orientation of a parent link breaks it in the parent,
+        // and a link past the end of the parent breaks it in the child
+        hal_index_t numParentSegments = alignment->openGenome(_parentName)->getNumBottomSegments();
+        bool flipped = false, outOfRange = false;
+        for (TopSegmentIteratorPtr topIt = child->getTopSegmentIterator(); not topIt->atEnd(); topIt->toRight()) {
+            TopSegment *topSegment = topIt->getTopSegment();
+            if (!topSegment->hasParent() || topSegment->hasNextParalogy()) {
+                continue;
+            }
+            if (!flipped) {
+                topSegment->setParentReversed(!topSegment->getParentReversed());
+                flipped = true;
+            } else if (!outOfRange) {
+                topSegment->setParentIndex(numParentSegments);
+                outOfRange = true;
+            }
+        }
+        if (!flipped || !outOfRange) {
+            throw hal_exception("no segments to corrupt in genome " + _childName);
+        }
+    }
+
+    void checkCallBack(AlignmentConstPtr alignment) {
+        vector<AlignmentConstPtr> alignments(1, alignment);
+        vector<GenomeValidation> validations = checkAlignment(alignments, 10);
+        CuAssertTrue(_testCase, validations.size() == alignment->getNumGenomes());
+        CuAssertTrue(_testCase, validations[0]._genomeName == _parentName);
+        for (const GenomeValidation &validation : validations) {
+            if (validation._genomeName == _parentName || validation._genomeName == _childName) {
+                CuAssertTrue(_testCase, !validation._violations.empty());
+            } else {
+                CuAssertTrue(_testCase, validation._violations.empty());
+            }
+        }
+        CuAssertTrue(_testCase, checkGenome(alignment->openGenome(_parentName), 1)._violations.size() == 1);
+        try {
+            validateAlignment(alignment.get());
+            CuFail(_testCase, "corrupt alignment not rejected");
+        } catch (const hal_exception &e) {
+        }
+    }
+};
+
 static void halValidateSmallTest(CuTest *testCase) {
     ValidateSmallTest tester;
     tester.check(testCase);
@@ -88,11 +140,17 @@ static void halValidateManyGenomesTest(CuTest *testCase) {
     tester.check(testCase);
 }
 
+static void halValidateCorruptTest(CuTest *testCase) {
+    ValidateCorruptTest tester;
+    tester.check(testCase);
+}
+
 static CuSuite *halValidateTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, halValidateSmallTest);
     SUITE_ADD_TEST(suite, halValidateMediumTest);
     SUITE_ADD_TEST(suite, halValidateManyGenomesTest);
+    SUITE_ADD_TEST(suite, halValidateCorruptTest);
     if (false) {// FIXME: this is very slow
         SUITE_ADD_TEST(suite, halValidateLargeTest);
     }
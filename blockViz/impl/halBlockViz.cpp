@@ -9,6 +9,8 @@
 #include "hal.h"
 #include "halAlignmentInstance.h"
 #include "halBlockMapper.h"
+#include "halBlockVizArena.h"
+#include "halBlockVizCache.h"
 #include "halLodManager.h"
 #include "halMafExport.h"
 #include <algorithm>
@@ -23,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <tuple>
 #include <unordered_map>
 
 #ifdef ENABLE_UDC
@@ -51,6 +54,13 @@ using namespace hal;
 typedef map<int, pair<string, LodManagerPtr>> HandleMap;
 static HandleMap handleMap;
 
+/* computed blocks, disabled until halSetBlockCache is called */
+static BlockVizCache blockCache;
+
+/* queries covering more tiles than this are computed directly, as they
+ * would just flush the cache */
+static const hal_index_t MAX_CACHED_TILES_PER_QUERY = 64;
+
 static int openLodOrHal(char *inputPath, bool isLod, char **errStr);
 static void checkHandle(int handle);
 static void checkGenomes(int halHandle, AlignmentConstPtr alignment, const string &qSpecies, const string &tSpecies,
@@ -60,14 +70,27 @@ static AlignmentConstPtr getExistingAlignment(int handle, hal_size_t queryLength
 static bool isAlignmentLod0(int handle, hal_size_t queryLength);
 static char *copyCString(const string &inString);
 
-static hal_block_results_t *readBlocks(AlignmentConstPtr seqAlignment, const Sequence *tSequence, hal_index_t absStart,
-                                       hal_index_t absEnd, bool tReversed, const Genome *qGenome, bool getSequenceString,
-                                       bool doDupes, bool doTargetDupes, bool doAdjes, const char *coalescenceLimitName);
+static hal_block_arena_results_t *readBlocks(AlignmentConstPtr seqAlignment, const Sequence *tSequence,
+                                             hal_index_t absStart, hal_index_t absEnd, bool tReversed, const Genome *qGenome,
+                                             bool getSequenceString, bool doDupes, bool doTargetDupes, bool doAdjes,
+                                             const char *coalescenceLimitName, BlockVizArena &arena);
 
 static void readBlock(AlignmentConstPtr seqAlignment, hal_block_t *cur, vector<MappedSegmentPtr> &fragments,
-                      bool getSequenceString, const string &genomeName);
+                      bool getSequenceString, const string &genomeName, BlockVizArena &arena);
+
+static bool isBlockCacheable(const Sequence *tSequence, hal_index_t absStart, hal_index_t absEnd, bool tReversed,
+                             bool doAdjes);
+
+static hal_block_arena_results_t *readCachedBlocks(int halHandle, AlignmentConstPtr alignment,
+                                                   AlignmentConstPtr seqAlignment, const Sequence *tSequence,
+                                                   hal_index_t absStart, hal_index_t absEnd, const Genome *qGenome,
+                                                   bool getSequenceString, hal_dup_type_t dupMode,
+                                                   const char *coalescenceLimitName, BlockVizArena &arena);
 
-static hal_target_dupe_list_t *processTargetDupes(BlockMapper &blockMapper, MappedSegmentSet &paraSet);
+static void processTargetDupes(BlockMapper &blockMapper, MappedSegmentSet &paraSet, BlockVizArena &arena,
+                               hal_block_arena_results_t *results);
+
+static hal_block_results_t *copyArenaResults(const hal_block_arena_results_t *arenaResults);
 
 static void chainReferenceParalogies(MappedSegmentSet& segMap, hal_index_t absStart, hal_index_t absEnd,
                                      MappedSegmentSet& outParalogies, double min_chain_pct = 0.025);
@@ -167,6 +190,7 @@ extern "C" int halClose(int handle, char **errStr) {
             handleError("halClose error on handle: " + std::to_string(handle) + ": not found", errStr);
             return -1;
         }
+        blockCache.eraseHandle(handle);
         handleMap.erase(mapIt);
     } catch (exception &e) {
         halUnlock();
@@ -215,6 +239,13 @@ extern "C" void halFreeBlockResults(struct hal_block_results_t *results) {
     }
 }
 
+extern "C" void halFreeBlockArenaResults(struct hal_block_arena_results_t *results) {
+    if (results != NULL) {
+        // results are themselves in the arena
+        freeBlockVizArena(results->arena);
+    }
+}
+
 extern "C" void halFreeBlocks(struct hal_block_t *head) {
     while (head != NULL) {
         hal_block_t *next = head->next;
@@ -245,9 +276,25 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
                                                                  hal_seqmode_type_t seqMode, hal_dup_type_t dupMode,
                                                                  int mapBackAdjacencies, const char *coalescenceLimitName,
                                                                  char **errStr) {
+    hal_block_arena_results_t *arenaResults =
+        halGetBlocksInTargetRangeArena(halHandle, qSpecies, tSpecies, tChrom, tStart, tEnd, tReversed, seqMode, dupMode,
+                                       mapBackAdjacencies, coalescenceLimitName, errStr);
+    if (arenaResults == NULL) {
+        return NULL;
+    }
+    hal_block_results_t *results = copyArenaResults(arenaResults);
+    halFreeBlockArenaResults(arenaResults);
+    return results;
+}
+
+extern "C" struct hal_block_arena_results_t *
+halGetBlocksInTargetRangeArena(int halHandle, char *qSpecies, char *tSpecies, char *tChrom, hal_int_t tStart, hal_int_t tEnd,
+                               hal_int_t tReversed, hal_seqmode_type_t seqMode, hal_dup_type_t dupMode,
+                               int mapBackAdjacencies, const char *coalescenceLimitName, char **errStr) {
     halLock();
-    hal_block_results_t *results = NULL;
+    hal_block_arena_results_t *results = NULL;
     try {
+        BlockVizArena arena;
         hal_int_t rangeLength = tEnd - tStart;
         if (rangeLength < 0) {
             halUnlock();
@@ -318,10 +365,16 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
             seqAlignment = getExistingAlignment(halHandle, absEnd - absStart, true);
         }
 
-        results = readBlocks(seqAlignment, tSequence, absStart, absEnd, tReversed != 0, qGenome, getSequenceString,
-                             dupMode != HAL_NO_DUPS, dupMode == HAL_QUERY_AND_TARGET_DUPS,
-                             mapBackAdjacencies != 0,
-                             coalescenceLimitName);
+        if (isBlockCacheable(tSequence, absStart, absEnd, tReversed != 0, mapBackAdjacencies != 0)) {
+            results = readCachedBlocks(halHandle, alignment, seqAlignment, tSequence, absStart, absEnd, qGenome,
+                                       getSequenceString, dupMode, coalescenceLimitName, arena);
+        } else {
+            results = readBlocks(seqAlignment, tSequence, absStart, absEnd, tReversed != 0, qGenome, getSequenceString,
+                                 dupMode != HAL_NO_DUPS, dupMode == HAL_QUERY_AND_TARGET_DUPS,
+                                 mapBackAdjacencies != 0,
+                                 coalescenceLimitName, arena);
+        }
+        arena.release();
     } catch (exception &e) {
         halUnlock();
         handleError("halGetBlocksInTargetRange error reading blocks: " + string(e.what()), errStr);
@@ -335,6 +388,30 @@ extern "C" struct hal_block_results_t *halGetBlocksInTargetRange(int halHandle,
     return results;
 }
 
+extern "C" int halSetBlockCache(hal_int_t maxBytes, hal_int_t tileSize, int prefetchNeighbors, char **errStr) {
+    halLock();
+    try {
+        if (maxBytes < 0 || tileSize < 0) {
+            halUnlock();
+            handleError("halSetBlockCache invalid cache size " + std::to_string(maxBytes) + " or tile size " +
+                            std::to_string(tileSize),
+                        errStr);
+            return -1;
+        }
+        blockCache.configure(maxBytes, tileSize, prefetchNeighbors != 0);
+    } catch (exception &e) {
+        halUnlock();
+        handleError("halSetBlockCache: " + string(e.what()), errStr);
+        return -1;
+    } catch (...) {
+        halUnlock();
+        handleError("halSetBlockCache: unknown exception", errStr);
+        return -1;
+    }
+    halUnlock();
+    return 0;
+}
+
 extern "C" struct hal_block_results_t *
 halGetBlocksInTargetRange_filterByChrom(int halHandle, char *qSpecies, char *tSpecies, char *tChrom, hal_int_t tStart,
                                         hal_int_t tEnd, hal_int_t tReversed, hal_seqmode_type_t seqMode, hal_dup_type_t dupMode,
@@ -756,12 +833,86 @@ static char *copyCString(const string &inString) {
     return outString;
 }
 
-static hal_block_results_t *readBlocks(AlignmentConstPtr seqAlignment, const Sequence *tSequence, hal_index_t absStart,
-                                       hal_index_t absEnd, bool tReversed, const Genome *qGenome, bool getSequenceString,
-                                       bool doDupes, bool doTargetDupes, bool doAdjes, const char *coalescenceLimitName) {
+/* copy arena results into separately allocated linked lists, for the
+ * original API */
+static hal_block_results_t *copyArenaResults(const hal_block_arena_results_t *arenaResults) {
+    hal_block_results_t *results = (hal_block_results_t *)calloc(1, sizeof(hal_block_results_t));
+    hal_block_t *prev = NULL;
+    for (const hal_block_t *block = arenaResults->mappedBlocks; block != NULL; block = block->next) {
+        hal_block_t *cur = (hal_block_t *)malloc(sizeof(hal_block_t));
+        *cur = *block;
+        cur->next = NULL;
+        cur->qChrom = copyCString(block->qChrom);
+        if (block->qSequence != NULL) {
+            cur->qSequence = copyCString(block->qSequence);
+            cur->tSequence = copyCString(block->tSequence);
+        }
+        if (prev == NULL) {
+            results->mappedBlocks = cur;
+        } else {
+            prev->next = cur;
+        }
+        prev = cur;
+    }
+    hal_target_dupe_list_t *prevDupe = NULL;
+    for (const hal_target_dupe_list_t *dupe = arenaResults->targetDupeBlocks; dupe != NULL; dupe = dupe->next) {
+        hal_target_dupe_list_t *cur = (hal_target_dupe_list_t *)calloc(1, sizeof(hal_target_dupe_list_t));
+        cur->id = dupe->id;
+        cur->qChrom = copyCString(dupe->qChrom);
+        hal_target_range_t *prevRange = NULL;
+        for (const hal_target_range_t *range = dupe->tRange; range != NULL; range = range->next) {
+            hal_target_range_t *curRange = (hal_target_range_t *)calloc(1, sizeof(hal_target_range_t));
+            curRange->tStart = range->tStart;
+            curRange->size = range->size;
+            if (prevRange == NULL) {
+                cur->tRange = curRange;
+            } else {
+                prevRange->next = curRange;
+            }
+            prevRange = curRange;
+        }
+        if (prevDupe == NULL) {
+            results->targetDupeBlocks = cur;
+        } else {
+            prevDupe->next = cur;
+        }
+        prevDupe = cur;
+    }
+    return results;
+}
+
+/* allocate the results struct and an array of numBlocks blocks linked in
+ * order */
+static hal_block_arena_results_t *newArenaResults(BlockVizArena &arena, size_t numBlocks) {
+    hal_block_arena_results_t *results = arena.allocArray<hal_block_arena_results_t>(1);
+    results->arena = arena.get();
+    results->numMappedBlocks = numBlocks;
+    if (numBlocks > 0) {
+        results->mappedBlocks = arena.allocArray<hal_block_t>(numBlocks);
+        for (size_t i = 1; i < numBlocks; ++i) {
+            results->mappedBlocks[i - 1].next = &results->mappedBlocks[i];
+        }
+    }
+    return results;
+}
+
+/* drop all but the first numBlocks blocks */
+static void truncateArenaResults(hal_block_arena_results_t *results, size_t numBlocks) {
+    assert(numBlocks <= (size_t)results->numMappedBlocks);
+    results->numMappedBlocks = numBlocks;
+    if (numBlocks == 0) {
+        results->mappedBlocks = NULL;
+    } else {
+        results->mappedBlocks[numBlocks - 1].next = NULL;
+    }
+}
+
+static hal_block_arena_results_t *readBlocks(AlignmentConstPtr seqAlignment, const Sequence *tSequence,
+                                             hal_index_t absStart, hal_index_t absEnd, bool tReversed, const Genome *qGenome,
+                                             bool getSequenceString, bool doDupes, bool doTargetDupes, bool doAdjes,
+                                             const char *coalescenceLimitName, BlockVizArena &arena) {
     const Genome *tGenome = tSequence->getGenome();
     string qGenomeName = qGenome->getName();
-    hal_block_t *prev = NULL;
     BlockMapper blockMapper;
     if (qGenome == tGenome && coalescenceLimitName == NULL) {
         // By default, for self-alignment tracks, walk all the way back to
@@ -800,34 +951,28 @@ static hal_block_results_t *readBlocks(AlignmentConstPtr seqAlignment, const Seq
     targetCutSet.insert(blockMapper.getAbsRefFirst());
     targetCutSet.insert(blockMapper.getAbsRefLast());
 
-    hal_block_results_t *results = (hal_block_results_t *)calloc(1, sizeof(hal_block_results_t));
+    // at most one block per mapped segment, extractSegment erases the
+    // segments it merges into the current block
+    hal_block_arena_results_t *results = newArenaResults(arena, segMap.size());
+    hal_block_t *cur = results->mappedBlocks;
 
     for (MappedSegmentSet::iterator segMapIt = segMap.begin(); segMapIt != segMap.end(); ++segMapIt) {
         assert((*segMapIt)->getSource()->getReversed() == false);
-        hal_block_t *cur = (hal_block_t *)calloc(1, sizeof(hal_block_t));
-        if (results->mappedBlocks == NULL) {
-            results->mappedBlocks = cur;
-        } else {
-            prev->next = cur;
-        }
         BlockMapper::extractSegment(segMapIt, paraSet, fragments, &segMap, targetCutSet, queryCutSet);
-        readBlock(seqAlignment, cur, fragments, getSequenceString, qGenomeName);
+        readBlock(seqAlignment, cur, fragments, getSequenceString, qGenomeName, arena);
         totalLength += cur->size;
         reversedLength += cur->strand == '-' ? cur->size : 0;
-        prev = cur;
+        ++cur;
     }
-    if (!paraSet.empty()) {
-        results->targetDupeBlocks = processTargetDupes(blockMapper, paraSet);
-    }
-    if (doTargetDupes == false && results->targetDupeBlocks != NULL) {
-        halFreeTargetDupeLists(results->targetDupeBlocks);
-        results->targetDupeBlocks = NULL;
+    truncateArenaResults(results, cur - results->mappedBlocks);
+    if (doTargetDupes == true && !paraSet.empty()) {
+        processTargetDupes(blockMapper, paraSet, arena, results);
     }
     return results;
 }
 
 static void readBlock(AlignmentConstPtr seqAlignment, hal_block_t *cur, vector<MappedSegmentPtr> &fragments,
-                      bool getSequenceString, const string &genomeName) {
+                      bool getSequenceString, const string &genomeName, BlockVizArena &arena) {
     MappedSegmentPtr firstQuerySeg = fragments.front();
     MappedSegmentPtr lastQuerySeg = fragments.back();
     const SlicedSegment *firstRefSeg = firstQuerySeg->getSource();
@@ -839,14 +984,11 @@ static void readBlock(AlignmentConstPtr seqAlignment, hal_block_t *cur, vector<M
     assert(firstRefSeg->getReversed() == false);
     assert(lastRefSeg->getReversed() == false);
 
-    cur->next = NULL;
-
     string seqBuffer = qSequence->getName();
     string qDnaBuffer;
     string tDnaBuffer;
     size_t prefix = seqBuffer.find(genomeName + '.') != 0 ? 0 : genomeName.length() + 1;
-    cur->qChrom = (char *)malloc(seqBuffer.length() + 1 - prefix);
-    strcpy(cur->qChrom, seqBuffer.c_str() + prefix);
+    cur->qChrom = arena.internString(seqBuffer.substr(prefix));
 
     cur->tStart = std::min(std::min(firstRefSeg->getStartPosition(), firstRefSeg->getEndPosition()),
                            std::min(lastRefSeg->getStartPosition(), lastRefSeg->getEndPosition()));
@@ -893,11 +1035,265 @@ static void readBlock(AlignmentConstPtr seqAlignment, hal_block_t *cur, vector<M
         if (cur->strand == '-') {
             reverseComplement(qDnaBuffer);
         }
-        cur->qSequence = (char *)malloc(qDnaBuffer.length() * sizeof(char) + 1);
-        cur->tSequence = (char *)malloc(tDnaBuffer.length() * sizeof(char) + 1);
-        strcpy(cur->qSequence, qDnaBuffer.c_str());
-        strcpy(cur->tSequence, tDnaBuffer.c_str());
+        cur->qSequence = arena.copyString(qDnaBuffer);
+        cur->tSequence = arena.copyString(tDnaBuffer);
+    }
+}
+
+/* tReversed queries are for liftover and are not repeated, so they are
+ * not cached.  Mapped-back adjacencies depend on where the query range ends,
+ * so they can't be assembled from tiles. */
+static bool isBlockCacheable(const Sequence *tSequence, hal_index_t absStart, hal_index_t absEnd, bool tReversed,
+                             bool doAdjes) {
+    if (!blockCache.isEnabled() || tReversed || doAdjes) {
+        return false;
+    }
+    hal_index_t tileSize = blockCache.getTileSize();
+    hal_index_t start = absStart - tSequence->getStartPosition();
+    hal_index_t end = absEnd - tSequence->getStartPosition();
+    return end / tileSize - start / tileSize < MAX_CACHED_TILES_PER_QUERY;
+}
+
+static BlockVizCachedTile *convertTile(const hal_block_arena_results_t *results) {
+    BlockVizCachedTile *tile = new BlockVizCachedTile();
+    for (const hal_block_t *cur = results->mappedBlocks; cur != NULL; cur = cur->next) {
+        BlockVizCachedBlock block;
+        block.qChrom = cur->qChrom;
+        block.tStart = cur->tStart;
+        block.qStart = cur->qStart;
+        block.size = cur->size;
+        block.strand = cur->strand;
+        block.hasSequence = cur->qSequence != NULL;
+        if (block.hasSequence) {
+            block.qSequence = cur->qSequence;
+            block.tSequence = cur->tSequence;
+        }
+        tile->blocks.push_back(block);
+    }
+    for (const hal_target_dupe_list_t *cur = results->targetDupeBlocks; cur != NULL; cur = cur->next) {
+        BlockVizCachedDupe dupe;
+        dupe.id = cur->id;
+        dupe.qChrom = cur->qChrom;
+        for (const hal_target_range_t *range = cur->tRange; range != NULL; range = range->next) {
+            dupe.tRanges.push_back(make_pair(range->tStart, range->size));
+        }
+        tile->dupes.push_back(dupe);
+    }
+    return tile;
+}
+
+/* get a tile from the cache, computing it with readBlocks if it
+ * isn't there */
+static BlockVizCachedTileConstPtr getCachedTile(const BlockVizCacheKey &key, AlignmentConstPtr seqAlignment,
+                                                const Sequence *tSequence, const Genome *qGenome, bool getSequenceString,
+                                                hal_dup_type_t dupMode, const char *coalescenceLimitName) {
+    BlockVizCachedTileConstPtr tile = blockCache.find(key);
+    if (tile.get() != NULL) {
+        return tile;
+    }
+    hal_index_t tileSize = blockCache.getTileSize();
+    hal_index_t tileStart = key.tile * tileSize;
+    hal_index_t tileEnd = std::min(tileStart + tileSize, (hal_index_t)tSequence->getSequenceLength());
+    BlockVizArena arena;
+    hal_block_arena_results_t *results =
+        readBlocks(seqAlignment, tSequence, tSequence->getStartPosition() + tileStart,
+                   tSequence->getStartPosition() + tileEnd - 1, false, qGenome, getSequenceString, dupMode != HAL_NO_DUPS,
+                   dupMode == HAL_QUERY_AND_TARGET_DUPS, false, coalescenceLimitName, arena);
+    tile.reset(convertTile(results));
+    blockCache.insert(key, tile);
+    return tile;
+}
+
+/* clip a block to the target range [start, end), keeping the query
+ * coordinates and DNA consistent */
+static void clipBlock(BlockVizCachedBlock &block, hal_index_t start, hal_index_t end) {
+    hal_index_t leftClip = std::max((hal_index_t)0, start - block.tStart);
+    hal_index_t rightClip = std::max((hal_index_t)0, block.tStart + block.size - end);
+    if (leftClip == 0 && rightClip == 0) {
+        return;
+    }
+    block.tStart += leftClip;
+    block.qStart += block.strand == '-' ? rightClip : leftClip;
+    block.size -= leftClip + rightClip;
+    if (block.hasSequence) {
+        // query DNA has already been reverse complemented to match the target
+        block.qSequence = block.qSequence.substr(leftClip, block.size);
+        block.tSequence = block.tSequence.substr(leftClip, block.size);
+    }
+}
+
+static bool blockTStartLess(const BlockVizCachedBlock &b1, const BlockVizCachedBlock &b2) {
+    return b1.tStart < b2.tStart;
+}
+
+/* (qChrom, strand, tStart, query position adjacent to tStart) used to find
+ * the block a piece that starts on a tile boundary continues */
+typedef tuple<string, char, hal_index_t, hal_index_t> BlockJoint;
+
+static BlockJoint blockEndJoint(const BlockVizCachedBlock &block) {
+    return make_tuple(block.qChrom, block.strand, block.tStart + block.size,
+                      block.strand == '-' ? block.qStart : block.qStart + block.size);
+}
+
+static BlockJoint blockStartJoint(const BlockVizCachedBlock &block) {
+    return make_tuple(block.qChrom, block.strand, block.tStart,
+                      block.strand == '-' ? block.qStart + block.size : block.qStart);
+}
+
+/* build the C results for the target range [start, end) (relative to the
+ * target sequence) from the tiles covering it.  Each tile provides the
+ * blocks inside of it clipped to the range, and blocks cut by tile
+ * boundaries are joined back together. */
+static hal_block_arena_results_t *stitchTiles(const vector<BlockVizCachedTileConstPtr> &tiles, hal_index_t firstTile,
+                                              hal_index_t start, hal_index_t end, BlockVizArena &arena) {
+    hal_index_t tileSize = blockCache.getTileSize();
+    vector<BlockVizCachedBlock> pieces;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        hal_index_t tileStart = std::max(start, (firstTile + (hal_index_t)i) * tileSize);
+        hal_index_t tileEnd = std::min(end, (firstTile + (hal_index_t)i + 1) * tileSize);
+        for (size_t j = 0; j < tiles[i]->blocks.size(); ++j) {
+            const BlockVizCachedBlock &block = tiles[i]->blocks[j];
+            if (block.tStart < tileEnd && block.tStart + block.size > tileStart) {
+                pieces.push_back(block);
+                clipBlock(pieces.back(), tileStart, tileEnd);
+            }
+        }
+    }
+    stable_sort(pieces.begin(), pieces.end(), blockTStartLess);
+
+    vector<BlockVizCachedBlock> blocks;
+    blocks.reserve(pieces.size());
+    map<BlockJoint, size_t> openBlocks;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        const BlockVizCachedBlock &piece = pieces[i];
+        map<BlockJoint, size_t>::iterator openIt = openBlocks.end();
+        if (piece.tStart % tileSize == 0 && piece.tStart > start) {
+            openIt = openBlocks.find(blockStartJoint(piece));
+        }
+        size_t cur = blocks.size();
+        if (openIt != openBlocks.end()) {
+            // continuation of a block cut by the tile boundary
+            cur = openIt->second;
+            openBlocks.erase(openIt);
+            BlockVizCachedBlock &block = blocks[cur];
+            block.size += piece.size;
+            if (piece.strand == '-') {
+                block.qStart = piece.qStart;
+            }
+            if (piece.hasSequence) {
+                block.qSequence += piece.qSequence;
+                block.tSequence += piece.tSequence;
+            }
+        } else {
+            blocks.push_back(piece);
+        }
+        openBlocks[blockEndJoint(blocks[cur])] = cur;
+    }
+
+    hal_block_arena_results_t *results = newArenaResults(arena, blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const BlockVizCachedBlock &block = blocks[i];
+        hal_block_t *cur = &results->mappedBlocks[i];
+        cur->qChrom = arena.internString(block.qChrom);
+        cur->tStart = block.tStart;
+        cur->qStart = block.qStart;
+        cur->size = block.size;
+        cur->strand = block.strand;
+        if (block.hasSequence) {
+            cur->qSequence = arena.copyString(block.qSequence);
+            cur->tSequence = arena.copyString(block.tSequence);
+        }
+    }
+
+    // dupe ids are only unique within a tile, so offset them
+    hal_index_t idOffset = 0;
+    hal_target_dupe_list_t *dupesTail = NULL;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        hal_index_t maxId = -1;
+        for (size_t j = 0; j < tiles[i]->dupes.size(); ++j) {
+            const BlockVizCachedDupe &dupe = tiles[i]->dupes[j];
+            maxId = std::max(maxId, dupe.id);
+            hal_target_dupe_list_t *cur = NULL;
+            hal_target_range_t *rangeTail = NULL;
+            for (size_t k = 0; k < dupe.tRanges.size(); ++k) {
+                hal_index_t rangeStart = std::max(start, dupe.tRanges[k].first);
+                hal_index_t rangeEnd = std::min(end, dupe.tRanges[k].first + dupe.tRanges[k].second);
+                if (rangeStart >= rangeEnd) {
+                    continue;
+                }
+                if (cur == NULL) {
+                    cur = arena.allocArray<hal_target_dupe_list_t>(1);
+                    cur->id = dupe.id + idOffset;
+                    cur->qChrom = arena.internString(dupe.qChrom);
+                }
+                hal_target_range_t *range = arena.allocArray<hal_target_range_t>(1);
+                range->tStart = rangeStart;
+                range->size = rangeEnd - rangeStart;
+                if (rangeTail == NULL) {
+                    cur->tRange = range;
+                } else {
+                    rangeTail->next = range;
+                }
+                rangeTail = range;
+            }
+            if (cur == NULL) {
+                continue;
+            }
+            if (dupesTail == NULL) {
+                results->targetDupeBlocks = cur;
+            } else {
+                dupesTail->next = cur;
+            }
+            dupesTail = cur;
+            ++results->numTargetDupeBlocks;
+        }
+        idOffset += maxId + 1;
     }
+    return results;
+}
+
+static hal_block_arena_results_t *readCachedBlocks(int halHandle, AlignmentConstPtr alignment,
+                                                   AlignmentConstPtr seqAlignment, const Sequence *tSequence,
+                                                   hal_index_t absStart, hal_index_t absEnd, const Genome *qGenome,
+                                                   bool getSequenceString, hal_dup_type_t dupMode,
+                                                   const char *coalescenceLimitName, BlockVizArena &arena) {
+    hal_index_t tileSize = blockCache.getTileSize();
+    hal_index_t start = absStart - tSequence->getStartPosition();
+    hal_index_t end = absEnd - tSequence->getStartPosition() + 1;
+    hal_index_t firstTile = start / tileSize;
+    hal_index_t lastTile = (end - 1) / tileSize;
+    hal_index_t numTiles = (tSequence->getSequenceLength() + tileSize - 1) / tileSize;
+
+    BlockVizCacheKey key;
+    key.handle = halHandle;
+    key.alignment = alignment.get();
+    key.qSpecies = qGenome->getName();
+    key.tSpecies = tSequence->getGenome()->getName();
+    key.tChrom = tSequence->getName();
+    key.dupMode = dupMode;
+    key.getSequence = getSequenceString;
+    key.hasCoalescenceLimit = coalescenceLimitName != NULL;
+    key.coalescenceLimit = coalescenceLimitName != NULL ? coalescenceLimitName : "";
+
+    vector<BlockVizCachedTileConstPtr> tiles;
+    for (hal_index_t tile = firstTile; tile <= lastTile; ++tile) {
+        key.tile = tile;
+        tiles.push_back(
+            getCachedTile(key, seqAlignment, tSequence, qGenome, getSequenceString, dupMode, coalescenceLimitName));
+    }
+    hal_block_arena_results_t *results = stitchTiles(tiles, firstTile, start, end, arena);
+
+    if (blockCache.getPrefetch()) {
+        // warm up the tiles the next pan will need
+        hal_index_t neighbors[] = {firstTile - 1, lastTile + 1};
+        for (size_t i = 0; i < 2; ++i) {
+            if (neighbors[i] >= 0 && neighbors[i] < numTiles) {
+                key.tile = neighbors[i];
+                getCachedTile(key, seqAlignment, tSequence, qGenome, getSequenceString, dupMode, coalescenceLimitName);
+            }
+        }
+    }
+    return results;
 }
 
 struct CStringLess {
@@ -936,7 +1332,8 @@ struct DupeListLess {
     }
 };
 
-static hal_target_dupe_list_t *processTargetDupes(BlockMapper &blockMapper, MappedSegmentSet &paraSet) {
+static void processTargetDupes(BlockMapper &blockMapper, MappedSegmentSet &paraSet, BlockVizArena &arena,
+                               hal_block_arena_results_t *results) {
 
     // a dupe list is a set of homologous intervals in the reference (which is Source in the mapped segments)
     // we store as size and start points
@@ -1011,7 +1408,7 @@ static hal_target_dupe_list_t *processTargetDupes(BlockMapper &blockMapper, Mapp
     hal_target_dupe_list_t* dupes_head = NULL;
     hal_target_dupe_list_t* dupes_tail = NULL;
     int64_t cur_id = 0;
-    string chrom_name = (*paraSet.begin())->getSource()->getSequence()->getName();
+    char *chrom_name = arena.internString((*paraSet.begin())->getSource()->getSequence()->getName());
     hal_index_t chrom_offset = (*paraSet.begin())->getSource()->getSequence()->getStartPosition();
     hal_index_t prev = -1;
     for (int64_t i = 0; i < dupe_lists.size(); ++i) {
@@ -1019,7 +1416,7 @@ static hal_target_dupe_list_t *processTargetDupes(BlockMapper &blockMapper, Mapp
             // this list was merged
             continue;
         }
-        hal_target_dupe_list_t* dupe = (hal_target_dupe_list_t *)calloc(1, sizeof(hal_target_dupe_list_t));
+        hal_target_dupe_list_t* dupe = arena.allocArray<hal_target_dupe_list_t>(1);
         if (prev >=0) {
             // apply id smoothing by giving overlapping adjacent sets same ID
             hal_index_t prev_end = *dupe_lists[prev].first.begin() + dupe_lists[prev].second;
@@ -1028,11 +1425,10 @@ static hal_target_dupe_list_t *processTargetDupes(BlockMapper &blockMapper, Mapp
             }
         }
         dupe->id = cur_id;
-        dupe->qChrom = (char *)malloc(chrom_name.length() * sizeof(char) + 1);
-        strcpy(dupe->qChrom, chrom_name.c_str());
+        dupe->qChrom = chrom_name;
         hal_target_range_t* range_tail = NULL;
         for (set<hal_index_t>::iterator j = dupe_lists[i].first.begin(); j != dupe_lists[i].first.end(); ++j) {
-            hal_target_range_t* range = (hal_target_range_t*)(calloc(1, sizeof(hal_target_range_t)));
+            hal_target_range_t* range = arena.allocArray<hal_target_range_t>(1);
             range->tStart = *j - chrom_offset;
             range->size = dupe_lists[i].second;
             if (range_tail == NULL) {
@@ -1048,10 +1444,11 @@ static hal_target_dupe_list_t *processTargetDupes(BlockMapper &blockMapper, Mapp
             dupes_tail->next = dupe;
         }
         dupes_tail = dupe;
+        ++results->numTargetDupeBlocks;
         prev = i;
     }
 
-    return dupes_head;
+    results->targetDupeBlocks = dupes_head;
 }
     
 
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halBlockVizArena.h"
+#include "hal.h"
+#include <stdlib.h>
+
+using namespace std;
+using namespace hal;
+
+/* default size of the chunks requested from malloc.  Allocations bigger
+ * than a quarter of this (long DNA strings) get a chunk of their own. */
+static const size_t ARENA_CHUNK_SIZE = 64 * 1024;
+
+/* alignment of every allocation, enough for any of the result structs */
+static const size_t ARENA_ALIGNMENT = 16;
+
+namespace {
+    struct ArenaChunk {
+        ArenaChunk *next;
+        size_t size;
+        size_t used;
+    };
+
+    /* data starts after the header, rounded up to the alignment */
+    const size_t ARENA_HEADER_SIZE = (sizeof(ArenaChunk) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+    ArenaChunk *newChunk(size_t size) {
+        ArenaChunk *chunk = static_cast<ArenaChunk *>(malloc(ARENA_HEADER_SIZE + size));
+        if (chunk == NULL) {
+            throw hal_exception("out of memory allocating blockViz results");
+        }
+        chunk->next = NULL;
+        chunk->size = size;
+        chunk->used = 0;
+        return chunk;
+    }
+
+    char *chunkData(ArenaChunk *chunk) {
+        return reinterpret_cast<char *>(chunk) + ARENA_HEADER_SIZE;
+    }
+}
+
+/* chunks are kept in a list with the one being filled at the head */
+struct hal_arena_t {
+    ArenaChunk *chunks;
+};
+
+BlockVizArena::BlockVizArena() {
+    _arena = static_cast<hal_arena_t *>(calloc(1, sizeof(hal_arena_t)));
+    if (_arena == NULL) {
+        throw hal_exception("out of memory allocating blockViz results");
+    }
+}
+
+BlockVizArena::~BlockVizArena() {
+    freeBlockVizArena(_arena);
+}
+
+void *BlockVizArena::alloc(size_t numBytes) {
+    numBytes = (numBytes + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    ArenaChunk *head = _arena->chunks;
+    if (head == NULL || head->size - head->used < numBytes) {
+        if (numBytes > ARENA_CHUNK_SIZE / 4) {
+            // put it behind the head, which still has room for small stuff
+            ArenaChunk *chunk = newChunk(numBytes);
+            chunk->used = numBytes;
+            if (head == NULL) {
+                _arena->chunks = chunk;
+            } else {
+                chunk->next = head->next;
+                head->next = chunk;
+            }
+            memset(chunkData(chunk), 0, numBytes);
+            return chunkData(chunk);
+        }
+        head = newChunk(ARENA_CHUNK_SIZE);
+        head->next = _arena->chunks;
+        _arena->chunks = head;
+    }
+    char *data = chunkData(head) + head->used;
+    head->used += numBytes;
+    memset(data, 0, numBytes);
+    return data;
+}
+
+char *BlockVizArena::copyString(const char *str, size_t length) {
+    char *copy = allocArray<char>(length + 1);
+    memcpy(copy, str, length);
+    return copy;
+}
+
+char *BlockVizArena::internString(const string &str) {
+    map<string, char *>::iterator it = _interned.find(str);
+    if (it == _interned.end()) {
+        it = _interned.insert(make_pair(str, copyString(str))).first;
+    }
+    return it->second;
+}
+
+hal_arena_t *BlockVizArena::release() {
+    hal_arena_t *arena = _arena;
+    _arena = NULL;
+    _interned.clear();
+    return arena;
+}
+
+void hal::freeBlockVizArena(hal_arena_t *arena) {
+    if (arena != NULL) {
+        ArenaChunk *chunk = arena->chunks;
+        while (chunk != NULL) {
+            ArenaChunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        free(arena);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALBLOCKVIZARENA_H
+#define _HALBLOCKVIZARENA_H
+
+#include "halBlockViz.h"
+#include <cstring>
+#include <map>
+#include <string>
+
+/* chunked memory pool behind hal_block_arena_results_t */
+struct hal_arena_t;
+
+namespace hal {
+
+    /** Bump allocator used to build the results of one blockViz query.
+     * Memory is taken from malloc in large chunks and is only given back
+     * all at once, either when the builder is destroyed or, once the
+     * arena has been released to the caller, by freeBlockVizArena().  Query
+     * chromosome names are interned so each distinct name is stored once.
+     * Allocated memory is zeroed.
+     */
+    class BlockVizArena {
+      public:
+        BlockVizArena();
+        ~BlockVizArena();
+
+        /** Allocate an array of n zeroed structures */
+        template <typename T> T *allocArray(size_t n) {
+            return static_cast<T *>(alloc(n * sizeof(T)));
+        }
+
+        /** Copy a string into the arena */
+        char *copyString(const char *str, size_t length);
+        char *copyString(const std::string &str) {
+            return copyString(str.c_str(), str.length());
+        }
+
+        /** Get the single copy of a string in the arena, adding it the
+         * first time it is seen */
+        char *internString(const std::string &str);
+
+        hal_arena_t *get() {
+            return _arena;
+        }
+
+        /** Hand ownership of the memory to the caller, who must free it
+         * with freeBlockVizArena */
+        hal_arena_t *release();
+
+      private:
+        BlockVizArena(const BlockVizArena &);
+        BlockVizArena &operator=(const BlockVizArena &);
+
+        void *alloc(size_t numBytes);
+
+        hal_arena_t *_arena;
+        std::map<std::string, char *> _interned;
+    };
+
+    /** Free an arena and everything allocated from it */
+    void freeBlockVizArena(hal_arena_t *arena);
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
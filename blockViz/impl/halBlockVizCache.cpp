@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halBlockVizCache.h"
+#include <tuple>
+
+using namespace std;
+using namespace hal;
+
+bool BlockVizCacheKey::operator<(const BlockVizCacheKey &other) const {
+    return tie(handle, alignment, tile, dupMode, getSequence, hasCoalescenceLimit, tChrom, tSpecies, qSpecies,
+               coalescenceLimit) < tie(other.handle, other.alignment, other.tile, other.dupMode, other.getSequence,
+                                       other.hasCoalescenceLimit, other.tChrom, other.tSpecies, other.qSpecies,
+                                       other.coalescenceLimit);
+}
+
+size_t BlockVizCachedTile::getNumBytes() const {
+    size_t numBytes = sizeof(BlockVizCachedTile);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        numBytes += sizeof(BlockVizCachedBlock) + blocks[i].qChrom.capacity() + blocks[i].qSequence.capacity() +
+                    blocks[i].tSequence.capacity();
+    }
+    for (size_t i = 0; i < dupes.size(); ++i) {
+        numBytes += sizeof(BlockVizCachedDupe) + dupes[i].qChrom.capacity() +
+                    dupes[i].tRanges.capacity() * sizeof(pair<hal_index_t, hal_index_t>);
+    }
+    return numBytes;
+}
+
+BlockVizCache::BlockVizCache() : _maxBytes(0), _tileSize(0), _prefetch(false), _numBytes(0) {
+}
+
+void BlockVizCache::configure(hal_size_t maxBytes, hal_size_t tileSize, bool prefetch) {
+    if (maxBytes > 0 && tileSize == 0) {
+        throw hal_exception("blockViz cache tile size must be greater than 0");
+    }
+    clear();
+    _maxBytes = maxBytes;
+    _tileSize = tileSize;
+    _prefetch = prefetch;
+}
+
+BlockVizCachedTileConstPtr BlockVizCache::find(const BlockVizCacheKey &key) {
+    EntryMap::iterator entryIt = _entries.find(key);
+    if (entryIt == _entries.end()) {
+        return BlockVizCachedTileConstPtr();
+    }
+    _lru.splice(_lru.begin(), _lru, entryIt->second.lruIt);
+    return entryIt->second.tile;
+}
+
+void BlockVizCache::insert(const BlockVizCacheKey &key, const BlockVizCachedTileConstPtr &tile) {
+    EntryMap::iterator entryIt = _entries.find(key);
+    if (entryIt != _entries.end()) {
+        erase(entryIt);
+    }
+    size_t numBytes = tile->getNumBytes() + sizeof(BlockVizCacheKey) + key.qSpecies.capacity() + key.tSpecies.capacity() +
+                      key.tChrom.capacity() + key.coalescenceLimit.capacity();
+    if (numBytes > _maxBytes) {
+        return;
+    }
+    _lru.push_front(key);
+    Entry entry = {tile, numBytes, _lru.begin()};
+    _entries.insert(EntryMap::value_type(key, entry));
+    _numBytes += numBytes;
+    evict();
+}
+
+void BlockVizCache::eraseHandle(int handle) {
+    for (EntryMap::iterator entryIt = _entries.begin(); entryIt != _entries.end();) {
+        EntryMap::iterator next = entryIt;
+        ++next;
+        if (entryIt->first.handle == handle) {
+            erase(entryIt);
+        }
+        entryIt = next;
+    }
+}
+
+void BlockVizCache::clear() {
+    _entries.clear();
+    _lru.clear();
+    _numBytes = 0;
+}
+
+void BlockVizCache::erase(EntryMap::iterator entryIt) {
+    _numBytes -= entryIt->second.numBytes;
+    _lru.erase(entryIt->second.lruIt);
+    _entries.erase(entryIt);
+}
+
+void BlockVizCache::evict() {
+    while (_numBytes > _maxBytes && !_lru.empty()) {
+        erase(_entries.find(_lru.back()));
+    }
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALBLOCKVIZCACHE_H
+#define _HALBLOCKVIZCACHE_H
+
+#include "hal.h"
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+    /** Identifies one fixed-size tile of target sequence together with all
+     * the parameters that influence the blocks computed for it.  The
+     * alignment pointer is part of the key since different levels of detail
+     * of the same handle give different blocks. */
+    struct BlockVizCacheKey {
+        int handle;
+        const Alignment *alignment;
+        std::string qSpecies;
+        std::string tSpecies;
+        std::string tChrom;
+        hal_index_t tile;
+        int dupMode;
+        bool getSequence;
+        bool hasCoalescenceLimit;
+        std::string coalescenceLimit;
+
+        bool operator<(const BlockVizCacheKey &other) const;
+    };
+
+    /** Block from hal_block_t, with all coordinates relative to the target
+     * and query sequences */
+    struct BlockVizCachedBlock {
+        std::string qChrom;
+        hal_index_t tStart;
+        hal_index_t qStart;
+        hal_index_t size;
+        char strand;
+        bool hasSequence;
+        std::string qSequence;
+        std::string tSequence;
+    };
+
+    /** Target duplication list from hal_target_dupe_list_t.  Ranges are
+     * (tStart, size) pairs. */
+    struct BlockVizCachedDupe {
+        hal_index_t id;
+        std::string qChrom;
+        std::vector<std::pair<hal_index_t, hal_index_t>> tRanges;
+    };
+
+    /** Everything computed for one tile */
+    struct BlockVizCachedTile {
+        std::vector<BlockVizCachedBlock> blocks;
+        std::vector<BlockVizCachedDupe> dupes;
+
+        /* approximate heap footprint, used to enforce the memory cap */
+        size_t getNumBytes() const;
+    };
+    typedef std::shared_ptr<const BlockVizCachedTile> BlockVizCachedTileConstPtr;
+
+    /** Least-recently-used cache of computed blocks for blockViz range
+     * queries.  Target sequences are divided into tiles of a fixed size.
+     * Tiles are computed and stored whole, queries for arbitrary ranges are
+     * stitched together from the overlapping tiles.  The cache is disabled
+     * when its byte limit is zero.  Not thread-safe, callers serialize access
+     * with the blockViz lock.
+     */
+    class BlockVizCache {
+      public:
+        BlockVizCache();
+
+        /** Change the limits, dropping everything currently cached.
+         * @param maxBytes maximum total size of cached tiles, 0 disables caching
+         * @param tileSize length of the target tiles
+         * @param prefetch compute the tiles on either side of each query */
+        void configure(hal_size_t maxBytes, hal_size_t tileSize, bool prefetch);
+
+        bool isEnabled() const {
+            return _maxBytes > 0;
+        }
+        hal_size_t getTileSize() const {
+            return _tileSize;
+        }
+        bool getPrefetch() const {
+            return _prefetch;
+        }
+        hal_size_t getNumBytes() const {
+            return _numBytes;
+        }
+
+        /** Get a tile, marking it as most recently used.
+         * @return NULL if not cached */
+        BlockVizCachedTileConstPtr find(const BlockVizCacheKey &key);
+
+        /** Add a tile, evicting the least recently used tiles until the
+         * cache is back under its byte limit.  A tile larger than the
+         * limit is not stored. */
+        void insert(const BlockVizCacheKey &key, const BlockVizCachedTileConstPtr &tile);
+
+        /** Drop all tiles computed from a handle */
+        void eraseHandle(int handle);
+
+        /** Drop everything */
+        void clear();
+
+      private:
+        typedef std::list<BlockVizCacheKey> LruList;
+        struct Entry {
+            BlockVizCachedTileConstPtr tile;
+            size_t numBytes;
+            LruList::iterator lruIt;
+        };
+        typedef std::map<BlockVizCacheKey, Entry> EntryMap;
+
+        void erase(EntryMap::iterator entryIt);
+        void evict();
+
+        hal_size_t _maxBytes;
+        hal_size_t _tileSize;
+        bool _prefetch;
+        hal_size_t _numBytes;
+        EntryMap _entries;
+        LruList _lru; // most recently used at front
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -59,6 +59,24 @@ struct hal_block_t {
     char *tSequence; // target DNA, if requested
 };
 
+/** Memory pool owning everything in a hal_block_arena_results_t */
+struct hal_arena_t;
+
+/** Same contents as hal_block_results_t, but the results struct and all of
+ * its blocks, dupe lists, ranges and strings are allocated from a single
+ * arena, so the whole query is released by one call to
+ * halFreeBlockArenaResults().  The blocks are contiguous: they can be read
+ * as an array of numMappedBlocks elements or by following next.  Blocks and
+ * dupe lists on the same query chromosome share one qChrom string.  Nothing
+ * in the structure may be passed to free() or modified in place. */
+struct hal_block_arena_results_t {
+    struct hal_block_t *mappedBlocks;
+    hal_int_t numMappedBlocks;
+    struct hal_target_dupe_list_t *targetDupeBlocks;
+    hal_int_t numTargetDupeBlocks;
+    struct hal_arena_t *arena;
+};
+
 /** Some information about a genome */
 struct hal_species_t {
     struct hal_species_t *next;
@@ -164,6 +182,9 @@ int halCloseGenome(int halHandle, const char *genomeName, char **errStr);
 /** Free block results structure */
 void halFreeBlockResults(struct hal_block_results_t *results);
 
+/** Free arena block results structure, and everything it points to */
+void halFreeBlockArenaResults(struct hal_block_arena_results_t *results);
+
 /** Free linked list of blocks */
 void halFreeBlocks(struct hal_block_t *block);
 
@@ -265,6 +286,42 @@ struct hal_block_results_t *halGetBlocksInTargetRange_filterByChrom(int halHandl
                                                                     int mapBackAdjacencies, char *qChrom,
                                                                     const char *coalescenceLimitName, char **errStr);
 
+/** Same as halGetBlocksInTargetRange, but the results are allocated from a
+ * single arena (see hal_block_arena_results_t) rather than with one malloc
+ * per block and string.  This is cheaper to build, traverse and free for
+ * queries returning many blocks.  halGetBlocksInTargetRange is a wrapper
+ * around this function that copies the results into linked lists.
+ *
+ * @return  block structure -- must be freed by halFreeBlockArenaResults().
+ * NULL on failure.
+ */
+struct hal_block_arena_results_t *halGetBlocksInTargetRangeArena(int halHandle, char *qSpecies, char *tSpecies, char *tChrom,
+                                                                 hal_int_t tStart, hal_int_t tEnd, hal_int_t tReversed,
+                                                                 hal_seqmode_type_t seqMode, hal_dup_type_t dupMode,
+                                                                 int mapBackAdjacencies, const char *coalescenceLimitName,
+                                                                 char **errStr);
+
+/** Enable, resize or disable the cache of blocks used by
+ * halGetBlocksInTargetRange.  The cache is shared by all handles and is
+ * disabled by default.  Target chromosomes are divided into tiles of
+ * tileSize bases, and blocks are computed and cached for whole tiles.
+ * Results for a query range are stitched together from the tiles that
+ * overlap it, so that panning and zooming over the same region do not
+ * remap it. Queries with tReversed or mapBackAdjacencies set, or covering
+ * a very large number of tiles, are not cached.  Changing the settings drops
+ * all cached blocks.
+ *
+ * @param maxBytes approximate memory limit for the cache.  The least
+ * recently used tiles are dropped when it is exceeded. 0 disables the cache.
+ * @param tileSize size of the target tiles.
+ * @param prefetchNeighbors if not 0, also compute the tiles immediately to
+ * the left and right of each query so they are ready for the next pan.
+ * @param errStr pointer to a string that contains an error message on
+ * failure. If NULL, throws an exception on failure instead.
+ * @return 0: success -1: failure
+ */
+int halSetBlockCache(hal_int_t maxBytes, hal_int_t tileSize, int prefetchNeighbors, char **errStr);
+
 /** Read alignment into an output file in MAF format.  Interface very
  * similar to halGetBlocksInTargetRange except multiple query species
  * can be specified
@@ -34,7 +34,11 @@ struct bv_args_t {
     int tEnd;
     int doSeq;
     int doDupes;
+    int noAdjacencies;
+    int arena;
     int numThreads;
+    long cacheBytes;
+    long cacheTileSize;
     char *coalescenceLimit;
     int verbose;
     int udcVerbose;
@@ -45,7 +49,11 @@ static void initParser(hal::CLParser &optionsParser) {
     optionsParser.addOptionFlag("verbose", "verbose tracing", false);
     optionsParser.addOptionFlag("doSeq", "get seqeuence", false);
     optionsParser.addOptionFlag("doDupes", "get duplicate regions", false);
+    optionsParser.addOptionFlag("noAdjacencies", "don't map back adjacencies", false);
+    optionsParser.addOptionFlag("arena", "use the arena allocated results API", false);
     optionsParser.addOption("numThreads", "number of threads for thread tests", 10);
+    optionsParser.addOption("blockCacheBytes", "enable the block cache with this memory limit", 0);
+    optionsParser.addOption("blockCacheTileSize", "tile size for the block cache", 1000);
     optionsParser.addOption("coalescenceLimit", "coalescence limit specices, default is none", "");
     optionsParser.addArgument("halLodPath", "path to HAL or LOD file");
     optionsParser.addArgument("qSpecies", "query species name");
@@ -89,7 +97,11 @@ static bool parseArgs(int argc, char **argv, bv_args_t *args) {
     args->tEnd = optionsParser.get<int>("tEnd");
     args->doSeq = optionsParser.get<bool>("doSeq");
     args->doDupes = optionsParser.get<bool>("doDupes");
+    args->noAdjacencies = optionsParser.get<bool>("noAdjacencies");
+    args->arena = optionsParser.get<bool>("arena");
     args->numThreads = optionsParser.get<int>("numThreads");
+    args->cacheBytes = optionsParser.get<long>("blockCacheBytes");
+    args->cacheTileSize = optionsParser.get<long>("blockCacheTileSize");
     args->coalescenceLimit = optionStrOrNull(optionsParser, "coalescenceLimit");
     args->verbose = optionsParser.get<bool>("verbose");
     return true;
@@ -183,14 +195,63 @@ static bool runThreadTest(bv_args_t *args) {
 }
 #endif
 
-static bool runSingleTest(bv_args_t *args, int handle) {
+/* blocks are read as an array, checking they are also correctly linked */
+static bool runSingleArenaTest(bv_args_t *args, int handle, bool verbose) {
+    hal_seqmode_type_t sm = HAL_NO_SEQUENCE;
+    if (args->doSeq != 0) {
+        sm = HAL_LOD0_SEQUENCE;
+    }
+    struct hal_block_arena_results_t *results =
+        halGetBlocksInTargetRangeArena(handle, args->qSpecies, args->tSpecies, args->tChrom, args->tStart, args->tEnd, 0, sm,
+                                       HAL_QUERY_AND_TARGET_DUPS, !args->noAdjacencies, args->coalescenceLimit, NULL);
+    if (results == NULL) {
+        fprintf(stderr, "halGetBlocksInTargetRangeArena returned NULL\n");
+        return false;
+    }
+    hal_int_t baseCnt = 0;
+    for (hal_int_t i = 0; i < results->numMappedBlocks; ++i) {
+        struct hal_block_t *cur = &results->mappedBlocks[i];
+        struct hal_block_t *next = i + 1 < results->numMappedBlocks ? cur + 1 : NULL;
+        if (cur->next != next) {
+            fprintf(stderr, "arena block %ld is not linked to the next block in the array\n", i);
+            halFreeBlockArenaResults(results);
+            return false;
+        }
+        baseCnt += cur->size;
+        if (verbose) {
+            printBlock(stdout, cur);
+        }
+    }
+    hal_int_t dupeCnt = 0;
+    for (struct hal_target_dupe_list_t *dupeList = results->targetDupeBlocks; dupeList != NULL; dupeList = dupeList->next) {
+        dupeCnt++;
+        if (verbose) {
+            printDupeList(stdout, dupeList);
+        }
+    }
+    if (dupeCnt != results->numTargetDupeBlocks) {
+        fprintf(stderr, "arena dupe list count %ld doesn't match numTargetDupeBlocks %ld\n", dupeCnt,
+                results->numTargetDupeBlocks);
+        halFreeBlockArenaResults(results);
+        return false;
+    }
+    std::cerr << "blockCnt: " << results->numMappedBlocks << std::endl;
+    std::cerr << "baseCnt: " << baseCnt << std::endl;
+    halFreeBlockArenaResults(results);
+    return true;
+}
+
+static bool runSingleTest(bv_args_t *args, int handle, bool verbose) {
+    if (args->arena) {
+        return runSingleArenaTest(args, handle, verbose);
+    }
     hal_seqmode_type_t sm = HAL_NO_SEQUENCE;
     if (args->doSeq != 0) {
         sm = HAL_LOD0_SEQUENCE;
     }
     struct hal_block_results_t *results =
         halGetBlocksInTargetRange(handle, args->qSpecies, args->tSpecies, args->tChrom, args->tStart, args->tEnd, 0, sm,
-                                  HAL_QUERY_AND_TARGET_DUPS, 1, args->coalescenceLimit, NULL);
+                                  HAL_QUERY_AND_TARGET_DUPS, !args->noAdjacencies, args->coalescenceLimit, NULL);
     if (results == NULL) {
         fprintf(stderr, "halGetBlocksInTargetRange returned NULL\n");
         return false;
@@ -201,14 +262,14 @@ static bool runSingleTest(bv_args_t *args, int handle) {
     while (cur != NULL) {
         blockCnt++;
         baseCnt += cur->size;
-        if (args->verbose) {
+        if (verbose) {
             printBlock(stdout, cur);
         }
         cur = cur->next;
     }
     struct hal_target_dupe_list_t *dupeList = results->targetDupeBlocks;
     while (dupeList != NULL) {
-        if (args->verbose) {
+        if (verbose) {
             printDupeList(stdout, dupeList);
         }
         dupeList = dupeList->next;
@@ -225,7 +286,16 @@ static bool runTest(bv_args_t *args, int handle) {
             return false;
         }
     }
-    if (!runSingleTest(args, handle)) {
+    if (args->cacheBytes > 0) {
+        if (halSetBlockCache(args->cacheBytes, args->cacheTileSize, 1, NULL) != 0) {
+            return false;
+        }
+        // fill the cache, the second query below is then served from it
+        if (!runSingleTest(args, handle, false)) {
+            return false;
+        }
+    }
+    if (!runSingleTest(args, handle, args->verbose)) {
         return false;
     }
 #ifdef ENABLE_UDC
@@ -14,7 +14,7 @@
 using namespace std;
 using namespace hal;
 
-Extract4d::Extract4d() {
+Extract4d::Extract4d() : _outBedWriter(NULL) {
 }
 
 Extract4d::~Extract4d() {
@@ -22,14 +22,17 @@ Extract4d::~Extract4d() {
 
 void Extract4d::run(const Genome *refGenome, istream *inBedStream, ostream *outBedStream, bool conserved) {
     _refGenome = refGenome;
-    _outBedStream = outBedStream;
     _conserved = conserved;
+    TextWriter outBedWriter(*outBedStream);
+    _outBedWriter = &outBedWriter;
     scan(inBedStream);
+    outBedWriter.flush();
+    _outBedWriter = NULL;
 }
 
 void Extract4d::visitLine() {
     _outBedLines.clear();
-    _refSequence = _refGenome->getSequence(_bedLine._chrName);
+    _refSequence = getChromSequence(_refGenome);
     if (_refSequence != NULL) {
         if (_bedLine._bedType <= 9) {
             throw hal_exception("Only compatible with BED12 input. 4d sites are sensitive to frame."
@@ -165,6 +168,6 @@ void Extract4d::extractBlocks4d(bool conserved) {
 
 void Extract4d::write() {
     for (size_t i = 0; i < _outBedLines.size(); ++i) {
-        _outBedLines[i].write(*_outBedStream);
+        _outBedLines[i].write(*_outBedWriter);
     }
 }
@@ -6,6 +6,7 @@
  */
 
 #include "halMaskExtractor.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <fstream>
@@ -29,60 +30,74 @@ void MaskExtractor::extract(AlignmentConstPtr alignment, const Genome *genome, o
     _extend = extend;
     _extendPct = extendPct;
 
+    TextWriter out(*_bedStream);
     for (SequenceIteratorPtr seqIt = _genome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
         _sequence = seqIt->getSequence();
         if (_sequence->getSequenceLength() > 0) {
-            _posCache.clear();
-            addMaskedBasesToCache();
-            extendCachedIntervals();
-            writeCachedIntervals();
+            getMaskedRuns();
+            extendRuns();
+            writeRuns(out);
         }
     }
+    out.flush();
 }
 
-void MaskExtractor::addMaskedBasesToCache() {
-    assert(_posCache.size() == 0);
+/* get the masked runs of the sequence from the genome's index, or by
+ * scanning its DNA if there is no index */
+void MaskExtractor::getMaskedRuns() {
+    hal_index_t start = _sequence->getStartPosition();
+    hal_index_t end = start + (hal_index_t)_sequence->getSequenceLength();
+    const DnaMaskIndex *maskIndex = _genome->getDnaMaskIndex();
+    if (maskIndex != NULL) {
+        DnaMaskIndex::getRuns(maskIndex->getMaskedRuns(), start, end, _runs);
+        return;
+    }
+    _runs.clear();
     for (DnaIteratorPtr dna = _sequence->getDnaIterator(); !dna->atEnd(); dna->toRight()) {
         if (isMasked(dna->getBase())) {
-            _posCache.insert(dna->getArrayIndex());
+            hal_index_t pos = dna->getArrayIndex();
+            if (!_runs.empty() && _runs.back()._end == pos) {
+                ++_runs.back()._end;
+            } else {
+                DnaMaskIndex::Run run = {pos, pos + 1};
+                _runs.push_back(run);
+            }
         }
     }
 }
 
-void MaskExtractor::extendCachedIntervals() {
+/* pad each run, within the sequence, then merge the runs that overlap or
+ * touch */
+void MaskExtractor::extendRuns() {
     if (_extend == 0 && _extendPct == 0.) {
         return;
     }
     assert(_extend == 0 || _extendPct == 0.);
 
-    hal_size_t start = (hal_size_t)_sequence->getStartPosition();
-    hal_size_t last = (hal_size_t)(start + _sequence->getSequenceLength()) - 1;
-
-    const PositionCache::IntervalSet *intervalSet = _posCache.getIntervalSet();
-    PositionCache::IntervalSet::const_iterator i;
-    vector<hal_index_t> padding;
-    for (i = intervalSet->begin(); i != intervalSet->end(); ++i) {
-        hal_size_t len = (hal_size_t)(i->first - i->second) + 1;
-        hal_size_t pad = _extend ? _extend : (hal_size_t)(_extendPct * len);
-        hal_size_t newFirst = max(start, i->second - pad);
-        for (hal_size_t j = newFirst; j < (hal_size_t)i->second; ++j) {
-            padding.push_back(j);
-        }
-        hal_size_t newLast = min(last, i->first + pad);
-        for (hal_size_t j = i->first + 1; j <= newLast; ++j) {
-            padding.push_back(j);
-        }
+    hal_index_t start = _sequence->getStartPosition();
+    hal_index_t end = start + (hal_index_t)_sequence->getSequenceLength();
+    for (size_t i = 0; i < _runs.size(); ++i) {
+        hal_size_t len = (hal_size_t)(_runs[i]._end - _runs[i]._start);
+        hal_index_t pad = (hal_index_t)(_extend ? _extend : (hal_size_t)(_extendPct * len));
+        _runs[i]._start = max(start, _runs[i]._start - pad);
+        _runs[i]._end = min(end, _runs[i]._end + pad);
     }
-    for (hal_size_t k = 0; k < padding.size(); ++k) {
-        _posCache.insert(padding[k]);
+    sort(_runs.begin(), _runs.end(),
+         [](const DnaMaskIndex::Run &a, const DnaMaskIndex::Run &b) { return a._start < b._start; });
+    size_t numMerged = 0;
+    for (size_t i = 0; i < _runs.size(); ++i) {
+        if (numMerged > 0 && _runs[i]._start <= _runs[numMerged - 1]._end) {
+            _runs[numMerged - 1]._end = max(_runs[numMerged - 1]._end, _runs[i]._end);
+        } else {
+            _runs[numMerged++] = _runs[i];
+        }
     }
+    _runs.resize(numMerged);
 }
 
-void MaskExtractor::writeCachedIntervals() {
+void MaskExtractor::writeRuns(TextWriter &out) {
     hal_index_t start = _sequence->getStartPosition();
-    const PositionCache::IntervalSet *intervalSet = _posCache.getIntervalSet();
-    PositionCache::IntervalSet::const_iterator i;
-    for (i = intervalSet->begin(); i != intervalSet->end(); ++i) {
-        *_bedStream << _sequence->getName() << '\t' << i->second - start << '\t' << (i->first + 1) - start << '\n';
+    for (size_t i = 0; i < _runs.size(); ++i) {
+        out << _sequence->getName() << '\t' << _runs[i]._start - start << '\t' << _runs[i]._end - start << '\n';
     }
 }
@@ -62,7 +62,7 @@ int main(int argc, char *argv[]) {
         throw hal_exception("Genome " + referenceGenomeName + " not present in alignment");
     }
 
-    ostream &os = cout;
+    TextWriter os(cout);
     size_t seqStart, seqEnd;
     if (refSequence != "") {
         seqStart = referenceGenome->getSequence(refSequence)->getStartPosition();
@@ -149,4 +149,5 @@ int main(int argc, char *argv[]) {
         colIt->toSite(colIt->getReferenceSequencePosition() + colIt->getReferenceSequence()->getStartPosition() + 1,
                       length == -1 ? seqEnd : seqStart + start + length - 1, true);
     }
+    os.flush();
 }
@@ -35,7 +35,7 @@ namespace hal {
         void write();
 
       protected:
-        std::ostream *_outBedStream;
+        TextWriter *_outBedWriter;
         const Genome *_refGenome;
         const Sequence *_refSequence;
         std::deque<BedLine> _outBedLines;
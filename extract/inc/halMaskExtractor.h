@@ -24,9 +24,9 @@ namespace hal {
                      double extendPct);
 
       protected:
-        void addMaskedBasesToCache();
-        void extendCachedIntervals();
-        void writeCachedIntervals();
+        void getMaskedRuns();
+        void extendRuns();
+        void writeRuns(TextWriter &out);
 
       protected:
         AlignmentConstPtr _alignment;
@@ -35,7 +35,7 @@ namespace hal {
         std::ostream *_bedStream;
         hal_size_t _extend;
         double _extendPct;
-        PositionCache _posCache;
+        DnaMaskIndex::RunVector _runs;
     };
 }
 
@@ -22,86 +22,7 @@ BedLine::BedLine() : _start(NULL_INDEX), _end(NULL_INDEX), _strand('+'), _bedTyp
 BedLine::~BedLine() {
 }
 
-/* bedType is zero or the number of standard bed columns.  All others
- * are saved as extra */
-istream &BedLine::read(istream &is, string &lineBuffer, int bedType) {
-    _bedType = bedType;
-    std::getline(is, lineBuffer);
-    std::vector<std::string> row = chopString(lineBuffer, "\t");
-    if (row.size() < 3) {
-        throw hal_exception("Expected at least three columns in BED record: " + lineBuffer);
-    }
-    if (_bedType == 0) {
-        _bedType = min(int(row.size()), 12);
-    }
-    _chrName = row[0];
-    _start = strToInt(row[1]);
-    _end = strToInt(row[2]);
-    if (_start >= _end) {
-        throw hal_exception("Error zero or negative length BED range: " + lineBuffer);
-    }
-    if (_bedType > 3) {
-        _name = row[3];
-    }
-    if (_bedType > 4) {
-        _score = strToInt(row[4]);
-    }
-    if (_bedType > 5) {
-        _strand = row[5][0];
-        if (_strand != '.' && _strand != '+' && _strand != '-') {
-            throw hal_exception("Strand character must be + or - or ." + lineBuffer);
-        }
-    }
-    if (_bedType > 6) {
-        _thickStart = strToInt(row[6]);
-    }
-    if (_bedType > 7) {
-        _thickEnd = strToInt(row[7]);
-    }
-   if (_bedType > 8) {
-        vector<string> rgbTokens = chopString(row[8], ",");
-        if (rgbTokens.size() > 3 || rgbTokens.size() == 0) {
-            throw hal_exception("Error parsing BED itemRGB: " + lineBuffer);
-        }
-        _itemR = strToInt(rgbTokens[0]);
-        _itemG = _itemB = _itemR;
-        if (rgbTokens.size() > 1) {
-            _itemG = strToInt(rgbTokens[1]);
-        }
-        if (rgbTokens.size() == 3) {
-            _itemB= strToInt(rgbTokens[2]);;
-        }
-    }
-    if (_bedType > 9) {
-        if (_bedType < 12) {
-            throw hal_exception("Error parsing BED, insufficient columns for blocks: " + lineBuffer);
-        }
-        size_t numBlocks = strToInt(row[9]);
-        vector<string> blockSizes = chopString(row[10], ",");
-        if (blockSizes.size() != numBlocks) {
-            throw hal_exception("Error parsing BED blockSizes: " + lineBuffer);
-        }
-        vector<string> blockStarts = chopString(row[11], ",");
-        if (blockStarts.size() != numBlocks) {
-            throw hal_exception("Error parsing BED blockStarts: " + lineBuffer);
-        }
-        _blocks.resize(numBlocks);
-        for (size_t i = 0; i < numBlocks; ++i) {
-            _blocks[i]._length = strToInt(blockSizes[i]);
-            _blocks[i]._start = strToInt(blockStarts[i]);
-            if (_start + _blocks[i]._start + _blocks[i]._length > _end) {
-                throw hal_exception("Error BED block out of range: " + lineBuffer);
-            }
-        }
-    }
-    _extra.clear();
-    for (int i = _bedType; i < row.size(); i++) {
-        _extra.push_back(row[i]);
-    }
-    return is;
-}
-
-ostream &BedLine::write(ostream &os) {
+TextWriter &BedLine::write(TextWriter &os) {
     os << _chrName << '\t' << _start << '\t' << _end;
 
     if (_bedType > 3) {
@@ -203,7 +124,7 @@ bool BedLineSrcLess::operator()(const BedLine &b1, const BedLine &b2) const {
     return b1._srcStart < b2._srcStart;
 }
 
-ostream &BedLine::writePSL(ostream &os, bool prefixWithName) {
+TextWriter &BedLine::writePSL(TextWriter &os, bool prefixWithName) {
     assert(_psl.size() == 1);
     const PSLInfo &psl = _psl[0];
     assert(_blocks.size() == psl._qBlockStarts.size());
@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halBedReader.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+using namespace hal;
+
+const size_t BedReader::BatchSize;
+const size_t BedReader::BufferSize = 4 * 1024 * 1024;
+
+static inline bool isSpace(char c) {
+    return isspace((unsigned char)c);
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* parse an integer as strToInt() does: leading white space and a sign are
+ * allowed, and anything after the digits is ignored */
+static hal_index_t parseInt(const char *pos, size_t length) {
+    const char *end = pos + length;
+    const char *first = pos;
+    while (pos < end && isSpace(*pos)) {
+        ++pos;
+    }
+    bool negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+')) {
+        negative = *pos == '-';
+        ++pos;
+    }
+    if (pos == end || !isDigit(*pos)) {
+        throw hal_exception("Error converting string to int: " + string(first, length));
+    }
+    const hal_size_t maxValue = numeric_limits<hal_index_t>::max();
+    hal_size_t value = 0;
+    for (; pos < end && isDigit(*pos); ++pos) {
+        hal_size_t digit = *pos - '0';
+        if (value > (maxValue - digit) / 10) {
+            throw hal_exception("Error converting string to int: " + string(first, length));
+        }
+        value = value * 10 + digit;
+    }
+    return negative ? -hal_index_t(value) : hal_index_t(value);
+}
+
+/* split as chopString() does: every separator starts a field, but an empty
+ * last field is dropped */
+static void splitFields(const char *text, size_t length, char separator, vector<BedBatch::Field> &fields) {
+    fields.clear();
+    size_t start = 0;
+    const char *sep;
+    while ((sep = (const char *)memchr(text + start, separator, length - start)) != NULL) {
+        BedBatch::Field field = {start, size_t(sep - text) - start};
+        fields.push_back(field);
+        start = sep - text + 1;
+    }
+    if (start < length) {
+        BedBatch::Field field = {start, length - start};
+        fields.push_back(field);
+    }
+}
+
+void BedBatch::clear() {
+    _chromIds.clear();
+    _starts.clear();
+    _ends.clear();
+    _bedTypes.clear();
+    _names.clear();
+    _scores.clear();
+    _strands.clear();
+    _thickStarts.clear();
+    _thickEnds.clear();
+    _itemRs.clear();
+    _itemGs.clear();
+    _itemBs.clear();
+    _blockOffsets.assign(1, 0);
+    _blocks.clear();
+    _extraOffsets.assign(1, 0);
+    _extras.clear();
+    _text.clear();
+}
+
+void BedBatch::getLine(size_t i, const vector<string> &chromNames, BedLine &bedLine) const {
+    int bedType = _bedTypes[i];
+    bedLine._bedType = bedType;
+    bedLine._chrName = chromNames[_chromIds[i]];
+    bedLine._start = _starts[i];
+    bedLine._end = _ends[i];
+    if (bedType > 3) {
+        bedLine._name.assign(_text.data() + _names[i]._offset, _names[i]._length);
+    }
+    if (bedType > 4) {
+        bedLine._score = _scores[i];
+    }
+    if (bedType > 5) {
+        bedLine._strand = _strands[i];
+    }
+    if (bedType > 6) {
+        bedLine._thickStart = _thickStarts[i];
+    }
+    if (bedType > 7) {
+        bedLine._thickEnd = _thickEnds[i];
+    }
+    if (bedType > 8) {
+        bedLine._itemR = _itemRs[i];
+        bedLine._itemG = _itemGs[i];
+        bedLine._itemB = _itemBs[i];
+    }
+    if (bedType > 9) {
+        bedLine._blocks.assign(_blocks.begin() + _blockOffsets[i], _blocks.begin() + _blockOffsets[i + 1]);
+    }
+    size_t numExtra = _extraOffsets[i + 1] - _extraOffsets[i];
+    bedLine._extra.resize(numExtra);
+    for (size_t j = 0; j < numExtra; ++j) {
+        const Field &extra = _extras[_extraOffsets[i] + j];
+        bedLine._extra[j].assign(_text.data() + extra._offset, extra._length);
+    }
+}
+
+BedReader::BedReader() : _bedStream(NULL), _next(0), _end(0), _eof(true), _numRecords(0), _lastChromId(0) {
+}
+
+void BedReader::open(istream *bedStream) {
+    _bedStream = bedStream;
+    _buffer.resize(BufferSize);
+    _next = _end = 0;
+    _eof = false;
+    _numRecords = 0;
+    _error.clear();
+}
+
+bool BedReader::readBatch(BedBatch &batch, int bedType) {
+    batch.clear();
+    if (!_error.empty()) {
+        string error;
+        swap(error, _error);
+        throw hal_exception(error);
+    }
+    const char *line;
+    size_t length;
+    while (batch.size() < BatchSize && nextLine(line, length)) {
+        ++_numRecords;
+        try {
+            parseLine(line, length, bedType, batch);
+        } catch (hal_exception &e) {
+            if (batch.size() == 0) {
+                throw;
+            }
+            _error = e.what();
+            break;
+        }
+    }
+    return batch.size() > 0;
+}
+
+/* find the next line that isn't blank, skipping its leading white space.
+ * It is left in the buffer, and is valid until the next call */
+bool BedReader::nextLine(const char *&line, size_t &length) {
+    for (;;) {
+        while (_next < _end && isSpace(_buffer[_next])) {
+            ++_next;
+        }
+        if (_next < _end) {
+            const char *start = _buffer.data() + _next;
+            const char *newline = (const char *)memchr(start, '\n', _end - _next);
+            if (newline != NULL || _eof) {
+                // last line may have no newline
+                length = (newline != NULL ? newline : _buffer.data() + _end) - start;
+                line = start;
+                _next = min(_end, _next + length + 1);
+                return true;
+            }
+        } else if (_eof) {
+            return false;
+        }
+        fill();
+    }
+}
+
+/* move the partial line to the front of the buffer, growing it if the line
+ * fills it, and read as much as fits after it */
+void BedReader::fill() {
+    if (_next > 0) {
+        memmove(_buffer.data(), _buffer.data() + _next, _end - _next);
+        _end -= _next;
+        _next = 0;
+    }
+    if (_end == _buffer.size()) {
+        _buffer.resize(_buffer.size() * 2);
+    }
+    _bedStream->read(_buffer.data() + _end, _buffer.size() - _end);
+    if (_bedStream->bad()) {
+        throw hal_exception("Error reading bed input stream");
+    }
+    _end += _bedStream->gcount();
+    _eof = !_bedStream->good();
+}
+
+void BedReader::parseLine(const char *line, size_t length, int bedType, BedBatch &batch) {
+    splitFields(line, length, '\t', _row);
+    if (_row.size() < 3) {
+        throw hal_exception("Expected at least three columns in BED record: " + string(line, length));
+    }
+    if (bedType == 0) {
+        bedType = min(int(_row.size()), 12);
+    } else if (size_t(bedType) > _row.size()) {
+        throw hal_exception("Expected " + std::to_string(bedType) + " columns in BED record: " + string(line, length));
+    }
+    // parse everything before adding to the batch, so a bad line adds nothing
+    hal_index_t start = parseInt(line + _row[1]._offset, _row[1]._length);
+    hal_index_t end = parseInt(line + _row[2]._offset, _row[2]._length);
+    if (start >= end) {
+        throw hal_exception("Error zero or negative length BED range: " + string(line, length));
+    }
+    hal_index_t score = 0;
+    if (bedType > 4) {
+        score = parseInt(line + _row[4]._offset, _row[4]._length);
+    }
+    char strand = '+';
+    if (bedType > 5) {
+        strand = _row[5]._length > 0 ? line[_row[5]._offset] : '\0';
+        if (strand != '.' && strand != '+' && strand != '-') {
+            throw hal_exception("Strand character must be + or - or ." + string(line, length));
+        }
+    }
+    hal_index_t thickStart = start;
+    if (bedType > 6) {
+        thickStart = parseInt(line + _row[6]._offset, _row[6]._length);
+    }
+    hal_index_t thickEnd = end;
+    if (bedType > 7) {
+        thickEnd = parseInt(line + _row[7]._offset, _row[7]._length);
+    }
+    hal_index_t rgb[3] = {0, 0, 0};
+    if (bedType > 8) {
+        const char *text = line + _row[8]._offset;
+        splitFields(text, _row[8]._length, ',', _list);
+        if (_list.size() > 3 || _list.size() == 0) {
+            throw hal_exception("Error parsing BED itemRGB: " + string(line, length));
+        }
+        for (size_t i = 0; i < 3; ++i) {
+            // a single value is used for all three
+            const BedBatch::Field &field = _list[i < _list.size() ? i : 0];
+            rgb[i] = parseInt(text + field._offset, field._length);
+        }
+    }
+    size_t numBlocks = 0;
+    if (bedType > 9) {
+        if (bedType < 12) {
+            throw hal_exception("Error parsing BED, insufficient columns for blocks: " + string(line, length));
+        }
+        numBlocks = parseInt(line + _row[9]._offset, _row[9]._length);
+        const char *sizesText = line + _row[10]._offset;
+        splitFields(sizesText, _row[10]._length, ',', _list);
+        if (_list.size() != numBlocks) {
+            throw hal_exception("Error parsing BED blockSizes: " + string(line, length));
+        }
+        const char *startsText = line + _row[11]._offset;
+        splitFields(startsText, _row[11]._length, ',', _blockStarts);
+        if (_blockStarts.size() != numBlocks) {
+            throw hal_exception("Error parsing BED blockStarts: " + string(line, length));
+        }
+        size_t firstBlock = batch._blocks.size();
+        for (size_t i = 0; i < numBlocks; ++i) {
+            BedBlock block;
+            block._length = parseInt(sizesText + _list[i]._offset, _list[i]._length);
+            block._start = parseInt(startsText + _blockStarts[i]._offset, _blockStarts[i]._length);
+            if (start + block._start + block._length > end) {
+                batch._blocks.resize(firstBlock);
+                throw hal_exception("Error BED block out of range: " + string(line, length));
+            }
+            batch._blocks.push_back(block);
+        }
+    }
+
+    batch._chromIds.push_back(internChrom(line + _row[0]._offset, _row[0]._length));
+    batch._starts.push_back(start);
+    batch._ends.push_back(end);
+    batch._bedTypes.push_back(bedType);
+    BedBatch::Field name = {batch._text.size(), 0};
+    if (bedType > 3) {
+        name._length = _row[3]._length;
+        batch._text.insert(batch._text.end(), line + _row[3]._offset, line + _row[3]._offset + _row[3]._length);
+    }
+    batch._names.push_back(name);
+    batch._scores.push_back(score);
+    batch._strands.push_back(strand);
+    batch._thickStarts.push_back(thickStart);
+    batch._thickEnds.push_back(thickEnd);
+    batch._itemRs.push_back(rgb[0]);
+    batch._itemGs.push_back(rgb[1]);
+    batch._itemBs.push_back(rgb[2]);
+    batch._blockOffsets.push_back(batch._blocks.size());
+    for (size_t i = bedType; i < _row.size(); ++i) {
+        BedBatch::Field extra = {batch._text.size(), _row[i]._length};
+        batch._text.insert(batch._text.end(), line + _row[i]._offset, line + _row[i]._offset + _row[i]._length);
+        batch._extras.push_back(extra);
+    }
+    batch._extraOffsets.push_back(batch._extras.size());
+}
+
+/* sorted BED files have runs of the same chromosome, so the last one is
+ * checked before the map */
+hal_size_t BedReader::internChrom(const char *name, size_t length) {
+    if (_lastChromId < _chromNames.size()) {
+        const string &last = _chromNames[_lastChromId];
+        if (last.length() == length && memcmp(last.data(), name, length) == 0) {
+            return _lastChromId;
+        }
+    }
+    _nameBuffer.assign(name, length);
+    unordered_map<string, hal_size_t>::iterator i = _chromIds.find(_nameBuffer);
+    if (i == _chromIds.end()) {
+        i = _chromIds.insert(make_pair(_nameBuffer, _chromNames.size())).first;
+        _chromNames.push_back(_nameBuffer);
+    }
+    _lastChromId = i->second;
+    return _lastChromId;
+}
+
+// Local Variables:
+// mode: c++
+// End:
@@ -16,7 +16,7 @@
 using namespace std;
 using namespace hal;
 
-BedScanner::BedScanner() : _bedStream(NULL) {
+BedScanner::BedScanner() : _bedStream(NULL), _chromId(0), _lineNumber(0), _chromGenome(NULL) {
 }
 
 BedScanner::~BedScanner() {
@@ -43,18 +43,21 @@ void BedScanner::scan(istream *is, int bedType) {
     if (_bedStream->bad()) {
         throw hal_exception("Error reading bed input stream");
     }
-    string lineBuffer;
+    _bedReader.open(_bedStream);
     _lineNumber = 0;
-    try {
-        skipWhiteSpaces(_bedStream);
-        while (_bedStream->good()) {
-            ++_lineNumber;
-            _bedLine.read(*_bedStream, lineBuffer, bedType);
-            visitLine();
-            skipWhiteSpaces(_bedStream);
+    for (;;) {
+        try {
+            if (!_bedReader.readBatch(_bedBatch, bedType)) {
+                break;
+            }
+        } catch (hal_exception &e) {
+            throw hal_exception(string(e.what()) + " in input bed line " + std::to_string(_bedReader.getNumRecords()));
+        }
+        try {
+            visitBatch(_bedBatch);
+        } catch (hal_exception &e) {
+            throw hal_exception(string(e.what()) + " in input bed line " + std::to_string(_lineNumber));
         }
-    } catch (hal_exception &e) {
-        throw hal_exception(string(e.what()) + " in input bed line " + std::to_string(_lineNumber));
     }
     visitEOF();
     _bedStream = NULL;
@@ -66,14 +69,34 @@ size_t BedScanner::getNumColumns(const string &bedLine) {
 void BedScanner::visitBegin() {
 }
 
+void BedScanner::visitBatch(const BedBatch &batch) {
+    for (size_t i = 0; i < batch.size(); ++i) {
+        ++_lineNumber;
+        batch.getLine(i, _bedReader.getChromNames(), _bedLine);
+        _chromId = batch._chromIds[i];
+        visitLine();
+    }
+}
+
 void BedScanner::visitLine() {
 }
 
 void BedScanner::visitEOF() {
 }
 
-void BedScanner::skipWhiteSpaces(istream *bedStream) {
-    while (bedStream->good() && std::isspace((char)bedStream->peek())) {
-        bedStream->get();
+const Sequence *BedScanner::getChromSequence(const Genome *genome) {
+    if (genome != _chromGenome) {
+        _chromGenome = genome;
+        _chromSequences.clear();
+        _chromLookedUp.clear();
+    }
+    if (_chromId >= _chromSequences.size()) {
+        _chromSequences.resize(_bedReader.getChromNames().size(), NULL);
+        _chromLookedUp.resize(_chromSequences.size(), false);
+    }
+    if (!_chromLookedUp[_chromId]) {
+        _chromSequences[_chromId] = genome->getSequence(_bedReader.getChromNames()[_chromId]);
+        _chromLookedUp[_chromId] = true;
     }
+    return _chromSequences[_chromId];
 }
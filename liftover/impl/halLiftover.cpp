@@ -13,7 +13,7 @@ using namespace std;
 using namespace hal;
 
 Liftover::Liftover()
-    : _outBedStream(NULL), _outPSL(false), _outPSLWithName(false), _srcGenome(NULL),
+    : _outBedWriter(NULL), _outPSL(false), _outPSLWithName(false), _srcGenome(NULL),
       _tgtGenome(NULL) {
 }
 
@@ -26,7 +26,6 @@ void Liftover::convert(AlignmentConstPtr alignment, const Genome *srcGenome, ist
     _srcGenome = srcGenome;
     _tgtGenome = tgtGenome;
     _coalescenceLimit = coalescenceLimit;
-    _outBedStream = outBedStream;
     _bedType = bedType;
     _traverseDupes = traverseDupes;
     _outPSL = outPSL;
@@ -37,7 +36,11 @@ void Liftover::convert(AlignmentConstPtr alignment, const Genome *srcGenome, ist
 
     _tgtSet.insert(tgtGenome);
 
+    TextWriter outBedWriter(*outBedStream);
+    _outBedWriter = &outBedWriter;
     scan(inBedStream, bedType);
+    outBedWriter.flush();
+    _outBedWriter = NULL;
 }
 
 void Liftover::visitBegin() {
@@ -49,7 +52,7 @@ void Liftover::visitLine() {
         _bedLine.expandToBed12();
     }
     _outBedLines.clear();
-    _srcSequence = _srcGenome->getSequence(_bedLine._chrName);
+    _srcSequence = getChromSequence(_srcGenome);
     if (_srcSequence == NULL) {
         pair<set<string>::iterator, bool> result = _missedSet.insert(_bedLine._chrName);
         if (result.second == true) {
@@ -98,9 +101,9 @@ void Liftover::writeLineResults() {
     BedList::iterator i = _outBedLines.begin();
     for (; i != _outBedLines.end(); ++i) {
         if (_outPSL == false) {
-            i->write(*_outBedStream);
+            i->write(*_outBedWriter);
         } else {
-            i->writePSL(*_outBedStream, _outPSLWithName);
+            i->writePSL(*_outBedWriter, _outPSLWithName);
         }
     }
 }
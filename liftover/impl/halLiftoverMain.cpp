@@ -7,9 +7,11 @@
 
 #include "halBlockLiftover.h"
 #include "halColumnLiftover.h"
+#include "halServeClient.h"
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 
 using namespace std;
 using namespace hal;
@@ -39,10 +41,57 @@ static void initParser(CLParser &optionsParser) {
     optionsParser.addOption("bedType", "number of standard columns (3 to 12), columns beyond this are passed "
                             "through.  This only needs to be specified for BEDs with less than 12 columns and "
                             "having non-standard extra columns.", 0);
+    optionsParser.addOption("serveSocket", "send the liftover to the halServe server listening on this socket "
+                            "instead of opening halFile here", "");
     optionsParser.setDescription("Map BED or PSL genome interval coordinates between "
                                  "two genomes.");
 }
 
+/* run the liftover in a halServe server, which already has the alignment
+ * open */
+static int liftoverWithServer(const string &serveSocket, const string &halPath, const string &srcGenomeName,
+                              const string &srcBedPath, const string &tgtGenomeName, const string &tgtBedPath,
+                              const string &coalescenceLimitName, bool noDupes, bool append, int bedType, bool outPSL,
+                              bool outPSLWithName) {
+    ifstream srcBed;
+    if (srcBedPath != "stdin") {
+        srcBed.open(srcBedPath.c_str());
+        if (!srcBed) {
+            throw hal_exception("Error opening srcBed, " + srcBedPath);
+        }
+    }
+    istream &srcBedStream = srcBedPath != "stdin" ? srcBed : cin;
+    string input((istreambuf_iterator<char>(srcBedStream)), istreambuf_iterator<char>());
+
+    vector<string> args = {"liftover", ServeClient::absolutePath(halPath), srcGenomeName, tgtGenomeName,
+                           "bedType=" + std::to_string(bedType)};
+    if (noDupes) {
+        args.push_back("noDupes");
+    }
+    if (outPSL) {
+        args.push_back("outPSL");
+    }
+    if (outPSLWithName) {
+        args.push_back("outPSLWithName");
+    }
+    if (coalescenceLimitName != "") {
+        args.push_back("coalescenceLimit=" + coalescenceLimitName);
+    }
+    ServeClient client(serveSocket);
+    string output = client.request(args, input);
+
+    ofstream tgtBed;
+    if (tgtBedPath != "stdout") {
+        tgtBed.open(tgtBedPath.c_str(), append ? ios::out | ios::app : ios_base::out);
+        if (!tgtBed) {
+            throw hal_exception("Error opening tgtBed, " + tgtBedPath);
+        }
+    }
+    ostream &tgtBedStream = tgtBedPath != "stdout" ? tgtBed : cout;
+    tgtBedStream << output;
+    return 0;
+}
+
 int main(int argc, char **argv) {
     CLParser optionsParser;
     initParser(optionsParser);
@@ -58,6 +107,7 @@ int main(int argc, char **argv) {
     int bedType;
     bool outPSL;
     bool outPSLWithName;
+    string serveSocket;
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("halFile");
@@ -78,6 +128,7 @@ int main(int argc, char **argv) {
         }
         outPSL = optionsParser.getFlag("outPSL");
         outPSLWithName = optionsParser.getFlag("outPSLWithName");
+        serveSocket = optionsParser.getOption<string>("serveSocket");
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
@@ -88,6 +139,10 @@ int main(int argc, char **argv) {
         if (outPSLWithName == true) {
             outPSL = true;
         }
+        if (!serveSocket.empty()) {
+            return liftoverWithServer(serveSocket, halPath, srcGenomeName, srcBedPath, tgtGenomeName, tgtBedPath,
+                                      coalescenceLimitName, noDupes, append, bedType, outPSL, outPSLWithName);
+        }
         AlignmentConstPtr alignment(openHalAlignment(halPath, &optionsParser));
         if (alignment->getNumGenomes() == 0) {
             throw hal_exception("hal alignment is empty");
@@ -9,15 +9,108 @@
 #include "halBlockMapper.h"
 #include "halWiggleLoader.h"
 #include <cassert>
+#include <condition_variable>
 #include <deque>
+#include <limits>
+#include <mutex>
 
 using namespace std;
 using namespace hal;
 
 const double WiggleLiftover::DefaultValue = 0.0;
 const hal_size_t WiggleLiftover::DefaultTileSize = 10000;
+const size_t WiggleLiftover::ChunkValues = 1 << 16;
 
-WiggleLiftover::WiggleLiftover() {
+namespace hal {
+    /* chunks of input passed from the reading thread to the mapping ones,
+     * with a fixed number in use so reading can't get far ahead */
+    class WiggleChunkQueue {
+      public:
+        WiggleChunkQueue(size_t size, WiggleLiftover::Chunk *chunks) : _closed(false), _failed(false) {
+            for (size_t i = 0; i < size; ++i) {
+                _free.push_back(&chunks[i]);
+            }
+        }
+
+        /* get an empty chunk to fill, or NULL if a thread has failed */
+        WiggleLiftover::Chunk *getFree() {
+            unique_lock<mutex> lock(_mutex);
+            _freeReady.wait(lock, [this] { return !_free.empty() || _failed; });
+            if (_failed) {
+                return NULL;
+            }
+            WiggleLiftover::Chunk *chunk = _free.front();
+            _free.pop_front();
+            return chunk;
+        }
+
+        void put(WiggleLiftover::Chunk *chunk) {
+            {
+                lock_guard<mutex> lock(_mutex);
+                _full.push_back(chunk);
+            }
+            _fullReady.notify_one();
+        }
+
+        /* get a chunk to map, or NULL once the queue is closed and empty or
+         * a thread has failed */
+        WiggleLiftover::Chunk *get() {
+            unique_lock<mutex> lock(_mutex);
+            _fullReady.wait(lock, [this] { return !_full.empty() || _closed || _failed; });
+            if (_full.empty() || _failed) {
+                return NULL;
+            }
+            WiggleLiftover::Chunk *chunk = _full.front();
+            _full.pop_front();
+            return chunk;
+        }
+
+        void release(WiggleLiftover::Chunk *chunk) {
+            chunk->_cvals.clear();
+            chunk->_groupEnds.clear();
+            {
+                lock_guard<mutex> lock(_mutex);
+                _free.push_back(chunk);
+            }
+            _freeReady.notify_one();
+        }
+
+        /* no more chunks will be put */
+        void close() {
+            {
+                lock_guard<mutex> lock(_mutex);
+                _closed = true;
+            }
+            _fullReady.notify_all();
+        }
+
+        /* stop all threads after an error */
+        void fail() {
+            {
+                lock_guard<mutex> lock(_mutex);
+                _failed = true;
+            }
+            _freeReady.notify_all();
+            _fullReady.notify_all();
+        }
+
+        bool failed() {
+            lock_guard<mutex> lock(_mutex);
+            return _failed;
+        }
+
+      private:
+        deque<WiggleLiftover::Chunk *> _free;
+        deque<WiggleLiftover::Chunk *> _full;
+        bool _closed;
+        bool _failed;
+        mutex _mutex;
+        condition_variable _freeReady;
+        condition_variable _fullReady;
+    };
+}
+
+WiggleLiftover::WiggleLiftover() : _queue(NULL), _chunk(NULL) {
 }
 
 WiggleLiftover::~WiggleLiftover() {
@@ -31,7 +124,15 @@ void WiggleLiftover::preloadOutput(AlignmentConstPtr alignment, const Genome *tg
 
 void WiggleLiftover::convert(AlignmentConstPtr alignment, const Genome *srcGenome, istream *inputFile, const Genome *tgtGenome,
                              ostream *outputFile, bool traverseDupes, bool unique) {
-    _alignment = alignment;
+    convertParallel(vector<AlignmentConstPtr>(1, alignment), srcGenome, inputFile, tgtGenome, outputFile, traverseDupes,
+                    unique);
+}
+
+void WiggleLiftover::convertParallel(const vector<AlignmentConstPtr> &alignments, const Genome *srcGenome,
+                                     istream *inputFile, const Genome *tgtGenome, ostream *outputFile, bool traverseDupes,
+                                     bool unique) {
+    assert(!alignments.empty());
+    _alignment = alignments[0];
     _srcGenome = srcGenome;
     _tgtGenome = tgtGenome;
     _outStream = outputFile;
@@ -39,23 +140,55 @@ void WiggleLiftover::convert(AlignmentConstPtr alignment, const Genome *srcGenom
     _unique = unique;
     _srcSequence = NULL;
 
-    if (_srcGenome->getNumTopSegments() > 0) {
-        _segment = _srcGenome->getTopSegmentIterator();
-        _lastIndex = (hal_index_t)_srcGenome->getNumTopSegments();
-    } else {
-        _segment = _srcGenome->getBottomSegmentIterator();
-        _lastIndex = (hal_index_t)_srcGenome->getNumBottomSegments();
-    }
-
-    set<const Genome *> inputSet;
-    inputSet.insert(_srcGenome);
-    inputSet.insert(_tgtGenome);
-    getGenomesInSpanningTree(inputSet, _tgtSet);
     // if not init'd by preload()...
     if (_outVals.getGenomeSize() == 0) {
         _outVals.init(tgtGenome->getSequenceLength(), DefaultValue, DefaultTileSize);
     }
-    scan(inputFile);
+    _mapper.init(_srcGenome, _tgtGenome, _traverseDupes, &_outVals);
+    _groupStart = 0;
+
+    if (alignments.size() == 1) {
+        Chunk chunk;
+        _chunk = &chunk;
+        scan(inputFile);
+        _chunk = NULL;
+    } else {
+        // the reader only keeps its place in the source segments to group
+        // the values as they would be mapped here
+        _mapper._vals = NULL;
+        size_t numMappers = alignments.size() - 1;
+        vector<Chunk> chunks(2 * numMappers);
+        WiggleChunkQueue queue(chunks.size(), chunks.data());
+        _queue = &queue;
+        vector<WiggleTiles<double>> threadVals(alignments.size());
+        runThreads(alignments.size(), [&](hal_size_t threadNum) {
+            try {
+                if (threadNum == 0) {
+                    _chunk = queue.getFree();
+                    scan(inputFile);
+                    if (_chunk != NULL && !_chunk->_cvals.empty()) {
+                        queue.put(_chunk);
+                    }
+                    queue.close();
+                } else {
+                    mapChunks(alignments[threadNum], threadVals[threadNum]);
+                }
+            } catch (...) {
+                if (threadNum == 0 && queue.failed()) {
+                    // the mapping thread's error is the one to report
+                    return;
+                }
+                queue.fail();
+                throw;
+            }
+        });
+        _queue = NULL;
+        _chunk = NULL;
+        for (size_t i = 1; i < threadVals.size(); ++i) {
+            _outVals.mergeMax(threadVals[i]);
+            threadVals[i].clear();
+        }
+    }
     write();
     _outVals.clear();
 }
@@ -72,95 +205,154 @@ void WiggleLiftover::visitLine() {
     if (_srcSequence == NULL) {
         throw hal_exception("Missing Wig header");
     }
-    if (_segment->getArrayIndex() >= _lastIndex) {
-        _segment->setArrayIndex(_segment->getGenome(), 0);
+    SegmentIteratorPtr &segment = _mapper._segment;
+    if (segment->getArrayIndex() >= _mapper._lastIndex) {
+        segment->setArrayIndex(segment->getGenome(), 0);
     }
     hal_index_t absFirst = _first + _srcSequence->getStartPosition();
     hal_index_t absLast = _last + _srcSequence->getStartPosition();
-    _segment->slice(0, 0);
-    if (absFirst < _segment->getStartPosition() || absLast > _segment->getEndPosition()) {
+    segment->slice(0, 0);
+    if (absFirst < segment->getStartPosition() || absLast > segment->getEndPosition()) {
         mapSegment();
     }
-    if (_cvals.size() > 0 && _cvals.back()._last >= absFirst) {
+    if (_chunk == NULL) {
+        throw hal_exception("stopped reading after a wiggle mapping error");
+    }
+    ValVec &cvals = _chunk->_cvals;
+    if (cvals.size() > _groupStart && cvals.back()._last >= absFirst) {
         throw hal_exception("Coordinate out of order");
     }
     CoordVal cv = {absFirst, absLast, _value};
-    _cvals.push_back(cv);
+    cvals.push_back(cv);
 }
 
 void WiggleLiftover::visitEOF() {
     mapSegment();
 }
 
+/* map the values read since the last call, or with mapping threads add them
+ * to the chunk as a group, passing the chunk on once it is big enough */
 void WiggleLiftover::mapSegment() {
-    if (_cvals.empty()) {
+    if (_chunk == NULL || _chunk->_cvals.size() == _groupStart) {
         return;
     }
+    ValVec &cvals = _chunk->_cvals;
+    _mapper.map(cvals.data() + _groupStart, cvals.data() + cvals.size());
+    if (_queue == NULL) {
+        cvals.clear();
+    } else {
+        _chunk->_groupEnds.push_back(cvals.size());
+        _groupStart = cvals.size();
+        if (cvals.size() >= ChunkValues) {
+            _queue->put(_chunk);
+            _chunk = _queue->getFree();
+            _groupStart = 0;
+        }
+    }
+}
+
+/* map chunks from the queue until it is empty, using a thread's own
+ * alignment instance */
+void WiggleLiftover::mapChunks(AlignmentConstPtr alignment, WiggleTiles<double> &vals) {
+    const Genome *srcGenome = alignment->openGenome(_srcGenome->getName());
+    const Genome *tgtGenome = alignment->openGenome(_tgtGenome->getName());
+    // unset positions take the value mapped to them when merged
+    vals.init(tgtGenome->getSequenceLength(), numeric_limits<double>::lowest(), DefaultTileSize);
+    Mapper mapper;
+    mapper.init(srcGenome, tgtGenome, _traverseDupes, &vals);
+    Chunk *chunk;
+    while ((chunk = _queue->get()) != NULL) {
+        // chunks can come in any order, so find the first segment afresh
+        mapper._segment->setArrayIndex(mapper._segment->getGenome(), 0);
+        size_t groupStart = 0;
+        for (size_t i = 0; i < chunk->_groupEnds.size(); ++i) {
+            mapper.map(chunk->_cvals.data() + groupStart, chunk->_cvals.data() + chunk->_groupEnds[i]);
+            groupStart = chunk->_groupEnds[i];
+        }
+        _queue->release(chunk);
+    }
+}
+
+void WiggleLiftover::Mapper::init(const Genome *srcGenome, const Genome *tgtGenome, bool traverseDupes,
+                                  WiggleTiles<double> *vals) {
+    _srcGenome = srcGenome;
+    _tgtGenome = tgtGenome;
+    _traverseDupes = traverseDupes;
+    _vals = vals;
+    if (_srcGenome->getNumTopSegments() > 0) {
+        _segment = _srcGenome->getTopSegmentIterator();
+        _lastIndex = (hal_index_t)_srcGenome->getNumTopSegments();
+    } else {
+        _segment = _srcGenome->getBottomSegmentIterator();
+        _lastIndex = (hal_index_t)_srcGenome->getNumBottomSegments();
+    }
+
+    set<const Genome *> inputSet;
+    inputSet.insert(_srcGenome);
+    inputSet.insert(_tgtGenome);
+    _tgtSet.clear();
+    getGenomesInSpanningTree(inputSet, _tgtSet);
+}
+
+void WiggleLiftover::Mapper::map(const CoordVal *first, const CoordVal *last) {
+    assert(first < last);
+    const CoordVal &back = *(last - 1);
     if (_segment->getArrayIndex() == 0 || _segment->getArrayIndex() >= _lastIndex) {
-        _segment->toSite(_cvals[0]._first, false);
+        _segment->toSite(first->_first, false);
     }
-    while (_segment->getEndPosition() < _cvals[0]._first) {
+    while (_segment->getEndPosition() < first->_first) {
         _segment->toRight();
     }
 
-    while (_cvals[0]._first < _segment->getStartPosition()) {
+    while (first->_first < _segment->getStartPosition()) {
         assert(_segment->getArrayIndex() > 0);
         assert(_segment->getReversed() == false);
-        _segment->toLeft(_cvals[0]._first);
+        _segment->toLeft(first->_first);
     }
 
-    assert(_cvals[0]._first <= _segment->getEndPosition());
-    if (_cvals[0]._first > _segment->getStartPosition()) {
-        hal_offset_t so = _cvals[0]._first - _segment->getStartPosition();
+    assert(first->_first <= _segment->getEndPosition());
+    if (first->_first > _segment->getStartPosition()) {
+        hal_offset_t so = first->_first - _segment->getStartPosition();
         _segment->slice(so, _segment->getEndOffset());
     }
-    if (_segment->getEndPosition() > _cvals.back()._last) {
-        hal_offset_t eo = _segment->getEndPosition() - _cvals.back()._last;
+    if (_segment->getEndPosition() > back._last) {
+        hal_offset_t eo = _segment->getEndPosition() - back._last;
         _segment->slice(_segment->getStartOffset(), eo);
     }
 
     _mappedSegments.clear();
-    while (_segment->getArrayIndex() < _lastIndex && _segment->getStartPosition() <= (_cvals.back()._last)) {
-        halMapSegment(_segment.get(), _mappedSegments, _tgtGenome, &_tgtSet, _traverseDupes);
-        _segment->toRight(_cvals.back()._last);
+    while (_segment->getArrayIndex() < _lastIndex && _segment->getStartPosition() <= back._last) {
+        if (_vals != NULL) {
+            halMapSegment(_segment.get(), _mappedSegments, _tgtGenome, &_tgtSet, _traverseDupes);
+        }
+        _segment->toRight(back._last);
     }
 
-    vector<MappedSegmentPtr> fragments;
     MappedSegmentSet emptySet;
     set<hal_index_t> queryCutSet;
     set<hal_index_t> targetCutSet;
 
     for (std::set<MappedSegmentPtr>::iterator i = _mappedSegments.begin(); i != _mappedSegments.end(); ++i) {
-        BlockMapper::extractSegment(i, emptySet, fragments, &_mappedSegments, targetCutSet, queryCutSet);
-        mapFragments(fragments);
+        BlockMapper::extractSegment(i, emptySet, _fragments, &_mappedSegments, targetCutSet, queryCutSet);
+        mapFragments(first, last);
     }
-    _cvals.clear();
 }
 
-void WiggleLiftover::mapFragments(vector<MappedSegmentPtr> &fragments) {
-    sort(fragments.begin(), fragments.end(), MappedSegment::LessSourcePtr());
-    _cvIdx = 0;
-
-    for (size_t i = 0; i < fragments.size() && _cvIdx < _cvals.size(); ++i) {
-        MappedSegmentPtr &seg = fragments[i];
-        for (size_t j = 0; j < seg->getLength() && _cvIdx < _cvals.size(); ++j) {
-            hal_index_t pos = seg->getSource()->getStartPosition() + j;
-            while (_cvIdx < _cvals.size() && _cvals[_cvIdx]._last < pos) {
-                ++_cvIdx;
-            }
-            if (pos >= _cvals[_cvIdx]._first && pos <= _cvals[_cvIdx]._last) {
-                assert(_cvals[_cvIdx]._first <= pos);
-                hal_index_t mpos;
-
-                if (seg->getReversed() == false) {
-                    mpos = seg->getStartPosition() + j;
-                } else {
-                    mpos = seg->getStartPosition() - j;
-                }
-                if (_cvIdx < _cvals.size() && _cvals[_cvIdx]._first <= pos && _cvals[_cvIdx]._last >= pos) {
-                    double val = std::max(_cvals[_cvIdx]._val, _outVals.get(mpos));
-                    _outVals.set(mpos, val);
-                }
+/* set the target range of each part of a fragment covered by a value */
+void WiggleLiftover::Mapper::mapFragments(const CoordVal *first, const CoordVal *last) {
+    for (size_t i = 0; i < _fragments.size(); ++i) {
+        MappedSegmentPtr &seg = _fragments[i];
+        hal_index_t srcStart = seg->getSource()->getStartPosition();
+        hal_index_t srcLast = srcStart + (hal_index_t)seg->getLength() - 1;
+        const CoordVal *cv = lower_bound(first, last, srcStart,
+                                         [](const CoordVal &val, hal_index_t pos) { return val._last < pos; });
+        for (; cv < last && cv->_first <= srcLast; ++cv) {
+            hal_index_t from = max(cv->_first, srcStart) - srcStart;
+            hal_index_t to = min(cv->_last, srcLast) - srcStart;
+            if (seg->getReversed() == false) {
+                _vals->setMax(seg->getStartPosition() + from, seg->getStartPosition() + to, cv->_val);
+            } else {
+                _vals->setMax(seg->getStartPosition() - to, seg->getStartPosition() - from, cv->_val);
             }
         }
     }
@@ -168,31 +360,29 @@ void WiggleLiftover::mapFragments(vector<MappedSegmentPtr> &fragments) {
 
 void WiggleLiftover::write() {
     const Sequence *outSequence = NULL;
-    hal_size_t ogSize = _tgtGenome->getSequenceLength();
     bool needHeader = true;
     hal_index_t prevPos = NULL_INDEX;
+    TextWriter out(*_outStream, true);
     for (hal_size_t i = 0; i < _outVals.getNumTiles(); ++i) {
-        if (_outVals.isTileEmpty(i) == false) {
-            hal_index_t pos = i * _outVals.getTileSize();
-            for (hal_size_t j = 0; pos < ogSize && j < _outVals.getTileSize(); ++j, ++pos) {
-                if (_outVals.exists(pos) == true) {
-                    if (outSequence == NULL || pos < outSequence->getStartPosition() || pos > outSequence->getEndPosition()) {
-                        outSequence = _tgtGenome->getSequenceBySite(pos);
-                        assert(outSequence != NULL);
-                        needHeader = true;
-                    } else if (pos != prevPos + 1) {
-                        needHeader = true;
-                    }
-                    if (needHeader == true) {
-                        *_outStream << "fixedStep"
-                                    << "\tchrom=" << outSequence->getName()
-                                    << "\tstart=" << (1 + pos - outSequence->getStartPosition()) << "\tstep=1\n";
-                        needHeader = false;
-                    }
-                    *_outStream << _outVals.get(pos) << '\n';
-                    prevPos = pos;
+        _outVals.forEachRange(i, [&](hal_index_t first, hal_index_t last, double value) {
+            for (hal_index_t pos = first; pos <= last; ++pos) {
+                if (outSequence == NULL || pos < outSequence->getStartPosition() || pos > outSequence->getEndPosition()) {
+                    outSequence = _tgtGenome->getSequenceBySite(pos);
+                    assert(outSequence != NULL);
+                    needHeader = true;
+                } else if (pos != prevPos + 1) {
+                    needHeader = true;
                 }
+                if (needHeader == true) {
+                    out << "fixedStep"
+                        << "\tchrom=" << outSequence->getName()
+                        << "\tstart=" << (1 + pos - outSequence->getStartPosition()) << "\tstep=1\n";
+                    needHeader = false;
+                }
+                out << value << '\n';
+                prevPos = pos;
             }
-        }
+        });
     }
+    out.flush();
 }
@@ -29,6 +29,10 @@ static void initParser(CLParser &optionsParser) {
                                           " memory then overwritten, so this data can be lost "
                                           "in event of a crash",
                                 false);
+    optionsParser.addOption("numThreads", "number of threads mapping the input, "
+                                          "each with its own instance of the alignment, "
+                                          "while it is read by another",
+                            1);
 #if 0
   optionsParser.addOptionFlag("unique",
                                "only map block if its left-most paralog is in"
@@ -54,6 +58,7 @@ int main(int argc, char **argv) {
     bool noDupes;
     bool append;
     bool unique;
+    hal_size_t numThreads;
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("halFile");
@@ -63,6 +68,10 @@ int main(int argc, char **argv) {
         tgtWigPath = optionsParser.getArgument<string>("tgtWig");
         noDupes = optionsParser.getFlag("noDupes");
         append = optionsParser.getFlag("append");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (numThreads == 0) {
+            throw hal_exception("--numThreads must be at least 1");
+        }
         //  unique = optionsParser.getFlag("unique");
         unique = false;
     } catch (exception &e) {
@@ -120,7 +129,14 @@ int main(int argc, char **argv) {
             }
         }
 
-        liftover.convert(alignment, srcGenome, srcWigPtr, tgtGenome, tgtWigPtr, !noDupes, unique);
+        vector<AlignmentConstPtr> alignments(1, alignment);
+        if (numThreads > 1) {
+            alignments = openHalAlignmentPerThread(alignment, halPath, &optionsParser, numThreads + 1);
+            if (alignments.size() == 1) {
+                cerr << "Warning [halWiggleLiftover]: HDF5 library is not thread-safe, ignoring --numThreads" << endl;
+            }
+        }
+        liftover.convertParallel(alignments, srcGenome, srcWigPtr, tgtGenome, tgtWigPtr, !noDupes, unique);
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
         return 1;
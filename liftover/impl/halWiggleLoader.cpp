@@ -42,7 +42,5 @@ void WiggleLoader::visitLine() {
     hal_index_t absFirst = _first + _srcSequence->getStartPosition();
     hal_index_t absLast = _last + _srcSequence->getStartPosition();
 
-    for (hal_index_t absPos = absFirst; absPos <= absLast; ++absPos) {
-        _vals->set(absPos, _value);
-    }
+    _vals->set(absFirst, absLast, _value);
 }
@@ -50,9 +50,8 @@ namespace hal {
     struct BedLine {
         BedLine();
         virtual ~BedLine();
-        std::istream &read(std::istream &is, std::string &lineBuffer, int bedType);
-        std::ostream &write(std::ostream &os);
-        std::ostream &writePSL(std::ostream &os, bool prefixWithName = false);
+        TextWriter &write(TextWriter &os);
+        TextWriter &writePSL(TextWriter &os, bool prefixWithName = false);
         bool validatePSL() const;
         void expandToBed12();
 
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALBEDREADER_H
+#define _HALBEDREADER_H
+
+#include "hal.h"
+#include "halBedLine.h"
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hal {
+
+    /** A batch of BED records stored by column, as read by BedReader.
+     * Chromosome names are interned by the reader, so a record holds the
+     * index of its name.  The name and extra columns are kept as spans of
+     * _text.  Columns beyond a record's BED type hold no value.  Nothing
+     * is freed between batches, so reading doesn't allocate once the
+     * columns have grown to the batch size. */
+    struct BedBatch {
+        struct Field {
+            size_t _offset;
+            size_t _length;
+        };
+
+        size_t size() const {
+            return _starts.size();
+        }
+        void clear();
+
+        /** copy record i into a BedLine, leaving columns beyond its type
+         * as they were */
+        void getLine(size_t i, const std::vector<std::string> &chromNames, BedLine &bedLine) const;
+
+        std::vector<hal_size_t> _chromIds;
+        std::vector<hal_index_t> _starts;
+        std::vector<hal_index_t> _ends;
+        std::vector<int> _bedTypes;
+        std::vector<Field> _names;
+        std::vector<hal_index_t> _scores;
+        std::vector<char> _strands;
+        std::vector<hal_index_t> _thickStarts;
+        std::vector<hal_index_t> _thickEnds;
+        std::vector<hal_index_t> _itemRs;
+        std::vector<hal_index_t> _itemGs;
+        std::vector<hal_index_t> _itemBs;
+        // blocks of record i are [_blockOffsets[i], _blockOffsets[i + 1])
+        std::vector<size_t> _blockOffsets;
+        std::vector<BedBlock> _blocks;
+        // columns after the BED type, as for blocks
+        std::vector<size_t> _extraOffsets;
+        std::vector<Field> _extras;
+        std::vector<char> _text;
+    };
+
+    /** Read BED records from a stream in batches, splitting the lines in
+     * place in a large buffer rather than reading and parsing each line
+     * through the stream.  Blank lines and leading white space are
+     * skipped. */
+    class BedReader {
+      public:
+        static const size_t BatchSize = 4096;
+
+        BedReader();
+
+        /** start reading a stream, keeping the names interned so far */
+        void open(std::istream *bedStream);
+
+        /** read up to BatchSize records into batch.  A record that can't be
+         * parsed is reported by the next call, so the records before it are
+         * returned first.
+         * @param bedType number of standard columns, or 0 to use the
+         * number each line has (up to 12)
+         * @return false at the end of the stream */
+        bool readBatch(BedBatch &batch, int bedType);
+
+        /** number of records read, including one that failed to parse */
+        hal_size_t getNumRecords() const {
+            return _numRecords;
+        }
+
+        const std::vector<std::string> &getChromNames() const {
+            return _chromNames;
+        }
+
+      private:
+        static const size_t BufferSize;
+
+        bool nextLine(const char *&line, size_t &length);
+        void parseLine(const char *line, size_t length, int bedType, BedBatch &batch);
+        hal_size_t internChrom(const char *name, size_t length);
+        void fill();
+
+        std::istream *_bedStream;
+        std::vector<char> _buffer;
+        size_t _next;
+        size_t _end;
+        bool _eof;
+        hal_size_t _numRecords;
+        std::string _error;
+        // columns of the line being parsed, and lists within them
+        std::vector<BedBatch::Field> _row;
+        std::vector<BedBatch::Field> _list;
+        std::vector<BedBatch::Field> _blockStarts;
+        std::vector<std::string> _chromNames;
+        std::unordered_map<std::string, hal_size_t> _chromIds;
+        std::string _nameBuffer;
+        hal_size_t _lastChromId;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
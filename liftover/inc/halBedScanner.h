@@ -10,6 +10,7 @@
 
 #include "hal.h"
 #include "halBedLine.h"
+#include "halBedReader.h"
 #include <cstdlib>
 #include <fstream>
 #include <string>
@@ -19,7 +20,10 @@ namespace hal {
 
     /** Parse a BED file line by line
      * written independently from the bed export, and it's too much of a
-     * bother to reuse any of that code. */
+     * bother to reuse any of that code.
+     * The file is read in batches by BedReader; visitBatch() passes each
+     * record of a batch to visitLine() in _bedLine, unless overridden to
+     * process the batch's columns directly. */
     class BedScanner {
       public:
         BedScanner();
@@ -31,15 +35,28 @@ namespace hal {
 
       protected:
         virtual void visitBegin();
+        virtual void visitBatch(const BedBatch &batch);
         virtual void visitLine();
         virtual void visitEOF();
 
-        static void skipWhiteSpaces(std::istream *bedStream);
+        /** the sequence of genome named by the chromosome of the current
+         * line, or NULL if there is none.  Lookups are cached by the
+         * line's interned chromosome. */
+        const Sequence *getChromSequence(const Genome *genome);
 
       protected:
         std::istream *_bedStream;
+        BedReader _bedReader;
+        BedBatch _bedBatch;
         BedLine _bedLine;
+        // interned chromosome of _bedLine
+        hal_size_t _chromId;
         hal_size_t _lineNumber;
+
+      private:
+        const Genome *_chromGenome;
+        std::vector<const Sequence *> _chromSequences;
+        std::vector<bool> _chromLookedUp;
     };
 }
 
@@ -45,7 +45,8 @@ namespace hal {
 
       protected:
         AlignmentConstPtr _alignment;
-        std::ostream *_outBedStream;
+        // buffers the output stream for the duration of convert()
+        TextWriter *_outBedWriter;
         bool _bedType;
         bool _traverseDupes;
         BedList _outBedLines;
@@ -17,6 +17,8 @@
 
 namespace hal {
 
+    class WiggleChunkQueue;
+
     class WiggleLiftover : public WiggleScanner {
       public:
         WiggleLiftover();
@@ -27,8 +29,20 @@ namespace hal {
         void convert(AlignmentConstPtr alignment, const Genome *srcGenome, std::istream *inputFile, const Genome *tgtGenome,
                      std::ostream *outputFile, bool traverseDupes = true, bool unique = false);
 
+        /** As convert(), but with the input split into chunks that are mapped
+         * by one thread per alignment instance after the first, each into
+         * its own tiles which are merged at the end.  The instances must all
+         * be of the same file (see openHalAlignmentPerThread).  The first
+         * is used to read the input and write the output, and the genomes
+         * must be from it. */
+        void convertParallel(const std::vector<AlignmentConstPtr> &alignments, const Genome *srcGenome,
+                             std::istream *inputFile, const Genome *tgtGenome, std::ostream *outputFile,
+                             bool traverseDupes = true, bool unique = false);
+
         static const double DefaultValue;
         static const hal_size_t DefaultTileSize;
+        /* number of input values handed to a mapping thread at once */
+        static const size_t ChunkValues;
 
       protected:
         virtual void visitLine();
@@ -36,10 +50,12 @@ namespace hal {
         virtual void visitEOF();
 
         void mapSegment();
-        void mapFragments(std::vector<MappedSegmentPtr> &fragments);
+        void mapChunks(AlignmentConstPtr alignment, WiggleTiles<double> &vals);
         void write();
 
       protected:
+        friend class WiggleChunkQueue;
+
         struct CoordVal {
             hal_index_t _first;
             hal_index_t _last;
@@ -47,6 +63,33 @@ namespace hal {
         };
         typedef std::vector<CoordVal> ValVec;
 
+        /* input values in the order read, in groups that are each within a
+         * run of source segments and mapped together */
+        struct Chunk {
+            ValVec _cvals;
+            std::vector<size_t> _groupEnds;
+        };
+
+        /* maps groups of values from the source genome to tiles of the
+         * target, keeping its place in the source segments */
+        struct Mapper {
+            void init(const Genome *srcGenome, const Genome *tgtGenome, bool traverseDupes, WiggleTiles<double> *vals);
+            /* map the values, or if vals is NULL only move past the source
+             * segments they cover */
+            void map(const CoordVal *first, const CoordVal *last);
+            void mapFragments(const CoordVal *first, const CoordVal *last);
+
+            const Genome *_srcGenome;
+            const Genome *_tgtGenome;
+            std::set<const Genome *> _tgtSet;
+            bool _traverseDupes;
+            WiggleTiles<double> *_vals;
+            SegmentIteratorPtr _segment;
+            hal_index_t _lastIndex;
+            MappedSegmentSet _mappedSegments;
+            std::vector<MappedSegmentPtr> _fragments;
+        };
+
         AlignmentConstPtr _alignment;
         std::istream *_inStream;
         std::ostream *_outStream;
@@ -56,14 +99,14 @@ namespace hal {
         const Genome *_srcGenome;
         const Genome *_tgtGenome;
         const Sequence *_srcSequence;
-        std::set<const Genome *> _tgtSet;
-        MappedSegmentSet _mappedSegments;
-        hal_index_t _lastIndex;
 
-        SegmentIteratorPtr _segment;
-        ValVec _cvals;
+        // mapper of the reading thread, which only keeps its place when
+        // others do the mapping
+        Mapper _mapper;
+        WiggleChunkQueue *_queue;
+        Chunk *_chunk;
+        size_t _groupStart;
         WiggleTiles<double> _outVals;
-        hal_index_t _cvIdx;
     };
 }
 #endif
@@ -9,8 +9,11 @@
 #define _HALWIGGLETILES_H
 
 #include "hal.h"
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -18,7 +21,13 @@ namespace hal {
 
     /** Memory structure to keep track of wiggle results by tiling the genome
      * into regular intervals.  The idea is that if we are only writing a
-     * subregion, then we don't bother allocating space for the whole genome
+     * subregion, then we don't bother allocating space for the whole genome.
+     *
+     * A tile is kept as runs of consecutive positions with the same value,
+     * so a sparse or piecewise constant signal costs memory in proportion
+     * to the runs rather than the bases they cover.  Once the runs of a
+     * tile would take more space than an array of its values, it is
+     * converted to the array.
     */
     template <class T> class WiggleTiles {
       public:
@@ -39,11 +48,26 @@ namespace hal {
          * pos which is set to val*/
         void set(hal_index_t pos, T val);
 
+        /** Set every position in [first, last] to val */
+        void set(hal_index_t first, hal_index_t last, T val);
+
+        /** Set every position in [first, last] to the larger of val and its
+         * current value, which is the default value if it was not set */
+        void setMax(hal_index_t first, hal_index_t last, T val);
+
+        /** setMax() each position set in other, which must have the same
+         * genome and tile sizes */
+        void mergeMax(const WiggleTiles<T> &other);
+
         /** Test if a value was written to using set().  Doing a get() isn't
          * really sufficient because it will return the default value in the case
          * where it was not set, or if it was set with the default value */
         bool exists(hal_index_t pos) const;
 
+        /** Call fn(first, last, value) for each range of consecutive positions
+         * of a tile that were set to the same value, in order */
+        template <class F> void forEachRange(hal_size_t tile, F fn) const;
+
         /** Methods to get basic structure info */
         hal_size_t getGenomeSize() const;
         hal_size_t getTileSize() const;
@@ -52,8 +76,28 @@ namespace hal {
         T getDefaultValue() const;
 
       protected:
-        std::vector<std::vector<T>> _tiles;
-        std::vector<std::vector<bool>> _bits;
+        struct Run {
+            uint32_t _offset;
+            uint32_t _length;
+            T _value;
+        };
+        /* runs are sorted and don't overlap.  _values and _bits are only
+         * used once the tile is converted to an array */
+        struct Tile {
+            std::vector<Run> _runs;
+            std::vector<T> _values;
+            std::vector<bool> _bits;
+        };
+
+        hal_size_t getTileLength(hal_size_t tile) const;
+        void update(hal_index_t first, hal_index_t last, T val, bool useMax);
+        void updateTile(hal_size_t tile, hal_size_t first, hal_size_t last, T val, bool useMax);
+        void addRun(hal_size_t offset, hal_size_t length, T val);
+        void toArray(hal_size_t tile);
+
+        std::vector<Tile> _tiles;
+        // runs replacing those touched by an update
+        std::vector<Run> _scratch;
         hal_size_t _tileSize;
         hal_size_t _genomeSize;
         hal_size_t _lastTileSize;
@@ -71,6 +115,7 @@ namespace hal {
         _genomeSize = genomeSize;
         _defaultValue = defaultValue;
         _tileSize = std::min(tileSize, genomeSize);
+        assert(_tileSize <= std::numeric_limits<uint32_t>::max());
         _lastTileSize = genomeSize % _tileSize;
         hal_size_t numTiles = genomeSize / _tileSize;
         if (_lastTileSize > 0) {
@@ -78,17 +123,12 @@ namespace hal {
         } else {
             _lastTileSize = _tileSize;
         }
-        for (size_t i = 0; i < _tiles.size(); ++i) {
-            _tiles[i].clear();
-            _bits[i].clear();
-        }
+        _tiles.clear();
         _tiles.resize(numTiles);
-        _bits.resize(numTiles);
     }
 
     template <class T> inline void WiggleTiles<T>::clear() {
         _tiles.clear();
-        _bits.clear();
         _tileSize = 0;
         _genomeSize = 0;
         _lastTileSize = 0;
@@ -98,39 +138,77 @@ namespace hal {
         assert(pos < _genomeSize);
         hal_size_t tile = pos / _tileSize;
         assert(tile < _tiles.size());
-        assert(_tiles[tile].size() == 0 || _tiles[tile].size() == _tileSize || _tiles[tile].size() == _lastTileSize);
-        if (_tiles[tile].size() == 0) {
-            return _defaultValue;
-        }
+        const Tile &t = _tiles[tile];
         hal_size_t offset = pos % _tileSize;
-        return _tiles[tile][offset];
+        if (!t._values.empty()) {
+            return t._values[offset];
+        }
+        // last run starting at or before offset
+        typename std::vector<Run>::const_iterator i = std::upper_bound(
+            t._runs.begin(), t._runs.end(), offset, [](hal_size_t o, const Run &run) { return o < run._offset; });
+        if (i != t._runs.begin() && offset < (i - 1)->_offset + (i - 1)->_length) {
+            return (i - 1)->_value;
+        }
+        return _defaultValue;
     }
 
     template <class T> inline void WiggleTiles<T>::set(hal_index_t pos, T val) {
-        assert(pos < _genomeSize);
-        hal_size_t tile = pos / _tileSize;
-        assert(tile < _tiles.size());
-        assert(_tiles[tile].size() == 0 || _tiles[tile].size() == _tileSize || _tiles[tile].size() == _lastTileSize);
-        if (_tiles[tile].size() == 0) {
-            hal_size_t len = tile == _tiles.size() - 1 ? _lastTileSize : _tileSize;
-            _tiles[tile].assign(len, _defaultValue);
-            _bits[tile].assign(len, false);
+        update(pos, pos, val, false);
+    }
+
+    template <class T> inline void WiggleTiles<T>::set(hal_index_t first, hal_index_t last, T val) {
+        update(first, last, val, false);
+    }
+
+    template <class T> inline void WiggleTiles<T>::setMax(hal_index_t first, hal_index_t last, T val) {
+        update(first, last, val, true);
+    }
+
+    template <class T> inline void WiggleTiles<T>::mergeMax(const WiggleTiles<T> &other) {
+        assert(other._genomeSize == _genomeSize && other._tileSize == _tileSize);
+        for (hal_size_t i = 0; i < other._tiles.size(); ++i) {
+            other.forEachRange(i, [this](hal_index_t first, hal_index_t last, T val) { setMax(first, last, val); });
         }
-        hal_size_t offset = pos % _tileSize;
-        _tiles[tile][offset] = val;
-        _bits[tile][offset] = true;
     }
 
     template <class T> inline bool WiggleTiles<T>::exists(hal_index_t pos) const {
         assert(pos < _genomeSize);
         hal_size_t tile = pos / _tileSize;
         assert(tile < _tiles.size());
-        assert(_tiles[tile].size() == 0 || _tiles[tile].size() == _tileSize || _tiles[tile].size() == _lastTileSize);
-        if (_tiles[tile].size() == 0) {
-            return false;
-        }
+        const Tile &t = _tiles[tile];
         hal_size_t offset = pos % _tileSize;
-        return _bits[tile][offset];
+        if (!t._values.empty()) {
+            return t._bits[offset];
+        }
+        typename std::vector<Run>::const_iterator i = std::upper_bound(
+            t._runs.begin(), t._runs.end(), offset, [](hal_size_t o, const Run &run) { return o < run._offset; });
+        return i != t._runs.begin() && offset < (i - 1)->_offset + (i - 1)->_length;
+    }
+
+    template <class T> template <class F> inline void WiggleTiles<T>::forEachRange(hal_size_t tile, F fn) const {
+        assert(tile < _tiles.size());
+        const Tile &t = _tiles[tile];
+        hal_index_t base = tile * _tileSize;
+        if (t._values.empty()) {
+            for (size_t i = 0; i < t._runs.size(); ++i) {
+                const Run &run = t._runs[i];
+                fn(base + run._offset, base + run._offset + run._length - 1, run._value);
+            }
+            return;
+        }
+        hal_size_t length = t._values.size();
+        for (hal_size_t i = 0; i < length;) {
+            if (!t._bits[i]) {
+                ++i;
+                continue;
+            }
+            hal_size_t j = i + 1;
+            while (j < length && t._bits[j] && t._values[j] == t._values[i]) {
+                ++j;
+            }
+            fn(base + i, base + j - 1, t._values[i]);
+            i = j;
+        }
     }
 
     template <class T> inline hal_size_t WiggleTiles<T>::getGenomeSize() const {
@@ -147,12 +225,108 @@ namespace hal {
 
     template <class T> inline bool WiggleTiles<T>::isTileEmpty(hal_size_t tile) const {
         assert(tile < _tiles.size());
-        return _tiles[tile].empty();
+        return _tiles[tile]._runs.empty() && _tiles[tile]._values.empty();
     }
 
     template <class T> inline T WiggleTiles<T>::getDefaultValue() const {
         return _defaultValue;
     }
+
+    template <class T> inline hal_size_t WiggleTiles<T>::getTileLength(hal_size_t tile) const {
+        return tile == _tiles.size() - 1 ? _lastTileSize : _tileSize;
+    }
+
+    template <class T> inline void WiggleTiles<T>::update(hal_index_t first, hal_index_t last, T val, bool useMax) {
+        assert(first <= last && last < (hal_index_t)_genomeSize);
+        for (hal_size_t tile = first / _tileSize; tile <= last / _tileSize; ++tile) {
+            hal_index_t base = tile * _tileSize;
+            hal_size_t tileFirst = std::max(first, base) - base;
+            hal_size_t tileLast = std::min(last, base + (hal_index_t)getTileLength(tile) - 1) - base;
+            updateTile(tile, tileFirst, tileLast, val, useMax);
+        }
+    }
+
+    /* rebuild the runs touching [first, last], including any ending just
+     * before it or starting just after it so that equal values are joined */
+    template <class T>
+    inline void WiggleTiles<T>::updateTile(hal_size_t tile, hal_size_t first, hal_size_t last, T val, bool useMax) {
+        Tile &t = _tiles[tile];
+        if (!t._values.empty()) {
+            for (hal_size_t i = first; i <= last; ++i) {
+                t._values[i] = useMax ? std::max(val, t._values[i]) : val;
+                t._bits[i] = true;
+            }
+            return;
+        }
+        typename std::vector<Run>::iterator lo = std::lower_bound(
+            t._runs.begin(), t._runs.end(), first,
+            [](const Run &run, hal_size_t o) { return run._offset + run._length < o; });
+        typename std::vector<Run>::iterator hi = lo;
+        while (hi != t._runs.end() && hi->_offset <= last + 1) {
+            ++hi;
+        }
+        T unsetVal = useMax ? std::max(val, _defaultValue) : val;
+        _scratch.clear();
+        hal_size_t pos = first;
+        for (typename std::vector<Run>::iterator i = lo; i != hi; ++i) {
+            hal_size_t runEnd = i->_offset + i->_length;
+            if (i->_offset < first) {
+                addRun(i->_offset, std::min(runEnd, first) - i->_offset, i->_value);
+            }
+            if (i->_offset > pos && pos <= last) {
+                addRun(pos, std::min<hal_size_t>(i->_offset, last + 1) - pos, unsetVal);
+                pos = std::min<hal_size_t>(i->_offset, last + 1);
+            }
+            hal_size_t overlapStart = std::max<hal_size_t>(i->_offset, first);
+            hal_size_t overlapEnd = std::min(runEnd, last + 1);
+            if (overlapStart < overlapEnd) {
+                addRun(overlapStart, overlapEnd - overlapStart, useMax ? std::max(val, i->_value) : val);
+                pos = overlapEnd;
+            }
+            if (runEnd > last + 1) {
+                hal_size_t afterStart = std::max<hal_size_t>(i->_offset, last + 1);
+                addRun(afterStart, runEnd - afterStart, i->_value);
+            }
+        }
+        if (pos <= last) {
+            addRun(pos, last + 1 - pos, unsetVal);
+        }
+
+        size_t numReplaced = hi - lo;
+        if (_scratch.size() <= numReplaced) {
+            std::copy(_scratch.begin(), _scratch.end(), lo);
+            t._runs.erase(lo + _scratch.size(), hi);
+        } else {
+            size_t index = lo - t._runs.begin();
+            std::copy(_scratch.begin(), _scratch.begin() + numReplaced, lo);
+            t._runs.insert(t._runs.begin() + index + numReplaced, _scratch.begin() + numReplaced, _scratch.end());
+        }
+        if (t._runs.size() * sizeof(Run) > getTileLength(tile) * sizeof(T)) {
+            toArray(tile);
+        }
+    }
+
+    template <class T> inline void WiggleTiles<T>::addRun(hal_size_t offset, hal_size_t length, T val) {
+        if (!_scratch.empty() && _scratch.back()._offset + _scratch.back()._length == offset && _scratch.back()._value == val) {
+            _scratch.back()._length += length;
+        } else {
+            Run run = {(uint32_t)offset, (uint32_t)length, val};
+            _scratch.push_back(run);
+        }
+    }
+
+    template <class T> inline void WiggleTiles<T>::toArray(hal_size_t tile) {
+        Tile &t = _tiles[tile];
+        hal_size_t length = getTileLength(tile);
+        t._values.assign(length, _defaultValue);
+        t._bits.assign(length, false);
+        for (size_t i = 0; i < t._runs.size(); ++i) {
+            const Run &run = t._runs[i];
+            std::fill(t._values.begin() + run._offset, t._values.begin() + run._offset + run._length, run._value);
+            std::fill(t._bits.begin() + run._offset, t._bits.begin() + run._offset + run._length, true);
+        }
+        std::vector<Run>().swap(t._runs);
+    }
 }
 #endif
 // Local Variables:
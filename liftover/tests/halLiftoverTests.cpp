@@ -7,7 +7,10 @@
 #include "halApiTestSupport.h"
 #include "halLiftoverTests.h"
 #include "halBlockLiftover.h"
+#include "halWiggleTiles.h"
 #include <cstdio>
+#include <cstdlib>
+#include <limits>
 
 using namespace std;
 using namespace hal;
@@ -461,10 +464,72 @@ void halWiggleLiftoverTest(CuTest *testCase) {
     }
 }
 
+/* compare random updates of tiles, including merged ones, with arrays of
+ * values.  Small tiles are used so they have both representations */
+void halWiggleTilesTest(CuTest *testCase) {
+    srand(40);
+    for (size_t iter = 0; iter < 200; ++iter) {
+        hal_size_t genomeSize = 1 + rand() % 300;
+        hal_size_t tileSize = 1 + rand() % 50;
+        WiggleTiles<double> tiles;
+        WiggleTiles<double> other;
+        tiles.init(genomeSize, 0.0, tileSize);
+        other.init(genomeSize, numeric_limits<double>::lowest(), tileSize);
+        vector<double> values(genomeSize, 0.0);
+        vector<bool> exists(genomeSize, false);
+        for (size_t i = 0; i < 50; ++i) {
+            hal_index_t first = rand() % genomeSize;
+            hal_index_t last = min(first + rand() % 30, (hal_index_t)genomeSize - 1);
+            double val = rand() % 5 - 2;
+            bool useMax = rand() % 2 == 0;
+            if (useMax) {
+                tiles.setMax(first, last, val);
+            } else {
+                tiles.set(first, last, val);
+            }
+            for (hal_index_t pos = first; pos <= last; ++pos) {
+                values[pos] = useMax ? max(val, values[pos]) : val;
+                exists[pos] = true;
+            }
+        }
+        for (hal_index_t pos = 0; pos < (hal_index_t)genomeSize; ++pos) {
+            CuAssertTrue(testCase, tiles.get(pos) == values[pos]);
+            CuAssertTrue(testCase, tiles.exists(pos) == exists[pos]);
+        }
+
+        for (size_t i = 0; i < 20; ++i) {
+            hal_index_t first = rand() % genomeSize;
+            hal_index_t last = min(first + rand() % 30, (hal_index_t)genomeSize - 1);
+            double val = rand() % 5 - 2;
+            other.setMax(first, last, val);
+        }
+        for (hal_index_t pos = 0; pos < (hal_index_t)genomeSize; ++pos) {
+            if (other.exists(pos)) {
+                values[pos] = max(values[pos], other.get(pos));
+                exists[pos] = true;
+            }
+        }
+        tiles.mergeMax(other);
+        hal_index_t prevLast = NULL_INDEX;
+        for (hal_size_t tile = 0; tile < tiles.getNumTiles(); ++tile) {
+            tiles.forEachRange(tile, [&](hal_index_t first, hal_index_t last, double val) {
+                CuAssertTrue(testCase, first > prevLast && first <= last);
+                for (hal_index_t pos = first; pos <= last; ++pos) {
+                    CuAssertTrue(testCase, exists[pos] && values[pos] == val);
+                    exists[pos] = false;
+                }
+                prevLast = last;
+            });
+        }
+        CuAssertTrue(testCase, find(exists.begin(), exists.end(), true) == exists.end());
+    }
+}
+
 CuSuite *halLiftoverTestSuite(void) {
     CuSuite *suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, halBedLiftoverTest);
     SUITE_ADD_TEST(suite, halWiggleLiftoverTest);
+    SUITE_ADD_TEST(suite, halWiggleTilesTest);
     return suite;
 }
 
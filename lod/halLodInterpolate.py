@@ -32,8 +32,14 @@ MaxLodToken = "max"
 
 # Wrapper for halLodExtract
 def getHalLodExtractCmd(inHalPath, outHalPath, scale, keepSeq, inMemory,
-                     probeFrac, minSeqFrac, chunk, minCovFrac):
+                     probeFrac, minSeqFrac, chunk, minCovFrac, levels=[],
+                     numThreads=1):
     cmd = "halLodExtract %s %s %s" % (inHalPath, outHalPath, scale)
+    if len(levels) > 0:
+        cmd += " --levels %s" % ",".join("%s:%s" % (levelScale, levelPath)
+                                         for levelScale, levelPath in levels)
+    if numThreads > 1:
+        cmd += " --numThreads %d" % numThreads
     if keepSeq is True:
         cmd += " --keepSequences"
     if inMemory is True:
@@ -139,7 +145,7 @@ def createLods(halPath, outLodPath, outDir, maxBlock, scale, overwrite,
     steps, lastIsMax = getSteps(halPath, maxBlock, scale, minLod0, cutOff,
                                 minSeqFrac, minCovFrac)
     curStepFactor = scaleCorFac
-    lodExtractCmds = []
+    lodExtractLevels = []
     prevStep = None
     for stepIdx in range(1,len(steps)):
         step = int(max(1, steps[stepIdx] * curStepFactor))
@@ -157,10 +163,8 @@ def createLods(halPath, outLodPath, outDir, maxBlock, scale, overwrite,
         isMaxLod = stepIdx == len(steps) - 1 and lastIsMax is True
         if not isMaxLod and (overwrite is True or
                              not os.path.isfile(outHalPath)):
-            lodExtractCmds.append(
-                getHalLodExtractCmd(srcPath, outHalPath, stepScale,
-                                    keepSequences, inMemory, probeFrac,
-                                    minSeqFrac, chunk, minCovFrac))
+            lodExtractLevels.append((srcPath, outHalPath, stepScale,
+                                     keepSequences))
         lodPath =  formatOutHalPath(outLodPath, outHalPath, absPath)
         if isMaxLod:
             lodPath = MaxLodToken
@@ -172,6 +176,27 @@ def createLods(halPath, outLodPath, outDir, maxBlock, scale, overwrite,
         prevStep = step
         curStepFactor *= scaleCorFac
     lodFile.close()
+
+    # unless each level is made from the last, consecutive levels that keep
+    # (or drop) sequences are built by one halLodExtract run, which samples
+    # each from the one before
+    groups = []
+    for level in lodExtractLevels:
+        if (trans is False and len(groups) > 0 and
+            groups[-1][-1][3] == level[3]):
+            groups[-1].append(level)
+        else:
+            groups.append([level])
+    numThreads = max(1, numProc // max(1, len(groups)))
+    lodExtractCmds = []
+    for group in groups:
+        srcPath, outHalPath, stepScale, keepSequences = group[0]
+        levels = [(level[2], level[1]) for level in group[1:]]
+        lodExtractCmds.append(
+            getHalLodExtractCmd(srcPath, outHalPath, stepScale,
+                                keepSequences, inMemory, probeFrac,
+                                minSeqFrac, chunk, minCovFrac, levels,
+                                numThreads))
     runParallelShellCommands(lodExtractCmds, numProc)
     
 def main(argv=None):
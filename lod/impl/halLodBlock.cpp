@@ -12,34 +12,31 @@
 using namespace std;
 using namespace hal;
 
-LodBlock::LodBlock() {
+LodBlock::LodBlock(LodSegmentArena *segments)
+    : _segments(segments), _firstSegment((hal_index_t)segments->size()), _numSegments(0) {
 }
 
-LodBlock::~LodBlock() {
-    clear();
-}
-
-void LodBlock::addSegment(LodSegment *segment) {
-    assert(segment != NULL);
-    assert(_segments.empty() || getLength() == segment->getLength());
-    _segments.push_back(segment);
+void LodBlock::addSegment(hal_index_t segment) {
+    assert(segment != NULL_INDEX);
+    assert(segment == _firstSegment + (hal_index_t)_numSegments);
+    assert(segment + 1 == (hal_index_t)_segments->size());
+    assert(_numSegments == 0 || getLength() == (*_segments)[segment].getLength());
+    ++_numSegments;
 }
 
 void LodBlock::clear() {
-    for (SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        delete *i;
-    }
-    _segments.clear();
+    _numSegments = 0;
 }
 
 hal_size_t LodBlock::getTotalAdjLength() const {
     hal_size_t total = 0;
-    for (LodBlock::SegmentConstIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        if ((*i)->getTailAdj() != NULL) {
-            total += (*i)->getTailAdjLen();
+    for (hal_size_t i = 0; i < _numSegments; ++i) {
+        hal_index_t segment = getSegmentIndex(i);
+        if ((*_segments)[segment].getTailAdj() != NULL_INDEX) {
+            total += _segments->getTailAdjLen(segment);
         }
-        if ((*i)->getHeadAdj() != NULL) {
-            total += (*i)->getHeadAdjLen();
+        if ((*_segments)[segment].getHeadAdj() != NULL_INDEX) {
+            total += _segments->getHeadAdjLen(segment);
         }
     }
     return total;
@@ -49,65 +46,69 @@ void LodBlock::extend(double maxFrac) {
     hal_size_t tailExtLen = getMaxTailExtensionLen();
     tailExtLen = (hal_size_t)std::ceil(maxFrac * (double)tailExtLen);
 
-    for (LodBlock::SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        (*i)->extendTail(tailExtLen);
-        assert((*i)->getLength() == getLength());
+    for (hal_size_t i = 0; i < _numSegments; ++i) {
+        _segments->extendTail(getSegmentIndex(i), tailExtLen);
+        assert((*_segments)[getSegmentIndex(i)].getLength() == getLength());
     }
 
     hal_size_t headExtLen = getMaxHeadExtensionLen();
     headExtLen = (hal_size_t)std::ceil(maxFrac * (double)headExtLen);
 
-    for (LodBlock::SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        (*i)->extendHead(headExtLen);
-        assert((*i)->getLength() == getLength());
+    for (hal_size_t i = 0; i < _numSegments; ++i) {
+        _segments->extendHead(getSegmentIndex(i), headExtLen);
+        assert((*_segments)[getSegmentIndex(i)].getLength() == getLength());
     }
 }
 
-LodBlock *LodBlock::getHeadMergePartner() {
-    LodBlock *adjBlock = NULL;
+hal_index_t LodBlock::getHeadMergePartner(const BlockArena &blocks) const {
+    hal_index_t adjBlock = NULL_INDEX;
     bool uniqueValidAdj = true;
-    for (LodBlock::SegmentIterator i = _segments.begin(); i != _segments.end() && uniqueValidAdj == true; ++i) {
-        const LodSegment *headAdj = (*i)->getHeadAdj();
+    for (hal_size_t i = 0; i < _numSegments && uniqueValidAdj == true; ++i) {
+        hal_index_t segment = getSegmentIndex(i);
+        hal_index_t headAdj = (*_segments)[segment].getHeadAdj();
 
         // Dont' want to merge from or a telomere
         // or to a telomere
         // or if there is a non-zero adjacency
         // or if there is a head to head adjacency
-        if (headAdj == NULL || headAdj->getHeadAdj() == NULL || (*i)->getHeadAdjLen() != 0 || (*i)->getHeadToTail() == false) {
+        if (headAdj == NULL_INDEX || (*_segments)[headAdj].getHeadAdj() == NULL_INDEX ||
+            _segments->getHeadAdjLen(segment) != 0 || _segments->getHeadToTail(segment) == false) {
             uniqueValidAdj = false;
-        } else if (adjBlock == NULL && headAdj->getBlock() != this &&
-                   headAdj->getBlock()->getNumSegments() == getNumSegments()) {
-            adjBlock = headAdj->getBlock();
         } else {
-            uniqueValidAdj = adjBlock == headAdj->getBlock();
+            // telomeres were ruled out above, so headAdj has a block
+            hal_index_t headAdjBlock = (*_segments)[headAdj].getBlock();
+            assert(headAdjBlock != NULL_INDEX);
+            if (adjBlock == NULL_INDEX && headAdjBlock != (*_segments)[segment].getBlock() &&
+                blocks[headAdjBlock].getNumSegments() == getNumSegments()) {
+                adjBlock = headAdjBlock;
+            } else {
+                uniqueValidAdj = adjBlock == headAdjBlock;
+            }
         }
     }
-    return uniqueValidAdj ? adjBlock : NULL;
+    return uniqueValidAdj ? adjBlock : NULL_INDEX;
 }
 
-void LodBlock::mergeHead(LodBlock *adjBlock) {
-    assert(adjBlock == getHeadMergePartner());
-    if (adjBlock != NULL) {
-        for (LodBlock::SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
-            (*i)->mergeHead();
-        }
-        adjBlock->clear();
+void LodBlock::mergeHead(LodBlock &adjBlock) {
+    for (hal_size_t i = 0; i < _numSegments; ++i) {
+        _segments->mergeHead(getSegmentIndex(i));
     }
+    adjBlock.clear();
 }
 
-void LodBlock::insertNeighbours(vector<LodBlock *> &outList) {
-    LodBlock *lodBlock = NULL;
+void LodBlock::insertNeighbours(BlockArena &blocks, vector<hal_index_t> &outList) {
+    hal_index_t lodBlock = NULL_INDEX;
     while (true) {
-        lodBlock = insertNewTailNeighbour();
-        if (lodBlock != NULL) {
+        lodBlock = insertNewTailNeighbour(blocks);
+        if (lodBlock != NULL_INDEX) {
             outList.push_back(lodBlock);
         } else {
             break;
         }
     }
     while (true) {
-        lodBlock = insertNewHeadNeighbour();
-        if (lodBlock != NULL) {
+        lodBlock = insertNewHeadNeighbour(blocks);
+        if (lodBlock != NULL_INDEX) {
             outList.push_back(lodBlock);
         } else {
             break;
@@ -117,49 +118,54 @@ void LodBlock::insertNeighbours(vector<LodBlock *> &outList) {
     assert(getMaxTailInsertionLen() == 0);
 }
 
-LodBlock *LodBlock::insertNewTailNeighbour() {
-    LodBlock *newBlock = NULL;
+hal_index_t LodBlock::insertNewTailNeighbour(BlockArena &blocks) {
+    hal_index_t newBlockIdx = NULL_INDEX;
     hal_size_t maxTailInsLen = getMaxTailInsertionLen();
     if (maxTailInsLen > 0) {
-        newBlock = new LodBlock();
-        for (LodBlock::SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
-            if ((*i)->getTailAdjLen() >= maxTailInsLen) {
-                LodSegment *newSeg = (*i)->insertNewTailAdj(newBlock, maxTailInsLen);
-                newBlock->_segments.push_back(newSeg);
+        // the deque doesn't move this block when another is added
+        newBlockIdx = (hal_index_t)blocks.size();
+        blocks.push_back(LodBlock(_segments));
+        LodBlock &newBlock = blocks.back();
+        for (hal_size_t i = 0; i < _numSegments; ++i) {
+            if (_segments->getTailAdjLen(getSegmentIndex(i)) >= maxTailInsLen) {
+                newBlock.addSegment(_segments->insertNewTailAdj(getSegmentIndex(i), newBlockIdx, maxTailInsLen));
             }
         }
     }
-    return newBlock;
+    return newBlockIdx;
 }
 
-LodBlock *LodBlock::insertNewHeadNeighbour() {
-    LodBlock *newBlock = NULL;
+hal_index_t LodBlock::insertNewHeadNeighbour(BlockArena &blocks) {
+    hal_index_t newBlockIdx = NULL_INDEX;
     hal_size_t maxHeadInsLen = getMaxHeadInsertionLen();
     if (maxHeadInsLen > 0) {
-        newBlock = new LodBlock();
-        for (LodBlock::SegmentIterator i = _segments.begin(); i != _segments.end(); ++i) {
-            if ((*i)->getHeadAdjLen() >= maxHeadInsLen) {
-                LodSegment *newSeg = (*i)->insertNewHeadAdj(newBlock, maxHeadInsLen);
-                newBlock->_segments.push_back(newSeg);
+        newBlockIdx = (hal_index_t)blocks.size();
+        blocks.push_back(LodBlock(_segments));
+        LodBlock &newBlock = blocks.back();
+        for (hal_size_t i = 0; i < _numSegments; ++i) {
+            if (_segments->getHeadAdjLen(getSegmentIndex(i)) >= maxHeadInsLen) {
+                newBlock.addSegment(_segments->insertNewHeadAdj(getSegmentIndex(i), newBlockIdx, maxHeadInsLen));
             }
         }
     }
-    return newBlock;
+    return newBlockIdx;
 }
 
+/* the block's segments are a range of the arena, so an adjacency to one
+ * earlier in the block is found by its index rather than in a set */
 hal_size_t LodBlock::getMaxTailExtensionLen() const {
     hal_size_t minTail = numeric_limits<hal_size_t>::max();
 
-    set<const LodSegment *> lookup;
     hal_size_t adjLen;
-    for (LodBlock::SegmentConstIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        adjLen = (*i)->getTailAdjLen();
-        if ((*i)->getTailToTail() && lookup.find((*i)->getTailAdj()) != lookup.end()) {
+    for (hal_size_t i = 0; i < _numSegments; ++i) {
+        hal_index_t segment = getSegmentIndex(i);
+        adjLen = _segments->getTailAdjLen(segment);
+        hal_index_t tailAdj = (*_segments)[segment].getTailAdj();
+        if (_segments->getTailToTail(segment) && tailAdj >= _firstSegment && tailAdj < segment) {
             // we have a tail to tail edge in the block.  can only extend half
             adjLen /= 2;
         }
         minTail = min(adjLen, minTail);
-        lookup.insert(*i);
     }
     return minTail;
 }
@@ -167,16 +173,16 @@ hal_size_t LodBlock::getMaxTailExtensionLen() const {
 hal_size_t LodBlock::getMaxHeadExtensionLen() const {
     hal_size_t minHead = numeric_limits<hal_size_t>::max();
 
-    set<const LodSegment *> lookup;
     hal_size_t adjLen;
-    for (LodBlock::SegmentConstIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        adjLen = (*i)->getHeadAdjLen();
-        if ((*i)->getHeadToHead() && lookup.find((*i)->getHeadAdj()) != lookup.end()) {
+    for (hal_size_t i = 0; i < _numSegments; ++i) {
+        hal_index_t segment = getSegmentIndex(i);
+        adjLen = _segments->getHeadAdjLen(segment);
+        hal_index_t headAdj = (*_segments)[segment].getHeadAdj();
+        if (_segments->getHeadToHead(segment) && headAdj >= _firstSegment && headAdj < segment) {
             // we have a head to head edge in the block.  can only extend half
             adjLen /= 2;
         }
         minHead = min(adjLen, minHead);
-        lookup.insert(*i);
     }
     return minHead;
 }
@@ -184,8 +190,8 @@ hal_size_t LodBlock::getMaxHeadExtensionLen() const {
 hal_size_t LodBlock::getMaxTailInsertionLen() const {
     hal_size_t minNZTail = numeric_limits<hal_size_t>::max();
     hal_size_t adjLen;
-    for (LodBlock::SegmentConstIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        adjLen = (*i)->getTailAdjLen();
+    for (hal_size_t i = 0; i < _numSegments; ++i) {
+        adjLen = _segments->getTailAdjLen(getSegmentIndex(i));
         if (adjLen > 0) {
             minNZTail = min(adjLen, minNZTail);
         }
@@ -196,8 +202,8 @@ hal_size_t LodBlock::getMaxTailInsertionLen() const {
 hal_size_t LodBlock::getMaxHeadInsertionLen() const {
     hal_size_t minNZHead = numeric_limits<hal_size_t>::max();
     hal_size_t adjLen;
-    for (LodBlock::SegmentConstIterator i = _segments.begin(); i != _segments.end(); ++i) {
-        adjLen = (*i)->getHeadAdjLen();
+    for (hal_size_t i = 0; i < _numSegments; ++i) {
+        adjLen = _segments->getHeadAdjLen(getSegmentIndex(i));
         if (adjLen > 0) {
             minNZHead = min(adjLen, minNZHead);
         }
@@ -207,8 +213,9 @@ hal_size_t LodBlock::getMaxHeadInsertionLen() const {
 
 ostream &hal::operator<<(ostream &os, const LodBlock &block) {
     os << "block " << &block << " n=" << block.getNumSegments() << " l=" << block.getLength() << ":";
-    for (LodBlock::SegmentConstIterator i = block._segments.begin(); i != block._segments.end(); ++i) {
-        os << "\n  " << **i;
+    for (hal_size_t i = 0; i < block.getNumSegments(); ++i) {
+        os << "\n  ";
+        block._segments->print(os, block.getSegmentIndex(i));
     }
     return os;
 }
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halLodManager.h"
+#include <iostream>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addArgument("lodFile", "Text file listing the levels of detail, as written "
+                                         "by halLodInterpolate.py");
+    optionsParser.addArgument("halPath", "mmap hal file holding the alignment of level 0, to "
+                                         "which the other levels are added");
+    optionsParser.setDescription("Embed levels of detail in an mmap HAL file holding the "
+                                 "original alignment, so that they can all be loaded from "
+                                 "that one file.  Genomes whose sequences match those of "
+                                 "the original alignment share its sequence names and DNA. "
+                                 "The file can be converted from the level 0 file with "
+                                 "halExtract --outputFormat mmap.");
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser(WRITE_ACCESS);
+    initParser(optionsParser);
+    string lodPath;
+    string halPath;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        lodPath = optionsParser.getArgument<string>("lodFile");
+        halPath = optionsParser.getArgument<string>("halPath");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        return 1;
+    }
+    try {
+        LodManager lodManager;
+        lodManager.loadLODFile(lodPath, &optionsParser);
+        AlignmentPtr alignment(openHalAlignment(halPath, &optionsParser, READ_ACCESS | WRITE_ACCESS));
+        lodManager.embedLevels(alignment);
+        alignment->close();
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -10,6 +10,8 @@
 #include <cassert>
 #include <deque>
 #include <limits>
+#include <memory>
+#include <sstream>
 extern "C" {
 #include "sonLibTree.h"
 }
@@ -17,39 +19,87 @@ extern "C" {
 using namespace std;
 using namespace hal;
 
-LodExtract::LodExtract() {
+LodExtract::LodExtract() : _graph(NULL), _printPassStats(false) {
 }
 
 LodExtract::~LodExtract() {
 }
 
+void LodExtract::setPrintPassStats(bool printPassStats) {
+    _printPassStats = printPassStats;
+}
+
 void LodExtract::createInterpolatedAlignment(AlignmentConstPtr inAlignment, AlignmentPtr outAlignment, double scale,
                                              const string &tree, const string &rootName, bool keepSequences, bool allSequences,
                                              double probeFrac, double minSeqFrac) {
-    _inAlignment = inAlignment;
-    _outAlignment = outAlignment;
+    createInterpolatedAlignments(vector<AlignmentConstPtr>(1, inAlignment), vector<AlignmentPtr>(1, outAlignment),
+                                 vector<double>(1, scale), tree, rootName, keepSequences, allSequences, probeFrac, minSeqFrac);
+}
+
+void LodExtract::createInterpolatedAlignments(const vector<AlignmentConstPtr> &inAlignments,
+                                              const vector<AlignmentPtr> &outAlignments, const vector<double> &scales,
+                                              const string &tree, const string &rootName, bool keepSequences,
+                                              bool allSequences, double probeFrac, double minSeqFrac) {
+    assert(!inAlignments.empty() && !outAlignments.empty() && outAlignments.size() == scales.size());
+    for (size_t level = 1; level < scales.size(); ++level) {
+        if (scales[level] <= scales[level - 1]) {
+            throw hal_exception("Scales of levels of detail must increase");
+        }
+    }
+    _inAlignment = inAlignments[0];
     _keepSequences = keepSequences;
     _allSequences = allSequences;
     _probeFrac = probeFrac;
     _minSeqFrac = minSeqFrac;
 
-    string newTree = tree.empty() ? inAlignment->getNewickTree() : tree;
-    createTree(newTree, rootName);
+    string newTree = tree.empty() ? _inAlignment->getNewickTree() : tree;
+    for (size_t level = 0; level < outAlignments.size(); ++level) {
+        _outAlignment = outAlignments[level];
+        createTree(newTree, rootName);
+    }
     cout << "tree = " << _outAlignment->getNewickTree() << endl;
 
+    vector<string> internalNodes;
+    vector<vector<string>> childNames;
     deque<string> bfQueue;
     bfQueue.push_front(_outAlignment->getRootName());
     while (!bfQueue.empty()) {
         string genomeName = bfQueue.back();
         bfQueue.pop_back();
-        vector<string> childNames = _outAlignment->getChildNames(genomeName);
-        if (!childNames.empty()) {
-            convertInternalNode(genomeName, scale);
-            for (size_t childIdx = 0; childIdx < childNames.size(); childIdx++) {
-                bfQueue.push_back(childNames[childIdx]);
+        vector<string> nodeChildNames = _outAlignment->getChildNames(genomeName);
+        if (!nodeChildNames.empty()) {
+            internalNodes.push_back(genomeName);
+            childNames.push_back(nodeChildNames);
+            for (size_t childIdx = 0; childIdx < nodeChildNames.size(); childIdx++) {
+                bfQueue.push_back(nodeChildNames[childIdx]);
             }
         }
     }
+
+    _nextNode = 0;
+    _nextWrite = 0;
+    _failed = false;
+    runThreads(inAlignments.size(), [&](hal_size_t threadIdx) {
+        try {
+            for (;;) {
+                size_t nodeIdx;
+                {
+                    lock_guard<mutex> lock(_writeMutex);
+                    if (_failed || _nextNode == internalNodes.size()) {
+                        break;
+                    }
+                    nodeIdx = _nextNode++;
+                }
+                convertInternalNode(inAlignments[threadIdx], outAlignments, scales, internalNodes[nodeIdx],
+                                    childNames[nodeIdx], nodeIdx);
+            }
+        } catch (...) {
+            lock_guard<mutex> lock(_writeMutex);
+            _failed = true;
+            _writeCond.notify_all();
+            throw;
+        }
+    });
 }
 
 void LodExtract::createTree(const string &tree, const string &rootName) {
@@ -119,19 +169,63 @@ void LodExtract::createTree(const string &tree, const string &rootName) {
     stTree_destruct(root);
 }
 
-void LodExtract::convertInternalNode(const string &genomeName, double scale) {
-    const Genome *parent = _inAlignment->openGenome(genomeName);
+void LodExtract::convertInternalNode(AlignmentConstPtr inAlignment, const vector<AlignmentPtr> &outAlignments,
+                                     const vector<double> &scales, const string &genomeName, const vector<string> &childNames,
+                                     size_t nodeIdx) {
+    const Genome *parent = inAlignment->openGenome(genomeName);
     assert(parent != NULL);
-    vector<string> childNames = _outAlignment->getChildNames(genomeName);
     vector<const Genome *> children;
     for (hal_size_t i = 0; i < childNames.size(); ++i) {
-        children.push_back(_inAlignment->openGenome(childNames[i]));
+        children.push_back(inAlignment->openGenome(childNames[i]));
     }
     const Genome *grandParent = NULL; // TEMP HACK  parent->getParent();
     hal_size_t minAvgBlockSize = getMinAvgBlockSize(parent, children, grandParent);
-    hal_size_t step = (hal_size_t)(scale * minAvgBlockSize);
-    _graph.build(_inAlignment, parent, children, grandParent, step, _allSequences, _probeFrac, _minSeqFrac);
 
+    // build every level, each from the columns sampled for the one before,
+    // then wait for the nodes before this one to be written
+    vector<unique_ptr<LodGraph>> graphs;
+    LodGraph::SampledColumns sampledColumns[2];
+    ostringstream dimensions;
+    for (size_t level = 0; level < scales.size(); ++level) {
+        hal_size_t step = (hal_size_t)(scales[level] * minAvgBlockSize);
+        const LodGraph::SampledColumns *finerColumns = level > 0 ? &sampledColumns[(level - 1) % 2] : NULL;
+        LodGraph::SampledColumns *columns = level + 1 < scales.size() ? &sampledColumns[level % 2] : NULL;
+        graphs.push_back(unique_ptr<LodGraph>(new LodGraph()));
+        graphs.back()->setPrintPassStats(_printPassStats);
+        graphs.back()->build(inAlignment, parent, children, grandParent, step, _allSequences, _probeFrac, _minSeqFrac,
+                             dimensions, finerColumns, columns);
+    }
+    {
+        unique_lock<mutex> lock(_writeMutex);
+        _writeCond.wait(lock, [this, nodeIdx]() { return _failed || _nextWrite == nodeIdx; });
+        if (_failed) {
+            return;
+        }
+    }
+
+    cout << dimensions.str() << flush;
+    _inAlignment = inAlignment;
+    for (size_t level = 0; level < scales.size(); ++level) {
+        _outAlignment = outAlignments[level];
+        _graph = graphs[level].get();
+        writeInternalNode(parent, children, childNames);
+        graphs[level].reset();
+    }
+    _graph = NULL;
+
+    {
+        lock_guard<mutex> lock(_writeMutex);
+        ++_nextWrite;
+        _writeCond.notify_all();
+    }
+    inAlignment->closeGenome(parent);
+    for (hal_size_t i = 0; i < children.size(); ++i) {
+        inAlignment->closeGenome(children[i]);
+    }
+}
+
+void LodExtract::writeInternalNode(const Genome *parent, const vector<const Genome *> &children,
+                                   const vector<string> &childNames) {
     map<const Sequence *, hal_size_t> segmentCounts;
     countSegmentsInGraph(segmentCounts);
 
@@ -146,16 +240,9 @@ void LodExtract::convertInternalNode(const string &genomeName, double scale) {
     // if we're gonna print anything out, do it before this:
     // (not necesssary but by closing genomes we erase their hdf5 caches
     // which can make a difference on huge trees
-    _graph.erase();
     _outAlignment->closeGenome(_outAlignment->openGenome(parent->getName()));
-    _inAlignment->closeGenome(parent);
     for (hal_size_t i = 0; i < children.size(); ++i) {
         _outAlignment->closeGenome(_outAlignment->openGenome(children[i]->getName()));
-        _inAlignment->closeGenome(children[i]);
-    }
-    if (grandParent != NULL) {
-        _outAlignment->closeGenome(_outAlignment->openGenome(grandParent->getName()));
-        _inAlignment->closeGenome(grandParent);
     }
 }
 
@@ -164,8 +251,8 @@ void LodExtract::countSegmentsInGraph(map<const Sequence *, hal_size_t> &segment
     const LodSegment *segment;
     pair<map<const Sequence *, hal_size_t>::iterator, bool> res;
 
-    for (hal_size_t blockIdx = 0; blockIdx < _graph.getNumBlocks(); ++blockIdx) {
-        block = _graph.getBlock(blockIdx);
+    for (hal_size_t blockIdx = 0; blockIdx < _graph->getNumBlocks(); ++blockIdx) {
+        block = _graph->getBlock(blockIdx);
         for (hal_size_t segIdx = 0; segIdx < block->getNumSegments(); ++segIdx) {
             segment = block->getSegment(segIdx);
             res = segmentCounts.insert(pair<const Sequence *, hal_size_t>(segment->getSequence(), 0));
@@ -176,9 +263,9 @@ void LodExtract::countSegmentsInGraph(map<const Sequence *, hal_size_t> &segment
 
     // add unsampled non-zero sequences to dimensions, by looking for
     // sequences who have telomeres but no segments.
-    const LodBlock *telomeres = _graph.getTelomeres();
-    for (hal_size_t telIdx = 0; telIdx < telomeres->getNumSegments(); ++telIdx) {
-        segment = telomeres->getSegment(telIdx);
+    const LodGraph::SegmentList &telomeres = _graph->getTelomeres();
+    for (hal_size_t telIdx = 0; telIdx < telomeres.size(); ++telIdx) {
+        segment = _graph->getSegment(telomeres[telIdx]);
         if (segment->getSequence()->getSequenceLength() > 0) {
             res = segmentCounts.insert(pair<const Sequence *, hal_size_t>(segment->getSequence(), 0));
             hal_size_t &count = res.first->second;
@@ -299,27 +386,20 @@ void LodExtract::writeSegments(const Genome *inParent, const vector<const Genome
                 bottom = const_pointer_cast<BottomSegmentIterator>(outSequence->getBottomSegmentIterator());
                 outSegment = bottom;
             }
-            const LodGraph::SegmentSet *segSet = _graph.getSegmentSet(inSequence);
-            assert(segSet != NULL);
-            LodGraph::SegmentSet::const_iterator segIt = segSet->begin();
-            if (segSet->size() > 2) {
-                // skip left telomere
-                ++segIt;
-                // use to skip right telomere:
-                LodGraph::SegmentSet::const_iterator segLast = segSet->end();
-                --segLast;
-
-                // FOR EVERY SEGMENT IN SEQUENCE
-                for (; segIt != segLast; ++segIt) {
+            const LodGraph::SegmentList &segments = _graph->getSequenceSegments(inSequence);
+            if (segments.size() > 2) {
+                // FOR EVERY SEGMENT IN SEQUENCE, skipping the telomeres
+                for (size_t segIdx = 1; segIdx < segments.size() - 1; ++segIdx) {
+                    LodSegment *segment = _graph->getSegment(segments[segIdx]);
                     // write the HAL array index back to the segment to make
                     // future passes quicker.
-                    (*segIt)->setArrayIndex(outSegment->getArrayIndex());
-                    outSegment->setCoordinates((*segIt)->getLeftPos(), (*segIt)->getLength());
+                    segment->setArrayIndex(outSegment->getArrayIndex());
+                    outSegment->setCoordinates(segment->getLeftPos(), segment->getLength());
                     assert(outSegment->getSequence()->getName() == inSequence->getName());
                     outSegment->toRight();
                 }
             } else if (outSequence->getSequenceLength() > 0) {
-                assert(segSet->size() == 2);
+                assert(segments.size() == 2);
                 writeUnsampledSequence(outSequence, outSegment);
             }
         }
@@ -358,9 +438,9 @@ void LodExtract::writeHomologies(const Genome *inParent, const vector<const Geno
     TopSegmentIteratorPtr top = outChild->getTopSegmentIterator();
 
     // FOR EVERY BLOCK
-    for (hal_size_t blockIdx = 0; blockIdx < _graph.getNumBlocks(); ++blockIdx) {
+    for (hal_size_t blockIdx = 0; blockIdx < _graph->getNumBlocks(); ++blockIdx) {
         SegmentMap segMap;
-        const LodBlock *block = _graph.getBlock(blockIdx);
+        const LodBlock *block = _graph->getBlock(blockIdx);
 
         for (hal_size_t segIdx = 0; segIdx < block->getNumSegments(); ++segIdx) {
             const LodSegment *segment = block->getSegment(segIdx);
@@ -7,6 +7,7 @@
 
 #include "halLodExtract.h"
 #include <cassert>
+#include <sstream>
 
 using namespace std;
 using namespace hal;
@@ -39,6 +40,19 @@ static void initParser(CLParser &optionsParser) {
                                                 "By default, small sequences may be skipped if "
                                                 "they fall within the step size.",
                                 false);
+    optionsParser.addOption("levels", "Further, coarser levels of detail to build in the same run, "
+                                      "as a comma-separated list of scale:outHalPath with "
+                                      "increasing scales.  Each level is sampled from the "
+                                      "columns of the one before where possible.",
+                            "\"\"");
+    optionsParser.addOption("numThreads", "number of threads building the graphs of "
+                                          "internal nodes, each with its own instance of "
+                                          "the input",
+                            1);
+    optionsParser.addOptionFlag("passStats", "Print the time taken and memory used by "
+                                             "each pass of building the graph of an "
+                                             "internal node, along with its dimensions.",
+                                false);
     optionsParser.setDescription("Generate a new HAL file at a coarser "
                                  "Level of Detail (LOD) by interpolation. "
                                  "The scale parameter is used to estimate "
@@ -47,6 +61,22 @@ static void initParser(CLParser &optionsParser) {
                                  " input.");
 }
 
+/* parse --levels into the scales and paths of the levels after the first */
+static void parseLevels(const string &levels, vector<double> &scales, vector<string> &outHalPaths) {
+    vector<string> levelStrings = chopString(levels, ",");
+    for (size_t i = 0; i < levelStrings.size(); ++i) {
+        size_t colon = levelStrings[i].find(':');
+        double scale;
+        istringstream scaleStream(levelStrings[i].substr(0, colon));
+        scaleStream >> scale;
+        if (colon == string::npos || colon + 1 == levelStrings[i].length() || !scaleStream || !scaleStream.eof()) {
+            throw hal_exception("Error parsing --levels, expected scale:outHalPath: " + levelStrings[i]);
+        }
+        scales.push_back(scale);
+        outHalPaths.push_back(levelStrings[i].substr(colon + 1));
+    }
+}
+
 int main(int argc, char **argv) {
     CLParser optionsParser(CREATE_ACCESS);
     initParser(optionsParser);
@@ -59,6 +89,10 @@ int main(int argc, char **argv) {
     bool allSequences;
     double probeFrac;
     double minSeqFrac;
+    vector<double> scales;
+    vector<string> outHalPaths;
+    hal_size_t numThreads;
+    bool passStats;
     try {
         optionsParser.parseOptions(argc, argv);
         inHalPath = optionsParser.getArgument<string>("inHalPath");
@@ -73,6 +107,17 @@ int main(int argc, char **argv) {
         if (allSequences == true) {
             minSeqFrac = 0.;
         }
+        scales.push_back(scale);
+        outHalPaths.push_back(outHalPath);
+        string levels = optionsParser.getOption<string>("levels");
+        if (levels != "\"\"") {
+            parseLevels(levels, scales, outHalPaths);
+        }
+        passStats = optionsParser.getFlag("passStats");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (numThreads == 0) {
+            throw hal_exception("--numThreads must be at least 1");
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
@@ -84,10 +129,20 @@ int main(int argc, char **argv) {
             throw hal_exception("Input hal alignment is empty");
         }
 
-        AlignmentPtr outAlignment(openHalAlignment(outHalPath, &optionsParser, hal::CREATE_ACCESS));
+        vector<AlignmentConstPtr> inAlignments(1, inAlignment);
+        if (numThreads > 1) {
+            inAlignments = openHalAlignmentPerThread(inAlignment, inHalPath, &optionsParser, numThreads);
+            if (inAlignments.size() == 1) {
+                cerr << "Warning [halLodExtract]: HDF5 library is not thread-safe, ignoring --numThreads" << endl;
+            }
+        }
 
-        if (outAlignment->getNumGenomes() != 0) {
-            throw hal_exception("Output hal Alignmnent cannot be initialized");
+        vector<AlignmentPtr> outAlignments;
+        for (size_t i = 0; i < outHalPaths.size(); ++i) {
+            outAlignments.push_back(openHalAlignment(outHalPaths[i], &optionsParser, hal::CREATE_ACCESS));
+            if (outAlignments.back()->getNumGenomes() != 0) {
+                throw hal_exception("Output hal Alignmnent cannot be initialized");
+            }
         }
         if (rootName != "\"\"" && inAlignment->openGenome(rootName) == NULL) {
             throw hal_exception(string("Genome ") + rootName + " not found");
@@ -100,8 +155,9 @@ int main(int argc, char **argv) {
         }
 
         LodExtract lodExtract;
-        lodExtract.createInterpolatedAlignment(inAlignment, outAlignment, scale, outTree, rootName, keepSequences,
-                                               allSequences, probeFrac, minSeqFrac);
+        lodExtract.setPrintPassStats(passStats);
+        lodExtract.createInterpolatedAlignments(inAlignments, outAlignments, scales, outTree, rootName, keepSequences,
+                                                allSequences, probeFrac, minSeqFrac);
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
         return 1;
@@ -11,11 +11,69 @@
 #include <cmath>
 #include <cstdlib>
 #include <limits>
+#include <sys/resource.h>
 
 using namespace std;
 using namespace hal;
 
-LodGraph::LodGraph() : _extendFraction(1.0) {
+const size_t LodGraph::PositionSet::MinRecent;
+
+/* peak resident set size of the process, in bytes */
+static size_t getPeakRss() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024;
+#endif
+}
+
+void LodGraph::PositionSet::insert(hal_index_t pos) {
+    assert(!binary_search(_sorted.begin(), _sorted.end(), pos));
+    vector<hal_index_t>::iterator i = lower_bound(_recent.begin(), _recent.end(), pos);
+    assert(i == _recent.end() || *i != pos);
+    _recent.insert(i, pos);
+    if (_recent.size() > MinRecent && _recent.size() * _recent.size() > _sorted.size()) {
+        size_t numSorted = _sorted.size();
+        _sorted.insert(_sorted.end(), _recent.begin(), _recent.end());
+        inplace_merge(_sorted.begin(), _sorted.begin() + numSorted, _sorted.end());
+        _recent.clear();
+    }
+}
+
+bool LodGraph::PositionSet::getNext(hal_index_t pos, hal_index_t &outNext) const {
+    vector<hal_index_t>::const_iterator i = lower_bound(_sorted.begin(), _sorted.end(), pos);
+    vector<hal_index_t>::const_iterator j = lower_bound(_recent.begin(), _recent.end(), pos);
+    if (i == _sorted.end() && j == _recent.end()) {
+        return false;
+    }
+    outNext = i == _sorted.end() ? *j : j == _recent.end() ? *i : std::min(*i, *j);
+    return true;
+}
+
+bool LodGraph::PositionSet::getPrevious(hal_index_t pos, hal_index_t &outPrevious) const {
+    vector<hal_index_t>::const_iterator i = lower_bound(_sorted.begin(), _sorted.end(), pos);
+    vector<hal_index_t>::const_iterator j = lower_bound(_recent.begin(), _recent.end(), pos);
+    if (i == _sorted.begin() && j == _recent.begin()) {
+        return false;
+    }
+    outPrevious = i == _sorted.begin() ? *(j - 1) : j == _recent.begin() ? *(i - 1) : std::max(*(i - 1), *(j - 1));
+    return true;
+}
+
+void LodGraph::PositionSet::clear() {
+    vector<hal_index_t>().swap(_sorted);
+    vector<hal_index_t>().swap(_recent);
+}
+
+size_t LodGraph::PositionSet::getMemorySize() const {
+    return (_sorted.capacity() + _recent.capacity()) * sizeof(hal_index_t);
+}
+
+LodGraph::LodGraph() : _extendFraction(1.0), _finerColumns(NULL), _sampledColumns(NULL), _printPassStats(false) {
 }
 
 LodGraph::~LodGraph() {
@@ -23,22 +81,21 @@ LodGraph::~LodGraph() {
 }
 
 void LodGraph::erase() {
-    for (SequenceMapIterator smi = _seqMap.begin(); smi != _seqMap.end(); ++smi) {
-        delete smi->second;
-    }
     _seqMap.clear();
-    for (BlockIterator bi = _blocks.begin(); bi != _blocks.end(); ++bi) {
-        delete *bi;
-    }
     _blocks.clear();
+    _blockArena.clear();
+    _segments.clear();
     _parent = NULL;
     _grandParent = NULL;
     _genomes.clear();
     _telomeres.clear();
+    _finerColumns = NULL;
+    _sampledColumns = NULL;
 }
 
 void LodGraph::build(AlignmentConstPtr alignment, const Genome *parent, const vector<const Genome *> &children,
-                     const Genome *grandParent, hal_size_t step, bool allSequences, double probeFrac, double minSeqFrac) {
+                     const Genome *grandParent, hal_size_t step, bool allSequences, double probeFrac, double minSeqFrac,
+                     ostream &dimensionsStream, const SampledColumns *finerColumns, SampledColumns *sampledColumns) {
     erase();
     _alignment = AlignmentConstPtr(alignment);
     _parent = parent;
@@ -47,6 +104,11 @@ void LodGraph::build(AlignmentConstPtr alignment, const Genome *parent, const ve
     _allSequences = allSequences;
     _probeFrac = probeFrac;
     _minSeqLen = minSeqFrac * _step;
+    _finerColumns = finerColumns;
+    _sampledColumns = sampledColumns;
+    if (_sampledColumns != NULL) {
+        _sampledColumns->clear();
+    }
 
     assert(_parent != NULL);
     assert(_alignment->openGenome(_parent->getName()) == _parent);
@@ -60,18 +122,52 @@ void LodGraph::build(AlignmentConstPtr alignment, const Genome *parent, const ve
         _genomes.insert(_grandParent);
     }
 
-    for (set<const Genome *>::iterator gi = _genomes.begin(); gi != _genomes.end(); ++gi) {
-        scanGenome(*gi);
+    chrono::steady_clock::time_point passStart = chrono::steady_clock::now();
+    // scan in tree order rather than that of the set, which is by address,
+    // so the sampling doesn't depend on where the genomes were allocated
+    scanGenome(parent);
+    for (vector<const Genome *>::const_iterator child = children.begin(); child != children.end(); ++child) {
+        scanGenome(*child);
+    }
+    if (_grandParent != NULL) {
+        scanGenome(_grandParent);
+    }
+    if (_sampledColumns != NULL) {
+        // windows can overlap, so a column may be sampled before the one
+        // to its left
+        for (SampledColumns::iterator i = _sampledColumns->begin(); i != _sampledColumns->end(); ++i) {
+            stable_sort(i->second.begin(), i->second.end(),
+                        [](const pair<hal_index_t, LodColumn> &a, const pair<hal_index_t, LodColumn> &b) {
+                            return a.first < b.first;
+                        });
+        }
+    }
+
+    if (_printPassStats) {
+        printPassStats(dimensionsStream, "scan", passStart);
     }
 
     computeAdjacencies();
-    printDimensions(cout);
+    if (_printPassStats) {
+        printPassStats(dimensionsStream, "adjacencies", passStart);
+    }
+    printDimensions(dimensionsStream);
     optimizeByExtension();
-    printDimensions(cout);
+    if (_printPassStats) {
+        printPassStats(dimensionsStream, "extension", passStart);
+    }
+    printDimensions(dimensionsStream);
     optimizeByMerging();
-    printDimensions(cout);
+    if (_printPassStats) {
+        printPassStats(dimensionsStream, "merging", passStart);
+    }
+    printDimensions(dimensionsStream);
     optimizeByInsertion();
-    printDimensions(cout);
+    collectSequenceSegments();
+    if (_printPassStats) {
+        printPassStats(dimensionsStream, "insertion", passStart);
+    }
+    printDimensions(dimensionsStream);
     assert(checkCoverage() == true);
 }
 
@@ -99,6 +195,18 @@ void LodGraph::scanGenome(const Genome *genome) {
                 hal_index_t numProbe = (hal_index_t)std::max(1., (double)(maxTry - minTry) * redProbFac);
                 hal_index_t npMinus1 = numProbe < 2 ? numProbe : numProbe - 1;
                 hal_index_t probeStep = std::max((hal_index_t)1, (maxTry - minTry) / (npMinus1));
+
+                // a column the finer level sampled nearby saves scanning
+                if (_finerColumns != NULL) {
+                    hal_index_t finerPos;
+                    const LodColumn *finerColumn = chooseFinerColumn(sequence, minTry, maxTry, probeStep, finerPos);
+                    if (finerColumn != NULL) {
+                        createColumn(sequence, finerPos, *finerColumn);
+                        lastSampledPos = sequence->getStartPosition() + finerPos;
+                        continue;
+                    }
+                }
+
                 hal_index_t bestPos = NULL_INDEX;
                 hal_size_t maxNumGenomes = 1;
                 hal_size_t maxDelta = 0;
@@ -114,7 +222,8 @@ void LodGraph::scanGenome(const Genome *genome) {
                     hal_size_t delta;
                     hal_size_t numGenomes;
                     hal_size_t minSeqLen;
-                    evaluateColumn(colIt, delta, numGenomes, minSeqLen);
+                    getColumn(colIt, _column);
+                    evaluateColumn(_column, delta, numGenomes, minSeqLen);
                     if (bestColumn(probeStep, delta, numGenomes, minSeqLen, maxDelta, maxNumGenomes, maxMinSeqLen)) {
                         bestPos = tryPos;
                         maxDelta = delta;
@@ -130,7 +239,8 @@ void LodGraph::scanGenome(const Genome *genome) {
                     }
                     assert(colIt->getReferenceSequence() == sequence);
                     assert(colIt->getReferenceSequencePosition() == bestPos);
-                    createColumn(colIt);
+                    getColumn(colIt, _column);
+                    createColumn(sequence, bestPos, _column);
                     lastSampledPos = sequence->getStartPosition() + bestPos;
                 }
             }
@@ -138,18 +248,61 @@ void LodGraph::scanGenome(const Genome *genome) {
     }
 }
 
-void LodGraph::evaluateColumn(ColumnIteratorPtr colIt, hal_size_t &outDeltaMax, hal_size_t &outNumGenomes,
+const LodColumn *LodGraph::chooseFinerColumn(const Sequence *sequence, hal_index_t minTry, hal_index_t maxTry,
+                                             hal_index_t probeStep, hal_index_t &outBestPos) {
+    SampledColumns::const_iterator smi = _finerColumns->find(sequence);
+    if (smi == _finerColumns->end()) {
+        return NULL;
+    }
+    const vector<pair<hal_index_t, LodColumn>> &columns = smi->second;
+    vector<pair<hal_index_t, LodColumn>>::const_iterator ci =
+        lower_bound(columns.begin(), columns.end(), minTry,
+                    [](const pair<hal_index_t, LodColumn> &column, hal_index_t pos) { return column.first < pos; });
+    const LodColumn *best = NULL;
+    hal_size_t maxNumGenomes = 1;
+    hal_size_t maxDelta = 0;
+    hal_size_t maxMinSeqLen = 0;
+    for (; ci != columns.end() && ci->first <= maxTry; ++ci) {
+        hal_size_t delta;
+        hal_size_t numGenomes;
+        hal_size_t minSeqLen;
+        evaluateColumn(ci->second, delta, numGenomes, minSeqLen);
+        if (bestColumn(probeStep, delta, numGenomes, minSeqLen, maxDelta, maxNumGenomes, maxMinSeqLen)) {
+            best = &ci->second;
+            outBestPos = ci->first;
+            maxDelta = delta;
+            maxNumGenomes = numGenomes;
+            maxMinSeqLen = minSeqLen;
+        }
+    }
+    return best;
+}
+
+void LodGraph::getColumn(ColumnIteratorPtr colIt, LodColumn &column) const {
+    column.clear();
+    const ColumnIterator::ColumnMap *colMap = colIt->getColumnMap();
+    for (ColumnIterator::ColumnMap::const_iterator colMapIt = colMap->begin(); colMapIt != colMap->end(); ++colMapIt) {
+        const ColumnIterator::DNASet *dnaSet = colMapIt->second;
+        for (ColumnIterator::DNASet::const_iterator dnaIt = dnaSet->begin(); dnaIt != dnaSet->end(); ++dnaIt) {
+            LodColumn::Position position = {(*dnaIt)->getArrayIndex(), (*dnaIt)->getReversed()};
+            column._positions.push_back(position);
+        }
+        LodColumn::Row row = {colMapIt->first, column._positions.size()};
+        column._rows.push_back(row);
+    }
+}
+
+void LodGraph::evaluateColumn(const LodColumn &column, hal_size_t &outDeltaMax, hal_size_t &outNumGenomes,
                               hal_size_t &outMinSeqLen) {
     outDeltaMax = 0;
     outMinSeqLen = numeric_limits<hal_size_t>::max();
     set<const Genome *> genomeSet;
     // check that block has not already been added.
-    const ColumnIterator::ColumnMap *colMap = colIt->getColumnMap();
-    ColumnIterator::ColumnMap::const_iterator colMapIt = colMap->begin();
     bool breakOut = false;
-    for (; colMapIt != colMap->end() && !breakOut; ++colMapIt) {
-        const ColumnIterator::DNASet *dnaSet = colMapIt->second;
-        const Sequence *sequence = colMapIt->first;
+    size_t first = 0;
+    for (size_t rowIdx = 0; rowIdx < column._rows.size() && !breakOut; first = column._rows[rowIdx++]._end) {
+        const Sequence *sequence = column._rows[rowIdx]._sequence;
+        size_t last = column._rows[rowIdx]._end;
         if (sequence->getSequenceLength() <= _minSeqLen) {
             // we never want to align two leaves through a disappeared
             // contig in parent
@@ -161,34 +314,31 @@ void LodGraph::evaluateColumn(ColumnIteratorPtr colIt, hal_size_t &outDeltaMax,
             }
         } else {
             outMinSeqLen = std::min(outMinSeqLen, sequence->getSequenceLength());
-            ColumnIterator::DNASet::const_iterator dnaIt = dnaSet->begin();
-            if (!dnaSet->empty()) {
+            if (last > first) {
                 genomeSet.insert(sequence->getGenome());
             }
-            for (; dnaIt != dnaSet->end() && !breakOut; ++dnaIt) {
-                hal_index_t pos = (*dnaIt)->getArrayIndex();
-                LodSegment segment(NULL, sequence, pos, false);
-                SequenceMapIterator smi = _seqMap.find(sequence);
-                if (smi != _seqMap.end()) {
-                    SegmentSet *segmentSet = smi->second;
-                    SegmentIterator si = segmentSet->lower_bound(&segment);
-                    SegmentSet::value_compare segPLess = segmentSet->key_comp();
-                    if (si == segmentSet->end()) {
-                        outDeltaMax = numeric_limits<hal_size_t>::max();
-                        breakOut = true;
-                    } else if (!segPLess(&segment, *si)) {
-                        assert(outDeltaMax == 0);
-                        breakOut = true;
+            SequenceMapIterator smi = _seqMap.find(sequence);
+            for (size_t i = first; i < last && !breakOut && smi != _seqMap.end(); ++i) {
+                // every segment has length 1 while scanning, so they are
+                // found by position
+                hal_index_t pos = column._positions[i]._pos;
+                const PositionSet &positions = smi->second._positions;
+                hal_index_t next;
+                hal_index_t previous;
+                if (!positions.getNext(pos, next)) {
+                    outDeltaMax = numeric_limits<hal_size_t>::max();
+                    breakOut = true;
+                } else if (next == pos) {
+                    assert(outDeltaMax == 0);
+                    breakOut = true;
+                } else {
+                    hal_size_t delta = std::min(_step, (hal_size_t)std::abs(next - pos));
+                    if (positions.getPrevious(pos, previous)) {
+                        delta += (hal_size_t)std::abs(previous - pos);
                     } else {
-                        hal_size_t delta = std::min(_step, (hal_size_t)std::abs((*si)->getLeftPos() - segment.getLeftPos()));
-                        if (si != segmentSet->begin()) {
-                            --si;
-                            delta += (hal_size_t)std::abs((*si)->getLeftPos() - segment.getLeftPos());
-                        } else {
-                            delta *= 2;
-                        }
-                        outDeltaMax = std::max(outDeltaMax, delta);
+                        delta *= 2;
                     }
+                    outDeltaMax = std::max(outDeltaMax, delta);
                 }
             }
         }
@@ -214,66 +364,52 @@ bool LodGraph::bestColumn(hal_size_t probeStep, hal_size_t delta, hal_size_t num
 }
 
 void LodGraph::addTelomeres(const Sequence *sequence) {
-    SequenceMapIterator smi = _seqMap.find(sequence);
-    SegmentSet *segSet = NULL;
-    if (smi == _seqMap.end()) {
-        segSet = new SegmentSet();
-        _seqMap.insert(pair<const Sequence *, SegmentSet *>(sequence, segSet));
-    } else {
-        segSet = smi->second;
-    }
-
-    LodSegment *segment = new LodSegment(&_telomeres, sequence, sequence->getStartPosition() - 1, false);
-    _telomeres.addSegment(segment);
-    segSet->insert(segment);
-    segment = new LodSegment(&_telomeres, sequence, sequence->getEndPosition() + 1, false);
-    _telomeres.addSegment(segment);
-    segSet->insert(segment);
+    SequenceSegments &seqSegments = _seqMap[sequence];
+    hal_index_t positions[2] = {sequence->getStartPosition() - 1, sequence->getEndPosition() + 1};
+    for (size_t i = 0; i < 2; ++i) {
+        hal_index_t segment = _segments.add(NULL_INDEX, sequence, positions[i], false);
+        _telomeres.push_back(segment);
+        seqSegments._segments.push_back(segment);
+        seqSegments._positions.insert(positions[i]);
+    }
 }
 
-void LodGraph::createColumn(ColumnIteratorPtr colIt) {
-    LodBlock *block = new LodBlock();
-    const ColumnIterator::ColumnMap *colMap = colIt->getColumnMap();
-    ColumnIterator::ColumnMap::const_iterator colMapIt = colMap->begin();
-    for (; colMapIt != colMap->end(); ++colMapIt) {
-        const Sequence *sequence = colMapIt->first;
+void LodGraph::createColumn(const Sequence *sampledSequence, hal_index_t sampledPos, const LodColumn &column) {
+    hal_index_t blockIdx = (hal_index_t)_blockArena.size();
+    _blockArena.push_back(LodBlock(&_segments));
+    LodBlock &block = _blockArena.back();
+    size_t first = 0;
+    for (size_t rowIdx = 0; rowIdx < column._rows.size(); first = column._rows[rowIdx++]._end) {
+        const Sequence *sequence = column._rows[rowIdx]._sequence;
         if (sequence->getSequenceLength() > _minSeqLen) {
-            SequenceMapIterator smi = _seqMap.find(sequence);
-            SegmentSet *segSet = NULL;
-            if (smi == _seqMap.end()) {
-                segSet = new SegmentSet();
-                ;
-                _seqMap.insert(pair<const Sequence *, SegmentSet *>(sequence, segSet));
-            } else {
-                segSet = smi->second;
-            }
-
-            const ColumnIterator::DNASet *dnaSet = colMapIt->second;
-            for (ColumnIterator::DNASet::const_iterator dnaIt = dnaSet->begin(); dnaIt != dnaSet->end(); ++dnaIt) {
-                hal_index_t pos = (*dnaIt)->getArrayIndex();
-                bool reversed = (*dnaIt)->getReversed();
-                LodSegment *segment = new LodSegment(block, sequence, pos, reversed);
-                block->addSegment(segment);
-                assert(segSet->find(segment) == segSet->end());
-                segSet->insert(segment);
+            SequenceSegments &seqSegments = _seqMap[sequence];
+            for (size_t i = first; i < column._rows[rowIdx]._end; ++i) {
+                hal_index_t pos = column._positions[i]._pos;
+                hal_index_t segment = _segments.add(blockIdx, sequence, pos, column._positions[i]._reversed);
+                block.addSegment(segment);
+                seqSegments._segments.push_back(segment);
+                seqSegments._positions.insert(pos);
             }
         }
     }
-    assert(block->getNumSegments() > 0);
-    _blocks.push_back(block);
+    assert(block.getNumSegments() > 0);
+    _blocks.push_back(blockIdx);
+    if (_sampledColumns != NULL) {
+        (*_sampledColumns)[sampledSequence].push_back(make_pair(sampledPos, column));
+    }
 }
 
 void LodGraph::computeAdjacencies() {
     for (SequenceMapIterator smi = _seqMap.begin(); smi != _seqMap.end(); ++smi) {
-        SegmentIterator si = smi->second->begin();
-        SegmentIterator siNext;
-        for (; si != smi->second->end(); ++si) {
-            siNext = si;
-            ++siNext;
-            if (siNext != smi->second->end()) {
-                assert((*si)->overlaps(**siNext) == false);
-                (*si)->addEdgeFromRightToLeft(*siNext);
-            }
+        // the positions are no longer needed, and every segment still has
+        // length 1, so they are sorted by position
+        smi->second._positions.clear();
+        SegmentList &segments = smi->second._segments;
+        sort(segments.begin(), segments.end(),
+             [this](hal_index_t a, hal_index_t b) { return _segments[a].getLeftPos() < _segments[b].getLeftPos(); });
+        for (size_t i = 1; i < segments.size(); ++i) {
+            assert(_segments[segments[i - 1]].overlaps(_segments[segments[i]]) == false);
+            _segments.addEdgeFromRightToLeft(segments[i - 1], segments[i]);
         }
     }
 }
@@ -282,71 +418,74 @@ void LodGraph::optimizeByExtension() {
     // Put bigger blocks first because (we hope) they tend to represent
     // more information and we'd rather extend them than, say, a block
     // that represents a little insertion.
-    std::sort(_blocks.begin(), _blocks.end(), LodBlockPBigger());
+    std::sort(_blocks.begin(), _blocks.end(), [this](hal_index_t b1, hal_index_t b2) {
+        return _blockArena[b1].getNumSegments() > _blockArena[b2].getNumSegments();
+    });
 
     // Pass 1: Extend all blocks with at least 2 sequences by half
-    for (BlockIterator bi = _blocks.begin(); bi != _blocks.end() && (*bi)->getNumSegments() > 1; ++bi) {
-        (*bi)->extend(0.5);
+    for (BlockIterator bi = _blocks.begin(); bi != _blocks.end() && _blockArena[*bi].getNumSegments() > 1; ++bi) {
+        _blockArena[*bi].extend(0.5);
     }
 
     // Pass 2: Greedily extend each block to the max
     for (BlockIterator bi = _blocks.begin(); bi != _blocks.end(); ++bi) {
-        (*bi)->extend();
+        _blockArena[*bi].extend();
     }
 }
 
 void LodGraph::optimizeByMerging() {
-    BlockList mergeList(_blocks);
-    for (BlockIterator bi = mergeList.begin(); bi != mergeList.end(); ++bi) {
-        LodBlock *adjBlock = (*bi)->getHeadMergePartner();
-        if (adjBlock != NULL) {
-            for (hal_size_t segIdx = 0; segIdx < adjBlock->getNumSegments(); ++segIdx) {
-                // blah - need to clean interface but this is harmless for now
-                LodSegment *seg = const_cast<LodSegment *>(adjBlock->getSegment(segIdx));
-                SequenceMapIterator mapIt = _seqMap.find(seg->getSequence());
-                assert(mapIt != _seqMap.end());
-                SegmentIterator setIt = mapIt->second->find(seg);
-                assert(setIt != mapIt->second->end());
-                assert(*setIt == seg);
-                mapIt->second->erase(setIt);
-            }
-            (*bi)->mergeHead(adjBlock);
-        }
-    }
-    _blocks.clear();
-    for (BlockIterator bi = mergeList.begin(); bi != mergeList.end(); ++bi) {
-        if ((*bi)->getNumSegments() > 0) {
-            _blocks.push_back(*bi);
+    for (BlockIterator bi = _blocks.begin(); bi != _blocks.end(); ++bi) {
+        LodBlock &block = _blockArena[*bi];
+        hal_index_t adjBlock = block.getHeadMergePartner(_blockArena);
+        if (adjBlock != NULL_INDEX) {
+            block.mergeHead(_blockArena[adjBlock]);
         }
     }
+    _blocks.erase(remove_if(_blocks.begin(), _blocks.end(),
+                            [this](hal_index_t block) { return _blockArena[block].getNumSegments() == 0; }),
+                  _blocks.end());
 }
 
 void LodGraph::optimizeByInsertion() {
-    vector<LodBlock *> newBlocks;
-    BlockIterator startPoint = _blocks.begin();
-    // seems more convoluted than necessary but I had problems with ?iterators?
-    // doing it more simply.
-    while (startPoint != _blocks.end()) {
+    vector<hal_index_t> newBlocks;
+    do {
         newBlocks.clear();
-        for (BlockIterator bi = _blocks.begin(); bi != _blocks.end(); ++bi) {
-            (*bi)->insertNeighbours(newBlocks);
+        for (size_t i = 0; i < _blocks.size(); ++i) {
+            _blockArena[_blocks[i]].insertNeighbours(_blockArena, newBlocks);
         }
-        startPoint = _blocks.end();
-        --startPoint;
         _blocks.insert(_blocks.end(), newBlocks.begin(), newBlocks.end());
+    } while (!newBlocks.empty());
+}
 
-        // need to get the new segments into the sorted structure too!
-        for (BlockIterator bi = newBlocks.begin(); bi != newBlocks.end(); ++bi) {
-            for (hal_size_t i = 0; i < (*bi)->getNumSegments(); ++i) {
-                // blah - need to clean interface but this is harmless for now
-                LodSegment *seg = const_cast<LodSegment *>((*bi)->getSegment(i));
-                _seqMap.find(seg->getSequence())->second->insert(seg);
-            }
+void LodGraph::collectSequenceSegments() {
+    for (SequenceMapIterator smi = _seqMap.begin(); smi != _seqMap.end(); ++smi) {
+        SegmentList &segments = smi->second._segments;
+        assert(!segments.empty() && _segments[segments[0]].getBlock() == NULL_INDEX);
+        hal_index_t segment = segments[0];
+        segments.clear();
+        for (; segment != NULL_INDEX;
+             segment = _segments[segment].getFlipped() ? _segments[segment].getTailAdj() : _segments[segment].getHeadAdj()) {
+            segments.push_back(segment);
         }
-        ++startPoint;
     }
 }
 
+size_t LodGraph::getMemorySize() const {
+    size_t size = _segments.getMemorySize() + _blockArena.size() * sizeof(LodBlock) +
+                  (_blocks.capacity() + _telomeres.capacity()) * sizeof(hal_index_t);
+    for (SequenceMap::const_iterator smi = _seqMap.begin(); smi != _seqMap.end(); ++smi) {
+        size += sizeof(*smi) + smi->second._positions.getMemorySize() + smi->second._segments.capacity() * sizeof(hal_index_t);
+    }
+    return size;
+}
+
+void LodGraph::printPassStats(ostream &os, const char *pass, chrono::steady_clock::time_point &start) const {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    os << "Pass: " << pass << " seconds=" << chrono::duration<double>(now - start).count() << " segments=" << _segments.size()
+       << " blocks=" << _blocks.size() << " graphBytes=" << getMemorySize() << " peakRssBytes=" << getPeakRss() << endl;
+    start = chrono::steady_clock::now();
+}
+
 void LodGraph::printDimensions(ostream &os) const {
     hal_size_t totalSegments = 0;
     hal_size_t maxSegments = 0;
@@ -361,17 +500,19 @@ void LodGraph::printDimensions(ostream &os) const {
     hal_size_t minAdjLength = numeric_limits<hal_size_t>::max();
 
     for (BlockConstIterator bi = _blocks.begin(); bi != _blocks.end(); ++bi) {
-        totalSegments += (*bi)->getNumSegments();
-        maxSegments = std::max(maxSegments, (*bi)->getNumSegments());
-        minSegments = std::min(minSegments, (*bi)->getNumSegments());
-
-        totalLength += (*bi)->getLength();
-        maxLength = std::max(maxLength, (*bi)->getLength());
-        minLength = std::min(minLength, (*bi)->getLength());
-
-        totalAdjLength += (*bi)->getTotalAdjLength();
-        maxAdjLength = std::max(maxAdjLength, (*bi)->getTotalAdjLength());
-        minAdjLength = std::min(minAdjLength, (*bi)->getTotalAdjLength());
+        const LodBlock &block = _blockArena[*bi];
+        totalSegments += block.getNumSegments();
+        maxSegments = std::max(maxSegments, block.getNumSegments());
+        minSegments = std::min(minSegments, block.getNumSegments());
+
+        totalLength += block.getLength();
+        maxLength = std::max(maxLength, block.getLength());
+        minLength = std::min(minLength, block.getLength());
+
+        hal_size_t adjLength = block.getTotalAdjLength();
+        totalAdjLength += adjLength;
+        maxAdjLength = std::max(maxAdjLength, adjLength);
+        minAdjLength = std::min(minAdjLength, adjLength);
     }
 
     os << "Graph: numBlocks=" << _blocks.size() << " numSegs=" << totalSegments << " minSegs=" << minSegments
@@ -395,8 +536,9 @@ bool LodGraph::checkCoverage() const {
 
     // iterate through every segment in every block.
     for (BlockConstIterator bi = _blocks.begin(); bi != _blocks.end() && success; ++bi) {
-        for (hal_size_t segIdx = 0; segIdx < (*bi)->getNumSegments() && success; ++segIdx) {
-            const LodSegment *segment = (*bi)->getSegment(segIdx);
+        const LodBlock &block = _blockArena[*bi];
+        for (hal_size_t segIdx = 0; segIdx < block.getNumSegments() && success; ++segIdx) {
+            const LodSegment *segment = block.getSegment(segIdx);
             const Genome *genome = segment->getSequence()->getGenome();
             covMapIt = covMap.find(genome);
             assert(covMapIt != covMap.end());
@@ -406,7 +548,7 @@ bool LodGraph::checkCoverage() const {
                 if (covMapIt->second->at(pos) == true) {
                     cerr << "dupcliate coverage found at position " << pos << " in"
                          << " genome " << genome->getName() << " offending block:\n"
-                         << **bi << endl;
+                         << block << endl;
                     success = false;
                 }
                 covMapIt->second->at(pos) = true;
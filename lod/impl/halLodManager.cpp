@@ -34,7 +34,8 @@ LodManager::LodManager() : _options(NULL), _maxLodLowerBound((hal_size_t)numeric
 }
 
 LodManager::~LodManager() {
-    for (AlignmentMap::iterator mapIt = _map.begin(); mapIt != _map.end(); ++mapIt) {
+    // coarsest first, as embedded levels use the file of level 0
+    for (AlignmentMap::reverse_iterator mapIt = _map.rbegin(); mapIt != _map.rend(); ++mapIt) {
         if (mapIt->second.second.get() != NULL) {
             const_cast<Alignment *>(mapIt->second.second.get())->close();
         }
@@ -44,6 +45,7 @@ LodManager::~LodManager() {
 void LodManager::loadLODFile(const string &lodPath, const CLParser *options) {
     _options = options;
     _map.clear();
+    _embeddedOffsets.clear();
 
 #ifdef ENABLE_UDC
     char *cpath = const_cast<char *>(lodPath.c_str());
@@ -104,11 +106,46 @@ void LodManager::loadLODFile(const string &lodPath, const CLParser *options) {
 void LodManager::loadSingeHALFile(const string &halPath, const CLParser *options) {
     _options = options;
     _map.clear();
+    _embeddedOffsets.clear();
     _map.insert(pair<hal_size_t, PathAlign>(0, PathAlign(halPath, AlignmentConstPtr())));
     _maxLodLowerBound = (hal_size_t)numeric_limits<hal_index_t>::max();
+    if (detectHalAlignmentFormat(halPath, options) == STORAGE_FORMAT_MMAP) {
+        loadEmbeddedLevels(halPath);
+    }
     checkMap(halPath);
 }
 
+/* open level 0 to find any levels embedded in its file */
+void LodManager::loadEmbeddedLevels(const string &halPath) {
+    AlignmentConstPtr &alignment = _map.begin()->second.second;
+    alignment = AlignmentConstPtr(openHalAlignment(halPath, _options));
+    checkAlignment(0, halPath, alignment);
+    hal_size_t maxLodLowerBound;
+    _embeddedOffsets = getEmbeddedLodLevels(alignment, maxLodLowerBound);
+    for (map<hal_size_t, size_t>::const_iterator i = _embeddedOffsets.begin(); i != _embeddedOffsets.end(); ++i) {
+        _map.insert(pair<hal_size_t, PathAlign>(i->first, PathAlign(halPath, AlignmentConstPtr())));
+    }
+    if (maxLodLowerBound != 0) {
+        _maxLodLowerBound = maxLodLowerBound;
+        _map.insert(pair<hal_size_t, PathAlign>(maxLodLowerBound, PathAlign(MaxLodToken, AlignmentConstPtr())));
+    }
+}
+
+void LodManager::embedLevels(AlignmentPtr alignment) {
+    for (AlignmentMap::iterator mapIt = _map.begin(); mapIt != _map.end(); ++mapIt) {
+        if (mapIt->first == 0 || mapIt->first == _maxLodLowerBound) {
+            continue;
+        }
+        AlignmentConstPtr level(openHalAlignment(mapIt->second.first, _options));
+        checkAlignment(mapIt->first, mapIt->second.first, level);
+        embedLodLevel(alignment, level, mapIt->first);
+        const_cast<Alignment *>(level.get())->close();
+    }
+    if (_maxLodLowerBound != (hal_size_t)numeric_limits<hal_index_t>::max()) {
+        setEmbeddedLodLimit(alignment, _maxLodLowerBound);
+    }
+}
+
 AlignmentConstPtr LodManager::getAlignment(hal_size_t queryLength, bool needDNA) {
     assert(_map.size() > 0);
     AlignmentMap::iterator mapIt;
@@ -125,7 +162,12 @@ AlignmentConstPtr LodManager::getAlignment(hal_size_t queryLength, bool needDNA)
                             std::to_string(getMaxQueryLength()));
     }
     if (alignment.get() == NULL) {
-        alignment = AlignmentConstPtr(openHalAlignment(mapIt->second.first, _options));
+        map<hal_size_t, size_t>::const_iterator offsetIt = _embeddedOffsets.find(mapIt->first);
+        if (offsetIt != _embeddedOffsets.end()) {
+            alignment = openEmbeddedLodLevel(_map.begin()->second.second, offsetIt->second);
+        } else {
+            alignment = AlignmentConstPtr(openHalAlignment(mapIt->second.first, _options));
+        }
         checkAlignment(mapIt->first, mapIt->second.first, alignment);
     }
     assert(mapIt->second.second.get() != NULL);
@@ -12,13 +12,13 @@ using namespace std;
 using namespace hal;
 
 LodSegment::LodSegment()
-    : _sequence(NULL), _tailPos(NULL_INDEX), _afterHeadPos(NULL_INDEX), _tailAdj(NULL), _headAdj(NULL), _arrayIndex(NULL_INDEX),
-      _block(NULL) {
+    : _sequence(NULL), _tailPos(NULL_INDEX), _afterHeadPos(NULL_INDEX), _tailAdj(NULL_INDEX), _headAdj(NULL_INDEX),
+      _arrayIndex(NULL_INDEX), _block(NULL_INDEX) {
 }
 
-LodSegment::LodSegment(LodBlock *block, const Sequence *sequence, hal_index_t pos, bool flipped)
-    : _sequence(sequence), _tailPos(pos), _afterHeadPos(pos), _tailAdj(NULL), _headAdj(NULL), _arrayIndex(NULL_INDEX),
-      _block(block) {
+LodSegment::LodSegment(hal_index_t block, const Sequence *sequence, hal_index_t pos, bool flipped)
+    : _sequence(sequence), _tailPos(pos), _afterHeadPos(pos), _tailAdj(NULL_INDEX), _headAdj(NULL_INDEX),
+      _arrayIndex(NULL_INDEX), _block(block) {
     _afterHeadPos += flipped ? -1 : 1;
     assert(_sequence != NULL);
     assert(getLeftPos() >= getRightPos());
@@ -26,128 +26,162 @@ LodSegment::LodSegment(LodBlock *block, const Sequence *sequence, hal_index_t po
     assert(getRightPos() <= _sequence->getEndPosition() + 1);
 }
 
-LodSegment::~LodSegment() {
+void LodSegmentArena::clear() {
+    _segments.clear();
 }
 
-void LodSegment::addEdgeFromRightToLeft(LodSegment *tgt) {
-    assert(tgt != NULL);
-    LodSegment *&myCap = getFlipped() ? _tailAdj : _headAdj;
-    LodSegment *&tgtCap = tgt->getFlipped() ? tgt->_headAdj : tgt->_tailAdj;
-    assert(myCap == NULL);
-    assert(tgtCap == NULL);
+size_t LodSegmentArena::getMemorySize() const {
+    return _segments.capacity() * sizeof(LodSegment);
+}
+
+hal_index_t LodSegmentArena::add(hal_index_t block, const Sequence *sequence, hal_index_t pos, bool flipped) {
+    _segments.push_back(LodSegment(block, sequence, pos, flipped));
+    return (hal_index_t)_segments.size() - 1;
+}
+
+void LodSegmentArena::addEdgeFromRightToLeft(hal_index_t src, hal_index_t tgt) {
+    assert(tgt != NULL_INDEX);
+    LodSegment &segment = _segments[src];
+    LodSegment &target = _segments[tgt];
+    hal_index_t &myCap = segment.getFlipped() ? segment._tailAdj : segment._headAdj;
+    hal_index_t &tgtCap = target.getFlipped() ? target._headAdj : target._tailAdj;
+    assert(myCap == NULL_INDEX);
+    assert(tgtCap == NULL_INDEX);
     myCap = tgt;
-    tgtCap = this;
-    assert(_tailAdj != _headAdj);
+    tgtCap = src;
+    assert(segment._tailAdj != segment._headAdj);
 }
 
-void LodSegment::extendTail(hal_size_t extLen) {
-    assert(getTailAdjLen() >= extLen);
-    assert(getLeftPos() >= _sequence->getStartPosition() && getRightPos() <= _sequence->getEndPosition());
-    if (getFlipped() == true) {
-        _tailPos += extLen;
+void LodSegmentArena::extendTail(hal_index_t index, hal_size_t extLen) {
+    LodSegment &segment = _segments[index];
+    const Sequence *sequence = segment._sequence;
+    (void)sequence;
+    assert(getTailAdjLen(index) >= extLen);
+    assert(segment.getLeftPos() >= sequence->getStartPosition() && segment.getRightPos() <= sequence->getEndPosition());
+    if (segment.getFlipped() == true) {
+        segment._tailPos += extLen;
     } else {
-        _tailPos -= extLen;
+        segment._tailPos -= extLen;
     }
-    assert(getLeftPos() >= _sequence->getStartPosition() && getRightPos() <= _sequence->getEndPosition());
-    assert(overlaps(*_tailAdj) == false);
+    assert(segment.getLeftPos() >= sequence->getStartPosition() && segment.getRightPos() <= sequence->getEndPosition());
+    assert(segment.overlaps(_segments[segment._tailAdj]) == false);
 }
 
-void LodSegment::extendHead(hal_size_t extLen) {
-    assert(getHeadAdjLen() >= extLen);
-    assert(getLeftPos() >= _sequence->getStartPosition() && getRightPos() <= _sequence->getEndPosition());
-    if (getFlipped() == true) {
-        _afterHeadPos -= extLen;
+void LodSegmentArena::extendHead(hal_index_t index, hal_size_t extLen) {
+    LodSegment &segment = _segments[index];
+    const Sequence *sequence = segment._sequence;
+    (void)sequence;
+    assert(getHeadAdjLen(index) >= extLen);
+    assert(segment.getLeftPos() >= sequence->getStartPosition() && segment.getRightPos() <= sequence->getEndPosition());
+    if (segment.getFlipped() == true) {
+        segment._afterHeadPos -= extLen;
     } else {
-        _afterHeadPos += extLen;
+        segment._afterHeadPos += extLen;
     }
-    assert(getLeftPos() >= _sequence->getStartPosition() && getRightPos() <= _sequence->getEndPosition());
-    assert(overlaps(*_headAdj) == false);
+    assert(segment.getLeftPos() >= sequence->getStartPosition() && segment.getRightPos() <= sequence->getEndPosition());
+    assert(segment.overlaps(_segments[segment._headAdj]) == false);
 }
 
-LodSegment *LodSegment::insertNewHeadAdj(LodBlock *block, hal_size_t newLen) {
+hal_index_t LodSegmentArena::insertNewHeadAdj(hal_index_t index, hal_index_t block, hal_size_t newLen) {
     assert(newLen > 0);
-    hal_index_t newTailPos = getHeadPos();
-    newTailPos += getFlipped() ? -1 : 1;
-    LodSegment *newSeg = new LodSegment(block, getSequence(), newTailPos, getFlipped());
-    bool headToHead = getHeadToHead();
-    newSeg->_headAdj = _headAdj;
+    bool flipped = _segments[index].getFlipped();
+    hal_index_t newTailPos = _segments[index].getHeadPos();
+    newTailPos += flipped ? -1 : 1;
+    bool headToHead = getHeadToHead(index);
+    // adding may move the segments, so they are only referenced after
+    hal_index_t newIndex = add(block, _segments[index].getSequence(), newTailPos, flipped);
+    LodSegment &segment = _segments[index];
+    LodSegment &newSeg = _segments[newIndex];
+    LodSegment &headAdj = _segments[segment._headAdj];
+    newSeg._headAdj = segment._headAdj;
     if (headToHead) {
-        assert(_headAdj->_headAdj == this);
-        _headAdj->_headAdj = newSeg;
+        assert(headAdj._headAdj == index);
+        headAdj._headAdj = newIndex;
     } else {
-        assert(_headAdj->_tailAdj == this);
-        _headAdj->_tailAdj = newSeg;
+        assert(headAdj._tailAdj == index);
+        headAdj._tailAdj = newIndex;
     }
-    newSeg->_tailAdj = this;
-    _headAdj = newSeg;
-    assert(getHeadAdjLen() == 0);
-    assert(newSeg->getTailAdjLen() == 0);
+    newSeg._tailAdj = index;
+    segment._headAdj = newIndex;
+    assert(getHeadAdjLen(index) == 0);
+    assert(getTailAdjLen(newIndex) == 0);
     // we do the minus 1 below because the segment already
     // counts for 1
-    newSeg->extendHead(newLen - 1);
-    return newSeg;
+    extendHead(newIndex, newLen - 1);
+    return newIndex;
 }
 
-LodSegment *LodSegment::insertNewTailAdj(LodBlock *block, hal_size_t newLen) {
+hal_index_t LodSegmentArena::insertNewTailAdj(hal_index_t index, hal_index_t block, hal_size_t newLen) {
     assert(newLen > 0);
-    hal_index_t newHeadPos = getTailPos();
-    newHeadPos += getFlipped() ? 1 : -1;
-    LodSegment *newSeg = new LodSegment(block, getSequence(), newHeadPos, getFlipped());
-    bool tailToTail = getTailToTail();
-    newSeg->_tailAdj = _tailAdj;
+    bool flipped = _segments[index].getFlipped();
+    hal_index_t newHeadPos = _segments[index].getTailPos();
+    newHeadPos += flipped ? 1 : -1;
+    bool tailToTail = getTailToTail(index);
+    // adding may move the segments, so they are only referenced after
+    hal_index_t newIndex = add(block, _segments[index].getSequence(), newHeadPos, flipped);
+    LodSegment &segment = _segments[index];
+    LodSegment &newSeg = _segments[newIndex];
+    LodSegment &tailAdj = _segments[segment._tailAdj];
+    newSeg._tailAdj = segment._tailAdj;
     if (tailToTail) {
-        assert(_tailAdj->_tailAdj == this);
-        _tailAdj->_tailAdj = newSeg;
+        assert(tailAdj._tailAdj == index);
+        tailAdj._tailAdj = newIndex;
     } else {
-        assert(_tailAdj->_headAdj == this);
-        _tailAdj->_headAdj = newSeg;
+        assert(tailAdj._headAdj == index);
+        tailAdj._headAdj = newIndex;
     }
-    newSeg->_headAdj = this;
-    _tailAdj = newSeg;
-    assert(getTailAdjLen() == 0);
-    assert(newSeg->getHeadAdjLen() == 0);
+    newSeg._headAdj = index;
+    segment._tailAdj = newIndex;
+    assert(getTailAdjLen(index) == 0);
+    assert(getHeadAdjLen(newIndex) == 0);
     // we do the minus 1 below because the segment already
     // counts for 1
-    newSeg->extendTail(newLen - 1);
-    return newSeg;
+    extendTail(newIndex, newLen - 1);
+    return newIndex;
 }
 
-void LodSegment::mergeHead() {
-    assert(getHeadAdjLen() == 0 && getHeadToTail() == true);
-    assert(getArrayIndex() == NULL_INDEX);
-    LodSegment *segToMerge = _headAdj;
-    LodSegment *newHeadAdj = segToMerge->_headAdj;
-    assert(segToMerge->getTailAdj() == this);
-    bool newHeadToTail = segToMerge->getHeadToTail();
-    hal_size_t segToMergeHeadAdjLen = segToMerge->getHeadAdjLen();
+void LodSegmentArena::mergeHead(hal_index_t index) {
+    assert(getHeadAdjLen(index) == 0 && getHeadToTail(index) == true);
+    LodSegment &segment = _segments[index];
+    assert(segment.getArrayIndex() == NULL_INDEX);
+    hal_index_t toMerge = segment._headAdj;
+    LodSegment &segToMerge = _segments[toMerge];
+    hal_index_t newHeadAdj = segToMerge._headAdj;
+    assert(segToMerge.getTailAdj() == index);
+    bool newHeadToTail = getHeadToTail(toMerge);
+    hal_size_t segToMergeHeadAdjLen = getHeadAdjLen(toMerge);
     (void)segToMergeHeadAdjLen;
-    hal_size_t segToMergeLen = segToMerge->getLength();
-    _headAdj = newHeadAdj;
+    hal_size_t segToMergeLen = segToMerge.getLength();
+    segment._headAdj = newHeadAdj;
     if (newHeadToTail) {
-        newHeadAdj->_tailAdj = this;
+        _segments[newHeadAdj]._tailAdj = index;
     } else {
-        newHeadAdj->_headAdj = this;
+        _segments[newHeadAdj]._headAdj = index;
+    }
+    assert(getHeadAdjLen(index) == segToMergeLen + segToMergeHeadAdjLen);
+    extendHead(index, segToMergeLen);
+    assert(getHeadAdjLen(index) == segToMergeHeadAdjLen);
+    segToMerge._headAdj = NULL_INDEX;
+    segToMerge._tailAdj = NULL_INDEX;
+}
+
+void LodSegmentArena::print(ostream &os, hal_index_t index) const {
+    const LodSegment &segment = _segments[index];
+    os << segment;
+    if (segment._tailAdj != NULL_INDEX) {
+        os << " tAdjLen=" << getTailAdjLen(index) << "(" << (getTailToHead(index) ? "H)" : "T)");
+    }
+    if (segment._headAdj != NULL_INDEX) {
+        os << " hAdjLen=" << getHeadAdjLen(index) << "(" << (getHeadToTail(index) ? "T)" : "H)");
     }
-    assert(getHeadAdjLen() == segToMergeLen + segToMergeHeadAdjLen);
-    extendHead(segToMergeLen);
-    assert(getHeadAdjLen() == segToMergeHeadAdjLen);
-    segToMerge->_headAdj = NULL;
-    segToMerge->_tailAdj = NULL;
 }
 
 ostream &hal::operator<<(ostream &os, const LodSegment &segment) {
-    os << "seg: " << &segment << " " << segment.getSequence()->getName() << " [" << segment.getLeftPos() << "("
+    os << "seg: " << segment.getSequence()->getName() << " [" << segment.getLeftPos() << "("
        << (segment.getFlipped() ? "H" : "T") << ")"
        << ", " << segment.getRightPos() << "(" << (segment.getFlipped() ? "T" : "H") << ")"
        << "]"
        << "[ai=" << segment.getArrayIndex() << "]"
-       << " tAdj: " << segment._tailAdj;
-    if (segment._tailAdj != NULL) {
-        os << " len=" << segment.getTailAdjLen() << "(" << (segment.getTailToHead() ? "H)" : "T)");
-    }
-    os << " hAdj: " << segment._headAdj;
-    if (segment._headAdj != NULL) {
-        os << " len=" << segment.getHeadAdjLen() << "(" << (segment.getHeadToTail() ? "T)" : "H)");
-    }
+       << " tAdj: " << segment._tailAdj << " hAdj: " << segment._headAdj;
     return os;
 }
@@ -10,10 +10,8 @@
 
 #include "hal.h"
 #include "halLodSegment.h"
+#include <deque>
 #include <iostream>
-#include <list>
-#include <map>
-#include <set>
 #include <string>
 #include <vector>
 
@@ -23,30 +21,30 @@ namespace hal {
 
     std::ostream &operator<<(std::ostream &os, const LodBlock &block);
 
-    struct LodBlockPBigger {
-        bool operator()(const LodBlock *b1, const LodBlock *b2) const;
-    };
-
     /* A block is a list of homolgous segments.  All these segments must
-     * be the same length.  The block's destructor will free all segments
-     * it contains.
+     * be the same length.  They are created together, so a block is a
+     * range of its graph's segment arena.  Blocks are stored in a deque,
+     * which the methods creating or finding other blocks are given, and
+     * are referred to by their index in it.
      */
     class LodBlock {
         friend std::ostream &operator<<(std::ostream &os, const LodBlock &block);
 
       public:
-        typedef std::vector<LodSegment *> SegmentList;
-        typedef SegmentList::iterator SegmentIterator;
-        typedef SegmentList::const_iterator SegmentConstIterator;
+        typedef std::deque<LodBlock> BlockArena;
 
-        LodBlock();
-        ~LodBlock();
+        /** Create an empty block, whose segments will be added to
+         * segments starting from the next one */
+        LodBlock(LodSegmentArena *segments);
 
         hal_size_t getNumSegments() const;
         hal_size_t getLength() const;
         const LodSegment *getSegment(hal_size_t index) const;
+        /** index of a segment in the arena */
+        hal_index_t getSegmentIndex(hal_size_t index) const;
 
-        void addSegment(LodSegment *segment);
+        /** Add a segment, which must be the last one in the arena */
+        void addSegment(hal_index_t segment);
         void clear();
 
         /** Get the total length of all (existing) adjacencies in all segmetns
@@ -58,26 +56,28 @@ namespace hal {
 
         /** Test if all segments in block have head to tail adjacencies
          * to segments in the same non-telomere block, and that all these
-         * adjacencies have length 0.  If test passes, return the candidate
-         * adjacent block.  NULL otherwise */
-        LodBlock *getHeadMergePartner();
+         * adjacencies have length 0.  If test passes, return the index of
+         * the candidate adjacent block.  NULL_INDEX otherwise */
+        hal_index_t getHeadMergePartner(const BlockArena &blocks) const;
 
         /** Merge head of this block to tail of adjBlock (which was found with
          * getHeadMergePartner.  Merged segments will disappear and need
          * to be accounted for elsewhere */
-        void mergeHead(LodBlock *adjBlock);
+        void mergeHead(LodBlock &adjBlock);
 
         /** Insert new blocks as neighbours until all adjacencies have length
          * 0.  (if there are no self edges, at most 1 head block and 1 tail
          * block are created.  If there are self edges, it can take multiple
-         * blocks to reduce all the edge  lengths */
-        void insertNeighbours(std::vector<LodBlock *> &outList);
+         * blocks to reduce all the edge  lengths.  The new blocks are added
+         * to blocks, and their indexes to outList */
+        void insertNeighbours(BlockArena &blocks, std::vector<hal_index_t> &outList);
 
       protected:
         /** Create a new block and insert it as a neighbour.  All adjacencies
-         * of this block become 0. */
-        LodBlock *insertNewTailNeighbour();
-        LodBlock *insertNewHeadNeighbour();
+         * of this block become 0.  Returns its index, or NULL_INDEX if
+         * there is nothing to insert */
+        hal_index_t insertNewTailNeighbour(BlockArena &blocks);
+        hal_index_t insertNewHeadNeighbour(BlockArena &blocks);
 
         /** Get the maximum length to extend the block.  This is equivalent
          * to the minimum adjacency length, except that adjacencies between
@@ -93,29 +93,26 @@ namespace hal {
         hal_size_t getMaxHeadInsertionLen() const;
         hal_size_t getMaxTailInsertionLen() const;
 
-        SegmentList _segments;
-
-      private:
-        LodBlock(const LodBlock &);
-        const LodBlock &operator=(const LodBlock &) const;
+        LodSegmentArena *_segments;
+        hal_index_t _firstSegment;
+        hal_size_t _numSegments;
     };
 
-    inline bool LodBlockPBigger::operator()(const LodBlock *b1, const LodBlock *b2) const {
-        bool bigger = b1->getNumSegments() > b2->getNumSegments();
-        return bigger;
-    }
-
     inline hal_size_t LodBlock::getNumSegments() const {
-        return _segments.size();
+        return _numSegments;
     }
 
     inline hal_size_t LodBlock::getLength() const {
-        return _segments.empty() ? 0 : _segments[0]->getLength();
+        return _numSegments == 0 ? 0 : (*_segments)[_firstSegment].getLength();
     }
 
     inline const LodSegment *LodBlock::getSegment(hal_size_t index) const {
+        return &(*_segments)[getSegmentIndex(index)];
+    }
+
+    inline hal_index_t LodBlock::getSegmentIndex(hal_size_t index) const {
         assert(index < getNumSegments());
-        return _segments.at(index);
+        return _firstSegment + (hal_index_t)index;
     }
 }
 
@@ -10,8 +10,10 @@
 
 #include "hal.h"
 #include "halLodGraph.h"
+#include <condition_variable>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -33,17 +35,38 @@ namespace hal {
         LodExtract();
         ~LodExtract();
 
+        /** print the time and memory used by each pass of building a
+         * graph with its dimensions */
+        void setPrintPassStats(bool printPassStats);
+
         void createInterpolatedAlignment(AlignmentConstPtr inAlignment, AlignmentPtr outAlignment, double scale,
                                          const std::string &tree, const std::string &rootName, bool keepSequences,
                                          bool allSequences, double probeFrac, double minSeqFrac);
 
+        /** Create several levels of detail at once, each coarser than the
+         * one before.  A level's graph is built from the columns sampled for
+         * the level before it where they will do, rather than by scanning the
+         * input again.  Internal nodes are built in parallel, one thread per
+         * input instance, and written in breadth-first order.
+         * @param inAlignments instances of the input alignment, one per thread
+         * @param outAlignments output alignment of each level
+         * @param scales scale factor of each level, increasing */
+        void createInterpolatedAlignments(const std::vector<AlignmentConstPtr> &inAlignments,
+                                          const std::vector<AlignmentPtr> &outAlignments, const std::vector<double> &scales,
+                                          const std::string &tree, const std::string &rootName, bool keepSequences,
+                                          bool allSequences, double probeFrac, double minSeqFrac);
+
       protected:
         typedef std::set<const LodSegment *, LodSegmentPLess> SegmentSet;
         typedef std::map<const Genome *, SegmentSet *> SegmentMap;
 
       protected:
         void createTree(const std::string &tree, const std::string &rootName);
-        void convertInternalNode(const std::string &genomeName, double scale);
+        void convertInternalNode(AlignmentConstPtr inAlignment, const std::vector<AlignmentPtr> &outAlignments,
+                                 const std::vector<double> &scales, const std::string &genomeName,
+                                 const std::vector<std::string> &childNames, size_t nodeIdx);
+        void writeInternalNode(const Genome *parent, const std::vector<const Genome *> &children,
+                               const std::vector<std::string> &childNames);
         void countSegmentsInGraph(std::map<const Sequence *, hal_size_t> &segmentCounts);
         void writeDimensions(const std::map<const Sequence *, hal_size_t> &segmentCounts, const std::string &parentName,
                              const std::vector<std::string> &childNames);
@@ -60,11 +83,21 @@ namespace hal {
         AlignmentConstPtr _inAlignment;
         AlignmentPtr _outAlignment;
 
-        LodGraph _graph;
+        // graph being written
+        LodGraph *_graph;
+        bool _printPassStats;
         bool _keepSequences;
         bool _allSequences;
         double _probeFrac;
         double _minSeqFrac;
+
+        // internal nodes are claimed in breadth-first order, and each waits
+        // for the ones before it to be written
+        size_t _nextNode;
+        size_t _nextWrite;
+        bool _failed;
+        std::mutex _writeMutex;
+        std::condition_variable _writeCond;
     };
 }
 
@@ -11,6 +11,7 @@
 #include "hal.h"
 #include "halLodBlock.h"
 #include "halLodSegment.h"
+#include <chrono>
 #include <iostream>
 #include <map>
 #include <set>
@@ -19,10 +20,42 @@
 
 namespace hal {
 
+    /** A column of the alignment, as the positions in it of each sequence,
+     * in the order of the column iterator's map. */
+    struct LodColumn {
+        struct Row {
+            const Sequence *_sequence;
+            // end of the row's positions
+            size_t _end;
+        };
+        struct Position {
+            hal_index_t _pos;
+            bool _reversed;
+        };
+
+        void clear() {
+            _rows.clear();
+            _positions.clear();
+        }
+
+        std::vector<Row> _rows;
+        std::vector<Position> _positions;
+    };
+
+    /* The sequence graph of a level of detail.  Segments and blocks are
+     * stored in arenas and refer to each other by index, and the segments of
+     * each sequence are kept in sorted vectors, so building the graphs of
+     * large genomes isn't bound by allocating and following pointers. */
     class LodGraph {
       public:
-        typedef std::set<LodSegment *, LodSegmentPLess> SegmentSet;
-        typedef SegmentSet::iterator SegmentIterator;
+        /** segments by index in the arena */
+        typedef std::vector<hal_index_t> SegmentList;
+
+        /** The columns sampled while building a graph, by the sequence they
+         * were sampled from and their position in it, so that the graph of a
+         * coarser level of detail can choose among them rather than scan
+         * the alignment again. */
+        typedef std::map<const Sequence *, std::vector<std::pair<hal_index_t, LodColumn>>> SampledColumns;
 
         LodGraph();
         ~LodGraph();
@@ -31,15 +64,31 @@ namespace hal {
 
         const LodBlock *getBlock(hal_size_t index) const;
         hal_size_t getNumBlocks() const;
-        const SegmentSet *getSegmentSet(const Sequence *sequence) const;
-        const LodBlock *getTelomeres() const;
+        const LodSegment *getSegment(hal_index_t index) const;
+        LodSegment *getSegment(hal_index_t index);
+        /** The segments of a sequence in order, starting and ending with
+         * its telomeres */
+        const SegmentList &getSequenceSegments(const Sequence *sequence) const;
+        const SegmentList &getTelomeres() const;
+
+        /** Print the time taken by each pass of build(), and the memory used
+         * by the graph and the peak of the process after it, along with the
+         * dimensions */
+        void setPrintPassStats(bool printPassStats);
 
         /** Build the LOD graph for a given subtree of the alignment.  The
          * entire graph is stored in memory in a special structure (ie not within
          * HAL).  The step parameter dictates how coarse-grained the interpolation
-         * is:  every step bases are sampled.  */
+         * is:  every step bases are sampled.
+         * @param dimensionsStream stream the graph's dimensions are printed to
+         * as it is optimized
+         * @param finerColumns if not NULL, columns sampled for a finer level
+         * of detail of the same genomes, which are preferred to scanning
+         * @param sampledColumns if not NULL, set to the columns sampled */
         void build(AlignmentConstPtr alignment, const Genome *parent, const std::vector<const Genome *> &children,
-                   const Genome *grandParent, hal_size_t step, bool allSequences, double probeFrac, double minSeqFrac);
+                   const Genome *grandParent, hal_size_t step, bool allSequences, double probeFrac, double minSeqFrac,
+                   std::ostream &dimensionsStream = std::cout, const SampledColumns *finerColumns = NULL,
+                   SampledColumns *sampledColumns = NULL);
 
         /** Help debuggin and tuning */
         void printDimensions(std::ostream &os) const;
@@ -50,20 +99,57 @@ namespace hal {
         bool checkCoverage() const;
 
       protected:
-        typedef std::vector<LodBlock *> BlockList;
+        /** blocks by index in the arena */
+        typedef std::vector<hal_index_t> BlockList;
         typedef BlockList::iterator BlockIterator;
         typedef BlockList::const_iterator BlockConstIterator;
 
-        typedef std::map<const Sequence *, SegmentSet *> SequenceMap;
+        /* Positions sampled from a sequence while scanning, for finding those
+         * nearest a probed column.  New positions go in a small sorted
+         * buffer, which is merged into the rest once it grows past the
+         * square root of their number, so inserting doesn't move them all. */
+        class PositionSet {
+          public:
+            void insert(hal_index_t pos);
+            /** the first position >= pos, false if none */
+            bool getNext(hal_index_t pos, hal_index_t &outNext) const;
+            /** the last position < pos, false if none */
+            bool getPrevious(hal_index_t pos, hal_index_t &outPrevious) const;
+            /** free the positions */
+            void clear();
+            size_t getMemorySize() const;
+
+          private:
+            static const size_t MinRecent = 64;
+            std::vector<hal_index_t> _sorted;
+            std::vector<hal_index_t> _recent;
+        };
+
+        struct SequenceSegments {
+            PositionSet _positions;
+            // sorted once scanning is done, and collected again once the
+            // graph is optimized
+            SegmentList _segments;
+        };
+        typedef std::map<const Sequence *, SequenceSegments> SequenceMap;
         typedef SequenceMap::iterator SequenceMapIterator;
 
         /** Read a HAL genome into sequence graph */
         void scanGenome(const Genome *genome);
 
+        /** Choose the best of the finer level's columns sampled from
+         * sequence in [minTry, maxTry], as scanGenome() would if it probed
+         * them.  Returns NULL if none is good enough */
+        const LodColumn *chooseFinerColumn(const Sequence *sequence, hal_index_t minTry, hal_index_t maxTry,
+                                           hal_index_t probeStep, hal_index_t &outBestPos);
+
+        /** Copy the column of a column iterator */
+        void getColumn(ColumnIteratorPtr colIt, LodColumn &column) const;
+
         /** Check maxium distance of this column to any other sampled position.
          * Also count the number of genomes it aligns to.  This information
          * will be used to prioritize probed columns*/
-        void evaluateColumn(ColumnIteratorPtr colIt, hal_size_t &outDeltaMax, hal_size_t &outNumGenomes,
+        void evaluateColumn(const LodColumn &column, hal_size_t &outDeltaMax, hal_size_t &outNumGenomes,
                             hal_size_t &outMinSeqLen);
 
         /* Test if this is the best column based on stats collected above */
@@ -74,13 +160,16 @@ namespace hal {
          * position -1 and and endPosition + 1 */
         void addTelomeres(const Sequence *sequence);
 
-        /** Add a single column iterator as  a block */
-        void createColumn(ColumnIteratorPtr colIt);
+        /** Add a single column as a block, and remember it if sampling
+         * columns for a coarser level.  pos is its position in the sequence
+         * it was sampled from */
+        void createColumn(const Sequence *sequence, hal_index_t pos, const LodColumn &column);
 
         /** Add an entire sequence as unaliged segment */
         void createUnaligedSegment(const Sequence *sequence);
 
-        /** compute the adjacencies using the SegmentSets */
+        /** sort the segments of each sequence and compute the
+         * adjacencies between them */
         void computeAdjacencies();
 
         /** First optimization pass: Maximally extend all blocks */
@@ -93,6 +182,18 @@ namespace hal {
          * zero length */
         void optimizeByInsertion();
 
+        /** Collect the segments of each sequence again by following the
+         * adjacencies from its left telomere, since the optimizations don't
+         * keep them up to date */
+        void collectSequenceSegments();
+
+        /** bytes allocated for the graph */
+        size_t getMemorySize() const;
+
+        /** print stats for a pass of build() which began at start, and
+         * restart the clock for the next */
+        void printPassStats(std::ostream &os, const char *pass, std::chrono::steady_clock::time_point &start) const;
+
       protected:
         // input alignment structure
         AlignmentConstPtr _alignment;
@@ -106,12 +207,16 @@ namespace hal {
         // fraction of edge to greedily extend
         double _extendFraction;
 
+        // every segment and block created, including those emptied by
+        // merging
+        LodSegmentArena _segments;
+        LodBlock::BlockArena _blockArena;
+
         // the alignment blocks
         BlockList _blocks;
 
-        // the telomeres all get put in one block.  the block structure
-        // is used only to make sure they get freed.
-        LodBlock _telomeres;
+        // the telomeres aren't in a block
+        SegmentList _telomeres;
 
         // nodes sorted by sequence
         SequenceMap _seqMap;
@@ -127,23 +232,45 @@ namespace hal {
         // min size of sequence to not be ignored (computed from the
         // minSeqFrac paramater)
         hal_size_t _minSeqLen;
+
+        // columns of the finer level to choose from, and where to put
+        // those sampled, if building several levels
+        const SampledColumns *_finerColumns;
+        SampledColumns *_sampledColumns;
+
+        // column being evaluated
+        LodColumn _column;
+
+        bool _printPassStats;
     };
 
     inline const LodBlock *LodGraph::getBlock(hal_size_t index) const {
-        return _blocks[index];
+        return &_blockArena[_blocks[index]];
     }
 
     inline hal_size_t LodGraph::getNumBlocks() const {
         return _blocks.size();
     }
 
-    inline const LodGraph::SegmentSet *LodGraph::getSegmentSet(const Sequence *sequence) const {
+    inline const LodSegment *LodGraph::getSegment(hal_index_t index) const {
+        return &_segments[index];
+    }
+
+    inline LodSegment *LodGraph::getSegment(hal_index_t index) {
+        return &_segments[index];
+    }
+
+    inline const LodGraph::SegmentList &LodGraph::getSequenceSegments(const Sequence *sequence) const {
         assert(_seqMap.find(sequence) != _seqMap.end());
-        return _seqMap.find(sequence)->second;
+        return _seqMap.find(sequence)->second._segments;
+    }
+
+    inline const LodGraph::SegmentList &LodGraph::getTelomeres() const {
+        return _telomeres;
     }
 
-    inline const LodBlock *LodGraph::getTelomeres() const {
-        return &_telomeres;
+    inline void LodGraph::setPrintPassStats(bool printPassStats) {
+        _printPassStats = printPassStats;
     }
 }
 
@@ -37,9 +37,17 @@ namespace hal {
         void loadLODFile(const std::string &lodPath, const CLParser *options = NULL);
 
         /** Just use the given HAL file for everything.  Same as if we gave a
-         * lodFile containing only "0 halPath"*/
+         * lodFile containing only "0 halPath", unless it is an mmap file with
+         * levels of detail embedded by halLodEmbed, in which case those are
+         * used, found by their offsets in the file. */
         void loadSingeHALFile(const std::string &halPath, const CLParser *options = NULL);
 
+        /** Embed the levels loaded by loadLODFile, other than 0, in an mmap
+         * HAL file opened for writing, along with the limit on query length.
+         * The file should hold the alignment of level 0, so that the levels
+         * can share its sequences. */
+        void embedLevels(AlignmentPtr alignment);
+
         AlignmentConstPtr getAlignment(hal_size_t queryLength, bool needDNA);
 
         /** Check if query length corresponds to LOD 0 (ie original HAL) */
@@ -59,6 +67,7 @@ namespace hal {
         std::string resolvePath(const std::string &lodPath, const std::string &halPath);
         void checkMap(const std::string &lodPath);
         void checkAlignment(hal_size_t minQuery, const std::string &path, AlignmentConstPtr alignment);
+        void loadEmbeddedLevels(const std::string &halPath);
         void preloadAlignments();
 
         typedef std::pair<std::string, AlignmentConstPtr> PathAlign;
@@ -66,6 +75,8 @@ namespace hal {
 
         const CLParser *_options;
         AlignmentMap _map;
+        // offsets of levels embedded in the file of level 0
+        std::map<hal_size_t, size_t> _embeddedOffsets;
         hal_size_t _maxLodLowerBound;
     };
 
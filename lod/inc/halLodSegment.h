@@ -21,7 +21,7 @@
 namespace hal {
 
     class LodSegment;
-    class LodBlock;
+    class LodSegmentArena;
 
     std::ostream &operator<<(std::ostream &os, const LodSegment &segment);
 
@@ -34,14 +34,18 @@ namespace hal {
      * HAL graph. Segments are oriented (have a head and a tail).  They have
      * a tail adjacency and a head adjacency to connect to other segments on
      * the same sequence.  Segments with head before tail are called flipped.
+     *
+     * Segments are stored in a LodSegmentArena, and refer to their
+     * adjacencies and block by index, so the operations that follow
+     * adjacencies belong to the arena.
      */
     class LodSegment {
+        friend class LodSegmentArena;
         friend std::ostream &operator<<(std::ostream &os, const LodSegment &segment);
 
       public:
         LodSegment();
-        LodSegment(LodBlock *block, const Sequence *sequence, hal_index_t pos, bool flipped);
-        ~LodSegment();
+        LodSegment(hal_index_t block, const Sequence *sequence, hal_index_t pos, bool flipped);
 
         // inline get methods
         const Sequence *getSequence() const;
@@ -51,60 +55,83 @@ namespace hal {
         hal_index_t getRightPos() const;
         bool getFlipped() const;
         hal_size_t getLength() const;
-        const LodSegment *getTailAdj() const;
-        const LodSegment *getHeadAdj() const;
-        hal_size_t getTailAdjLen() const;
-        hal_size_t getHeadAdjLen() const;
-        bool getTailToHead() const;
-        bool getTailToTail() const;
-        bool getHeadToTail() const;
-        bool getHeadToHead() const;
+        /** index of the adjacent segments in the arena, NULL_INDEX
+         * for none */
+        hal_index_t getTailAdj() const;
+        hal_index_t getHeadAdj() const;
         bool overlaps(const LodSegment &other) const;
         hal_index_t getArrayIndex() const;
         void setArrayIndex(hal_index_t index);
-        LodBlock *getBlock() const;
+        /** index of the block in the graph, NULL_INDEX for a telomere */
+        hal_index_t getBlock() const;
 
-        /** Add a new edge from right endpoint of this segment to left
+      protected:
+        const Sequence *_sequence;
+        hal_index_t _tailPos;
+        hal_index_t _afterHeadPos;
+        hal_index_t _tailAdj;
+        hal_index_t _headAdj;
+        hal_index_t _arrayIndex;
+        hal_index_t _block;
+    };
+
+    /* Contiguous storage for the segments of a LodGraph.  Segments are
+     * allocated together rather than one by one, and refer to each other
+     * by index, so the arena can grow without adjacencies being fixed up.
+     * A reference to a segment is only valid until the next is added.
+     */
+    class LodSegmentArena {
+      public:
+        hal_size_t size() const;
+        void clear();
+
+        /** bytes allocated for segments */
+        size_t getMemorySize() const;
+
+        /** Add a segment, returning its index */
+        hal_index_t add(hal_index_t block, const Sequence *sequence, hal_index_t pos, bool flipped);
+
+        LodSegment &operator[](hal_index_t index);
+        const LodSegment &operator[](hal_index_t index) const;
+
+        hal_size_t getTailAdjLen(hal_index_t index) const;
+        hal_size_t getHeadAdjLen(hal_index_t index) const;
+        bool getTailToHead(hal_index_t index) const;
+        bool getTailToTail(hal_index_t index) const;
+        bool getHeadToTail(hal_index_t index) const;
+        bool getHeadToHead(hal_index_t index) const;
+
+        /** Add a new edge from right endpoint of src segment to left
          * endpoint of tgt segment.  (whether or not these endpoints are
          * heads or tails depends on the orientation of the segments)
          */
-        void addEdgeFromRightToLeft(LodSegment *tgt);
+        void addEdgeFromRightToLeft(hal_index_t src, hal_index_t tgt);
 
         /** Extend the segment tail-wards by extLen */
-        void extendTail(hal_size_t extLen);
+        void extendTail(hal_index_t index, hal_size_t extLen);
 
         /** Extend the segment head-wards by extLen */
-        void extendHead(hal_size_t extLen);
+        void extendHead(hal_index_t index, hal_size_t extLen);
 
-        /** Insert a new segment as a head adjacency to this
+        /** Insert a new segment as a head adjacency to a
          * segment. So the head of this will be connected to the
          * tail of the new segment, and the new segment's head
          * will connect to whatever this's head connected to. The
          * new segment will have 0 distance from this segment, and
-         * it's length is given by the parameter.  The new segment
-         * is then returned */
-        LodSegment *insertNewHeadAdj(LodBlock *block, hal_size_t newLen);
-        LodSegment *insertNewTailAdj(LodBlock *block, hal_size_t newLen);
+         * it's length is given by the parameter.  The index of the new
+         * segment is then returned */
+        hal_index_t insertNewHeadAdj(hal_index_t index, hal_index_t block, hal_size_t newLen);
+        hal_index_t insertNewTailAdj(hal_index_t index, hal_index_t block, hal_size_t newLen);
 
-        /** Merge the head adjacency segment to this segment.  That segment
+        /** Merge the head adjacency segment to a segment.  That segment
          * should then get taken out of consideration */
-        void mergeHead();
-
-      protected:
-        /* Find the minimum edge lengths in both directions */
-        void getMinLengths(hal_size_t &rMin, hal_size_t &fMin) const;
+        void mergeHead(hal_index_t index);
 
-        const Sequence *_sequence;
-        hal_index_t _tailPos;
-        hal_index_t _afterHeadPos;
-        LodSegment *_tailAdj;
-        LodSegment *_headAdj;
-        hal_index_t _arrayIndex;
-        LodBlock *_block;
+        /** Print a segment with the lengths of its adjacencies */
+        void print(std::ostream &os, hal_index_t index) const;
 
-      private:
-        LodSegment(const LodSegment &);
-        const LodSegment &operator=(const LodSegment &) const;
+      protected:
+        std::vector<LodSegment> _segments;
     };
 
     inline bool LodSegmentPLess::operator()(const LodSegment *s1, const LodSegment *s2) const {
@@ -141,62 +168,80 @@ namespace hal {
         return (hal_size_t)std::abs(_afterHeadPos - _tailPos);
     }
 
-    inline const LodSegment *LodSegment::getTailAdj() const {
+    inline hal_index_t LodSegment::getTailAdj() const {
         return _tailAdj;
     }
 
-    inline const LodSegment *LodSegment::getHeadAdj() const {
+    inline hal_index_t LodSegment::getHeadAdj() const {
         return _headAdj;
     }
 
-    inline hal_size_t LodSegment::getTailAdjLen() const {
-        assert(_tailAdj != NULL);
-        hal_index_t otherPos = getTailToHead() ? _tailAdj->getHeadPos() : _tailAdj->getTailPos();
-        assert(otherPos > getRightPos() || otherPos < getLeftPos());
-        return (hal_size_t)std::abs(getTailPos() - otherPos) - 1;
+    inline bool LodSegment::overlaps(const LodSegment &other) const {
+        return other.getRightPos() >= getLeftPos() && other.getLeftPos() <= getRightPos();
     }
 
-    inline hal_size_t LodSegment::getHeadAdjLen() const {
-        assert(_headAdj != NULL);
-        hal_index_t otherPos = getHeadToTail() ? _headAdj->getTailPos() : _headAdj->getHeadPos();
-        assert(otherPos > getRightPos() || otherPos < getLeftPos());
-        return (hal_size_t)std::abs(getHeadPos() - otherPos) - 1;
+    inline hal_index_t LodSegment::getArrayIndex() const {
+        return _arrayIndex;
     }
 
-    inline bool LodSegment::getTailToHead() const {
-        assert(_tailAdj != NULL);
-        assert(this == _tailAdj->_headAdj || this == _tailAdj->_tailAdj);
-        return this == _tailAdj->_headAdj;
+    inline void LodSegment::setArrayIndex(hal_index_t index) {
+        _arrayIndex = index;
     }
 
-    inline bool LodSegment::getTailToTail() const {
-        return !getTailToHead();
+    inline hal_index_t LodSegment::getBlock() const {
+        return _block;
     }
 
-    inline bool LodSegment::getHeadToTail() const {
-        assert(_headAdj != NULL);
-        assert(this == _headAdj->_headAdj || this == _headAdj->_tailAdj);
-        return this == _headAdj->_tailAdj;
+    inline hal_size_t LodSegmentArena::size() const {
+        return _segments.size();
     }
 
-    inline bool LodSegment::getHeadToHead() const {
-        return !getHeadToTail();
+    inline LodSegment &LodSegmentArena::operator[](hal_index_t index) {
+        assert(index >= 0 && index < (hal_index_t)_segments.size());
+        return _segments[index];
     }
 
-    inline bool LodSegment::overlaps(const LodSegment &other) const {
-        return other.getRightPos() >= getLeftPos() && other.getLeftPos() <= getRightPos();
+    inline const LodSegment &LodSegmentArena::operator[](hal_index_t index) const {
+        assert(index >= 0 && index < (hal_index_t)_segments.size());
+        return _segments[index];
     }
 
-    inline hal_index_t LodSegment::getArrayIndex() const {
-        return _arrayIndex;
+    inline hal_size_t LodSegmentArena::getTailAdjLen(hal_index_t index) const {
+        const LodSegment &segment = _segments[index];
+        assert(segment._tailAdj != NULL_INDEX);
+        const LodSegment &tailAdj = _segments[segment._tailAdj];
+        hal_index_t otherPos = getTailToHead(index) ? tailAdj.getHeadPos() : tailAdj.getTailPos();
+        assert(otherPos > segment.getRightPos() || otherPos < segment.getLeftPos());
+        return (hal_size_t)std::abs(segment.getTailPos() - otherPos) - 1;
     }
 
-    inline void LodSegment::setArrayIndex(hal_index_t index) {
-        _arrayIndex = index;
+    inline hal_size_t LodSegmentArena::getHeadAdjLen(hal_index_t index) const {
+        const LodSegment &segment = _segments[index];
+        assert(segment._headAdj != NULL_INDEX);
+        const LodSegment &headAdj = _segments[segment._headAdj];
+        hal_index_t otherPos = getHeadToTail(index) ? headAdj.getTailPos() : headAdj.getHeadPos();
+        assert(otherPos > segment.getRightPos() || otherPos < segment.getLeftPos());
+        return (hal_size_t)std::abs(segment.getHeadPos() - otherPos) - 1;
     }
 
-    inline LodBlock *LodSegment::getBlock() const {
-        return _block;
+    inline bool LodSegmentArena::getTailToHead(hal_index_t index) const {
+        const LodSegment &tailAdj = _segments[_segments[index]._tailAdj];
+        assert(index == tailAdj._headAdj || index == tailAdj._tailAdj);
+        return index == tailAdj._headAdj;
+    }
+
+    inline bool LodSegmentArena::getTailToTail(hal_index_t index) const {
+        return !getTailToHead(index);
+    }
+
+    inline bool LodSegmentArena::getHeadToTail(hal_index_t index) const {
+        const LodSegment &headAdj = _segments[_segments[index]._headAdj];
+        assert(index == headAdj._headAdj || index == headAdj._tailAdj);
+        return index == headAdj._tailAdj;
+    }
+
+    inline bool LodSegmentArena::getHeadToHead(hal_index_t index) const {
+        return !getHeadToTail(index);
     }
 }
 
@@ -5,12 +5,15 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include "halBgzfStreamBuf.h"
 #include "halMafBed.h"
 #include "halMafExport.h"
+#include "halMafIndex.h"
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 
 using namespace std;
 using namespace hal;
@@ -63,6 +66,11 @@ static void initParser(CLParser &optionsParser) {
                                 false);
     optionsParser.addOptionFlag("keepEmptyRefBlocks", "keep blocks that contain no reference sequence",
                                 false);
+    optionsParser.addOptionFlag("bgzip", "compress the output in BGZF format, which gzip can read, and (unless "
+                                         "writing to stdout) index the blocks by reference position in "
+                                         "mafFile.idx.  With --append, the existing file must also be BGZF",
+                                false);
+    optionsParser.addOption("compressThreads", "number of threads compressing the output with --bgzip", 2);
 
     optionsParser.setDescription("Convert hal database to maf.");
 }
@@ -90,6 +98,8 @@ class MafOptions {
     bool onlyOrthologs;
     bool keepEmptyRefBlocks;
     hal_index_t maxBlockLen;
+    bool bgzip;
+    hal_size_t compressThreads;
 };
 
 /* This empty string options specified using the old convention of '""' rather than
@@ -173,13 +183,31 @@ static void hal2maf(AlignmentConstPtr alignment, const MafOptions &opts) {
         openFlags |= ios_base::app;
     }
     ofstream mafFileStream;
+    hal_size_t appendOffset = 0;
     if (opts.mafPath != "stdout") {
         mafFileStream.open(opts.mafPath, openFlags);
         if (!mafFileStream) {
             throw hal_exception("Error opening " + opts.mafPath);
         }
+        if (opts.append) {
+            mafFileStream.seekp(0, ios_base::end);
+            appendOffset = mafFileStream.tellp();
+        }
+    }
+    ostream &outStream = opts.mafPath != "stdout" ? mafFileStream : cout;
+
+    unique_ptr<BgzfStreamBuf> bgzfBuf;
+    unique_ptr<ostream> bgzfStream;
+    unique_ptr<MafIndex> mafIndex;
+    if (opts.bgzip) {
+        bgzfBuf.reset(new BgzfStreamBuf(outStream, opts.compressThreads, appendOffset));
+        bgzfStream.reset(new ostream(bgzfBuf.get()));
+        if (opts.mafPath != "stdout") {
+            mafIndex.reset(new MafIndex(*bgzfBuf));
+            mafIndex->open(opts.mafPath + ".idx", opts.append);
+        }
     }
-    ostream &mafStream = opts.mafPath != "stdout" ? mafFileStream : cout;
+    ostream &mafStream = opts.bgzip ? *bgzfStream : outStream;
 
     MafExport mafExport;
     mafExport.setMaxRefGap(opts.maxRefGap);
@@ -192,6 +220,7 @@ static void hal2maf(AlignmentConstPtr alignment, const MafOptions &opts) {
     mafExport.setPrintTree(opts.printTree);
     mafExport.setOnlyOrthologs(opts.onlyOrthologs);
     mafExport.setKeepEmptyRefBlocks(opts.keepEmptyRefBlocks);
+    mafExport.setIndex(mafIndex.get());
 
     if (opts.refTargetsPath != "") {
         hal2mafWithTargets(opts, alignment, refGenome, targetSet, mafExport, mafStream);
@@ -204,14 +233,23 @@ static void hal2maf(AlignmentConstPtr alignment, const MafOptions &opts) {
             mafExport.convertSequence(mafStream, alignment, seqIt->getSequence(), opts.start, opts.length, targetSet);
         }
     }
+    if (opts.bgzip) {
+        bgzfBuf->close();
+        if (mafIndex) {
+            mafIndex->close();
+        }
+    }
     if (opts.mafPath != "stdout") {
         // dont want to leave a size 0 file when there's not ouput because
         // it can make some scripts (ie that process a maf for each contig)
         // obnoxious (presently the case for halPhlyoPTrain which uses
         // hal2mafMP --splitBySequence). FIXME: this can also break stuff that
         // has dependencies, so drop it.
-        if (mafFileStream.tellp() == (streampos)0) {
+        if (mafStream.tellp() == (streampos)0) {
             std::remove(opts.mafPath.c_str());
+            if (mafIndex) {
+                std::remove((opts.mafPath + ".idx").c_str());
+            }
         }
     }
 }
@@ -242,6 +280,8 @@ int main(int argc, char **argv) {
         opts.maxBlockLen = optionsParser.getOption<hal_index_t>("maxBlockLen");
         opts.onlyOrthologs = optionsParser.getFlag("onlyOrthologs");
         opts.keepEmptyRefBlocks = optionsParser.getFlag("keepEmptyRefBlocks");
+        opts.bgzip = optionsParser.getFlag("bgzip");
+        opts.compressThreads = optionsParser.getOption<hal_size_t>("compressThreads");
 
         if (((opts.length != 0) || (opts.start != 0)) && (opts.refSequenceName == "")) {
             throw hal_exception("--start and --length require --refSequenceName");
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halBgzfStreamBuf.h"
+#include <cstring>
+
+using namespace std;
+using namespace hal;
+
+// gzip header with the BC extra field holding the block size, and the crc
+// and uncompressed length that follow the compressed data
+static const size_t HeaderSize = 18;
+static const size_t FooterSize = 8;
+static const size_t MaxBlockSize = 0x10000;
+static const unsigned char blockHeader[HeaderSize] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0};
+
+// empty block that marks the end of a BGZF file
+static const unsigned char eofBlock[28] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0,    0xff, 6, 0, 'B', 'C',
+                                           2,    0,    0x1b, 0, 3, 0, 0, 0, 0, 0,    0, 0, 0, 0};
+
+static void initDeflate(z_stream &zs) {
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw hal_exception("can't initialize zlib compression");
+    }
+}
+
+static void putLittleEndian32(unsigned char *dest, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) {
+        dest[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+BgzfStreamBuf::BgzfStreamBuf(ostream &out, hal_size_t numThreads, hal_size_t fileOffset)
+    : _out(out), _jobs(numThreads == 0 ? 1 : 2 * numThreads + 2), _fill(0), _oldest(0), _numPending(0), _numSubmitted(0),
+      _numWritten(0), _fileOffset(fileOffset), _appendOffset(fileOffset), _dataLength(0), _closed(false), _stop(false) {
+    for (size_t i = 0; i < _jobs.size(); ++i) {
+        _jobs[i]._data.resize(BlockSize);
+        _jobs[i]._compressed.resize(MaxBlockSize);
+        _jobs[i]._state = Free;
+    }
+    setp(_jobs[0]._data.data(), _jobs[0]._data.data() + BlockSize);
+    initDeflate(_zs);
+    for (hal_size_t i = 0; i < numThreads; ++i) {
+        _threads.push_back(thread(&BgzfStreamBuf::compressThread, this));
+    }
+}
+
+BgzfStreamBuf::~BgzfStreamBuf() {
+    stopThreads();
+    deflateEnd(&_zs);
+}
+
+void BgzfStreamBuf::close() {
+    if (_closed) {
+        return;
+    }
+    try {
+        if (_error.empty()) {
+            if (pptr() > pbase()) {
+                submitBlock();
+            }
+            writeDone(0);
+            _out.write((const char *)eofBlock, sizeof(eofBlock));
+            _out.flush();
+            if (!_out) {
+                throw hal_exception("error writing compressed output");
+            }
+        }
+    } catch (exception &e) {
+        _error = e.what();
+    }
+    stopThreads();
+    _closed = true;
+    setp(NULL, NULL);
+    if (!_error.empty()) {
+        throw hal_exception(_error);
+    }
+}
+
+/* errors are kept to be thrown by close(), as the stream only reports that
+ * something went wrong */
+BgzfStreamBuf::int_type BgzfStreamBuf::overflow(int_type c) {
+    if (_closed || !_error.empty()) {
+        return traits_type::eof();
+    }
+    try {
+        submitBlock();
+    } catch (exception &e) {
+        _error = e.what();
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+/* write out the blocks that are ready, but leave the partial block */
+int BgzfStreamBuf::sync() {
+    if (_closed || !_error.empty()) {
+        return -1;
+    }
+    try {
+        writeDone(_numPending);
+    } catch (exception &e) {
+        _error = e.what();
+        return -1;
+    }
+    _out.flush();
+    return _out ? 0 : -1;
+}
+
+/* only telling the position is supported.  It is the uncompressed length
+ * written plus the size of the file appended to, so is zero only if the
+ * file is empty */
+BgzfStreamBuf::pos_type BgzfStreamBuf::seekoff(off_type off, ios_base::seekdir dir, ios_base::openmode which) {
+    if (off != 0 || dir != ios_base::cur || !(which & ios_base::out)) {
+        return pos_type(off_type(-1));
+    }
+    return pos_type(off_type(_appendOffset + _dataLength + (pptr() - pbase())));
+}
+
+void BgzfStreamBuf::submitBlock() {
+    Job &job = _jobs[_fill];
+    job._length = pptr() - pbase();
+    _dataLength += job._length;
+    ++_numSubmitted;
+    if (_threads.empty()) {
+        compressBlock(job, _zs);
+        writeBlock(job);
+    } else {
+        {
+            lock_guard<mutex> lock(_mutex);
+            job._state = Queued;
+            _queue.push_back(&job);
+        }
+        _queued.notify_one();
+        ++_numPending;
+        _fill = (_fill + 1) % _jobs.size();
+        // the next job to fill must be free
+        writeDone(_jobs.size() - 1);
+    }
+    setp(_jobs[_fill]._data.data(), _jobs[_fill]._data.data() + BlockSize);
+}
+
+/* write the compressed blocks in order, waiting for them until no more than
+ * maxPending are left */
+void BgzfStreamBuf::writeDone(size_t maxPending) {
+    while (_numPending > 0) {
+        Job &job = _jobs[_oldest];
+        {
+            unique_lock<mutex> lock(_mutex);
+            if (_numPending > maxPending) {
+                _done.wait(lock, [&job] { return job._state == Done; });
+            } else if (job._state != Done) {
+                return;
+            }
+        }
+        writeBlock(job);
+        {
+            lock_guard<mutex> lock(_mutex);
+            job._state = Free;
+        }
+        _oldest = (_oldest + 1) % _jobs.size();
+        --_numPending;
+    }
+}
+
+void BgzfStreamBuf::writeBlock(Job &job) {
+    if (!job._error.empty()) {
+        throw hal_exception(job._error);
+    }
+    _out.write((const char *)job._compressed.data(), job._compressedLength);
+    if (!_out) {
+        throw hal_exception("error writing compressed output");
+    }
+    if (_blockWritten) {
+        _blockWritten(_numWritten, _fileOffset);
+    }
+    ++_numWritten;
+    _fileOffset += job._compressedLength;
+}
+
+void BgzfStreamBuf::compressThread() {
+    z_stream zs;
+    string initError;
+    try {
+        initDeflate(zs);
+    } catch (exception &e) {
+        initError = e.what();
+    }
+    for (;;) {
+        Job *job;
+        {
+            unique_lock<mutex> lock(_mutex);
+            _queued.wait(lock, [this] { return _stop || !_queue.empty(); });
+            if (_queue.empty()) {
+                break;
+            }
+            job = _queue.front();
+            _queue.pop_front();
+        }
+        if (initError.empty()) {
+            compressBlock(*job, zs);
+        } else {
+            job->_error = initError;
+        }
+        {
+            lock_guard<mutex> lock(_mutex);
+            job->_state = Done;
+        }
+        _done.notify_one();
+    }
+    if (initError.empty()) {
+        deflateEnd(&zs);
+    }
+}
+
+void BgzfStreamBuf::compressBlock(Job &job, z_stream &zs) {
+    unsigned char *block = job._compressed.data();
+    int ret;
+    // data that doesn't compress to fit in a block is stored instead
+    for (int level = Z_DEFAULT_COMPRESSION;; level = Z_NO_COMPRESSION) {
+        deflateReset(&zs);
+        deflateParams(&zs, level, Z_DEFAULT_STRATEGY);
+        zs.next_in = (Bytef *)job._data.data();
+        zs.avail_in = job._length;
+        zs.next_out = block + HeaderSize;
+        zs.avail_out = MaxBlockSize - HeaderSize - FooterSize;
+        ret = deflate(&zs, Z_FINISH);
+        if (ret == Z_STREAM_END || level == Z_NO_COMPRESSION) {
+            break;
+        }
+    }
+    if (ret != Z_STREAM_END) {
+        job._error = "error compressing block";
+        return;
+    }
+    size_t blockLength = HeaderSize + zs.total_out + FooterSize;
+    memcpy(block, blockHeader, HeaderSize);
+    block[16] = (blockLength - 1) & 0xff;
+    block[17] = (blockLength - 1) >> 8;
+    putLittleEndian32(block + HeaderSize + zs.total_out, crc32(crc32(0, Z_NULL, 0), (const Bytef *)job._data.data(), job._length));
+    putLittleEndian32(block + HeaderSize + zs.total_out + 4, job._length);
+    job._compressedLength = blockLength;
+}
+
+void BgzfStreamBuf::stopThreads() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _queued.notify_all();
+    for (size_t i = 0; i < _threads.size(); ++i) {
+        _threads[i].join();
+    }
+    _threads.clear();
+}
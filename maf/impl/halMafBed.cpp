@@ -22,7 +22,7 @@ MafBed::~MafBed() {
 }
 
 void MafBed::visitLine() {
-    const Sequence *refSequence = _refGenome->getSequence(_bedLine._chrName);
+    const Sequence *refSequence = getChromSequence(_refGenome);
     if (refSequence == NULL) {
         cerr << "Line " << _lineNumber << ": BED sequence " << _bedLine._chrName << " not found in genome "
              << _refGenome->getName() << '\n';
@@ -15,7 +15,8 @@ using namespace hal;
 
 const hal_index_t MafBlock::defaultMaxLength = 1000;
 
-MafBlock::MafBlock(hal_index_t maxLength) : _maxLength(maxLength), _fullNames(false), _tree(NULL) {
+MafBlock::MafBlock(hal_index_t maxLength)
+    : _reference(NULL), _maxLength(maxLength), _refIndex(NULL_INDEX), _fullNames(false), _printTree(false), _tree(NULL) {
     if (_maxLength <= 0) {
         _maxLength = numeric_limits<hal_index_t>::max();
     }
@@ -28,7 +29,7 @@ MafBlock::~MafBlock() {
     for (size_t j = 0; j < _stringBuffers.size(); ++j) {
         delete _stringBuffers[j];
     }
-    if (_printTree && _tree != NULL) {
+    if (_tree != NULL) {
         stTree_destruct(_tree);
     }
 }
@@ -78,15 +79,15 @@ void MafBlock::resetEntries() {
     }
 }
 
-void MafBlock::initEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIteratorPtr dna, bool clearSequence) {
-    string sequenceName = getName(sequence);
-    if (entry->_name != sequenceName || sequence->getGenome() != entry->_genome) {
-        // replace genearl sequence information
-        entry->_name = sequenceName;
+void MafBlock::initEntry(MafBlockEntry *entry, const Sequence *sequence, const DnaIterator *dna, bool clearSequence) {
+    // entries are keyed on their sequence, so the name only needs to be
+    // made when the entry is new (initBlock() redoes it if fullNames changes)
+    if (entry->_genome == NULL) {
+        entry->_name = getName(sequence);
         entry->_genome = sequence->getGenome();
         entry->_srcLength = (hal_index_t)sequence->getSequenceLength();
     }
-    if (dna.get()) {
+    if (dna != NULL) {
         // update start position from the iterator
         entry->_start = dna->getArrayIndex() - sequence->getStartPosition();
         entry->_length = 0;
@@ -106,12 +107,11 @@ void MafBlock::initEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIter
     entry->_tree = NULL;
 }
 
-inline void MafBlock::updateEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIteratorPtr dna) {
-    if (dna.get() != NULL) {
+inline void MafBlock::updateEntry(MafBlockEntry *entry, const Sequence *sequence, const DnaIterator *dna) {
+    if (dna != NULL) {
         if (entry->_start == NULL_INDEX) {
             initEntry(entry, sequence, dna, false);
         }
-        assert(entry->_name == getName(sequence));
         assert(entry->_strand == (dna->getReversed() ? '-' : '+'));
         assert(entry->_srcLength == (hal_index_t)sequence->getSequenceLength());
 
@@ -236,7 +236,7 @@ void MafBlock::buildTreeR(BottomSegmentIteratorPtr botIt, stTree *tree, bool mod
     }
 }
 
-stTree *MafBlock::buildTree(ColumnIteratorPtr colIt, bool modifyEntries) {
+stTree *MafBlock::buildTree(const ColumnIteratorPtr &colIt, bool modifyEntries) {
     // Get any base from the column to begin building the tree
     const ColumnMap *colMap = colIt->getColumnMap();
     ColumnMap::const_iterator colMapIt = colMap->begin();
@@ -291,12 +291,18 @@ stTree *MafBlock::buildTree(ColumnIteratorPtr colIt, bool modifyEntries) {
     return tree;
 }
 
-void MafBlock::initBlock(ColumnIteratorPtr col, bool fullNames, bool printTree) {
-    if (printTree && _tree != NULL) {
+void MafBlock::initBlock(const ColumnIteratorPtr &col, bool fullNames, bool printTree) {
+    if (_tree != NULL) {
         stTree_destruct(_tree);
+        _tree = NULL;
     }
     resetEntries();
-    _fullNames = fullNames;
+    if (fullNames != _fullNames) {
+        _fullNames = fullNames;
+        for (Entries::iterator i = _entries.begin(); i != _entries.end(); ++i) {
+            i->second->_name = getName(i->first);
+        }
+    }
     _printTree = printTree;
     const ColumnMap *colMap = col->getColumnMap();
     Entries::iterator e = _entries.begin();
@@ -312,13 +318,12 @@ void MafBlock::initBlock(ColumnIteratorPtr col, bool fullNames, bool printTree)
         if (c->second->empty()) {
             e = _entries.lower_bound(sequence);
             if (e == _entries.end() || e->first != sequence) {
-                MafBlockEntry *entry = new MafBlockEntry(_stringBuffers);
-                initEntry(entry, sequence, DnaIteratorPtr());
+                MafBlockEntry *entry = new MafBlockEntry(_stringBuffers, entryCapacity());
+                initEntry(entry, sequence, NULL);
                 e = _entries.insert(Entries::value_type(sequence, entry));
             } else {
                 assert(e->first == sequence);
-                assert(e->second->_name == getName(sequence));
-                initEntry(e->second, sequence, DnaIteratorPtr());
+                initEntry(e->second, sequence, NULL);
             }
         }
 
@@ -338,12 +343,11 @@ void MafBlock::initBlock(ColumnIteratorPtr col, bool fullNames, bool printTree)
                     }
                 }
                 if (e == _entries.end()) {
-                    MafBlockEntry *entry = new MafBlockEntry(_stringBuffers);
-                    initEntry(entry, sequence, *d);
-                    assert(entry->_name == getName(sequence));
+                    MafBlockEntry *entry = new MafBlockEntry(_stringBuffers, entryCapacity());
+                    initEntry(entry, sequence, d->get());
                     e = _entries.insert(Entries::value_type(sequence, entry));
                 } else {
-                    initEntry(e->second, sequence, *d);
+                    initEntry(e->second, sequence, d->get());
                 }
                 ++e;
             }
@@ -367,7 +371,7 @@ void MafBlock::initBlock(ColumnIteratorPtr col, bool fullNames, bool printTree)
     }
 }
 
-void MafBlock::appendColumn(ColumnIteratorPtr col) {
+void MafBlock::appendColumn(const ColumnIteratorPtr &col) {
     const ColumnMap *colMap = col->getColumnMap();
     Entries::iterator e = _entries.begin();
     ColumnMap::const_iterator c = colMap->begin();
@@ -378,19 +382,18 @@ void MafBlock::appendColumn(ColumnIteratorPtr col) {
         sequence = c->first;
         for (d = c->second->begin(); d != c->second->end(); ++d) {
             while (e->first != sequence && e != _entries.end()) {
-                updateEntry(e->second, NULL, DnaIteratorPtr());
+                updateEntry(e->second, NULL, NULL);
                 ++e;
             }
             assert(e != _entries.end());
             assert(e->first == sequence);
-            assert(e->second->_name == getName(sequence));
-            updateEntry(e->second, sequence, *d);
+            updateEntry(e->second, sequence, d->get());
             ++e;
         }
     }
 
     for (; e != _entries.end(); ++e) {
-        updateEntry(e->second, NULL, DnaIteratorPtr());
+        updateEntry(e->second, NULL, NULL);
     }
 }
 
@@ -398,7 +401,7 @@ void MafBlock::appendColumn(ColumnIteratorPtr col) {
 // A: When for every sequence already in the column, the new column
 //    has either a gap or a contigugous base.  The new column also has
 //    no new sequences.
-bool MafBlock::canAppendColumn(ColumnIteratorPtr col) {
+bool MafBlock::canAppendColumn(const ColumnIteratorPtr &col) {
     const ColumnMap *colMap = col->getColumnMap();
     Entries::iterator e = _entries.begin();
     ColumnMap::const_iterator c;
@@ -421,7 +424,7 @@ bool MafBlock::canAppendColumn(ColumnIteratorPtr col) {
             } else {
                 entry = e->second;
                 assert(e->first == sequence);
-                assert(entry->_name == getName(sequence) && entry->_genome == sequence->getGenome());
+                assert(entry->_genome == sequence->getGenome());
                 if (entry->_start != NULL_INDEX) {
                     if (entry->_length >= _maxLength ||
                         (entry->_length > 0 && (entry->_strand == '-') != (*d)->getReversed())) {
@@ -469,63 +472,79 @@ istream &hal::operator>>(istream &is, MafBlockEntry &mafBlockEntry) {
     return is;
 }
 
-static void printTreeEntries(stTree *tree, ostream &os) {
+void MafBlock::takeRow(MafBlockEntry *entry, hal_index_t start, MafBlockRows &rows) {
+    if (rows._numRows == rows._rows.size()) {
+        rows._rows.push_back(MafBlockRows::Row());
+        rows._rows.back()._sequence = new MafBlockString(entryCapacity());
+    }
+    if (entry == _reference) {
+        rows._referenceRow = rows._numRows;
+    }
+    MafBlockRows::Row &row = rows._rows[rows._numRows++];
+    row._name = entry->_name;
+    row._start = start;
+    row._length = entry->_length;
+    row._strand = entry->_strand;
+    row._srcLength = entry->_srcLength;
+    swap(row._sequence, entry->_sequence);
+    entry->_sequence->clear();
+}
+
+// rows are taken in post order
+void MafBlock::takeTreeRows(stTree *tree, MafBlockRows &rows) {
     for (int64_t i = 0; i < stTree_getChildNumber(tree); i++) {
-        stTree *child = stTree_getChild(tree, i);
-        printTreeEntries(child, os);
+        takeTreeRows(stTree_getChild(tree, i), rows);
     }
     MafBlockEntry *entry = (MafBlockEntry *)stTree_getClientData(tree);
     if (entry != NULL) {
         // The entry can be null if --noAncestors is enabled.
-        os << *entry;
+        takeRow(entry, entry->_start, rows);
     }
 }
 
-ostream &MafBlock::printBlockWithTree(ostream &os) const {
-    // Sort tree so that the reference comes first.
-    prioritizeNodeInTree(_reference->_tree);
-
-    // Print tree as a block comment.
-    char *treeString = stTree_getNewickTreeString(_tree);
-    os << "a tree=\"" << treeString << "\"\n";
-
-    // Print entries in post order.
-    printTreeEntries(_tree, os);
-
-    return os;
-}
-
 // todo: fast way of reference first.
-ostream &MafBlock::printBlock(ostream &os) const {
-    os << "a\n";
-
+void MafBlock::takeRows(MafBlockRows &rows) {
     assert(_reference != NULL);
-    if (_reference->_start == NULL_INDEX) {
-        if (_refIndex != NULL_INDEX) {
-            _reference->_start = _refIndex;
-            os << *_reference;
-            _reference->_start = NULL_INDEX;
-        }
+    rows._numRows = 0;
+    rows._referenceRow = numeric_limits<size_t>::max();
+    rows._tree.clear();
+    if (_printTree) {
+        // Sort tree so that the reference comes first.
+        prioritizeNodeInTree(_reference->_tree);
+        char *treeString = stTree_getNewickTreeString(_tree);
+        rows._tree = treeString;
+        free(treeString);
+        takeTreeRows(_tree, rows);
     } else {
-        os << *_reference;
-    }
+        if (_reference->_start == NULL_INDEX) {
+            if (_refIndex != NULL_INDEX) {
+                takeRow(_reference, _refIndex, rows);
+            }
+        } else {
+            takeRow(_reference, _reference->_start, rows);
+        }
 
-    for (Entries::const_iterator e = _entries.begin(); e != _entries.end(); ++e) {
-        if ((e->second->_start != NULL_INDEX) && (e->second != _reference)) {
-            os << *e->second;
+        for (Entries::const_iterator e = _entries.begin(); e != _entries.end(); ++e) {
+            if ((e->second->_start != NULL_INDEX) && (e->second != _reference)) {
+                takeRow(e->second, e->second->_start, rows);
+            }
         }
     }
-    return os;
+    rows._referenceRow = min(rows._referenceRow, rows._numRows);
 }
 
-ostream &hal::operator<<(ostream &os, const MafBlock &mafBlock) {
-    if (mafBlock._printTree) {
-        return mafBlock.printBlockWithTree(os);
+TextWriter &hal::operator<<(TextWriter &os, const MafBlockRows &mafBlockRows) {
+    if (mafBlockRows._tree.empty()) {
+        os << "a\n";
     } else {
-        return mafBlock.printBlock(os);
+        os << "a tree=\"" << mafBlockRows._tree << "\"\n";
     }
-}
-
-istream &hal::operator>>(istream &is, MafBlock &mafBlock) {
-    return is;
+    for (size_t i = 0; i < mafBlockRows._numRows; ++i) {
+        const MafBlockRows::Row &row = mafBlockRows._rows[i];
+        os << "s\t" << row._name << '\t' << row._start << '\t' << row._length << '\t' << row._strand << '\t'
+           << row._srcLength << '\t';
+        os.write(row._sequence->str(), row._sequence->length());
+        os << '\n';
+    }
+    return os;
 }
@@ -12,6 +12,94 @@
 using namespace std;
 using namespace hal;
 
+MafBlockQueue::MafBlockQueue(size_t size) : _closed(true), _failed(false) {
+    for (size_t i = 0; i < size; ++i) {
+        _allRows.push_back(new MafBlockRows());
+    }
+}
+
+MafBlockQueue::~MafBlockQueue() {
+    for (size_t i = 0; i < _allRows.size(); ++i) {
+        delete _allRows[i];
+    }
+}
+
+void MafBlockQueue::open() {
+    lock_guard<mutex> lock(_mutex);
+    _free.assign(_allRows.begin(), _allRows.end());
+    _full.clear();
+    _closed = false;
+    _failed = false;
+}
+
+MafBlockRows *MafBlockQueue::getFree() {
+    unique_lock<mutex> lock(_mutex);
+    _freeReady.wait(lock, [this] { return !_free.empty() || _failed; });
+    if (_failed) {
+        throw hal_exception("error writing maf");
+    }
+    MafBlockRows *rows = _free.front();
+    _free.pop_front();
+    return rows;
+}
+
+void MafBlockQueue::put(MafBlockRows *rows) {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _full.push_back(rows);
+    }
+    _fullReady.notify_one();
+}
+
+void MafBlockQueue::close() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _closed = true;
+    }
+    _fullReady.notify_one();
+}
+
+void MafBlockQueue::write(ostream &os, MafIndex *index) {
+    TextWriter out(os);
+    try {
+        for (;;) {
+            MafBlockRows *rows;
+            {
+                unique_lock<mutex> lock(_mutex);
+                _fullReady.wait(lock, [this] { return !_full.empty() || _closed; });
+                if (_full.empty()) {
+                    break;
+                }
+                rows = _full.front();
+                _full.pop_front();
+            }
+            if (index != NULL && rows->_referenceRow < rows->_numRows) {
+                const MafBlockRows::Row &ref = rows->_rows[rows->_referenceRow];
+                if (ref._start != NULL_INDEX) {
+                    // the index needs the stream's position at the start of the block
+                    out.writeBuffered();
+                    hal_index_t start = ref._strand == '-' ? ref._srcLength - ref._start - ref._length : ref._start;
+                    index->addBlock(ref._name, start, start + ref._length);
+                }
+            }
+            out << *rows << '\n';
+            {
+                lock_guard<mutex> lock(_mutex);
+                _free.push_back(rows);
+            }
+            _freeReady.notify_one();
+        }
+        out.flush();
+    } catch (...) {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _failed = true;
+        }
+        _freeReady.notify_one();
+        throw;
+    }
+}
+
 void MafExport::writeHeader() {
     assert(_mafStream != NULL);
     // sometimes tellp() returns -1
@@ -22,6 +110,32 @@ void MafExport::writeHeader() {
     }
 }
 
+void MafExport::writeBlock() {
+    MafBlockRows *rows = _blockQueue.getFree();
+    _mafBlock.takeRows(*rows);
+    _blockQueue.put(rows);
+}
+
+/* run buildBlocks on a second thread while this one writes the blocks it
+ * passes to writeBlock() */
+void MafExport::runPipeline(const function<void()> &buildBlocks) {
+    _blockQueue.open();
+    runThreads(2, [this, &buildBlocks](hal_size_t threadNum) {
+        if (threadNum == 0) {
+            _blockQueue.write(*_mafStream, _index);
+        } else {
+            try {
+                buildBlocks();
+            } catch (...) {
+                _blockQueue.close();
+                throw;
+            }
+            _blockQueue.close();
+        }
+    });
+    _mafStream->flush();
+}
+
 void MafExport::convertSequence(ostream &mafStream, AlignmentConstPtr alignment, const Sequence *seq, hal_index_t startPosition,
                                 hal_size_t length, const set<const Genome *> &targets) {
     assert(seq != NULL);
@@ -47,7 +161,10 @@ void MafExport::convertSequence(ostream &mafStream, AlignmentConstPtr alignment,
                                                      false, // reverseStrand,
                                                      _unique,
                                                      _onlyOrthologs);
+    runPipeline([this, &colIt] { convertSequenceBlocks(colIt); });
+}
 
+void MafExport::convertSequenceBlocks(const ColumnIteratorPtr &colIt) {
     hal_size_t appendCount = 0;
     if (_unique == false || colIt->isCanonicalOnRef() == true) {
         _mafBlock.initBlock(colIt, _ucscNames, _printTree);
@@ -70,7 +187,7 @@ void MafExport::convertSequence(ostream &mafStream, AlignmentConstPtr alignment,
                     colIt->defragment();
                 }
                 if ((appendCount > 0) and (_keepEmptyRefBlocks or (not _mafBlock.referenceIsAllGaps()))) {
-                    mafStream << _mafBlock << '\n';
+                    writeBlock();
                 }
                 _mafBlock.initBlock(colIt, _ucscNames, _printTree);
                 assert(_mafBlock.canAppendColumn(colIt) == true);
@@ -83,21 +200,24 @@ void MafExport::convertSequence(ostream &mafStream, AlignmentConstPtr alignment,
     // all columns violate unique), mafBlock ostream operator will crash
     // so we do following check
     if ((appendCount > 0) and (_keepEmptyRefBlocks or (not _mafBlock.referenceIsAllGaps()))) {
-        mafStream << _mafBlock << endl;
+        writeBlock();
     }
 }
 
 void MafExport::convertEntireAlignment(ostream &mafStream, AlignmentConstPtr alignment) {
-    hal_size_t appendCount = 0;
-    size_t numBlocks = 0;
-
     _mafStream = &mafStream;
     _alignment = alignment;
 
     writeHeader();
+    runPipeline([this] { convertEntireAlignmentBlocks(); });
+}
+
+void MafExport::convertEntireAlignmentBlocks() {
+    hal_size_t appendCount = 0;
+    size_t numBlocks = 0;
 
     // Load in all leaves from alignment
-    vector<const Genome *> leafGenomes = getLeafGenomes(alignment.get());
+    vector<const Genome *> leafGenomes = getLeafGenomes(_alignment.get());
 
     ColumnIterator::VisitCache visitCache;
     // Go through all the genomes one by one, and spit out any columns
@@ -124,7 +244,7 @@ void MafExport::convertEntireAlignment(ostream &mafStream, AlignmentConstPtr ali
                     colIt->defragment();
                 }
                 if (appendCount > 0) {
-                    mafStream << _mafBlock << '\n';
+                    writeBlock();
                 }
                 _mafBlock.initBlock(colIt, _ucscNames, _printTree);
                 assert(_mafBlock.canAppendColumn(colIt) == true);
@@ -153,6 +273,6 @@ void MafExport::convertEntireAlignment(ostream &mafStream, AlignmentConstPtr ali
     // all columns violate unique), mafBlock ostream operator will crash
     // so we do following check
     if (appendCount > 0) {
-        mafStream << _mafBlock << endl;
+        writeBlock();
     }
 }
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halMafIndex.h"
+#include <algorithm>
+
+using namespace std;
+using namespace hal;
+
+MafIndex::MafIndex(BgzfStreamBuf &bgzf) : _bgzf(bgzf) {
+    _bgzf.setBlockWritten(
+        [this](hal_size_t blockNumber, hal_size_t fileOffset) { blockWritten(blockNumber, fileOffset); });
+}
+
+void MafIndex::open(const string &path, bool append) {
+    _path = path;
+    _file.open(path.c_str(), append ? ios_base::app : ios_base::out);
+    if (!_file) {
+        throw hal_exception("Error opening " + path);
+    }
+    // sometimes tellp() returns -1
+    if (_file.tellp() <= streampos(0)) {
+        _file << "#sequence\tstart\tend\tvirtualOffset\n";
+    }
+}
+
+void MafIndex::addBlock(const string &sequenceName, hal_index_t start, hal_index_t end) {
+    hal_size_t blockNumber = _bgzf.getBlockNumber();
+    if (!_pending.empty() && _pending.back()._blockNumber == blockNumber &&
+        _pending.back()._sequenceName == sequenceName) {
+        Entry &entry = _pending.back();
+        entry._start = min(entry._start, start);
+        entry._end = max(entry._end, end);
+    } else {
+        Entry entry = {sequenceName, start, end, blockNumber, _bgzf.getBlockOffset()};
+        _pending.push_back(entry);
+    }
+}
+
+void MafIndex::blockWritten(hal_size_t blockNumber, hal_size_t fileOffset) {
+    while (!_pending.empty() && _pending.front()._blockNumber == blockNumber) {
+        const Entry &entry = _pending.front();
+        _file << entry._sequenceName << '\t' << entry._start << '\t' << entry._end << '\t'
+              << ((fileOffset << 16) | entry._blockOffset) << '\n';
+        _pending.pop_front();
+    }
+}
+
+void MafIndex::close() {
+    if (!_pending.empty()) {
+        throw hal_exception("MAF index closed before all its blocks were written");
+    }
+    _file.close();
+    if (!_file) {
+        throw hal_exception("Error writing " + _path);
+    }
+}
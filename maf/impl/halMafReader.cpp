@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+#include "halMafReader.h"
+#include <climits>
+#include <cstring>
+
+using namespace std;
+using namespace hal;
+
+const size_t MafReader::InitialBufferSize = 16 * 1024 * 1024;
+
+MafReader::MafReader() : _file(NULL), _keep(0), _next(0), _end(0), _bufferOffset(0), _lineOffset(0), _moved(0), _eof(true) {
+}
+
+MafReader::~MafReader() {
+    close();
+}
+
+void MafReader::open(const string &path) {
+    close();
+    // zlib reads uncompressed files as they are
+    _file = gzopen(path.c_str(), "rb");
+    if (_file == NULL) {
+        throw hal_exception("error opening path: " + path);
+    }
+    gzbuffer(_file, 1024 * 1024);
+    _path = path;
+    _buffer.resize(InitialBufferSize);
+    _keep = _next = _end = 0;
+    _bufferOffset = _lineOffset = 0;
+    _moved = 0;
+    _eof = false;
+}
+
+void MafReader::close() {
+    if (_file != NULL) {
+        gzclose(_file);
+        _file = NULL;
+    }
+    _eof = true;
+}
+
+bool MafReader::readLine(char *&line, size_t &length) {
+    const char *kept = _buffer.data() + _keep;
+    _moved = 0;
+    char *newline;
+    while ((newline = (char *)memchr(_buffer.data() + _next, '\n', _end - _next)) == NULL) {
+        if (_eof) {
+            if (_next == _end) {
+                return false;
+            }
+            // last line has no newline
+            newline = _buffer.data() + _end;
+            break;
+        }
+        fill();
+        _moved = _buffer.data() + _keep - kept;
+    }
+    line = _buffer.data() + _next;
+    length = newline - line;
+    _lineOffset = _bufferOffset + _next;
+    _next = min(_end, _next + length + 1);
+    return true;
+}
+
+/* move the kept lines to the front of the buffer, growing it if they fill
+ * it, and read as much as fits after them */
+void MafReader::fill() {
+    if (_keep > 0) {
+        memmove(_buffer.data(), _buffer.data() + _keep, _end - _keep);
+        _next -= _keep;
+        _end -= _keep;
+        _bufferOffset += _keep;
+        _keep = 0;
+    }
+    if (_end == _buffer.size()) {
+        _buffer.resize(_buffer.size() * 2);
+    }
+    int bytesRead = gzread(_file, _buffer.data() + _end, (unsigned)min(_buffer.size() - _end, (size_t)INT_MAX));
+    if (bytesRead < 0) {
+        int errnum;
+        throw hal_exception("error reading " + _path + ": " + gzerror(_file, &errnum));
+    }
+    _end += bytesRead;
+    _eof = bytesRead == 0;
+}
@@ -49,9 +49,8 @@ void MafScanDimensions::sLine() {
     Row &row = _block[_rows - 1];
 
     // this is the first pass.  so we do a quick sanity check
-    size_t dotPos = row._sequenceName.find('.');
-    if (dotPos == string::npos || dotPos == 0 || dotPos == row._sequenceName.length() - 1) {
-        throw hal_exception("illegal sequence name found: " + row._sequenceName +
+    if (row._name->_genomeName.empty()) {
+        throw hal_exception("illegal sequence name found: " + row._name->_fullName +
                             ".  Sequence "
                             "names must be in genomeName.sequenceName format.");
     }
@@ -62,7 +61,7 @@ void MafScanDimensions::sLine() {
             ++numGaps;
         } else {
             if (!isNucleotide(row._line[i])) {
-                throw hal_exception("problem reading line for sequence " + row._sequenceName +
+                throw hal_exception("problem reading line for sequence " + row._name->_fullName +
                                     ": non-gap non-nucleotide character " + row._line[i] + " found at " + std::to_string(i) +
                                     "th position");
             }
@@ -70,13 +69,13 @@ void MafScanDimensions::sLine() {
     }
 
     if (row._line.length() - numGaps != row._length) {
-        throw hal_exception("problem reading line for sequence " + row._sequenceName + ": length field was " +
+        throw hal_exception("problem reading line for sequence " + row._name->_fullName + ": length field was " +
                             std::to_string(row._length) + " but line contains " + std::to_string(row._line.length() - numGaps) +
                             " bases");
     }
 
     if (row._startPosition + row._length > row._srcLength) {
-        throw hal_exception("problem reading line for sequence " + row._sequenceName + ": sequence length is" +
+        throw hal_exception("problem reading line for sequence " + row._name->_fullName + ": sequence length is" +
                             std::to_string(row._srcLength) + " but line starts at " + std::to_string(row._startPosition) +
                             " and contains " + std::to_string(row._length) + " bases");
     }
@@ -94,7 +93,7 @@ void MafScanDimensions::updateDimensionsFromBlock() {
     size_t length = _block[0]._line.length();
     for (size_t i = 0; i < _rows; ++i) {
         Row &row = _block[i];
-        pair<string, Record *> newRec(row._sequenceName, NULL);
+        pair<string, Record *> newRec(row._name->_fullName, NULL);
         pair<DimMap::iterator, bool> result = _dimMap.insert(newRec);
         Record *&rec = result.first->second;
         pair<hal_size_t, ArrayInfo> startIndex;
@@ -105,7 +104,7 @@ void MafScanDimensions::updateDimensionsFromBlock() {
         startIndex.second._empty = 0;
         if (result.second == false && row._srcLength != rec->_length) {
             assert(rec != NULL);
-            throw hal_exception("conflicting length for sequence " + row._sequenceName + ": " + "was scanned once as " +
+            throw hal_exception("conflicting length for sequence " + row._name->_fullName + ": " + "was scanned once as " +
                                 std::to_string(row._srcLength) + " then again as " + std::to_string(rec->_length));
         } else if (result.second == true) {
             rec = new Record();
@@ -177,7 +176,7 @@ void MafScanDimensions::updateDimensionsFromBlock() {
                 if (smResult.second == true) {
                     rec->_startMap.erase(smIt);
                 }
-                rec->_badPosSet.insert(FilePosition(_mafFile.tellg(), i));
+                rec->_badPosSet.insert(FilePosition(_blockOffset, i));
             } else {
                 smIt->second._empty = 0;
                 assert(smIt->second._count == 1);
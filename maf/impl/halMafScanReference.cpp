@@ -30,13 +30,13 @@ void MafScanReference::aLine() {
 void MafScanReference::sLine() {
     Row &row = _block[_rows - 1];
     // this is the first pass.  so we do a quick sanity check
-    if (row._sequenceName.find('.') == string::npos || row._sequenceName.find('.') == 0) {
-        throw hal_exception("illegal sequence name found: " + row._sequenceName +
+    if (row._name->_fullName.find('.') == string::npos || row._name->_fullName.find('.') == 0) {
+        throw hal_exception("illegal sequence name found: " + row._name->_fullName +
                             ".  Sequence names must be in genomeName.sequenceName format.");
     }
 
-    _name = genomeName(row._sequenceName);
-    _mafFile.seekg(0, ios_base::end);
+    _name = genomeName(row._name->_fullName);
+    stopScan();
 }
 
 void MafScanReference::end() {
@@ -14,7 +14,55 @@
 using namespace std;
 using namespace hal;
 
-MafScanner::MafScanner() {
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/* find the next whitespace separated token in [pos, end), leaving pos after
+ * it */
+static bool nextToken(char *&pos, char *end, char *&token, size_t &tokenLength) {
+    while (pos < end && isBlank(*pos)) {
+        ++pos;
+    }
+    token = pos;
+    while (pos < end && !isBlank(*pos)) {
+        ++pos;
+    }
+    tokenLength = pos - token;
+    return tokenLength > 0;
+}
+
+/* the alignment text is the rest of the line, so it is found from the ends
+ * rather than scanned */
+static bool lastToken(char *pos, char *end, char *&token, size_t &tokenLength) {
+    while (pos < end && isBlank(*pos)) {
+        ++pos;
+    }
+    while (end > pos && isBlank(end[-1])) {
+        --end;
+    }
+    token = pos;
+    tokenLength = end - pos;
+    return tokenLength > 0;
+}
+
+static bool nextSize(char *&pos, char *end, hal_size_t &value) {
+    char *token;
+    size_t tokenLength;
+    if (!nextToken(pos, end, token, tokenLength)) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < tokenLength; ++i) {
+        if (token[i] < '0' || token[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (token[i] - '0');
+    }
+    return true;
+}
+
+MafScanner::MafScanner() : _numSpilledNames(0) {
 }
 
 MafScanner::~MafScanner() {
@@ -22,66 +70,237 @@ MafScanner::~MafScanner() {
 
 void MafScanner::scan(const string &mafFilePath, const set<string> &targets) {
     _targets = targets;
-    _mafFile.open(mafFilePath.c_str());
+    _names.clear();
+    _nameList.clear();
+    _mafFile.open(mafFilePath);
     _numBlocks = 0;
-
-    if (!_mafFile) {
-        throw runtime_error("error opening path: " + mafFilePath);
+    _stop = false;
+    if (!_spillPath.empty()) {
+        _spillFile.open(_spillPath.c_str(), ios::binary | ios::trunc);
+        if (!_spillFile) {
+            throw hal_exception("error opening spill file: " + _spillPath);
+        }
+        _numSpilledNames = 0;
+        _spillRows.clear();
+        _spillText.clear();
     }
 
     _rows = 0;
     _block.clear();
-    string buffer;
-    while (!_mafFile.eof() && _mafFile.good()) {
-        buffer.clear();
-        _mafFile >> buffer;
-        if (buffer == "a") {
+    char *line;
+    size_t length;
+    while (!_stop && _mafFile.readLine(line, length)) {
+        if (_mafFile.getMoved() != 0) {
+            for (size_t i = 0; i < _rows; ++i) {
+                _block[i]._line._data += _mafFile.getMoved();
+            }
+        }
+        char *pos = line;
+        char *token;
+        size_t tokenLength;
+        nextToken(pos, line + length, token, tokenLength);
+        if (tokenLength == 1 && token[0] == 'a') {
             if (_rows > 0) {
+                _blockOffset = _mafFile.getLineOffset();
+                spillBlock();
                 updateMask();
                 aLine();
                 ++_numBlocks;
-                nextLine();
             }
             _rows = 0;
-        } else if (buffer == "s") {
+        } else if (tokenLength == 1 && token[0] == 's') {
             ++_rows;
             if (_rows > _block.size()) {
                 _block.resize(_rows);
             }
             Row &row = _block[_rows - 1];
-            _mafFile >> row._sequenceName >> row._startPosition >> row._length >> row._strand >> row._srcLength >> row._line;
-            if (_mafFile.bad() || _mafFile.fail()) {
-                throw hal_exception("error parsing sequence " + row._sequenceName);
-            }
+            parseRow(row, pos, line + length - pos);
             if (_rows > 1 && row._line.length() != _block[_rows - 2]._line.length()) {
-                throw hal_exception("two lines in same block have different lengths: " + row._sequenceName + " " +
-                                    std::to_string(row._startPosition) + " and " + _block[_rows - 2]._sequenceName + " " +
-                                    std::to_string(_block[_rows - 2]._startPosition));
+                throw hal_exception("two lines in same block have different lengths: " + row._name->_fullName + " " +
+                                    std::to_string(row._startPosition) + " and " + _block[_rows - 2]._name->_fullName +
+                                    " " + std::to_string(_block[_rows - 2]._startPosition));
             }
 
             if (_targets.size() > 1 && // (will always include reference)
-                _targets.find(genomeName(row._sequenceName)) == _targets.end()) {
+                !row._name->_target) {
                 // genome not in targets, pretend like it never happened.
                 --_rows;
             } else {
+                spillRow(row);
                 sLine();
             }
-        } else {
-            nextLine();
+        }
+        if (_rows == 0) {
+            _mafFile.release();
         }
     }
     if (_rows > 0) {
+        _blockOffset = _mafFile.getOffset();
+        spillBlock();
         updateMask();
         ++_numBlocks;
     }
     end();
     _mafFile.close();
+    if (_spillFile.is_open()) {
+        _spillFile.close();
+        if (!_spillFile) {
+            throw hal_exception("error writing spill file: " + _spillPath);
+        }
+    }
+}
+
+void MafScanner::scanSpill(const string &spillPath) {
+    ifstream spillFile(spillPath.c_str(), ios::binary);
+    if (!spillFile) {
+        throw hal_exception("error opening spill file: " + spillPath);
+    }
+    _names.clear();
+    _nameList.clear();
+    _numBlocks = 0;
+    _stop = false;
+
+    _rows = 0;
+    _block.clear();
+    while (!_stop && readSpillBlock(spillFile)) {
+        for (_rows = 0; _rows < _spillRows.size();) {
+            ++_rows;
+            sLine();
+        }
+        // as in scan(), the last block is left for end()
+        if (spillFile.peek() == EOF) {
+            break;
+        }
+        updateMask();
+        aLine();
+        ++_numBlocks;
+        _rows = 0;
+    }
+    if (_rows > 0) {
+        updateMask();
+        ++_numBlocks;
+    }
+    end();
+}
+
+/* copy a row to the block being saved, before sLine() can change it */
+void MafScanner::spillRow(const Row &row) {
+    if (_spillFile.is_open()) {
+        SpillRow saved = {row._name->_index, row._startPosition, row._length, row._srcLength, row._strand};
+        _spillRows.push_back(saved);
+        _spillText.insert(_spillText.end(), row._line._data, row._line._data + row._line._length);
+    }
+}
+
+/* write the rows of a block, preceded by the names not yet written */
+void MafScanner::spillBlock() {
+    if (!_spillFile.is_open()) {
+        return;
+    }
+    hal_size_t numNewNames = _nameList.size() - _numSpilledNames;
+    _spillFile.write((const char *)&numNewNames, sizeof(numNewNames));
+    for (; _numSpilledNames < _nameList.size(); ++_numSpilledNames) {
+        const string &name = _nameList[_numSpilledNames]->_fullName;
+        hal_size_t nameLength = name.length();
+        _spillFile.write((const char *)&nameLength, sizeof(nameLength));
+        _spillFile.write(name.data(), nameLength);
+    }
+    hal_size_t header[3] = {_blockOffset, _spillRows.size(), _spillText.size() / _spillRows.size()};
+    _spillFile.write((const char *)header, sizeof(header));
+    _spillFile.write((const char *)_spillRows.data(), _spillRows.size() * sizeof(SpillRow));
+    _spillFile.write(_spillText.data(), _spillText.size());
+    if (!_spillFile) {
+        throw hal_exception("error writing spill file: " + _spillPath);
+    }
+    _spillRows.clear();
+    _spillText.clear();
+}
+
+/* read the next block written by spillBlock() into _block, leaving _rows
+ * for the caller to advance.
+ * @return false at the end of the file */
+bool MafScanner::readSpillBlock(ifstream &spillFile) {
+    hal_size_t numNewNames;
+    if (!spillFile.read((char *)&numNewNames, sizeof(numNewNames))) {
+        if (spillFile.gcount() == 0) {
+            return false;
+        }
+        throw hal_exception("spill file is truncated");
+    }
+    string name;
+    for (hal_size_t i = 0; i < numNewNames; ++i) {
+        hal_size_t nameLength = 0;
+        spillFile.read((char *)&nameLength, sizeof(nameLength));
+        name.resize(nameLength);
+        spillFile.read(&name[0], nameLength);
+        internName(name.data(), nameLength);
+    }
+    hal_size_t header[3] = {0, 0, 0};
+    spillFile.read((char *)header, sizeof(header));
+    _blockOffset = header[0];
+    hal_size_t numRows = header[1];
+    hal_size_t columns = header[2];
+    _spillRows.resize(numRows);
+    _spillText.resize(numRows * columns);
+    spillFile.read((char *)_spillRows.data(), numRows * sizeof(SpillRow));
+    spillFile.read(_spillText.data(), _spillText.size());
+    if (!spillFile) {
+        throw hal_exception("spill file is truncated");
+    }
+    if (numRows > _block.size()) {
+        _block.resize(numRows);
+    }
+    for (hal_size_t i = 0; i < numRows; ++i) {
+        const SpillRow &saved = _spillRows[i];
+        if (saved._nameIndex >= _nameList.size()) {
+            throw hal_exception("spill file is corrupt");
+        }
+        Row &row = _block[i];
+        row._name = _nameList[saved._nameIndex];
+        row._startPosition = saved._startPosition;
+        row._length = saved._length;
+        row._strand = saved._strand;
+        row._srcLength = saved._srcLength;
+        row._line._data = _spillText.data() + i * columns;
+        row._line._length = columns;
+    }
+    return true;
+}
+
+/* split the fields after the s of an s line in place */
+void MafScanner::parseRow(Row &row, char *line, size_t length) {
+    char *end = line + length;
+    char *token;
+    size_t tokenLength;
+    nextToken(line, end, token, tokenLength);
+    row._name = internName(token, tokenLength);
+    char *strand;
+    size_t strandLength;
+    if (!nextSize(line, end, row._startPosition) || !nextSize(line, end, row._length) ||
+        !nextToken(line, end, strand, strandLength) || strandLength != 1 || !nextSize(line, end, row._srcLength) ||
+        !lastToken(line, end, row._line._data, row._line._length)) {
+        throw hal_exception("error parsing sequence " + row._name->_fullName);
+    }
+    row._strand = strand[0];
 }
 
-void MafScanner::nextLine() {
-    while (!_mafFile.eof() && !_mafFile.bad() && _mafFile.peek() != '\n') {
-        _mafFile.get();
+const MafScanner::Name *MafScanner::internName(const char *name, size_t length) {
+    _nameBuffer.assign(name, length);
+    NameMap::iterator i = _names.find(_nameBuffer);
+    if (i == _names.end()) {
+        i = _names.insert(NameMap::value_type(_nameBuffer, Name())).first;
+        Name &interned = i->second;
+        interned._fullName = _nameBuffer;
+        size_t dotPos = _nameBuffer.find('.');
+        if (dotPos != string::npos && dotPos > 0 && dotPos < _nameBuffer.length() - 1) {
+            interned._genomeName = genomeName(_nameBuffer);
+            interned._sequenceName = sequenceName(_nameBuffer);
+        }
+        interned._target = _targets.find(interned._genomeName) != _targets.end();
+        interned._index = _nameList.size();
+        _nameList.push_back(&interned);
     }
+    return &i->second;
 }
 
 // the mask stores a bit for every column where a gap begins in any row
@@ -93,16 +312,13 @@ void MafScanner::updateMask() {
         _mask.resize(length);
         fill(_mask.begin(), _mask.end(), false);
 
-        // scan left to right
-        for (size_t i = 1; i < length; ++i) {
-            // scan up to down
-            for (size_t j = 0; j < _rows && _mask[i] == false; ++j) {
-                // beginning of gap run. add position of first gap to mask
-                if (_block[j]._line[i] == '-' && _block[j]._line[i - 1] != '-') {
-                    _mask[i] = true;
-                }
-                // end of gap run. add position of first non gap to mask
-                else if (_block[j]._line[i] != '-' && _block[j]._line[i - 1] == '-') {
+        // scan a row at a time, left to right, as rows are contiguous
+        for (size_t j = 0; j < _rows; ++j) {
+            const char *line = _block[j]._line._data;
+            for (size_t i = 1; i < length; ++i) {
+                // beginning of gap run or end of gap run: add position of
+                // first gap or first non gap to mask
+                if ((line[i] == '-') != (line[i - 1] == '-')) {
                     _mask[i] = true;
                 }
             }
@@ -21,7 +21,7 @@ MafWriteGenomes::~MafWriteGenomes() {
 }
 
 void MafWriteGenomes::convert(const string &mafPath, const string &refGenomeName, const set<string> &targets,
-                              const DimMap &dimMap, AlignmentPtr alignment) {
+                              const DimMap &dimMap, AlignmentPtr alignment, const string &spillPath) {
     _refName = refGenomeName;
     _dimMap = &dimMap;
     _alignment = alignment;
@@ -31,7 +31,11 @@ void MafWriteGenomes::convert(const string &mafPath, const string &refGenomeName
     _refBottom = BottomSegmentIteratorPtr();
     _childIdxMap.clear();
     createGenomes();
-    MafScanner::scan(mafPath, targets);
+    if (spillPath.empty()) {
+        MafScanner::scan(mafPath, targets);
+    } else {
+        scanSpill(spillPath);
+    }
     initEmptySegments();
     updateRefParseInfo();
 }
@@ -173,16 +177,16 @@ void MafWriteGenomes::initBlockInfo(size_t col) {
             _blockInfo[i]._gaps = 0;
             _blockInfo[i]._start = NULL_INDEX;
             _blockInfo[i]._length = 0;
-            assert(_dimMap->find(_block[i]._sequenceName) != _dimMap->end());
-            _blockInfo[i]._record = _dimMap->find(_block[i]._sequenceName)->second;
-            _blockInfo[i]._genome = _alignment->openGenome(genomeName(_block[i]._sequenceName));
+            assert(_dimMap->find(_block[i]._name->_fullName) != _dimMap->end());
+            _blockInfo[i]._record = _dimMap->find(_block[i]._name->_fullName)->second;
+            _blockInfo[i]._genome = _alignment->openGenome(_block[i]._name->_genomeName);
             assert(_blockInfo[i]._genome != NULL);
             _blockInfo[i]._skip = false;
             // correction for - strand: need to iterate index right to left
             // so keep a correctly flipped maf line here (rather than doing it
             // every chunk)
             if (_block[i]._strand == '-') {
-                _blockInfo[i]._gapComp = _block[i]._line;
+                _blockInfo[i]._gapComp.assign(_block[i]._line._data, _block[i]._line._length);
                 reverseGaps(_blockInfo[i]._gapComp);
             } else {
                 _blockInfo[i]._gapComp.erase();
@@ -201,7 +205,7 @@ void MafWriteGenomes::initBlockInfo(size_t col) {
     _refRow = NULL_INDEX;
 
     for (size_t i = 0; i < _rows; ++i) {
-        std::string &line = _block[i]._line;
+        Text &line = _block[i]._line;
         Row &row = _block[i];
         RowInfo &rowInfo = _blockInfo[i];
         if (line[col] == '-') {
@@ -221,7 +225,7 @@ void MafWriteGenomes::initBlockInfo(size_t col) {
                 assert(rowInfo._gaps <= col);
                 StartMap::const_iterator mapIt = startMap.find(rowInfo._start);
                 if (mapIt != startMap.end() && mapIt->second._written == 0 && mapIt->second._empty == 0 &&
-                    posSet.find(FilePosition(_mafFile.tellg(), i)) == posSet.end()) {
+                    posSet.find(FilePosition(_blockOffset, i)) == posSet.end()) {
                     rowInfo._arrayIndex = mapIt->second._index;
 
                     // correction for - strand: need to iterate index right to left
@@ -263,9 +267,9 @@ void MafWriteGenomes::initParaMap() {
 
     for (size_t i = 0; i < _rows; ++i) {
         Row &row = _block[i];
-        Genome *genome = _alignment->openGenome(genomeName(row._sequenceName));
+        Genome *genome = _alignment->openGenome(row._name->_genomeName);
         assert(genome != NULL);
-        Sequence *sequence = genome->getSequence(sequenceName(row._sequenceName));
+        Sequence *sequence = genome->getSequence(row._name->_sequenceName);
         assert(sequence != NULL);
         Paralogy para = {sequence->getStartPosition() + static_cast<hal_index_t>(row._startPosition), i};
         pair<ParaMap::iterator, bool> res = _paraMap.insert(pair<Genome *, ParaSet>(genome, ParaSet()));
@@ -281,7 +285,7 @@ void MafWriteGenomes::convertSegments(size_t col) {
         RowInfo &rowInfo = _blockInfo[_refRow];
         Row &row = _block[_refRow];
         _refBottom->setArrayIndex(_refGenome, rowInfo._arrayIndex);
-        seq = _refGenome->getSequence(sequenceName(row._sequenceName));
+        seq = _refGenome->getSequence(row._name->_sequenceName);
         assert(seq != NULL);
         _refBottom->setCoordinates(seq->getStartPosition() + rowInfo._start, rowInfo._length);
         _refBottom->bseg()->setTopParseIndex(NULL_INDEX);
@@ -303,9 +307,9 @@ void MafWriteGenomes::convertSegments(size_t col) {
             // at last minute
             hal_index_t genStart = rowInfo._start;
             hal_index_t rowSeqOffset = col;
-            const string &rowLine = row._strand == '-' ? rowInfo._gapComp : row._line;
+            const char *rowLine = row._strand == '-' ? rowInfo._gapComp.data() : row._line._data;
 
-            seq = genome->getSequence(sequenceName(row._sequenceName));
+            seq = genome->getSequence(row._name->_sequenceName);
             assert(seq != NULL);
             if (genome == _refGenome) {
                 _bottomSegment->setArrayIndex(rowInfo._genome, rowInfo._arrayIndex);
@@ -347,7 +351,7 @@ void MafWriteGenomes::convertSegments(size_t col) {
                 }
             }
 
-            seq->setSubString(rowLine.substr(rowSeqOffset, rowInfo._length), genStart, rowInfo._length);
+            seq->setSubString(string(rowLine + rowSeqOffset, rowInfo._length), genStart, rowInfo._length);
         }
     }
 }
@@ -362,7 +366,7 @@ void MafWriteGenomes::updateParalogy(size_t i) {
     assert(pIt != _paraMap.end());
     ParaSet &paraSet = pIt->second;
     if (paraSet.size() > 1) {
-        Sequence *sequence = rowInfo._genome->getSequence(sequenceName(row._sequenceName));
+        Sequence *sequence = rowInfo._genome->getSequence(row._name->_sequenceName);
         assert(sequence != NULL);
         Paralogy query = {sequence->getStartPosition() + static_cast<hal_index_t>(row._startPosition), 0};
         ParaSet::iterator sIt = paraSet.find(query);
@@ -430,12 +434,7 @@ void MafWriteGenomes::initEmptySegments() {
                     _topSegment->tseg()->setParentReversed(false);
                     _topSegment->tseg()->setNextParalogyIndex(NULL_INDEX);
                 }
-                DnaIteratorPtr dna = sequence->getDnaIterator(startPosition);
-                for (hal_size_t i = 0; i < length; ++i) {
-                    dna->setBase('N');
-                    dna->toRight();
-                }
-                dna->flush();
+                sequence->setSubString(string(length, 'N'), startPosition, length);
             }
         }
     }
@@ -458,7 +457,11 @@ void MafWriteGenomes::sLine() {
     // CONVERT TO FORWARD COORDINATES
     if (row._strand == '-') {
         row._startPosition = row._srcLength - 1 - (row._startPosition + row._length - 1);
-        reverseComplement(row._line);
+        char *line = row._line._data;
+        std::reverse(line, line + row._line._length);
+        for (size_t i = 0; i < row._line._length; ++i) {
+            line[i] = reverseComplement(line[i]);
+        }
     }
 }
 
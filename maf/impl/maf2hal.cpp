@@ -8,6 +8,7 @@
 #include "halMafScanDimensions.h"
 #include "halMafScanReference.h"
 #include "halMafWriteGenomes.h"
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -16,8 +17,8 @@ using namespace std;
 using namespace hal;
 
 static void initParser(CLParser &optionsParser) {
-    optionsParser.addArgument("mafFile", "output maf file");
-    optionsParser.addArgument("halFile", "input hal file");
+    optionsParser.addArgument("mafFile", "input maf file (may be gzip compressed)");
+    optionsParser.addArgument("halFile", "output hal file");
     optionsParser.addOption("refGenome", "name of reference genome in MAF "
                                          "(first found if empty)",
                             "");
@@ -28,10 +29,23 @@ static void initParser(CLParser &optionsParser) {
                                           " reference must alaready be present in hal"
                                           " dabase as a leaf.",
                                 false);
+    optionsParser.addOption("spillFile", "temporary file that the parsed alignment blocks are saved to while "
+                                         "scanning the maf, so that they can be read back when writing the hal "
+                                         "rather than scanning the maf a second time (default: halFile.spill)",
+                            "");
+    optionsParser.addOptionFlag("noSpill", "scan the maf a second time rather than using a spill file, which "
+                                           "needs about as much disk space as the maf uncompressed",
+                                false);
 
     optionsParser.setDescription("import maf into hal database.");
 }
 
+static void removeSpill(const string &spillPath) {
+    if (!spillPath.empty()) {
+        remove(spillPath.c_str());
+    }
+}
+
 int main(int argc, char **argv) {
     CLParser optionsParser(CREATE_ACCESS);
     initParser(optionsParser);
@@ -40,6 +54,7 @@ int main(int argc, char **argv) {
     string refGenomeName;
     string targetGenomes;
     bool append;
+    string spillPath;
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("halFile");
@@ -47,13 +62,20 @@ int main(int argc, char **argv) {
         refGenomeName = optionsParser.getOption<string>("refGenome");
         targetGenomes = optionsParser.getOption<string>("targetGenomes");
         append = optionsParser.getFlag("append");
+        spillPath = optionsParser.getOption<string>("spillFile");
+        if (optionsParser.getFlag("noSpill")) {
+            if (!spillPath.empty()) {
+                throw hal_exception("--spillFile and --noSpill are mutually exclusive");
+            }
+        } else if (spillPath.empty()) {
+            spillPath = halPath + ".spill";
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
         exit(1);
     }
-    //  try
-    {
+    try {
         ifstream mafStream(mafPath.c_str());
         if (!mafStream) {
             throw hal_exception("Error opening MAF file: " + mafPath);
@@ -88,6 +110,7 @@ int main(int argc, char **argv) {
         targetSet.insert(refGenomeName);
 
         MafScanDimensions dScan;
+        dScan.setSpillPath(spillPath);
         dScan.scan(mafPath, targetSet);
 
         string prevGenome, curGenome;
@@ -117,16 +140,17 @@ int main(int argc, char **argv) {
         cout << "Total Number of blocks in maf: " << dScan.getNumBlocks() << "\n";
 
         MafWriteGenomes writer;
-        writer.convert(mafPath, refGenomeName, targetSet, dScan.getDimensions(), alignment);
-    }
-    try {
+        writer.convert(mafPath, refGenomeName, targetSet, dScan.getDimensions(), alignment, spillPath);
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
+        removeSpill(spillPath);
         return 1;
     } catch (exception &e) {
         cerr << "Exception caught: " << e.what() << endl;
+        removeSpill(spillPath);
         return 1;
     }
+    removeSpill(spillPath);
 
     return 0;
 }
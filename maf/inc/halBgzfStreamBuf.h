@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALBGZFSTREAMBUF_H
+#define _HALBGZFSTREAMBUF_H
+
+#include "hal.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+namespace hal {
+
+    /** Stream buffer that compresses what is written to it in BGZF format
+     * (as bgzip does): a series of gzip members each holding at most
+     * BlockSize bytes, which can be decompressed by gzip and seeked into
+     * using virtual offsets (the compressed offset of a block shifted left
+     * 16 bits, plus an offset into its uncompressed data).
+     *
+     * Full blocks are compressed by a pool of threads and written to the
+     * output stream in order by the thread writing to the buffer.
+     * Partial blocks are only written by close(), so flushing the stream
+     * doesn't make small blocks. */
+    class BgzfStreamBuf : public std::streambuf {
+      public:
+        /* uncompressed bytes in a block, as in htslib */
+        static const size_t BlockSize = 0xff00;
+
+        /* called with the number of each block (counting from zero for this
+         * buffer) and its offset in the file as it is written */
+        typedef std::function<void(hal_size_t blockNumber, hal_size_t fileOffset)> BlockWrittenFn;
+
+        /** @param out stream the compressed data is written to
+         * @param numThreads number of compression threads, or 0 to compress
+         * on the writing thread
+         * @param fileOffset size of the file being appended to, if any */
+        BgzfStreamBuf(std::ostream &out, hal_size_t numThreads, hal_size_t fileOffset = 0);
+        ~BgzfStreamBuf();
+
+        void setBlockWritten(const BlockWrittenFn &blockWritten) {
+            _blockWritten = blockWritten;
+        }
+
+        /** number of the block the next byte written goes in */
+        hal_size_t getBlockNumber() const {
+            return pptr() == epptr() ? _numSubmitted + 1 : _numSubmitted;
+        }
+
+        /** offset of the next byte written in its block's uncompressed data */
+        hal_size_t getBlockOffset() const {
+            return pptr() == epptr() ? 0 : pptr() - pbase();
+        }
+
+        /** compress and write what is left, followed by the BGZF end of file
+         * marker, and stop the compression threads.  Must be called to
+         * finish the output, and throws if any of it couldn't be written. */
+        void close();
+
+      protected:
+        int_type overflow(int_type c);
+        int sync();
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which);
+
+      private:
+        BgzfStreamBuf(const BgzfStreamBuf &);
+        BgzfStreamBuf &operator=(const BgzfStreamBuf &);
+
+        enum JobState { Free, Queued, Done };
+        struct Job {
+            std::vector<char> _data;
+            size_t _length;
+            std::vector<unsigned char> _compressed;
+            size_t _compressedLength;
+            std::string _error;
+            JobState _state;
+        };
+
+        void submitBlock();
+        void writeDone(size_t maxPending);
+        void writeBlock(Job &job);
+        void compressThread();
+        static void compressBlock(Job &job, z_stream &zs);
+        void stopThreads();
+
+        std::ostream &_out;
+        std::vector<Job> _jobs;
+        // job being filled, first job not yet written, and jobs in between
+        size_t _fill;
+        size_t _oldest;
+        size_t _numPending;
+        std::deque<Job *> _queue;
+        hal_size_t _numSubmitted;
+        hal_size_t _numWritten;
+        hal_size_t _fileOffset;
+        hal_size_t _appendOffset;
+        hal_size_t _dataLength;
+        std::string _error;
+        BlockWrittenFn _blockWritten;
+        z_stream _zs;
+        bool _closed;
+        bool _stop;
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _queued;
+        std::condition_variable _done;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
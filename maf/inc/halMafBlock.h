@@ -10,6 +10,7 @@
 
 #include "hal.h"
 #include "sonLib.h"
+#include <algorithm>
 #include <cstdlib>
 #include <deque>
 #include <iostream>
@@ -25,7 +26,7 @@ namespace hal {
     // problem.
     class MafBlockString {
       public:
-        MafBlockString() : _buf(NULL), _cap(1024), _len(0) {
+        MafBlockString(size_t capacity = 1024) : _buf(NULL), _cap(capacity), _len(0) {
             _buf = (char *)malloc((_cap + 1));
             if (_buf == NULL) {
                 mallocFailure();
@@ -45,6 +46,9 @@ namespace hal {
         void clear() {
             _len = 0;
         }
+        size_t length() const {
+            return _len;
+        }
         const char *str() {
             _buf[_len] = '\0';
             return _buf;
@@ -70,14 +74,14 @@ namespace hal {
     struct MafBlockEntry {
         // we hack to keep a global buffer list to reduce
         // allocs and frees as entries get created and destroyed
-        inline MafBlockEntry(std::vector<MafBlockString *> &buffers)
+        inline MafBlockEntry(std::vector<MafBlockString *> &buffers, size_t capacity)
             : _buffers(buffers), _genome(NULL), _lastUsed(0) {
             if (_buffers.empty() == false) {
                 _sequence = _buffers.back();
                 _buffers.pop_back();
                 _sequence->clear();
             } else {
-                _sequence = new MafBlockString();
+                _sequence = new MafBlockString(capacity);
             }
         }
 
@@ -114,6 +118,42 @@ namespace hal {
         stTree *_tree;
     };
 
+    /* The rows of a finished block in output order, taken from the MafBlock
+     * (see MafBlock::takeRows) so that they can be written on another thread
+     * while the next block is built.  Sequence buffers are swapped with the
+     * entries' rather than copied, and rows are kept to be reused by the next
+     * block taken, so nothing is allocated once a few blocks have passed
+     * through. */
+    struct MafBlockRows {
+        struct Row {
+            std::string _name;
+            hal_index_t _start;
+            hal_index_t _length;
+            char _strand;
+            hal_index_t _srcLength;
+            MafBlockString *_sequence;
+        };
+
+        MafBlockRows() : _numRows(0), _referenceRow(0) {
+        }
+        ~MafBlockRows() {
+            for (size_t i = 0; i < _rows.size(); ++i) {
+                delete _rows[i]._sequence;
+            }
+        }
+
+        // newick tree for the a line (empty if trees aren't printed)
+        std::string _tree;
+        std::vector<Row> _rows;
+        size_t _numRows;
+        // index of the reference's row (_numRows if it isn't printed)
+        size_t _referenceRow;
+
+      private:
+        MafBlockRows(const MafBlockRows &);
+        MafBlockRows &operator=(const MafBlockRows &);
+    };
+
     class MafBlock {
       public:
         static const hal_index_t defaultMaxLength;
@@ -121,9 +161,13 @@ namespace hal {
         MafBlock(hal_index_t maxLength = defaultMaxLength);
         ~MafBlock();
 
-        void initBlock(ColumnIteratorPtr col, bool fullNames, bool printTree);
-        void appendColumn(ColumnIteratorPtr col);
-        bool canAppendColumn(ColumnIteratorPtr col);
+        void initBlock(const ColumnIteratorPtr &col, bool fullNames, bool printTree);
+        void appendColumn(const ColumnIteratorPtr &col);
+        bool canAppendColumn(const ColumnIteratorPtr &col);
+
+        /* move the block's rows into rows, in the order they are printed.
+         * The block must be re-initialized before it is used again. */
+        void takeRows(MafBlockRows &rows);
 
         inline std::string getName(const Sequence *sequence) const {
             return _fullNames ? sequence->getFullName() : sequence->getName();
@@ -146,15 +190,19 @@ namespace hal {
         }
 
       protected:
+        // sequence buffers are made big enough for a full block up front
+        size_t entryCapacity() const {
+            return (size_t)std::min(_maxLength, (hal_index_t)65536);
+        }
         void resetEntries();
-        void initEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIteratorPtr dna, bool clearSequence = true);
-        void updateEntry(MafBlockEntry *entry, const Sequence *sequence, DnaIteratorPtr dna);
-        stTree *buildTree(ColumnIteratorPtr colIt, bool modifyEntries);
+        void initEntry(MafBlockEntry *entry, const Sequence *sequence, const DnaIterator *dna, bool clearSequence = true);
+        void updateEntry(MafBlockEntry *entry, const Sequence *sequence, const DnaIterator *dna);
+        stTree *buildTree(const ColumnIteratorPtr &colIt, bool modifyEntries);
         void buildTreeR(BottomSegmentIteratorPtr botIt, stTree *tree, bool modifyEntries);
         stTree *getTreeNode(SegmentIteratorPtr segIt, bool modifyEntries);
 
-        std::ostream &printBlock(std::ostream &os) const;
-        std::ostream &printBlockWithTree(std::ostream &os) const;
+        void takeRow(MafBlockEntry *entry, hal_index_t start, MafBlockRows &rows);
+        void takeTreeRows(stTree *tree, MafBlockRows &rows);
 
         typedef std::multimap<const Sequence *, MafBlockEntry *, ColumnIterator::SequenceLess> Entries;
         Entries _entries;
@@ -168,14 +216,11 @@ namespace hal {
 
         typedef hal::ColumnIterator::ColumnMap ColumnMap;
         typedef hal::ColumnIterator::DNASet DNASet;
-        friend std::ostream &operator<<(std::ostream &os, const hal::MafBlock &mafBlock);
-        friend std::istream &operator>>(std::istream &is, hal::MafBlock &mafBlock);
     };
 
     std::ostream &operator<<(std::ostream &os, const hal::MafBlockEntry &mafBlockEntry);
     std::istream &operator>>(std::istream &is, hal::MafBlockEntry &mafBlockEntry);
-    std::ostream &operator<<(std::ostream &os, const hal::MafBlock &mafBlock);
-    std::istream &operator>>(std::istream &is, hal::MafBlock &mafBlock);
+    TextWriter &operator<<(TextWriter &os, const hal::MafBlockRows &mafBlockRows);
 
 }
 
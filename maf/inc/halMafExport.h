@@ -9,17 +9,63 @@
 #define _HALMAFEXPORT_H
 
 #include "halMafBlock.h"
+#include "halMafIndex.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
 
 namespace hal {
 
+    /* Passes finished blocks from the thread that iterates over the columns
+     * and builds them to a thread that formats and writes them, so the two
+     * overlap.  A fixed number of MafBlockRows circulate between the two,
+     * which bounds the memory used and lets their buffers be reused. */
+    class MafBlockQueue {
+      public:
+        MafBlockQueue(size_t size = 4);
+        ~MafBlockQueue();
+
+        /* start a conversion */
+        void open();
+
+        /* get rows to take a block into, waiting until the writer has
+         * finished with some.  Throws if the writer has failed. */
+        MafBlockRows *getFree();
+
+        /* queue rows from getFree() to be written */
+        void put(MafBlockRows *rows);
+
+        /* no more blocks will be put */
+        void close();
+
+        /* write blocks as they are put until the queue is closed and empty,
+         * each followed by a blank line, adding them to index if it isn't
+         * NULL */
+        void write(std::ostream &os, MafIndex *index);
+
+      private:
+        MafBlockQueue(const MafBlockQueue &);
+        MafBlockQueue &operator=(const MafBlockQueue &);
+
+        std::vector<MafBlockRows *> _allRows;
+        std::deque<MafBlockRows *> _free;
+        std::deque<MafBlockRows *> _full;
+        bool _closed;
+        bool _failed;
+        std::mutex _mutex;
+        std::condition_variable _freeReady;
+        std::condition_variable _fullReady;
+    };
+
     class MafExport {
       public:
         MafExport():
-            _mafStream(NULL), _maxRefGap(0), _noDupes(false), _noAncestors(false),
+            _mafStream(NULL), _index(NULL), _maxRefGap(0), _noDupes(false), _noAncestors(false),
             _ucscNames(false), _unique(false), _append(false), _printTree(false),
             _onlyOrthologs(false), _keepEmptyRefBlocks(false) {
         }
@@ -66,14 +112,24 @@ namespace hal {
         void setKeepEmptyRefBlocks(bool keepEmptyRefBlocks) {
             _keepEmptyRefBlocks = keepEmptyRefBlocks;
         }
+        // index of the blocks, when writing to a BGZF stream
+        void setIndex(MafIndex *index) {
+            _index = index;
+        }
 
       protected:
         void writeHeader();
+        void writeBlock();
+        void convertSequenceBlocks(const ColumnIteratorPtr &colIt);
+        void convertEntireAlignmentBlocks();
+        void runPipeline(const std::function<void()> &buildBlocks);
 
       protected:
         AlignmentConstPtr _alignment;
         std::ostream *_mafStream;
+        MafIndex *_index;
         MafBlock _mafBlock;
+        MafBlockQueue _blockQueue;
         hal_size_t _maxRefGap;
         bool _noDupes;
         bool _noAncestors;
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALMAFINDEX_H
+#define _HALMAFINDEX_H
+
+#include "halBgzfStreamBuf.h"
+#include <deque>
+#include <fstream>
+#include <string>
+
+namespace hal {
+
+    /** Sidecar index of a BGZF compressed MAF, so that readers can seek
+     * straight to the blocks for a region of the reference.  It is a tab
+     * separated file with a line for each run of blocks whose reference rows
+     * are on the same sequence and start in the same BGZF block:
+     *
+     *    sequence  start  end  virtualOffset
+     *
+     * where start and end are the zero-based, half-open range on the forward
+     * strand covered by the run's reference rows, and virtualOffset is the
+     * BGZF virtual offset of the first block's a line.  The blocks of a run
+     * are consecutive in the MAF. */
+    class MafIndex {
+      public:
+        MafIndex(BgzfStreamBuf &bgzf);
+
+        /** open the index, adding to it if append is true */
+        void open(const std::string &path, bool append);
+
+        /** add a MAF block that is about to be written, given its reference
+         * row's sequence and range on the forward strand */
+        void addBlock(const std::string &sequenceName, hal_index_t start, hal_index_t end);
+
+        /** close the index, once the BGZF stream has been closed */
+        void close();
+
+      private:
+        struct Entry {
+            std::string _sequenceName;
+            hal_index_t _start;
+            hal_index_t _end;
+            hal_size_t _blockNumber;
+            hal_size_t _blockOffset;
+        };
+
+        void blockWritten(hal_size_t blockNumber, hal_size_t fileOffset);
+
+        BgzfStreamBuf &_bgzf;
+        std::string _path;
+        std::ofstream _file;
+        // entries in blocks that haven't been written, so whose offsets
+        // aren't known yet
+        std::deque<Entry> _pending;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALMAFREADER_H
+#define _HALMAFREADER_H
+
+#include "hal.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace hal {
+
+    /** Read a MAF file, plain or gzip compressed, a line at a time through a
+     * large buffer.  Lines are returned in place rather than copied: every
+     * line read since the last call to release() is kept in the buffer, but
+     * may be moved when the buffer is refilled (see getMoved()). */
+    class MafReader {
+      public:
+        MafReader();
+        ~MafReader();
+        void open(const std::string &path);
+        void close();
+
+        /** get the next line, without its newline.
+         * @return false at the end of the file */
+        bool readLine(char *&line, size_t &length);
+
+        /** let the buffer space of the lines read so far be reused */
+        void release() {
+            _keep = _next;
+        }
+
+        /** bytes by which the kept lines were moved by the last readLine() */
+        std::ptrdiff_t getMoved() const {
+            return _moved;
+        }
+
+        /** offset of the last line read in the uncompressed input */
+        hal_size_t getLineOffset() const {
+            return _lineOffset;
+        }
+
+        /** offset of the end of the lines read in the uncompressed input */
+        hal_size_t getOffset() const {
+            return _bufferOffset + _next;
+        }
+
+      private:
+        void fill();
+
+        static const size_t InitialBufferSize;
+
+        std::string _path;
+        gzFile _file;
+        std::vector<char> _buffer;
+        size_t _keep;
+        size_t _next;
+        size_t _end;
+        hal_size_t _bufferOffset;
+        hal_size_t _lineOffset;
+        std::ptrdiff_t _moved;
+        bool _eof;
+    };
+}
+
+#endif
+// Local Variables:
+// mode: c++
+// End:
@@ -30,7 +30,7 @@ namespace hal {
         };
         typedef std::map<hal_size_t, ArrayInfo> StartMap;
 
-        typedef std::pair<std::streampos, size_t> FilePosition;
+        typedef std::pair<hal_size_t, size_t> FilePosition;
         typedef std::set<FilePosition> PosSet;
 
         struct Record {
@@ -9,35 +9,79 @@
 #define _HALMAFSCANNER_H
 
 #include "hal.h"
+#include "halMafReader.h"
 #include <cstdlib>
 #include <deque>
 #include <fstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace hal {
 
     /** Parse a MAF file line by line
      * written independently from the maf export, and it's too much of a
-     * bother to reuse any of that code. */
+     * bother to reuse any of that code.  Lines are tokenized in place in
+     * the reader's buffer, and sequence names are interned so that they
+     * are only copied and split the first time they are seen. */
     class MafScanner {
       public:
         MafScanner();
         virtual ~MafScanner();
         virtual void scan(const std::string &mafPath, const std::set<std::string> &targetSet);
+
+        /** save the rows of the blocks read by scan() (after filtering by
+         * target) to a spill file, so a later pass can read them with
+         * scanSpill() instead of reading and parsing the MAF again.  An
+         * empty path turns spilling off. */
+        void setSpillPath(const std::string &spillPath) {
+            _spillPath = spillPath;
+        }
+
+        /** scan the blocks saved to a spill file by scan() */
+        void scanSpill(const std::string &spillPath);
+
         hal_size_t getNumBlocks() const {
             return _numBlocks;
         }
         static std::string genomeName(const std::string &fullName);
         static std::string sequenceName(const std::string &fullName);
 
-        struct Row {
+        /** interned genomeName.sequenceName of a row.  The genome and
+         * sequence names are empty if the name has no dot to split on */
+        struct Name {
+            std::string _fullName;
+            std::string _genomeName;
             std::string _sequenceName;
+            bool _target;
+            hal_size_t _index;
+        };
+
+        /** alignment text of a row, left in the reader's buffer */
+        struct Text {
+            char *_data;
+            size_t _length;
+            size_t length() const {
+                return _length;
+            }
+            char &operator[](size_t i) {
+                return _data[i];
+            }
+            char operator[](size_t i) const {
+                return _data[i];
+            }
+            std::string substr(size_t pos, size_t len) const {
+                return std::string(_data + pos, len);
+            }
+        };
+
+        struct Row {
+            const Name *_name;
             hal_size_t _startPosition;
             hal_size_t _length;
             char _strand;
             hal_size_t _srcLength;
-            std::string _line;
+            Text _line;
         };
         typedef std::vector<Row> Block;
         typedef std::vector<bool> Mask;
@@ -46,16 +90,51 @@ namespace hal {
         virtual void aLine() = 0;
         virtual void sLine() = 0;
         virtual void end() = 0;
-        void nextLine();
         void updateMask();
+        /** stop scanning after the current line */
+        void stopScan() {
+            _stop = true;
+        }
 
-        std::ifstream _mafFile;
+        MafReader _mafFile;
         std::set<std::string> _targets;
+        /* offset in the input of the line ending the current block, which
+         * identifies the block across scans */
+        hal_size_t _blockOffset;
 
         Block _block;
         size_t _rows;
         Mask _mask;
         hal_size_t _numBlocks;
+
+      private:
+        /* row fields as saved in a spill file, followed by the text of the
+         * block's rows */
+        struct SpillRow {
+            hal_size_t _nameIndex;
+            hal_size_t _startPosition;
+            hal_size_t _length;
+            hal_size_t _srcLength;
+            char _strand;
+        };
+
+        void parseRow(Row &row, char *line, size_t length);
+        const Name *internName(const char *name, size_t length);
+        void spillRow(const Row &row);
+        void spillBlock();
+        bool readSpillBlock(std::ifstream &spillFile);
+
+        typedef std::unordered_map<std::string, Name> NameMap;
+        NameMap _names;
+        std::vector<const Name *> _nameList;
+        std::string _nameBuffer;
+        bool _stop;
+
+        std::string _spillPath;
+        std::ofstream _spillFile;
+        hal_size_t _numSpilledNames;
+        std::vector<SpillRow> _spillRows;
+        std::vector<char> _spillText;
     };
 }
 
@@ -35,8 +35,10 @@ namespace hal {
         typedef MafScanDimensions::PosSet PosSet;
         typedef std::pair<DimMap::const_iterator, DimMap::const_iterator> MapRange;
 
+        /** convert the MAF, or, if spillPath is not empty, the blocks saved
+         * from it by the dimension scan */
         void convert(const std::string &mafPath, const std::string &refGenomeName, const std::set<std::string> &targets,
-                     const DimMap &dimMap, AlignmentPtr alignment);
+                     const DimMap &dimMap, AlignmentPtr alignment, const std::string &spillPath);
 
       private:
         MapRange getRefSequences() const;
@@ -45,7 +45,7 @@ int main(int argc, char *argv[]) {
     }
     const Genome *referenceGenome = alignment->openGenome(referenceGenomeName);
     // FIXME tmp
-    ostream &os = cout;
+    TextWriter os(cout);
     for (SequenceIteratorPtr seqIt = referenceGenome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
         ColumnIteratorPtr colIt = seqIt->getSequence()->getColumnIterator(NULL, 0, 0, NULL_INDEX, false, true);
         bool inRegion = false;
@@ -107,5 +107,6 @@ int main(int argc, char *argv[]) {
             colIt->toRight();
         }
     }
+    os.flush();
     return 0;
 }
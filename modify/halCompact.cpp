@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "hal.h"
+#include <cstdlib>
+#include <iostream>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addArgument("inHalPath", "input mmap hal file");
+    optionsParser.addArgument("outHalPath", "output mmap hal file, which must not be the input file");
+    optionsParser.setDescription("Copy an mmap hal file without the space lost to changes made in place, such as "
+                                 "renaming sequences or replacing genomes, laying each genome out contiguously.  "
+                                 "Embedded levels of detail are kept.");
+}
+
+/* check that the output doesn't overwrite the input while it is read */
+static bool isSameFile(const string &path1, const string &path2) {
+    struct stat stat1, stat2;
+    return stat(path1.c_str(), &stat1) == 0 && stat(path2.c_str(), &stat2) == 0 && stat1.st_dev == stat2.st_dev &&
+           stat1.st_ino == stat2.st_ino;
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    initParser(optionsParser);
+    string inHalPath;
+    string outHalPath;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        inHalPath = optionsParser.getArgument<string>("inHalPath");
+        outHalPath = optionsParser.getArgument<string>("outHalPath");
+        if (isSameFile(inHalPath, outHalPath)) {
+            throw hal_exception("outHalPath must be a different file from inHalPath");
+        }
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        exit(1);
+    }
+
+    try {
+        AlignmentConstPtr alignment(openHalAlignment(inHalPath, &optionsParser));
+        compactHalAlignment(alignment, outHalPath);
+        alignment->close();
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -6,9 +6,13 @@
  */
 
 #include "halBranchMutations.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <deque>
 #include <locale>
+#include <mutex>
+#include <sstream>
 
 using namespace std;
 using namespace hal;
@@ -29,7 +33,9 @@ string BranchMutations::substitutionBedTag(char parent, char child) {
     return string("S_") + parent + child;
 }
 
-BranchMutations::BranchMutations() {
+const hal_size_t BranchMutations::ParallelChunkLength = 10000000;
+
+BranchMutations::BranchMutations() : _writeHeaders(true) {
 }
 
 BranchMutations::~BranchMutations() {
@@ -116,6 +122,90 @@ void BranchMutations::analyzeBranch(AlignmentConstPtr alignment, hal_size_t gapT
     }
 }
 
+void BranchMutations::analyzeBranchParallel(const vector<AlignmentConstPtr> &alignments, hal_size_t gapThreshold,
+                                            double nThreshold, ostream *refBedStream, ostream *parentBedStream,
+                                            ostream *snpBedStream, ostream *delBreakBedStream, const string &referenceName,
+                                            const vector<pair<hal_index_t, hal_size_t>> &ranges) {
+    assert(!alignments.empty());
+    const Genome *reference = alignments[0]->openGenome(referenceName);
+    if (reference == NULL) {
+        throw hal_exception("Reference genome, " + referenceName + ", not found in alignment");
+    }
+    hal_size_t totalLength = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        totalLength += ranges[i].second;
+    }
+    hal_size_t chunkLength = min(ParallelChunkLength, max(totalLength / (alignments.size() * 4), hal_size_t(1)));
+
+    // only split ranges at sequence boundaries.  rearrangements don't cross
+    // them, so the pieces have the same events as the whole range.
+    vector<pair<hal_index_t, hal_size_t>> chunks;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        hal_index_t end = ranges[i].first + (hal_index_t)ranges[i].second;
+        hal_index_t chunkStart = ranges[i].first;
+        while (chunkStart < end) {
+            hal_index_t chunkEnd = chunkStart;
+            do {
+                const Sequence *sequence = reference->getSequenceBySite(chunkEnd);
+                chunkEnd = sequence->getStartPosition() + sequence->getSequenceLength();
+            } while (chunkEnd < end && chunkEnd - chunkStart < (hal_index_t)chunkLength);
+            chunkEnd = min(chunkEnd, end);
+            chunks.push_back(make_pair(chunkStart, (hal_size_t)(chunkEnd - chunkStart)));
+            chunkStart = chunkEnd;
+        }
+    }
+
+    _refStream = refBedStream;
+    _parentStream = parentBedStream;
+    _snpStream = snpBedStream;
+    _delBreakStream = delBreakBedStream;
+    writeHeaders();
+
+    // each chunk is written to a buffer per distinct output stream (they may
+    // be shared), which are copied to the outputs in order as chunks finish
+    vector<ostream *> streams;
+    ostream *outStreams[] = {refBedStream, parentBedStream, snpBedStream, delBreakBedStream};
+    for (size_t i = 0; i < 4; ++i) {
+        if (outStreams[i] != NULL && find(streams.begin(), streams.end(), outStreams[i]) == streams.end()) {
+            streams.push_back(outStreams[i]);
+        }
+    }
+    vector<vector<string>> chunkOutputs(chunks.size());
+    vector<bool> chunkDone(chunks.size(), false);
+    size_t nextOutput = 0;
+    mutex outputMutex;
+    atomic<size_t> nextChunk(0);
+
+    runThreads(alignments.size(), [&](hal_size_t threadNum) {
+        const Genome *threadReference = alignments[threadNum]->openGenome(referenceName);
+        for (size_t i = nextChunk++; i < chunks.size(); i = nextChunk++) {
+            vector<ostringstream> buffers(streams.size());
+            ostream *bufferStreams[4];
+            for (size_t j = 0; j < 4; ++j) {
+                size_t k = find(streams.begin(), streams.end(), outStreams[j]) - streams.begin();
+                bufferStreams[j] = k < streams.size() ? &buffers[k] : NULL;
+            }
+            BranchMutations mutations;
+            mutations._writeHeaders = false;
+            mutations.analyzeBranch(alignments[threadNum], gapThreshold, nThreshold, bufferStreams[0], bufferStreams[1],
+                                    bufferStreams[2], bufferStreams[3], threadReference, chunks[i].first,
+                                    chunks[i].second);
+
+            lock_guard<mutex> lock(outputMutex);
+            for (size_t j = 0; j < buffers.size(); ++j) {
+                chunkOutputs[i].push_back(buffers[j].str());
+            }
+            chunkDone[i] = true;
+            for (; nextOutput < chunks.size() && chunkDone[nextOutput]; ++nextOutput) {
+                for (size_t j = 0; j < streams.size(); ++j) {
+                    *streams[j] << chunkOutputs[nextOutput][j];
+                }
+                chunkOutputs[nextOutput].clear();
+            }
+        }
+    });
+}
+
 void BranchMutations::writeInsertionOrInversion() {
     if (_refStream == NULL) {
         return;
@@ -256,6 +346,9 @@ void BranchMutations::writeDuplication() {
 }
 
 void BranchMutations::writeHeaders() {
+    if (!_writeHeaders) {
+        return;
+    }
     string header("#Sequence\tStart\tEnd\tMutationID\tParentGenome\tChildGenome\n"
                   "#I=Insertion D=Deletion GI(D)=GapInsertion(GapDeletion) "
                   "V=Inversion P=Transposition U=Duplication "
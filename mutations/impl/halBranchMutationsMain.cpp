@@ -51,6 +51,9 @@ static void initParser(CLParser &optionsParser) {
     optionsParser.addOption("maxNFraction", "maximum fraction of Ns in a rearranged segment "
                                             "for it to not be ignored as missing data.",
                             1.0);
+    optionsParser.addOption("numThreads", "number of threads to use.  The reference is divided between them at "
+                                          "sequence boundaries, or by --refTargets interval",
+                            1);
 
     optionsParser.setDescription("Identify mutations on branch between given "
                                  "genome and its parent.");
@@ -72,6 +75,7 @@ int main(int argc, char **argv) {
     hal_size_t length;
     hal_size_t maxGap;
     double nThreshold;
+    hal_size_t numThreads;
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("halFile");
@@ -86,6 +90,10 @@ int main(int argc, char **argv) {
         length = optionsParser.getOption<hal_size_t>("length");
         maxGap = optionsParser.getOption<hal_size_t>("maxGap");
         nThreshold = optionsParser.getOption<double>("maxNFraction");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (numThreads == 0) {
+            throw hal_exception("--numThreads must be at least 1");
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
@@ -206,6 +214,7 @@ int main(int argc, char **argv) {
             }
         }
 
+        vector<pair<hal_index_t, hal_size_t>> ranges;
         ifstream refTargetsStream;
         if (refTargetsPath != "\"\"") {
             refTargetsStream.open(refTargetsPath.c_str());
@@ -229,17 +238,28 @@ int main(int argc, char **argv) {
                     refSequence = refGenome->getSequence(refSequenceName);
                     length = end - start;
                     if (refSequence != NULL && length <= refSequence->getSequenceLength()) {
-                        start = refSequence->getStartPosition() + start;
-                        BranchMutations mutations;
-                        mutations.analyzeBranch(alignment, maxGap, nThreshold, refBedStream, parentBedStream,
-                                                snpBedStream, delBreakBedStream, refGenome, start, length);
+                        ranges.push_back(make_pair(refSequence->getStartPosition() + start, length));
                     }
                 }
             }
         } else {
+            ranges.push_back(make_pair(start, length));
+        }
+
+        vector<AlignmentConstPtr> alignments = openHalAlignmentPerThread(alignment, halPath, &optionsParser, numThreads);
+        if (alignments.size() < numThreads) {
+            cerr << "Warning [halBranchMutations]: HDF5 library is not thread-safe, ignoring --numThreads" << endl;
+        }
+        if (alignments.size() > 1) {
             BranchMutations mutations;
-            mutations.analyzeBranch(alignment, maxGap, nThreshold, refBedStream, parentBedStream, snpBedStream,
-                                    delBreakBedStream, refGenome, start, length);
+            mutations.analyzeBranchParallel(alignments, maxGap, nThreshold, refBedStream, parentBedStream, snpBedStream,
+                                            delBreakBedStream, refGenomeName, ranges);
+        } else {
+            for (size_t i = 0; i < ranges.size(); ++i) {
+                BranchMutations mutations;
+                mutations.analyzeBranch(alignment, maxGap, nThreshold, refBedStream, parentBedStream, snpBedStream,
+                                        delBreakBedStream, refGenome, ranges[i].first, ranges[i].second);
+            }
         }
         if (newRef) {
             delete refBedStream;
@@ -6,6 +6,7 @@
  */
 
 #include "halSummarizeMutations.h"
+#include <algorithm>
 #include <cassert>
 #include <deque>
 #include <locale>
@@ -13,6 +14,8 @@
 using namespace std;
 using namespace hal;
 
+const hal_size_t SummarizeMutations::SubstitutionChunkSegments = 100000;
+
 SummarizeMutations::SummarizeMutations() {
 }
 
@@ -52,20 +55,45 @@ void SummarizeMutations::printCsv(ostream &outStream) const {
 
 void SummarizeMutations::analyzeAlignmentPtr(AlignmentConstPtr alignment, hal_size_t gapThreshold, double nThreshold, bool justSubs,
                                           const set<string> *targetSet) {
+    analyzeAlignmentParallel(vector<AlignmentConstPtr>(1, alignment), gapThreshold, nThreshold, justSubs, targetSet);
+}
+
+void SummarizeMutations::analyzeAlignmentParallel(const vector<AlignmentConstPtr> &alignments, hal_size_t gapThreshold,
+                                                  double nThreshold, bool justSubs, const set<string> *targetSet) {
+    assert(!alignments.empty());
     _gapThreshold = gapThreshold;
     _nThreshold = nThreshold;
     _justSubs = justSubs;
     _targetSet = targetSet;
     _branchMap.clear();
-    _alignment = alignment;
+    _alignment = alignments[0];
+
+    if (_alignment->getNumGenomes() == 0) {
+        return;
+    }
+    vector<BranchTask> tasks;
+    makeTasksRecursive(_alignment->getRootName(), tasks);
 
-    if (_alignment->getNumGenomes() > 0) {
-        string root = _alignment->getRootName();
-        analyzeGenomeRecursive(root);
+    // biggest first so a long branch doesn't start last.  stable to keep
+    // the chunks of a genome together
+    stable_sort(tasks.begin(), tasks.end(),
+                [](const BranchTask &a, const BranchTask &b) { return a._size > b._size; });
+
+    atomic<size_t> nextTask(0);
+    vector<BranchMap> threadBranchMaps(alignments.size());
+    runThreads(alignments.size(), [&](hal_size_t threadNum) {
+        analyzeTasks(alignments[threadNum], tasks, nextTask, threadBranchMaps[threadNum]);
+    });
+    for (size_t i = 0; i < threadBranchMaps.size(); ++i) {
+        for (BranchMap::const_iterator j = threadBranchMaps[i].begin(); j != threadBranchMaps[i].end(); ++j) {
+            _branchMap[j->first] += j->second;
+        }
     }
 }
 
-void SummarizeMutations::analyzeGenomeRecursive(const string &genomeName) {
+// record the tree information for every genome, and the work to do on the
+// targeted ones
+void SummarizeMutations::makeTasksRecursive(const string &genomeName, vector<BranchTask> &tasks) {
     const Genome *genome = _alignment->openGenome(genomeName);
     assert(genome != NULL);
     const Genome *parent = genome->getParent();
@@ -75,49 +103,83 @@ void SummarizeMutations::analyzeGenomeRecursive(const string &genomeName) {
         stats._parentLength = parent->getSequenceLength();
         stats._branchLength = _alignment->getBranchLength(parent->getName(), genome->getName());
     }
-
-    if (_justSubs == true) {
-        substitutionAnalysis(genome, stats);
-    } else if (parent != NULL && (!_targetSet || _targetSet->find(genomeName) != _targetSet->end())) {
-        TopSegmentIteratorPtr topIt = genome->getTopSegmentIterator();
-        BottomSegmentIteratorPtr parIt = parent->getBottomSegmentIterator();
-
-        rearrangementAnalysis(genome, stats);
-    }
-
     string pname = parent != NULL ? parent->getName() : string();
     StrPair branchName(genome->getName(), pname);
     _branchMap.insert(pair<StrPair, MutationsStats>(branchName, stats));
 
+    bool targeted = !_targetSet || _targetSet->find(genomeName) != _targetSet->end();
+    if (_justSubs == true) {
+        hal_size_t n = genome->getNumBottomSegments();
+        if (genome->getNumChildren() > 0 && targeted) {
+            for (hal_size_t i = 0; i < n; i += SubstitutionChunkSegments) {
+                hal_size_t size = min(SubstitutionChunkSegments, n - i);
+                BranchTask task = {genomeName, branchName, (hal_index_t)i, (hal_index_t)(i + size - 1), size};
+                tasks.push_back(task);
+            }
+        }
+    } else if (parent != NULL && targeted) {
+        BranchTask task = {genomeName, branchName, 0, (hal_index_t)genome->getNumTopSegments() - 1,
+                           genome->getNumTopSegments()};
+        tasks.push_back(task);
+    }
+
     _alignment->closeGenome(genome);
     if (parent != NULL) {
         _alignment->closeGenome(parent);
     }
     vector<string> children = _alignment->getChildNames(genomeName);
     for (hal_size_t i = 0; i < children.size(); ++i) {
-        analyzeGenomeRecursive(children[i]);
+        makeTasksRecursive(children[i], tasks);
+    }
+}
+
+// run tasks until there are none left, accumulating their results in
+// branchMap.  genomes are kept open between tasks on the same genome.
+void SummarizeMutations::analyzeTasks(AlignmentConstPtr alignment, const vector<BranchTask> &tasks,
+                                      atomic<size_t> &nextTask, BranchMap &branchMap) {
+    const Genome *genome = NULL;
+    for (size_t i = nextTask++; i < tasks.size(); i = nextTask++) {
+        const BranchTask &task = tasks[i];
+        if (genome != NULL && genome->getName() != task._genomeName) {
+            if (genome->getParent() != NULL) {
+                alignment->closeGenome(genome->getParent());
+            }
+            alignment->closeGenome(genome);
+            genome = NULL;
+        }
+        if (genome == NULL) {
+            genome = alignment->openGenome(task._genomeName);
+            assert(genome != NULL);
+        }
+        MutationsStats &stats = branchMap.insert(pair<StrPair, MutationsStats>(task._branchName, MutationsStats()))
+                                    .first->second;
+        if (_justSubs == true) {
+            substitutionAnalysis(genome, task._firstSegment, task._lastSegment, stats);
+        } else {
+            rearrangementAnalysis(genome, stats);
+        }
+    }
+    if (genome != NULL) {
+        if (genome->getParent() != NULL) {
+            alignment->closeGenome(genome->getParent());
+        }
+        alignment->closeGenome(genome);
     }
 }
 
 // quickly count subsitutions without loading rearrangement machinery.
 // used for benchmarks for basic file scanning... and not much else since
 // the interface is still a bit wonky.
-void SummarizeMutations::substitutionAnalysis(const Genome *genome, MutationsStats &stats) {
-    assert(stats._subs == 0);
+void SummarizeMutations::substitutionAnalysis(const Genome *genome, hal_index_t firstSegment, hal_index_t lastSegment,
+                                              MutationsStats &stats) {
     if (genome->getNumChildren() == 0 || genome->getNumBottomSegments() == 0 ||
         (_targetSet && _targetSet->find(genome->getName()) == _targetSet->end())) {
         return;
     }
-    const Genome *parent = genome->getParent();
-    string pname = parent != NULL ? parent->getName() : string();
-    StrPair branchName(genome->getName(), pname);
 
-    BottomSegmentIteratorPtr bottom = genome->getBottomSegmentIterator();
+    BottomSegmentIteratorPtr bottom = genome->getBottomSegmentIterator(firstSegment);
     TopSegmentIteratorPtr top = genome->getChild(0)->getTopSegmentIterator();
 
-    string gString, cString;
-
-    hal_size_t n = genome->getNumBottomSegments();
     vector<hal_size_t> children;
     hal_size_t m = genome->getNumChildren();
     for (hal_size_t i = 0; i < m; ++i) {
@@ -130,26 +192,17 @@ void SummarizeMutations::substitutionAnalysis(const Genome *genome, MutationsSta
         return;
     }
 
-    for (hal_size_t i = 0; i < n; ++i) {
-        bool readString = false;
+    BaseComparison counts;
+    for (hal_index_t i = firstSegment; i <= lastSegment; ++i) {
         for (size_t j = 0; j < children.size(); ++j) {
             if (bottom->bseg()->hasChild(children[j])) {
-                if (readString == false) {
-                    bottom->getString(gString);
-                    readString = true;
-                }
                 top->toChild(bottom, children[j]);
-                top->getString(cString);
-                assert(gString.length() == cString.length());
-                for (hal_size_t k = 0; k < gString.length(); ++k) {
-                    if (isSubstitution(gString[k], cString[k])) {
-                        ++stats._subs;
-                    }
-                }
+                bottom->compareBases(*top, counts);
             }
         }
         bottom->toRight();
     }
+    stats._subs += counts.getSubstitutions();
 }
 
 void SummarizeMutations::rearrangementAnalysis(const Genome *genome, MutationsStats &stats) {
@@ -211,7 +264,7 @@ void SummarizeMutations::subsAndGapInserts(GappedTopSegmentIteratorPtr gappedTop
         stats._gapInsertionLength.add(gappedTop->getNumGapBases(), numGaps);
     }
 
-    string parent, child;
+    BaseComparison counts;
     TopSegmentIteratorPtr l = gappedTop->getLeft();
     TopSegmentIteratorPtr r = gappedTop->getRight();
     BottomSegmentIteratorPtr p = l->getTopSegment()->getGenome()->getParent()->getBottomSegmentIterator();
@@ -220,22 +273,11 @@ void SummarizeMutations::subsAndGapInserts(GappedTopSegmentIteratorPtr gappedTop
          i->toRight()) {
         if (i->tseg()->hasParent()) {
             p->toParent(i);
-            i->getString(child);
-            p->getString(parent);
-            assert(child.length() == parent.length());
-            for (size_t j = 0; j < child.length(); ++j) {
-                if (isTransition(child[j], parent[j])) {
-                    ++stats._transitions;
-                    ++stats._subs;
-                } else if (isTransversion(child[j], parent[j])) {
-                    ++stats._transversions;
-                    ++stats._subs;
-                } else if (isSubstitution(child[j], parent[j])) {
-                    ++stats._subs;
-                } else if (!isMissingData(child[j]) && !isMissingData(parent[j])) {
-                    ++stats._matches;
-                }
-            }
+            i->compareBases(*p, counts);
         }
     }
+    stats._transitions += counts._transitions;
+    stats._transversions += counts._transversions;
+    stats._subs += counts.getSubstitutions();
+    stats._matches += counts._matches;
 }
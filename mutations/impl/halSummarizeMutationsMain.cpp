@@ -32,6 +32,9 @@ static void initParser(CLParser &optionsParser) {
                                             " when using the normal interface.  For tuning "
                                             " and performance checking only",
                                 false);
+    optionsParser.addOption("numThreads", "number of branches (or for --justSubs, "
+                                          "ranges of segments) to analyze at once",
+                            1);
     optionsParser.setDescription("Print summary table of mutation events "
                                  "in the alignemt.");
 }
@@ -47,6 +50,7 @@ int main(int argc, char **argv) {
     hal_size_t maxGap;
     double nThreshold;
     bool justSubs;
+    hal_size_t numThreads;
     try {
         optionsParser.parseOptions(argc, argv);
         halPath = optionsParser.getArgument<string>("halFile");
@@ -55,6 +59,10 @@ int main(int argc, char **argv) {
         maxGap = optionsParser.getOption<hal_size_t>("maxGap");
         nThreshold = optionsParser.getOption<double>("maxNFraction");
         justSubs = optionsParser.getFlag("justSubs");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (numThreads == 0) {
+            throw hal_exception("--numThreads must be at least 1");
+        }
 
         if (rootGenomeName != "\"\"" && targetGenomes != "\"\"") {
             throw hal_exception("--rootGenome and --targetGenomes options are "
@@ -106,8 +114,13 @@ int main(int argc, char **argv) {
             }
         }
 
+        vector<AlignmentConstPtr> alignments = openHalAlignmentPerThread(alignment, halPath, &optionsParser, numThreads);
+        if (alignments.size() < numThreads) {
+            cerr << "Warning [halSummarizeMutations]: HDF5 library is not thread-safe, ignoring --numThreads" << endl;
+        }
         SummarizeMutations mutations;
-        mutations.analyzeAlignmentPtr(alignment, maxGap, nThreshold, justSubs, targetSet.empty() ? NULL : &targetNames);
+        mutations.analyzeAlignmentParallel(alignments, maxGap, nThreshold, justSubs,
+                                           targetSet.empty() ? NULL : &targetNames);
 
         cout << endl << mutations;
     } catch (hal_exception &e) {
@@ -12,6 +12,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace hal {
 
@@ -25,6 +26,19 @@ namespace hal {
                            std::ostream *parentBedStream, std::ostream *snpBedStream, std::ostream *delBreakBedStream,
                            const Genome *reference, hal_index_t startPosition, hal_size_t length);
 
+        /** Analyze ranges (start, length) of the reference genome concurrently,
+         * using one thread per alignment instance.  The instances must all be
+         * of the same file (see openHalAlignmentPerThread).  The output is
+         * the same as calling analyzeBranch on each range in turn. */
+        void analyzeBranchParallel(const std::vector<AlignmentConstPtr> &alignments, hal_size_t gapThreshold,
+                                   double nThreshold, std::ostream *refBedStream, std::ostream *parentBedStream,
+                                   std::ostream *snpBedStream, std::ostream *delBreakBedStream,
+                                   const std::string &referenceName,
+                                   const std::vector<std::pair<hal_index_t, hal_size_t>> &ranges);
+
+        /* maximum bases of the reference per unit of work in analyzeBranchParallel */
+        static const hal_size_t ParallelChunkLength;
+
         static const std::string inversionBedTag;
         static const std::string insertionBedTag;
         static const std::string deletionBedTag;
@@ -46,6 +60,7 @@ namespace hal {
         void writeHeaders();
 
       protected:
+        bool _writeHeaders;
         AlignmentConstPtr _alignment;
         std::ostream *_refStream;
         std::ostream *_parentStream;
@@ -11,6 +11,7 @@
 #include "hal.h"
 #include "halAverage.h"
 #include "halMutationsStats.h"
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -26,15 +27,37 @@ namespace hal {
         void analyzeAlignmentPtr(AlignmentConstPtr alignment, hal_size_t gapThreshold, double nThreshold, bool justSubs,
                               const std::set<std::string> *targetSet = NULL);
 
-      protected:
-        void analyzeGenomeRecursive(const std::string &genomeName);
-        void substitutionAnalysis(const Genome *genome, MutationsStats &stats);
-        void rearrangementAnalysis(const Genome *genome, MutationsStats &stats);
-        void subsAndGapInserts(GappedTopSegmentIteratorPtr gappedTop, MutationsStats &stats);
+        /** Analyze branches concurrently, using one thread per alignment
+         * instance.  The instances must all be of the same file (see
+         * openHalAlignmentPerThread). */
+        void analyzeAlignmentParallel(const std::vector<AlignmentConstPtr> &alignments, hal_size_t gapThreshold,
+                                      double nThreshold, bool justSubs, const std::set<std::string> *targetSet = NULL);
 
+        /* bottom segments per unit of work when just counting substitutions */
+        static const hal_size_t SubstitutionChunkSegments;
+
+      protected:
         typedef std::pair<std::string, std::string> StrPair;
         typedef std::map<StrPair, MutationsStats> BranchMap;
 
+        /* unit of work handed to a thread: a branch, or for justSubs a range
+         * of bottom segments of a genome */
+        struct BranchTask {
+            std::string _genomeName;
+            StrPair _branchName;
+            hal_index_t _firstSegment;
+            hal_index_t _lastSegment;
+            hal_size_t _size;
+        };
+
+        void makeTasksRecursive(const std::string &genomeName, std::vector<BranchTask> &tasks);
+        void analyzeTasks(AlignmentConstPtr alignment, const std::vector<BranchTask> &tasks, std::atomic<size_t> &nextTask,
+                          BranchMap &branchMap);
+        void substitutionAnalysis(const Genome *genome, hal_index_t firstSegment, hal_index_t lastSegment,
+                                  MutationsStats &stats);
+        void rearrangementAnalysis(const Genome *genome, MutationsStats &stats);
+        void subsAndGapInserts(GappedTopSegmentIteratorPtr gappedTop, MutationsStats &stats);
+
         BranchMap _branchMap;
         AlignmentConstPtr _alignment;
         hal_size_t _gapThreshold;
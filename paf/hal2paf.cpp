@@ -16,7 +16,7 @@
 using namespace std;
 using namespace hal;
 
-static void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames);
+static void genome2PAF(TextWriter& outStream, const Genome* genome, bool fullNames);
 
 static void initParser(CLParser &optionsParser) {
     optionsParser.addArgument("inHalPath", "input hal file");
@@ -72,6 +72,7 @@ int main(int argc, char **argv) {
 
         vector<string> childs = alignment->getChildNames(rootGenome->getName());
         deque<string> queue(childs.begin(), childs.end());
+        TextWriter outStream(cout, true);
 
         while (!queue.empty()) {
             string childName = queue.front();
@@ -83,7 +84,7 @@ int main(int argc, char **argv) {
                 parentGenome = childGenome->getParent();
             }
 
-            genome2PAF(cout, childGenome, fullNames);
+            genome2PAF(outStream, childGenome, fullNames);
 
             childs = alignment->getChildNames(childName);
             for (int i = 0; i < childs.size(); ++i) {
@@ -92,6 +93,7 @@ int main(int argc, char **argv) {
 
             alignment->closeGenome(childGenome);
         }
+        outStream.flush();
     }
     catch(exception& e) {
         cerr << e.what() << endl;
@@ -179,21 +181,12 @@ static char blockCat(const TopSegmentIteratorPtr& topIt1, const BottomSegmentIte
 }
 
 static size_t countSnps(TopSegmentIteratorPtr& topIt, BottomSegmentIteratorPtr& botIt) {
-    string top_bases;
-    topIt->getString(top_bases);
-    string bot_bases;
-    botIt->getString(bot_bases);
-    assert(top_bases.length() == bot_bases.length());
-    size_t num_snps = 0;
-    for (size_t i = 0; i < top_bases.length(); ++i) {
-        if (fastUpper(top_bases[i]) != fastUpper(bot_bases[i])) {
-            ++num_snps;
-        }
-    }
-    return num_snps;
+    BaseComparison counts;
+    topIt->compareBases(*botIt, counts);
+    return counts.getSubstitutions();
 }
 
-void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames) {
+void genome2PAF(TextWriter& outStream, const Genome* genome, bool fullNames) {
     TopSegmentIteratorPtr topIt1 = genome->getTopSegmentIterator();
     TopSegmentIteratorPtr topIt2 = genome->getTopSegmentIterator();
     TopSegmentIteratorPtr topIt3 = genome->getTopSegmentIterator();
@@ -302,18 +295,6 @@ void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames) {
             }
         } while (cat != 'o');
 
-        // make our cigar string
-        string cigar_string;
-        if (reversed) {
-            for (vector<pair<char, int64_t>>::reverse_iterator ci = cigar.rbegin(); ci != cigar.rend(); ++ci) {
-                cigar_string += to_string(ci->second) + ci->first;
-            }
-        } else {
-            for (vector<pair<char, int64_t>>::iterator ci = cigar.begin(); ci != cigar.end(); ++ci) {
-                cigar_string += to_string(ci->second) + ci->first;
-            }
-        }
-
         // write out the current paf line
         outStream << queryName << "\t" << queryLength << "\t"
                   << queryStart << "\t"
@@ -325,6 +306,16 @@ void genome2PAF(ostream& outStream, const Genome* genome, bool fullNames) {
                   << (matches - snps)<< "\t"
                   << (matches + gaps) << "\t"
                   << 255 << "\t"
-                  << "cg:Z:" << cigar_string << endl;
+                  << "cg:Z:";
+        if (reversed) {
+            for (vector<pair<char, int64_t>>::reverse_iterator ci = cigar.rbegin(); ci != cigar.rend(); ++ci) {
+                outStream << ci->second << ci->first;
+            }
+        } else {
+            for (vector<pair<char, int64_t>>::iterator ci = cigar.begin(); ci != cigar.end(); ++ci) {
+                outStream << ci->second << ci->first;
+            }
+        }
+        outStream << '\n';
     }
 }
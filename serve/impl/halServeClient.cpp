@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halServeClient.h"
+#include "hal.h"
+#include "halServeProtocol.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+const char *const ServeClient::SocketEnvVar = "HAL_SERVE_SOCKET";
+
+/* delay between connection attempts while waiting for the server */
+static const useconds_t CONNECT_RETRY_USEC = 50000;
+
+ServeClient::ServeClient(const string &socketPath, double connectTimeout) : _fd(-1), _connection(NULL) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.length() >= sizeof(addr.sun_path)) {
+        throw hal_exception("halServe socket path is too long: " + socketPath);
+    }
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    for (double waited = 0;; waited += CONNECT_RETRY_USEC / 1.0e6) {
+        _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (_fd < 0) {
+            throw hal_exception("can't create socket: " + string(strerror(errno)));
+        }
+        if (connect(_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            break;
+        }
+        int connectErrno = errno;
+        close(_fd);
+        _fd = -1;
+        if (waited >= connectTimeout || (connectErrno != ENOENT && connectErrno != ECONNREFUSED)) {
+            throw hal_exception("can't connect to halServe at " + socketPath + ": " + strerror(connectErrno));
+        }
+        usleep(CONNECT_RETRY_USEC);
+    }
+    _connection = new ServeConnection(_fd);
+}
+
+ServeClient::~ServeClient() {
+    delete _connection;
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+string ServeClient::request(const vector<string> &args, const string &input) {
+    _connection->writeRequest(args, input);
+    string output;
+    _connection->readResponse(output);
+    return output;
+}
+
+string ServeClient::absolutePath(const string &path) {
+    if (path.empty() || path[0] == '/' || path.find(":/") != string::npos) {
+        return path;
+    }
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved) == NULL) {
+        throw hal_exception("can't resolve path " + path + ": " + strerror(errno));
+    }
+    return resolved;
+}
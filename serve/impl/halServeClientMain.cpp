@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "hal.h"
+#include "halServeClient.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+using namespace std;
+using namespace hal;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addArgument("request", "command followed by its space-separated arguments, "
+                                         "e.g. \"dna in.hal human chr1 0 100\".  The command list is given by "
+                                         "halServe --help");
+    optionsParser.addOption("socket", string("socket of the halServe server (default from $") +
+                                          ServeClient::SocketEnvVar + ")",
+                            "");
+    optionsParser.addOption("input", "file to send as the request input, or \"stdin\"", "");
+    optionsParser.addOption("connectTimeout", "seconds to wait for the server to start", 0.0);
+    optionsParser.setDescription("Send a request to a halServe server and write the result to standard output.");
+}
+
+/* commands whose first argument isn't an alignment path */
+static bool takesPath(const string &command) {
+    return command != "ping" && command != "list" && command != "shutdown";
+}
+
+static string readInput(const string &inputPath) {
+    if (inputPath.empty()) {
+        return "";
+    }
+    ifstream inputFile;
+    if (inputPath != "stdin") {
+        inputFile.open(inputPath.c_str(), ios::binary);
+        if (!inputFile) {
+            throw hal_exception("Error opening input, " + inputPath);
+        }
+    }
+    istream &inputStream = inputPath != "stdin" ? inputFile : cin;
+    return string(istreambuf_iterator<char>(inputStream), istreambuf_iterator<char>());
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser(0);
+    initParser(optionsParser);
+    vector<string> args;
+    string socketPath;
+    string inputPath;
+    double connectTimeout;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        args = chopString(optionsParser.getArgument<string>("request"), " ");
+        socketPath = optionsParser.getOption<string>("socket");
+        inputPath = optionsParser.getOption<string>("input");
+        connectTimeout = optionsParser.getOption<double>("connectTimeout");
+        if (socketPath.empty() && getenv(ServeClient::SocketEnvVar) != NULL) {
+            socketPath = getenv(ServeClient::SocketEnvVar);
+        }
+        if (socketPath.empty()) {
+            throw hal_exception(string("--socket must be specified if $") + ServeClient::SocketEnvVar + " is not set");
+        }
+        if (args.empty()) {
+            throw hal_exception("empty request");
+        }
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        exit(1);
+    }
+
+    try {
+        if (args.size() > 1 && takesPath(args[0])) {
+            args[1] = ServeClient::absolutePath(args[1]);
+        }
+        string input = readInput(inputPath);
+        ServeClient client(socketPath, connectTimeout);
+        cout << client.request(args, input);
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
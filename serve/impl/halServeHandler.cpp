@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halServeHandler.h"
+#include "halBlockLiftover.h"
+#include "halBlockViz.h"
+#include "halMafExport.h"
+#include "halStats.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+
+using namespace std;
+using namespace hal;
+
+namespace {
+    /* description of a command: positional arguments followed by optional
+     * name=value settings */
+    struct CommandSpec {
+        const char *name;
+        size_t numPositional;
+        const char *positional;
+        const char *options;
+        const char *description;
+    };
+
+    const CommandSpec commandSpecs[] = {
+        {"ping", 0, "", "", "check that the server is running"},
+        {"open", 1, "halPath", "", "open an alignment, this is done automatically by the other commands"},
+        {"close", 1, "halPath", "", "close an alignment, freeing its memory"},
+        {"list", 0, "", "", "list the open alignments"},
+        {"stats", 1, "halPath", "", "same as halStats without options"},
+        {"chromSizes", 2, "halPath genome", "", "same as halStats --chromSizes"},
+        {"dna", 5, "halPath genome sequence start length", "", "DNA of a sequence range, followed by a newline"},
+        {"liftover", 3, "halPath srcGenome tgtGenome",
+         "noDupes outPSL outPSLWithName bedType coalescenceLimit",
+         "map the BED sent as input, same as halLiftover"},
+        {"maf", 1, "halPath",
+         "refGenome refSequence start length targetGenomes maxRefGap noDupes noAncestors onlySequenceNames unique "
+         "maxBlockLen onlyOrthologs keepEmptyRefBlocks",
+         "MAF slice, same as hal2maf"},
+        {"blocks", 6, "halPath qSpecies tSpecies tChrom tStart tEnd", "seqMode dupMode noAdjacencies coalescenceLimit",
+         "blockViz blocks as qChrom tStart qStart size strand [qSequence tSequence], followed by the target "
+         "duplications as dupe id qChrom tStart size"},
+        {"shutdown", 0, "", "", "stop the server"}};
+    const size_t numCommandSpecs = sizeof(commandSpecs) / sizeof(commandSpecs[0]);
+
+    const CommandSpec &findCommand(const string &name) {
+        for (size_t i = 0; i < numCommandSpecs; ++i) {
+            if (name == commandSpecs[i].name) {
+                return commandSpecs[i];
+            }
+        }
+        throw hal_exception("halServe: unknown command \"" + name + "\"");
+    }
+
+    /* request arguments split into positional arguments (starting with the
+     * command name) and settings */
+    struct ParsedRequest {
+        vector<string> args;
+        map<string, string> options;
+
+        bool has(const string &name) const {
+            return options.find(name) != options.end();
+        }
+        string getString(const string &name, const string &defaultValue = "") const {
+            map<string, string>::const_iterator it = options.find(name);
+            return it == options.end() ? defaultValue : it->second;
+        }
+        hal_index_t getInt(const string &name, hal_index_t defaultValue) const {
+            return has(name) ? parseInt(name, getString(name)) : defaultValue;
+        }
+        bool getFlag(const string &name) const {
+            return getInt(name, 0) != 0;
+        }
+
+        static hal_index_t parseInt(const string &name, const string &value) {
+            char *end = NULL;
+            errno = 0;
+            long long intValue = strtoll(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || errno != 0) {
+                throw hal_exception("halServe: invalid integer for " + name + ": \"" + value + "\"");
+            }
+            return intValue;
+        }
+    };
+
+    ParsedRequest parseRequest(const vector<string> &args) {
+        const CommandSpec &spec = findCommand(args[0]);
+        if (args.size() < spec.numPositional + 1) {
+            throw hal_exception("halServe: usage: " + string(spec.name) + " " + spec.positional);
+        }
+        ParsedRequest request;
+        request.args.assign(args.begin(), args.begin() + spec.numPositional + 1);
+        vector<string> optionNames = chopString(spec.options, " ");
+        for (size_t i = spec.numPositional + 1; i < args.size(); ++i) {
+            size_t equals = args[i].find('=');
+            string name = args[i].substr(0, equals);
+            if (find(optionNames.begin(), optionNames.end(), name) == optionNames.end()) {
+                throw hal_exception("halServe: invalid option \"" + args[i] + "\" for command " + spec.name);
+            }
+            request.options[name] = equals == string::npos ? "1" : args[i].substr(equals + 1);
+        }
+        return request;
+    }
+}
+
+ServeHandler::ServeHandler(const CLParser *options) : _options(options) {
+}
+
+ServeHandler::~ServeHandler() {
+    for (OpenMap::iterator it = _open.begin(); it != _open.end(); ++it) {
+        if (it->second.blockVizHandle >= 0) {
+            halClose(it->second.blockVizHandle, NULL);
+        }
+    }
+}
+
+bool ServeHandler::handle(const vector<string> &args, const string &input, string &output) {
+    if (args.empty() || args[0].empty()) {
+        throw hal_exception("halServe: empty request");
+    }
+    ParsedRequest request = parseRequest(args);
+    const string &command = request.args[0];
+    stringstream os;
+    if (command == "ping") {
+        os << "pong\n";
+    } else if (command == "open") {
+        open(request.args[1]);
+    } else if (command == "close") {
+        close(request.args[1]);
+    } else if (command == "list") {
+        for (OpenMap::const_iterator it = _open.begin(); it != _open.end(); ++it) {
+            os << it->first << "\n";
+        }
+    } else if (command == "stats") {
+        stats(args, os);
+    } else if (command == "chromSizes") {
+        chromSizes(args, os);
+    } else if (command == "dna") {
+        dna(args, os);
+    } else if (command == "liftover") {
+        liftover(args, input, os);
+    } else if (command == "maf") {
+        maf(args, os);
+    } else if (command == "blocks") {
+        blocks(args, os);
+    } else if (command == "shutdown") {
+        output.clear();
+        return false;
+    }
+    output = os.str();
+    return true;
+}
+
+void ServeHandler::printCommands(ostream &os) {
+    os << "commands (options are given as name=value after the arguments):\n";
+    for (size_t i = 0; i < numCommandSpecs; ++i) {
+        const CommandSpec &spec = commandSpecs[i];
+        os << "  " << spec.name << " " << spec.positional << "\n      " << spec.description << "\n";
+        if (spec.options[0] != '\0') {
+            os << "      options: " << spec.options << "\n";
+        }
+    }
+}
+
+ServeHandler::OpenAlignment &ServeHandler::open(const string &path) {
+    OpenMap::iterator it = _open.find(path);
+    if (it == _open.end()) {
+        OpenAlignment openAlignment;
+        openAlignment.lodManager.reset(new LodManager());
+        if (not detectHalAlignmentFormat(path).empty()) {
+            openAlignment.lodManager->loadSingeHALFile(path, _options);
+        } else {
+            openAlignment.lodManager->loadLODFile(path, _options);
+        }
+        openAlignment.blockVizHandle = -1;
+        it = _open.insert(OpenMap::value_type(path, openAlignment)).first;
+    }
+    return it->second;
+}
+
+void ServeHandler::close(const string &path) {
+    OpenMap::iterator it = _open.find(path);
+    if (it == _open.end()) {
+        throw hal_exception("halServe: alignment not open: " + path);
+    }
+    if (it->second.blockVizHandle >= 0) {
+        halClose(it->second.blockVizHandle, NULL);
+    }
+    _open.erase(it);
+}
+
+/* full resolution alignment */
+AlignmentConstPtr ServeHandler::getAlignment(const string &path) {
+    return open(path).lodManager->getAlignment(0, true);
+}
+
+const Genome *ServeHandler::getGenome(AlignmentConstPtr alignment, const string &name) {
+    const Genome *genome = alignment->openGenome(name);
+    if (genome == NULL) {
+        throw hal_exception("Genome " + name + " not found in alignment");
+    }
+    return genome;
+}
+
+void ServeHandler::stats(const vector<string> &args, ostream &os) {
+    AlignmentConstPtr alignment = getAlignment(args[1]);
+    HalStats halStats(alignment);
+    os << endl << "hal v" << alignment->getVersion() << "\n";
+    halStats.printCsv(os);
+}
+
+void ServeHandler::chromSizes(const vector<string> &args, ostream &os) {
+    const Genome *genome = getGenome(getAlignment(args[1]), args[2]);
+    for (SequenceIteratorPtr seqIt = genome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
+        os << seqIt->getSequence()->getName() << '\t' << seqIt->getSequence()->getSequenceLength() << '\n';
+    }
+}
+
+void ServeHandler::dna(const vector<string> &args, ostream &os) {
+    const Genome *genome = getGenome(getAlignment(args[1]), args[2]);
+    const Sequence *sequence = genome->getSequence(args[3]);
+    if (sequence == NULL) {
+        throw hal_exception("Sequence " + args[3] + " not found in genome " + args[2]);
+    }
+    hal_index_t start = ParsedRequest::parseInt("start", args[4]);
+    hal_index_t length = ParsedRequest::parseInt("length", args[5]);
+    if (start < 0 || length < 0 || start + length > (hal_index_t)sequence->getSequenceLength()) {
+        throw hal_exception("range " + args[4] + "+" + args[5] + " is outside of sequence " + args[3]);
+    }
+    string dna;
+    sequence->getSubString(dna, start, length);
+    os << dna << "\n";
+}
+
+void ServeHandler::liftover(const vector<string> &args, const string &input, ostream &os) {
+    ParsedRequest request = parseRequest(args);
+    AlignmentConstPtr alignment = getAlignment(args[1]);
+    const Genome *srcGenome = getGenome(alignment, args[2]);
+    const Genome *tgtGenome = getGenome(alignment, args[3]);
+    const Genome *coalescenceLimit = NULL;
+    if (request.getString("coalescenceLimit") != "") {
+        coalescenceLimit = getGenome(alignment, request.getString("coalescenceLimit"));
+    }
+    int bedType = request.getInt("bedType", 0);
+    if (bedType != 0 && (bedType < 3 || bedType > 12)) {
+        throw hal_exception("bedType must be between 3 and 12");
+    }
+    bool outPSLWithName = request.getFlag("outPSLWithName");
+    bool outPSL = outPSLWithName || request.getFlag("outPSL");
+
+    istringstream inStream(input);
+    BlockLiftover liftover;
+    liftover.convert(alignment, srcGenome, &inStream, tgtGenome, &os, bedType, !request.getFlag("noDupes"), outPSL,
+                     outPSLWithName, coalescenceLimit);
+}
+
+void ServeHandler::maf(const vector<string> &args, ostream &os) {
+    ParsedRequest request = parseRequest(args);
+    AlignmentConstPtr alignment = getAlignment(args[1]);
+
+    set<const Genome *> targetSet;
+    vector<string> targetNames = chopString(request.getString("targetGenomes"), ",");
+    for (size_t i = 0; i < targetNames.size(); ++i) {
+        targetSet.insert(getGenome(alignment, targetNames[i]));
+    }
+    const Genome *refGenome = getGenome(alignment, request.getString("refGenome", alignment->getRootName()));
+    bool noAncestors = request.getFlag("noAncestors");
+    if (noAncestors && refGenome->getNumChildren() != 0) {
+        throw hal_exception("Since the reference genome to be used for the MAF is ancestral (" + refGenome->getName() +
+                            "), the noAncestors option is invalid");
+    }
+    const Sequence *refSequence = NULL;
+    if (request.has("refSequence")) {
+        refSequence = refGenome->getSequence(request.getString("refSequence"));
+        if (refSequence == NULL) {
+            throw hal_exception("Reference sequence, " + request.getString("refSequence") +
+                                ", not found in reference genome, " + refGenome->getName());
+        }
+    }
+    hal_index_t start = request.getInt("start", 0);
+    hal_index_t length = request.getInt("length", 0);
+
+    MafExport mafExport;
+    mafExport.setMaxRefGap(request.getInt("maxRefGap", 0));
+    mafExport.setNoDupes(request.getFlag("noDupes"));
+    mafExport.setNoAncestors(noAncestors);
+    mafExport.setUcscNames(!request.getFlag("onlySequenceNames"));
+    mafExport.setUnique(request.getFlag("unique"));
+    mafExport.setMaxBlockLength(request.getInt("maxBlockLen", MafBlock::defaultMaxLength));
+    mafExport.setOnlyOrthologs(request.getFlag("onlyOrthologs"));
+    mafExport.setKeepEmptyRefBlocks(request.getFlag("keepEmptyRefBlocks"));
+    if (refSequence != NULL) {
+        mafExport.convertSequence(os, alignment, refSequence, start, length, targetSet);
+    } else {
+        for (SequenceIteratorPtr seqIt(refGenome->getSequenceIterator()); not seqIt->atEnd(); seqIt->toNext()) {
+            mafExport.convertSequence(os, alignment, seqIt->getSequence(), start, length, targetSet);
+        }
+    }
+}
+
+/* blocks are computed with the blockViz API, which picks the level of detail
+ * from the query length and caches blocks if enabled */
+void ServeHandler::blocks(const vector<string> &args, ostream &os) {
+    ParsedRequest request = parseRequest(args);
+    OpenAlignment &openAlignment = open(args[1]);
+    if (openAlignment.blockVizHandle < 0) {
+        openAlignment.blockVizHandle = halOpenHalOrLod(const_cast<char *>(args[1].c_str()), NULL);
+    }
+    hal_int_t seqMode = request.getInt("seqMode", HAL_NO_SEQUENCE);
+    hal_int_t dupMode = request.getInt("dupMode", HAL_QUERY_AND_TARGET_DUPS);
+    if (seqMode < HAL_NO_SEQUENCE || seqMode > HAL_FORCE_LOD0_SEQUENCE || dupMode < HAL_NO_DUPS ||
+        dupMode > HAL_QUERY_AND_TARGET_DUPS) {
+        throw hal_exception("halServe: invalid seqMode or dupMode");
+    }
+    string coalescenceLimit = request.getString("coalescenceLimit");
+    hal_block_arena_results_t *results = halGetBlocksInTargetRangeArena(
+        openAlignment.blockVizHandle, const_cast<char *>(args[2].c_str()), const_cast<char *>(args[3].c_str()),
+        const_cast<char *>(args[4].c_str()), ParsedRequest::parseInt("tStart", args[5]),
+        ParsedRequest::parseInt("tEnd", args[6]), 0, (hal_seqmode_type_t)seqMode, (hal_dup_type_t)dupMode,
+        !request.getFlag("noAdjacencies"), coalescenceLimit.empty() ? NULL : coalescenceLimit.c_str(), NULL);
+    for (hal_int_t i = 0; i < results->numMappedBlocks; ++i) {
+        const hal_block_t &block = results->mappedBlocks[i];
+        os << block.qChrom << '\t' << block.tStart << '\t' << block.qStart << '\t' << block.size << '\t'
+           << block.strand;
+        if (block.qSequence != NULL) {
+            os << '\t' << block.qSequence << '\t' << block.tSequence;
+        }
+        os << '\n';
+    }
+    for (const hal_target_dupe_list_t *dupe = results->targetDupeBlocks; dupe != NULL; dupe = dupe->next) {
+        for (const hal_target_range_t *range = dupe->tRange; range != NULL; range = range->next) {
+            os << "dupe\t" << dupe->id << '\t' << dupe->qChrom << '\t' << range->tStart << '\t' << range->size << '\n';
+        }
+    }
+    halFreeBlockArenaResults(results);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALSERVEHANDLER_H
+#define _HALSERVEHANDLER_H
+
+#include "hal.h"
+#include "halLodManager.h"
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+    /** Executes halServe requests.  Alignments (HAL files or LOD sets) are
+     * opened the first time they are referenced and then kept open, along
+     * with the genomes they have loaded, until closed or the server exits.
+     */
+    class ServeHandler {
+      public:
+        /** @param options command line options applied when opening
+         * alignments, must outlive the handler */
+        ServeHandler(const CLParser *options);
+        ~ServeHandler();
+
+        /** Run one request.  Errors are thrown as hal_exceptions.
+         * @param args command name followed by its arguments
+         * @param input data sent with the request
+         * @param output set to the result of the command
+         * @return false if the server was asked to shut down */
+        bool handle(const std::vector<std::string> &args, const std::string &input, std::string &output);
+
+        /** Describe the commands, for the usage message */
+        static void printCommands(std::ostream &os);
+
+      private:
+        ServeHandler(const ServeHandler &);
+        ServeHandler &operator=(const ServeHandler &);
+
+        struct OpenAlignment {
+            LodManagerPtr lodManager;
+            int blockVizHandle;
+        };
+        typedef std::map<std::string, OpenAlignment> OpenMap;
+        typedef std::map<std::string, std::string> OptionMap;
+
+        OpenAlignment &open(const std::string &path);
+        void close(const std::string &path);
+        AlignmentConstPtr getAlignment(const std::string &path);
+        const Genome *getGenome(AlignmentConstPtr alignment, const std::string &name);
+
+        void stats(const std::vector<std::string> &args, std::ostream &os);
+        void chromSizes(const std::vector<std::string> &args, std::ostream &os);
+        void dna(const std::vector<std::string> &args, std::ostream &os);
+        void liftover(const std::vector<std::string> &args, const std::string &input, std::ostream &os);
+        void maf(const std::vector<std::string> &args, std::ostream &os);
+        void blocks(const std::vector<std::string> &args, std::ostream &os);
+
+        const CLParser *_options;
+        OpenMap _open;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
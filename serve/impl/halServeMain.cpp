@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halServeHandler.h"
+#include "halServeProtocol.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+/* removed on exit, including by signal */
+static string socketPath;
+
+static void initParser(CLParser &optionsParser) {
+    optionsParser.addArgument("socketPath", "path of the Unix domain socket to listen on");
+    optionsParser.addOptionFlag("verbose", "log each request to stderr", false);
+    optionsParser.setDescription("Keep HAL alignments and LOD sets open and answer queries on them over a Unix "
+                                 "domain socket, avoiding the cost of opening the alignment for each query.  Queries "
+                                 "are sent with halServeClient.  Requests are served one at a time.");
+}
+
+static void removeSocket(int sig) {
+    unlink(socketPath.c_str());
+    _exit(128 + sig);
+}
+
+/* bind the socket, replacing a stale one left by a server that didn't exit
+ * cleanly */
+static int listenOnSocket(const string &path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.length() >= sizeof(addr.sun_path)) {
+        throw hal_exception("socket path is too long: " + path);
+    }
+    strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw hal_exception("can't create socket: " + string(strerror(errno)));
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        close(fd);
+        throw hal_exception("a server is already listening on " + path);
+    }
+    unlink(path.c_str());
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        int bindErrno = errno;
+        close(fd);
+        throw hal_exception("can't listen on " + path + ": " + strerror(bindErrno));
+    }
+    return fd;
+}
+
+static string requestString(const vector<string> &args) {
+    string str;
+    for (size_t i = 0; i < args.size(); ++i) {
+        str += (i > 0 ? " " : "") + args[i];
+    }
+    return str;
+}
+
+/* answer the requests on a connection until the client closes it.
+ * @return false if the server should shut down */
+static bool serveConnection(ServeHandler &handler, int fd, bool verbose) {
+    ServeConnection connection(fd);
+    vector<string> args;
+    string input;
+    string output;
+    try {
+        while (connection.readRequest(args, input)) {
+            if (verbose) {
+                cerr << "halServe: " << requestString(args) << endl;
+            }
+            bool running = true;
+            try {
+                running = handler.handle(args, input, output);
+            } catch (exception &e) {
+                connection.writeResponse(false, e.what());
+                continue;
+            }
+            connection.writeResponse(true, output);
+            if (!running) {
+                return false;
+            }
+        }
+    } catch (exception &e) {
+        // client went away or sent garbage, keep serving others
+        cerr << "halServe: connection dropped: " << e.what() << endl;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    CLParser optionsParser(READ_ACCESS);
+    initParser(optionsParser);
+    bool verbose;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        socketPath = optionsParser.getArgument<string>("socketPath");
+        verbose = optionsParser.getFlag("verbose");
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        ServeHandler::printCommands(cerr);
+        exit(1);
+    }
+
+    try {
+        int listenFd = listenOnSocket(socketPath);
+        signal(SIGPIPE, SIG_IGN);
+        signal(SIGINT, removeSocket);
+        signal(SIGTERM, removeSocket);
+        ServeHandler handler(&optionsParser);
+        bool running = true;
+        while (running) {
+            int fd = accept(listenFd, NULL, NULL);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                throw hal_exception("accept failed: " + string(strerror(errno)));
+            }
+            running = serveConnection(handler, fd, verbose);
+            close(fd);
+        }
+        close(listenFd);
+        unlink(socketPath.c_str());
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
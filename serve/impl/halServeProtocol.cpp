@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#include "halServeProtocol.h"
+#include "hal.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace hal;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+/* no single message may be bigger than this, guards against garbage */
+static const size_t MAX_MESSAGE_LENGTH = size_t(1) << 40;
+
+ServeConnection::ServeConnection(int fd) : _fd(fd), _bufferPos(0) {
+}
+
+bool ServeConnection::readRequest(vector<string> &args, string &input) {
+    string header;
+    if (!readLine(header)) {
+        return false;
+    }
+    args.clear();
+    size_t start = 0;
+    for (size_t tab = header.find('\t'); tab != string::npos; tab = header.find('\t', start)) {
+        args.push_back(header.substr(start, tab - start));
+        start = tab + 1;
+    }
+    args.push_back(header.substr(start));
+    string lengthLine;
+    if (!readLine(lengthLine)) {
+        throw hal_exception("halServe: connection closed in the middle of a request");
+    }
+    readBytes(input, parseLength(lengthLine));
+    return true;
+}
+
+void ServeConnection::writeRequest(const vector<string> &args, const string &input) {
+    if (args.empty()) {
+        throw hal_exception("halServe: empty request");
+    }
+    string message;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i].find_first_of("\t\n") != string::npos) {
+            throw hal_exception("halServe: request arguments may not contain tabs or newlines: \"" + args[i] + "\"");
+        }
+        message += (i > 0 ? "\t" : "") + args[i];
+    }
+    message += "\n" + std::to_string(input.length()) + "\n";
+    writeBytes(message);
+    writeBytes(input);
+}
+
+void ServeConnection::readResponse(string &output) {
+    string status;
+    if (!readLine(status)) {
+        throw hal_exception("halServe: connection closed by server");
+    }
+    size_t tab = status.find('\t');
+    if (tab == string::npos) {
+        throw hal_exception("halServe: invalid response header \"" + status + "\"");
+    }
+    readBytes(output, parseLength(status.substr(tab + 1)));
+    string code = status.substr(0, tab);
+    if (code == "ERROR") {
+        throw hal_exception(output);
+    } else if (code != "OK") {
+        throw hal_exception("halServe: invalid response status \"" + code + "\"");
+    }
+}
+
+void ServeConnection::writeResponse(bool ok, const string &output) {
+    writeBytes(string(ok ? "OK" : "ERROR") + "\t" + std::to_string(output.length()) + "\n");
+    writeBytes(output);
+}
+
+bool ServeConnection::readLine(string &line) {
+    line.clear();
+    while (true) {
+        size_t newline = _buffer.find('\n', _bufferPos);
+        if (newline != string::npos) {
+            line.append(_buffer, _bufferPos, newline - _bufferPos);
+            _bufferPos = newline + 1;
+            return true;
+        }
+        line.append(_buffer, _bufferPos, string::npos);
+        _bufferPos = _buffer.length();
+        if (!fillBuffer()) {
+            if (!line.empty()) {
+                throw hal_exception("halServe: connection closed in the middle of a line");
+            }
+            return false;
+        }
+    }
+}
+
+void ServeConnection::readBytes(string &bytes, size_t length) {
+    bytes.clear();
+    bytes.reserve(length);
+    while (bytes.length() < length) {
+        if (_bufferPos == _buffer.length() && !fillBuffer()) {
+            throw hal_exception("halServe: connection closed in the middle of a message");
+        }
+        size_t count = min(length - bytes.length(), _buffer.length() - _bufferPos);
+        bytes.append(_buffer, _bufferPos, count);
+        _bufferPos += count;
+    }
+}
+
+void ServeConnection::writeBytes(const string &bytes) {
+    size_t written = 0;
+    while (written < bytes.length()) {
+        ssize_t count = send(_fd, bytes.data() + written, bytes.length() - written, MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw hal_exception("halServe: write to socket failed: " + string(strerror(errno)));
+        }
+        written += count;
+    }
+}
+
+bool ServeConnection::fillBuffer() {
+    _buffer.resize(READ_CHUNK_SIZE);
+    _bufferPos = 0;
+    while (true) {
+        ssize_t count = read(_fd, &_buffer[0], READ_CHUNK_SIZE);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            _buffer.clear();
+            throw hal_exception("halServe: read from socket failed: " + string(strerror(errno)));
+        }
+        _buffer.resize(count);
+        return count > 0;
+    }
+}
+
+size_t ServeConnection::parseLength(const string &str) {
+    char *end = NULL;
+    errno = 0;
+    unsigned long long length = strtoull(str.c_str(), &end, 10);
+    if (str.empty() || *end != '\0' || errno != 0 || length > MAX_MESSAGE_LENGTH) {
+        throw hal_exception("halServe: invalid message length \"" + str + "\"");
+    }
+    return length;
+}
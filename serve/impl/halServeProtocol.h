@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALSERVEPROTOCOL_H
+#define _HALSERVEPROTOCOL_H
+
+#include <string>
+#include <vector>
+
+/*
+ * Wire format between halServe and its clients.  A connection carries any
+ * number of request/response pairs.
+ *
+ * request:  <arg0>\t<arg1>\t...\t<argN>\n<inputLength>\n<input bytes>
+ * response: OK\t<length>\n<output bytes>
+ *       or: ERROR\t<length>\n<message bytes>
+ *
+ * arg0 is the command name.  Arguments may not contain tabs or newlines,
+ * the input and output are arbitrary bytes (BED, MAF, DNA, ...).
+ */
+namespace hal {
+
+    /** Buffered, blocking message I/O on a connected socket.  Does not own
+     * the file descriptor. */
+    class ServeConnection {
+      public:
+        ServeConnection(int fd);
+
+        /** Read a request.
+         * @return false on a clean end of file before the request */
+        bool readRequest(std::vector<std::string> &args, std::string &input);
+        void writeRequest(const std::vector<std::string> &args, const std::string &input);
+
+        /** Read a response, throwing a hal_exception with the message if it
+         * is an error */
+        void readResponse(std::string &output);
+        void writeResponse(bool ok, const std::string &output);
+
+      private:
+        bool readLine(std::string &line);
+        void readBytes(std::string &bytes, size_t length);
+        void writeBytes(const std::string &bytes);
+        bool fillBuffer();
+        size_t parseLength(const std::string &str);
+
+        int _fd;
+        std::string _buffer;
+        size_t _bufferPos;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
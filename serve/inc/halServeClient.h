@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2012-2019 by UCSC Computational Genomics Lab
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+#ifndef _HALSERVECLIENT_H
+#define _HALSERVECLIENT_H
+
+#include <string>
+#include <vector>
+
+namespace hal {
+    class ServeConnection;
+
+    /** Connection to a halServe daemon, which keeps alignments open
+     * between requests.  A request is a command name followed by its
+     * arguments, plus optional input data (such as BED records); the response
+     * is the command's output.  See halServe --help for the commands.
+     * Errors, including those reported by the server, are thrown as
+     * hal_exceptions.  Not thread-safe, use one client per thread.
+     */
+    class ServeClient {
+      public:
+        /** Connect to the server listening on socketPath.
+         * @param connectTimeout seconds to keep retrying while the server
+         * is starting up */
+        ServeClient(const std::string &socketPath, double connectTimeout = 0);
+        ~ServeClient();
+
+        /** Send a request and wait for its output */
+        std::string request(const std::vector<std::string> &args, const std::string &input = "");
+
+        /** Convert a path to the absolute path the server must be given,
+         * as it does not share the client's working directory.  URLs are
+         * left as they are. */
+        static std::string absolutePath(const std::string &path);
+
+        /** Environment variable that may hold the default socket path */
+        static const char *const SocketEnvVar;
+
+      private:
+        ServeClient(const ServeClient &);
+        ServeClient &operator=(const ServeClient &);
+
+        int _fd;
+        ServeConnection *_connection;
+    };
+}
+#endif
+// Local Variables:
+// mode: c++
+// End:
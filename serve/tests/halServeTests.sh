@@ -0,0 +1,59 @@
+#!/bin/bash
+# Start a halServe server and check that the results of queries sent
+# through it match those of the standalone tools.
+#   halServeTests.sh binDir halFile outDir
+set -beEu -o pipefail
+
+binDir=$1
+halFile=$2
+outDir=$3
+socket=${outDir}/halServe.sock
+input=../liftover/tests/input/test1.bed12
+
+${binDir}/halServe ${socket} &
+serverPid=$!
+trap "kill ${serverPid} 2>/dev/null || true" EXIT
+
+client="${binDir}/halServeClient --socket ${socket}"
+${client} --connectTimeout 30 "ping" > ${outDir}/ping.out
+echo pong | diff - ${outDir}/ping.out
+
+${binDir}/halStats ${halFile} > ${outDir}/stats.expected
+${client} "stats ${halFile}" > ${outDir}/stats.out
+diff ${outDir}/stats.expected ${outDir}/stats.out
+
+${binDir}/halStats --chromSizes Genome_2 ${halFile} > ${outDir}/chromSizes.expected
+${client} "chromSizes ${halFile} Genome_2" > ${outDir}/chromSizes.out
+diff ${outDir}/chromSizes.expected ${outDir}/chromSizes.out
+
+${binDir}/halLiftover ${halFile} Genome_0 ${input} Genome_2 ${outDir}/liftover.expected
+${client} --input ${input} "liftover ${halFile} Genome_0 Genome_2" > ${outDir}/liftover.out
+diff ${outDir}/liftover.expected ${outDir}/liftover.out
+
+# halLiftover routed through the server
+${binDir}/halLiftover --outPSL --serveSocket ${socket} ${halFile} Genome_0 ${input} Genome_2 ${outDir}/liftoverPsl.out
+${binDir}/halLiftover --outPSL ${halFile} Genome_0 ${input} Genome_2 ${outDir}/liftoverPsl.expected
+diff ${outDir}/liftoverPsl.expected ${outDir}/liftoverPsl.out
+
+${binDir}/hal2maf --refGenome Genome_1 --refSequence Genome_1_seq --start 500 --length 2000 ${halFile} ${outDir}/maf.expected
+${client} "maf ${halFile} refGenome=Genome_1 refSequence=Genome_1_seq start=500 length=2000" > ${outDir}/maf.out
+diff ${outDir}/maf.expected ${outDir}/maf.out
+
+${client} "dna ${halFile} Genome_0 Genome_0_seq 100 20" > ${outDir}/dna.out
+test $(wc -c < ${outDir}/dna.out) -eq 21
+
+${client} "blocks ${halFile} Genome_2 Genome_0 Genome_0_seq 0 1000" > ${outDir}/blocks.out
+test -s ${outDir}/blocks.out
+
+# errors are reported without killing the server
+if ${client} "dna ${halFile} noSuchGenome x 0 1" 2> ${outDir}/error.out ; then
+    echo "error not reported" >&2
+    exit 1
+fi
+grep -q noSuchGenome ${outDir}/error.out
+
+${client} "list" | grep -q "$(basename ${halFile})"
+${client} "shutdown"
+wait ${serverPid}
+trap - EXIT
+test ! -e ${socket}
@@ -1,47 +1,164 @@
 #include "hal.h"
 #include "halCLParser.h"
+#include <algorithm>
+#include <atomic>
 
 using namespace std;
 using namespace hal;
 
-int main(int argc, char **argv) {
-    CLParser optionsParser;
-    optionsParser.setDescription("Calculate % identity by sampling bases.");
-    optionsParser.addArgument("halFile", "path to hal file to analyze");
-    optionsParser.addArgument("refGenome", "genome to calculate coverage on");
-    optionsParser.addOption("numSamples", "Number of bases to sample when calculating % ID", 1000000);
-    optionsParser.addOption("seed", "Random seed (integer)", 0);
-    string path;
-    string refGenome;
-    hal_size_t numSamples;
-    int64_t seed;
-    try {
-        optionsParser.parseOptions(argc, argv);
-        path = optionsParser.getArgument<string>("halFile");
-        refGenome = optionsParser.getArgument<string>("refGenome");
-        numSamples = optionsParser.getOption<hal_size_t>("numSamples");
-        seed = optionsParser.getOption<int64_t>("seed");
-    } catch (exception &e) {
-        cerr << e.what() << endl;
-        optionsParser.printUsage(cerr);
-        exit(1);
+// leaf genome name, reference sequence name (empty when not by sequence)
+typedef pair<string, string> IdentityKey;
+typedef map<IdentityKey, BaseComparison> IdentityMap;
+
+/* reference segments per unit of work in exact mode */
+static const hal_size_t exactChunkSegments = 1000;
+
+/* a gapless alignment of reference bases [_refStart, _refStart + _length) to
+ * a target, where reference base _refStart + i aligns to target base
+ * _tgtStart + i (or _tgtStart - i, complemented, if _tgtReversed) */
+struct AlignedRun {
+    hal_index_t _refStart;
+    hal_size_t _length;
+    hal_index_t _tgtStart;
+    bool _tgtReversed;
+};
+
+static AlignedRun getAlignedRun(MappedSegment *mappedSeg) {
+    const SlicedSegment *source = mappedSeg->getSource();
+    const SlicedSegment *target = mappedSeg->getTarget();
+    AlignedRun run;
+    run._length = source->getLength();
+    if (!source->getReversed()) {
+        run._refStart = source->getStartPosition();
+        run._tgtStart = target->getStartPosition();
+        run._tgtReversed = target->getReversed();
+    } else {
+        run._refStart = source->getEndPosition();
+        run._tgtStart = target->getEndPosition();
+        run._tgtReversed = !target->getReversed();
+    }
+    return run;
+}
+
+/* compare the reference bases [start, end) of a run to the target */
+static void compareRun(const Genome *refGenome, const Genome *tgtGenome, const AlignedRun &run, hal_index_t start,
+                       hal_index_t end, BaseComparison &counts) {
+    hal_index_t offset = start - run._refStart;
+    DnaIteratorPtr refDna = refGenome->getDnaIterator(start);
+    DnaIteratorPtr tgtDna = tgtGenome->getDnaIterator(run._tgtReversed ? run._tgtStart - offset : run._tgtStart + offset);
+    tgtDna->setReversed(run._tgtReversed);
+    refDna->compareBases(*tgtDna, end - start, counts);
+}
+
+/* compare the reference bases aligned to exactly one target base, as the
+ * sampling mode only counts sites that map to a single base */
+static void compareMappedSegments(const Genome *refGenome, const Genome *tgtGenome, const MappedSegmentSet &mappedSegs,
+                                  BaseComparison &counts) {
+    vector<AlignedRun> runs;
+    for (MappedSegmentSet::const_iterator i = mappedSegs.begin(); i != mappedSegs.end(); ++i) {
+        runs.push_back(getAlignedRun(i->get()));
+    }
+    if (runs.size() == 1) {
+        compareRun(refGenome, tgtGenome, runs[0], runs[0]._refStart, runs[0]._refStart + runs[0]._length, counts);
+        return;
+    }
+    vector<hal_index_t> breaks;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        breaks.push_back(runs[i]._refStart);
+        breaks.push_back(runs[i]._refStart + runs[i]._length);
+    }
+    sort(breaks.begin(), breaks.end());
+    breaks.erase(unique(breaks.begin(), breaks.end()), breaks.end());
+    for (size_t b = 1; b < breaks.size(); ++b) {
+        size_t numCovering = 0, covering = 0;
+        for (size_t i = 0; i < runs.size(); ++i) {
+            if (runs[i]._refStart <= breaks[b - 1] && breaks[b] <= runs[i]._refStart + (hal_index_t)runs[i]._length) {
+                ++numCovering;
+                covering = i;
+            }
+        }
+        if (numCovering == 1) {
+            compareRun(refGenome, tgtGenome, runs[covering], breaks[b - 1], breaks[b], counts);
+        }
     }
+}
 
-    if (seed == 0) {
-        // Default seed. Generate a "random" seed based on the time.
-        time_t curTime = time(NULL);
-        seed = curTime;
+/* compare the reference segments in chunks handed out by nextChunk to their
+ * homologs in each leaf */
+static void exactIdentityThread(AlignmentConstPtr alignment, const string &refName, const vector<string> &leafNames,
+                                bool bySequence, atomic<hal_size_t> &nextChunk, IdentityMap &identity) {
+    const Genome *ref = alignment->openGenome(refName);
+    bool useTop = ref->getParent() != NULL;
+    hal_size_t numSegments = useTop ? ref->getNumTopSegments() : ref->getNumBottomSegments();
+    SegmentIteratorPtr refSeg;
+    if (useTop) {
+        refSeg = ref->getTopSegmentIterator();
+    } else {
+        refSeg = ref->getBottomSegmentIterator();
     }
-    st_randomSeed(seed);
 
-    AlignmentConstPtr alignment(openHalAlignment(path, &optionsParser));
-    const Genome *ref = alignment->openGenome(refGenome);
-    vector<const Genome *> leafGenomes = getLeafGenomes(alignment.get());
+    vector<const Genome *> leaves;
+    vector<const Genome *> mrcas;
+    vector<set<const Genome *>> downwardPaths(leafNames.size());
+    for (size_t i = 0; i < leafNames.size(); ++i) {
+        leaves.push_back(alignment->openGenome(leafNames[i]));
+        set<const Genome *> inputSet;
+        inputSet.insert(ref);
+        inputSet.insert(leaves[i]);
+        mrcas.push_back(getLowestCommonAncestor(inputSet));
+        inputSet.clear();
+        inputSet.insert(mrcas[i]);
+        inputSet.insert(leaves[i]);
+        getGenomesInSpanningTree(inputSet, downwardPaths[i]);
+    }
 
-    // Genome -> <# of identical bases to ref, # of total bases aligned to ref>
-    map<const Genome *, pair<hal_size_t, hal_size_t>> idStats;
-    for (size_t i = 0; i < leafGenomes.size(); i++) {
-        idStats.insert(make_pair(leafGenomes[i], make_pair(0, 0)));
+    MappedSegmentSet mappedSegs;
+    for (hal_size_t chunk = nextChunk++; chunk * exactChunkSegments < numSegments; chunk = nextChunk++) {
+        hal_size_t last = min(numSegments, (chunk + 1) * exactChunkSegments);
+        for (hal_size_t segIdx = chunk * exactChunkSegments; segIdx < last; ++segIdx) {
+            refSeg->setArrayIndex(const_cast<Genome *>(ref), segIdx);
+            string seqName = bySequence ? refSeg->getSequence()->getName() : string();
+            for (size_t i = 0; i < leaves.size(); ++i) {
+                mappedSegs.clear();
+                halMapSegment(refSeg.get(), mappedSegs, leaves[i], &downwardPaths[i], true, 0, mrcas[i], mrcas[i]);
+                if (!mappedSegs.empty()) {
+                    compareMappedSegments(ref, leaves[i], mappedSegs, identity[IdentityKey(leafNames[i], seqName)]);
+                }
+            }
+        }
+    }
+}
+
+static IdentityMap exactIdentity(const vector<AlignmentConstPtr> &alignments, const string &refName,
+                                 const vector<string> &leafNames, bool bySequence) {
+    atomic<hal_size_t> nextChunk(0);
+    vector<IdentityMap> threadIdentity(alignments.size());
+    runThreads(alignments.size(), [&](hal_size_t threadNum) {
+        exactIdentityThread(alignments[threadNum], refName, leafNames, bySequence, nextChunk, threadIdentity[threadNum]);
+    });
+    IdentityMap identity;
+    for (size_t i = 0; i < leafNames.size(); ++i) {
+        identity[IdentityKey(leafNames[i], string())];
+    }
+    for (size_t t = 0; t < threadIdentity.size(); ++t) {
+        for (IdentityMap::const_iterator i = threadIdentity[t].begin(); i != threadIdentity[t].end(); ++i) {
+            identity[i->first] += i->second;
+            if (bySequence) {
+                identity[IdentityKey(i->first.first, string())] += i->second;
+            }
+        }
+    }
+    return identity;
+}
+
+static IdentityMap sampleIdentity(AlignmentConstPtr alignment, const string &refName, const vector<string> &leafNames,
+                                  hal_size_t numSamples) {
+    const Genome *ref = alignment->openGenome(refName);
+    vector<const Genome *> leafGenomes;
+    IdentityMap identity;
+    for (size_t i = 0; i < leafNames.size(); i++) {
+        leafGenomes.push_back(alignment->openGenome(leafNames[i]));
+        identity[IdentityKey(leafNames[i], string())];
     }
 
     for (hal_size_t i = 0; i < numSamples; i++) {
@@ -61,32 +178,99 @@ int main(int argc, char **argv) {
             MappedSegmentSet segments;
             halMapSegmentSP(refSeg, segments, leafGenome, NULL, true, 0, NULL, NULL);
             if (segments.size() == 1) {
-                auto i = segments.begin();
-                string tgtString;
-                (*i)->getString(tgtString);
-                if (toupper(tgtString[0]) == 'N') {
-                    continue;
-                }
-                bool identical = toupper(refString[0]) == toupper(tgtString[0]);
-                auto mapIt = idStats.find(leafGenome);
-                if (identical) {
-                    mapIt->second.first++;
-                }
-                mapIt->second.second++;
+                (*segments.begin())->compareBases(identity[IdentityKey(leafNames[j], string())]);
             }
         }
     }
+    return identity;
+}
+
+static void printIdentity(ostream &os, const IdentityMap &identity, bool bySequence) {
+    os << "Genome, " << (bySequence ? "Sequence, " : "") << "IdenticalSites, AlignedSites, PercentIdentity" << endl;
+    for (IdentityMap::const_iterator it = identity.begin(); it != identity.end(); it++) {
+        hal_size_t identicalBases = it->second._matches;
+        hal_size_t alignedBases = it->second.getAligned();
+        os << it->first.first << ", ";
+        if (bySequence) {
+            os << (it->first.second.empty() ? "Total" : it->first.second) << ", ";
+        }
+        os << identicalBases << ", " << alignedBases << ", " << 100.0 * ((double)identicalBases) / alignedBases << endl;
+    }
+}
 
-    cout << "Genome, IdenticalSites, AlignedSites, PercentIdentity" << endl;
-
-    for (map<const Genome *, pair<hal_size_t, hal_size_t>>::iterator it = idStats.begin(); it != idStats.end(); it++) {
-        string name = it->first->getName();
-        hal_size_t identicalBases = it->second.first;
-        hal_size_t alignedBases = it->second.second;
-        cout << name << ", "
-             << identicalBases << ", "
-             << alignedBases << ", "
-             << 100.0 * ((double) identicalBases) / alignedBases
-             << endl;
+int main(int argc, char **argv) {
+    CLParser optionsParser;
+    optionsParser.setDescription("Calculate % identity of the leaves to a reference genome by sampling bases, or "
+                                 "over every aligned base with --exact.");
+    optionsParser.addArgument("halFile", "path to hal file to analyze");
+    optionsParser.addArgument("refGenome", "genome to calculate coverage on");
+    optionsParser.addOption("numSamples", "Number of bases to sample when calculating % ID", 1000000);
+    optionsParser.addOption("seed", "Random seed (integer)", 0);
+    optionsParser.addOptionFlag("exact", "compare every base of the reference to the leaves instead of sampling", false);
+    optionsParser.addOptionFlag("bySequence", "with --exact, also report identity for each reference sequence", false);
+    optionsParser.addOption("numThreads", "with --exact, number of threads to divide the reference between", 1);
+    string path;
+    string refGenome;
+    hal_size_t numSamples;
+    int64_t seed;
+    bool exact;
+    bool bySequence;
+    hal_size_t numThreads;
+    try {
+        optionsParser.parseOptions(argc, argv);
+        path = optionsParser.getArgument<string>("halFile");
+        refGenome = optionsParser.getArgument<string>("refGenome");
+        numSamples = optionsParser.getOption<hal_size_t>("numSamples");
+        seed = optionsParser.getOption<int64_t>("seed");
+        exact = optionsParser.getFlag("exact");
+        bySequence = optionsParser.getFlag("bySequence");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (bySequence && !exact) {
+            throw hal_exception("--bySequence requires --exact");
+        }
+        if (numThreads == 0) {
+            throw hal_exception("--numThreads must be at least 1");
+        }
+    } catch (exception &e) {
+        cerr << e.what() << endl;
+        optionsParser.printUsage(cerr);
+        exit(1);
+    }
+
+    try {
+        AlignmentConstPtr alignment(openHalAlignment(path, &optionsParser));
+        if (alignment->openGenome(refGenome) == NULL) {
+            throw hal_exception("Reference genome, " + refGenome + ", not found in alignment");
+        }
+        vector<string> leafNames;
+        vector<const Genome *> leafGenomes = getLeafGenomes(alignment.get());
+        for (size_t i = 0; i < leafGenomes.size(); i++) {
+            leafNames.push_back(leafGenomes[i]->getName());
+        }
+
+        IdentityMap identity;
+        if (exact) {
+            vector<AlignmentConstPtr> alignments = openHalAlignmentPerThread(alignment, path, &optionsParser, numThreads);
+            if (alignments.size() < numThreads) {
+                cerr << "Warning [halPctId]: HDF5 library is not thread-safe, ignoring --numThreads" << endl;
+            }
+            identity = exactIdentity(alignments, refGenome, leafNames, bySequence);
+        } else {
+            if (seed == 0) {
+                // Default seed. Generate a "random" seed based on the time.
+                time_t curTime = time(NULL);
+                seed = curTime;
+            }
+            st_randomSeed(seed);
+            identity = sampleIdentity(alignment, refGenome, leafNames, numSamples);
+        }
+        printIdentity(cout, identity, bySequence);
+    } catch (hal_exception &e) {
+        cerr << "hal exception caught: " << e.what() << endl;
+        return 1;
+    } catch (exception &e) {
+        cerr << "Exception caught: " << e.what() << endl;
+        return 1;
     }
+    return 0;
 }
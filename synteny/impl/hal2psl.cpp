@@ -29,30 +29,39 @@ std::vector<PslBlock> Hal2Psl::convert2psl(AlignmentConstPtr alignment, const Ge
         _missedSet.clear();
         _tgtSet.clear();
         _tgtSet.insert(tgtGenome);
-        for (SequenceIteratorPtr seqIt = srcGenome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
-            _outBedLines.clear();
-            _srcSequence = seqIt->getSequence();
-            auto chrName = _srcSequence->getName();
-            if (srcChrom != "\"\"" && srcChrom != chrName) {
-                continue;
+        if (srcChrom != "\"\"") {
+            // look the chromosome up rather than scanning every sequence,
+            // as it is called for each chromosome of the genome
+            const Sequence *sequence = srcGenome->getSequence(srcChrom);
+            if (sequence != NULL) {
+                convertSequence(sequence, pslBlocks);
             }
-            _bedLine._start = 0;
-            _bedLine._end = _srcSequence->getSequenceLength();
-            _mappedBlocks.clear();
-            _outPSL = true;
-            visitBegin();
-            liftInterval(_mappedBlocks);
-            if (_mappedBlocks.size()) {
-                assignBlocksToIntervals();
+        } else {
+            for (SequenceIteratorPtr seqIt = srcGenome->getSequenceIterator(); not seqIt->atEnd(); seqIt->toNext()) {
+                convertSequence(seqIt->getSequence(), pslBlocks);
             }
-            //_outBedLines.sort(BedLineSrcLess());
-            storePslResults(pslBlocks);
-            cleanResults();
         }
     }
     return pslBlocks;
 }
 
+void Hal2Psl::convertSequence(const Sequence *sequence, std::vector<PslBlock> &pslBlocks) {
+    _outBedLines.clear();
+    _srcSequence = sequence;
+    _bedLine._start = 0;
+    _bedLine._end = _srcSequence->getSequenceLength();
+    _mappedBlocks.clear();
+    _outPSL = true;
+    visitBegin();
+    liftInterval(_mappedBlocks);
+    if (_mappedBlocks.size()) {
+        assignBlocksToIntervals();
+    }
+    //_outBedLines.sort(BedLineSrcLess());
+    storePslResults(pslBlocks);
+    cleanResults();
+}
+
 void Hal2Psl::makeUpPsl(const std::vector<PSLInfo> &vpsl, const std::vector<BedBlock> &blocks, const char strand,
                         const hal_index_t start, const std::string chrName, std::vector<PslBlock> &pslBlocks) {
     assert(vpsl.size() == 1);
@@ -10,6 +10,7 @@
 #include "hal2psl.h"
 #include "psl_io.h"
 #include "psl_merger.h"
+#include <atomic>
 
 using namespace hal;
 
@@ -22,6 +23,9 @@ static void initParser(CLParser &optionsParser) {
     optionsParser.addOption("minBlockSize", "lower bound on synteny block length", 5000);
     optionsParser.addOption("maxAnchorDistance", "upper bound on distance for syntenic psl blocks", 5000);
     optionsParser.addOption("queryChromosome", "chromosome to infer synteny (default is whole genome)", "\"\"");
+    optionsParser.addOption("numThreads", "number of query chromosomes (or for PSL input, pairs of query and "
+                                          "target chromosomes) to process at once",
+                            1);
     optionsParser.setDescription("Convert alignments into synteny blocks");
 }
 
@@ -55,19 +59,13 @@ void validateInputOrThrow(const std::string &queryGenomeName, const std::string
     }
 }
 
-static void makeSyntenyBlocks(std::vector<PslBlock>& blocks, hal_size_t minBlockSize,
-                              hal_size_t maxAnchorDistance, std::ofstream &pslFh) {
-    auto merged_blocks = dag_merge(blocks, minBlockSize, maxAnchorDistance);
-    psl_io::write_psl(merged_blocks, pslFh);
-}
-
 static void syntenyFromPsl(std::string alignmentFile, hal_size_t minBlockSize,
-                           hal_size_t maxAnchorDistance, std::string outPslPath) {
+                           hal_size_t maxAnchorDistance, std::string outPslPath, hal_size_t numThreads) {
     auto blocks = psl_io::get_blocks_set(alignmentFile);
     std::ofstream pslFh;
     pslFh.exceptions(std::ofstream::failbit|std::ofstream::badbit);
     pslFh.open(outPslPath, std::ofstream::out);
-    makeSyntenyBlocks(blocks, minBlockSize, maxAnchorDistance, pslFh);
+    psl_io::write_psl(dag_merge(blocks, minBlockSize, maxAnchorDistance, numThreads), pslFh);
     pslFh.close();
 }
 
@@ -81,22 +79,16 @@ static std::vector<std::string> getChromNames(const Genome *genome) {
     return chromNames;
 }
 
-static void syntenyBlockForChrom(AlignmentConstPtr alignment,
-                                 const Genome *targetGenome, const Genome *queryGenome,
-                                 std::string queryChromosome, hal_size_t minBlockSize,
-                                 hal_size_t maxAnchorDistance, std::ofstream &pslFh) {
-    auto hal2psl = hal::Hal2Psl();
-    auto blocks = hal2psl.convert2psl(alignment, queryGenome, targetGenome, queryChromosome);
-    makeSyntenyBlocks(blocks, minBlockSize, maxAnchorDistance, pslFh);
-}
-
 
-/* do one chromosome at a time to reduce memory */
-static void syntenyFromHal(AlignmentConstPtr alignment, std::string queryGenomeName,
+/* do one chromosome at a time to reduce memory, with each thread using its
+ * own copy of the alignment.  If the alignment can't be opened again, the
+ * threads are used to merge the blocks of each chromosome instead. */
+static void syntenyFromHal(const std::vector<AlignmentConstPtr> &alignments, std::string queryGenomeName,
                            std::string targetGenomeName, std::string queryChromosome,
-                           hal_size_t minBlockSize, hal_size_t maxAnchorDistance, std::string outPslPath) {
-    auto targetGenome = openGenomeOrThrow(alignment, targetGenomeName);
-    auto queryGenome = openGenomeOrThrow(alignment, queryGenomeName);
+                           hal_size_t minBlockSize, hal_size_t maxAnchorDistance, std::string outPslPath,
+                           hal_size_t numThreads) {
+    auto queryGenome = openGenomeOrThrow(alignments[0], queryGenomeName);
+    openGenomeOrThrow(alignments[0], targetGenomeName);
     std::vector<std::string> chromNames;
     if (queryChromosome != "\"\"") {
         chromNames.push_back(queryChromosome);
@@ -104,13 +96,24 @@ static void syntenyFromHal(AlignmentConstPtr alignment, std::string queryGenomeN
         chromNames = getChromNames(queryGenome);
     }
 
+    std::vector<std::vector<std::vector<PslBlock>>> chromBlocks(chromNames.size());
+    hal_size_t mergeThreads = alignments.size() > 1 ? 1 : numThreads;
+    std::atomic<size_t> nextChrom(0);
+    runThreads(std::max<size_t>(1, std::min(alignments.size(), chromNames.size())), [&](hal_size_t threadNum) {
+        auto targetGenome = openGenomeOrThrow(alignments[threadNum], targetGenomeName);
+        auto queryGenome = openGenomeOrThrow(alignments[threadNum], queryGenomeName);
+        for (size_t i = nextChrom++; i < chromNames.size(); i = nextChrom++) {
+            auto hal2psl = hal::Hal2Psl();
+            auto blocks = hal2psl.convert2psl(alignments[threadNum], queryGenome, targetGenome, chromNames[i]);
+            chromBlocks[i] = dag_merge(blocks, minBlockSize, maxAnchorDistance, mergeThreads);
+        }
+    });
 
     std::ofstream pslFh;
     pslFh.exceptions(std::ofstream::failbit|std::ofstream::badbit);
     pslFh.open(outPslPath, std::ofstream::out);
-    for (auto chromIt = chromNames.begin(); chromIt != chromNames.end(); chromIt++) {
-        syntenyBlockForChrom(alignment, targetGenome, queryGenome,
-                             *chromIt, minBlockSize, maxAnchorDistance, pslFh);
+    for (auto chromIt = chromBlocks.begin(); chromIt != chromBlocks.end(); chromIt++) {
+        psl_io::write_psl(*chromIt, pslFh);
     }
     pslFh.close();
 }
@@ -126,6 +129,7 @@ int main(int argc, char *argv[]) {
     std::string queryChromosome;
     hal_size_t minBlockSize;
     hal_size_t maxAnchorDistance;
+    hal_size_t numThreads;
     try {
         optionsParser.parseOptions(argc, argv);
         alignmentFile = optionsParser.getArgument<std::string>("alignment");
@@ -136,6 +140,10 @@ int main(int argc, char *argv[]) {
         minBlockSize = optionsParser.getOption<hal_size_t>("minBlockSize");
         maxAnchorDistance = optionsParser.getOption<hal_size_t>("maxAnchorDistance");
         queryChromosome = optionsParser.getOption<std::string>("queryChromosome");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        if (numThreads == 0) {
+            throw hal_exception("--numThreads must be at least 1");
+        }
     } catch (std::exception &e) {
         std::cerr << e.what() << std::endl;
         optionsParser.printUsage(std::cerr);
@@ -146,11 +154,19 @@ int main(int argc, char *argv[]) {
     try {
         std::vector<PslBlock> blocks;
         if (alignmentIsPsl) {
-            syntenyFromPsl(alignmentFile, minBlockSize, maxAnchorDistance, outPslPath);
+            syntenyFromPsl(alignmentFile, minBlockSize, maxAnchorDistance, outPslPath, numThreads);
         } else {
             auto alignment = openAlignmentOrThrow(alignmentFile, optionsParser);
-            syntenyFromHal(alignment, queryGenomeName, targetGenomeName, queryChromosome, minBlockSize, maxAnchorDistance, outPslPath);
-            alignment->close();
+            auto alignments = openHalAlignmentPerThread(alignment, alignmentFile, &optionsParser, numThreads);
+            if (alignments.size() < numThreads) {
+                std::cerr << "Warning [halSynteny]: HDF5 library is not thread-safe, only merging "
+                          << "synteny blocks with --numThreads" << std::endl;
+            }
+            syntenyFromHal(alignments, queryGenomeName, targetGenomeName, queryChromosome, minBlockSize, maxAnchorDistance,
+                           outPslPath, numThreads);
+            for (auto &threadAlignment : alignments) {
+                threadAlignment->close();
+            }
         }
     } catch (std::exception &e) {
         std::cerr << "Exception caught: " << e.what() << std::endl;
@@ -83,10 +83,11 @@ namespace psl_io {
     }
 
     void write_psl(const std::vector<std::vector<PslBlock>> &merged_blocks, std::ofstream &ofs) {
-        for (auto path : merged_blocks) {
-            auto psl = construct_psl(path);
-            ofs << psl << std::endl;
+        hal::TextWriter out(ofs);
+        for (const auto &path : merged_blocks) {
+            out << construct_psl(path) << '\n';
         }
+        out.flush();
     }
 
     void write_psl(const std::vector<std::vector<PslBlock>> &merged_blocks, const std::string &outFilePath) {
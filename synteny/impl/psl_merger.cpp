@@ -1,4 +1,6 @@
 #include "psl_merger.h"
+#include <atomic>
+#include <queue>
 
 // Assumes a.start < b.start
 bool are_syntenic(const PslBlock &a, const PslBlock &b) {
@@ -10,126 +12,286 @@ bool is_not_overlapping_ordered_pair(const PslBlock &a, const PslBlock &b, const
            b.tStart - a.tEnd < threshold;
 }
 
-std::vector<int> get_next(const int pos, const std::vector<PslBlock> &queryGroup, const hal_size_t maxAnchorDistance) {
-    std::vector<int> f;
-    for (auto i = pos + 1; i < (int)queryGroup.size(); ++i) {
-        if (is_not_overlapping_ordered_pair(queryGroup[pos], queryGroup[i], maxAnchorDistance)) {
-            if (f.empty())
-                f.push_back(i);
-            else {
-                if (not f.empty() && is_not_overlapping_ordered_pair(queryGroup[f[0]], queryGroup[i], maxAnchorDistance)) {
-                    return f;
+namespace {
+    // is_not_overlapping_ordered_pair for blocks known to be on the same
+    // target chromosome and strand
+    bool chains_to(const PslBlock &a, const PslBlock &b, const hal_size_t threshold) {
+        return a.qEnd <= b.qStart && a.tEnd <= b.tStart && b.qStart - a.qEnd < threshold && b.tStart - a.tEnd < threshold;
+    }
+
+    struct MergedPath {
+        hal_size_t weight;
+        // position of the last block among the blocks of its query chromosome
+        int lastIndex;
+        std::vector<PslBlock> blocks;
+    };
+
+    // *dag* of the blocks of a query chromosome aligned to one target
+    // chromosome on one strand, which are the only ones that can be chained.
+    // Vertices are numbered in order of query start, and refer to the
+    // blocks of the query chromosome through *members*.  Edges go to the
+    // next vertices whose block can follow in a synteny block, and are
+    // stored in flat arrays along with the reverse edges.
+    // Weight of an edge equals length of the next psl block;
+    // Weight of a vertex equals estimated weight:
+    // w_j < w_i + w_e(ij) => w_j must be updated
+    // Also keeps track of how we came to this state (*from*).
+    class PslDag {
+      public:
+        PslDag(const std::vector<PslBlock> &group, const std::vector<int> &members, const hal_size_t maxAnchorDistance);
+
+        // Repeatedly take the heaviest path and hide its vertices, until
+        // all are hidden, adding the paths spanning minBlockBreath
+        void merge_paths(const hal_size_t minBlockBreath, std::vector<MergedPath> &paths);
+
+      private:
+        const PslBlock &block(int v) const {
+            return _group[_members[v]];
+        }
+        void add_edges(const hal_size_t maxAnchorDistance);
+        void weigh(int v);
+        void hide_path(const std::vector<int> &path);
+
+        const std::vector<PslBlock> &_group;
+        const std::vector<int> &_members;
+        // next vertices of v are _nexts[_nextOffsets[v]] to _nexts[_nextOffsets[v + 1]]
+        std::vector<int> _nextOffsets;
+        std::vector<int> _nexts;
+        std::vector<int> _prevOffsets;
+        std::vector<int> _prevs;
+        std::vector<hal_size_t> _weights;
+        std::vector<int> _from;
+        std::vector<char> _hidden;
+        std::vector<char> _dirty;
+        // candidates for the heaviest vertex, heaviest and then last first.
+        // Weights only decrease, so entries not matching _weights are stale
+        std::priority_queue<std::pair<hal_size_t, int>> _heaviest;
+    };
+
+    PslDag::PslDag(const std::vector<PslBlock> &group, const std::vector<int> &members, const hal_size_t maxAnchorDistance)
+        : _group(group), _members(members) {
+        add_edges(maxAnchorDistance);
+        int n = members.size();
+        _weights.resize(n);
+        _from.resize(n);
+        _hidden.assign(n, false);
+        _dirty.assign(n, false);
+        for (int v = 0; v < n; ++v) {
+            weigh(v);
+            _heaviest.push(std::make_pair(_weights[v], v));
+        }
+    }
+
+    // The next vertices of a block are those that can follow it, up to and
+    // excluding the first that could also follow the first of them.
+    // Blocks are sorted by query start, so only those starting within
+    // maxAnchorDistance of the end of the block need be checked.
+    void PslDag::add_edges(const hal_size_t maxAnchorDistance) {
+        int n = _members.size();
+        _nextOffsets.resize(n + 1);
+        _nextOffsets[0] = 0;
+        std::vector<int> numPrevs(n + 1, 0);
+        for (int pos = 0; pos < n; ++pos) {
+            const PslBlock &a = block(pos);
+            int lo = pos + 1, hi = n;
+            while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (block(mid).qStart < a.qEnd) {
+                    lo = mid + 1;
                 } else {
-                    f.push_back(i);
+                    hi = mid;
                 }
             }
+            int first = -1;
+            for (int i = lo; i < n && block(i).qStart - a.qEnd < maxAnchorDistance; ++i) {
+                if (chains_to(a, block(i), maxAnchorDistance)) {
+                    if (first < 0) {
+                        first = i;
+                    } else if (chains_to(block(first), block(i), maxAnchorDistance)) {
+                        break;
+                    }
+                    _nexts.push_back(i);
+                    ++numPrevs[i + 1];
+                }
+            }
+            _nextOffsets[pos + 1] = _nexts.size();
+        }
+        // previous vertices in increasing order
+        _prevOffsets.resize(n + 1);
+        _prevOffsets[0] = 0;
+        for (int v = 0; v < n; ++v) {
+            _prevOffsets[v + 1] = _prevOffsets[v] + numPrevs[v + 1];
+        }
+        _prevs.resize(_nexts.size());
+        std::vector<int> fill(_prevOffsets.begin(), _prevOffsets.end() - 1);
+        for (int v = 0; v < n; ++v) {
+            for (int e = _nextOffsets[v]; e < _nextOffsets[v + 1]; ++e) {
+                _prevs[fill[_nexts[e]]++] = v;
+            }
         }
     }
 
-    return f;
-}
+    // A vertex weighs its size plus the heaviest of its previous vertices,
+    // the first one in order if there are several, or just its size if they
+    // are all hidden.  Previous vertices must already be weighed.
+    void PslDag::weigh(int v) {
+        int from = -1;
+        hal_size_t weight = 0;
+        for (int e = _prevOffsets[v]; e < _prevOffsets[v + 1]; ++e) {
+            int p = _prevs[e];
+            if (not _hidden[p] && (from < 0 || _weights[p] > weight)) {
+                from = p;
+                weight = _weights[p];
+            }
+        }
+        _weights[v] = weight + block(v).size;
+        _from[v] = from;
+    }
 
-// *dag* is represented as a map:  vertex -> its possible next vertices;
-// *hidden_vertices* is a set of vertices that are already in paths;
-// Weight of an edge equals length of the next psl block;
-// Weight of a vertex equals estimated weight:
-// w_j < w_i + w_e(ij) => w_j must be updated
-// Also keeps track of how we came to this state:
-// (prev_vertex, weight)
-std::map<int, std::pair<int, hal_size_t>> weigh_dag(const std::vector<PslBlock> &group, std::map<int, std::vector<int>> &dag,
-                                                    const std::set<int> &hiddenVertices, const hal_size_t maxAnchorDistance) {
-    std::map<int, std::pair<int, hal_size_t>> weightedDag;
-    for (int i = 0; i < (int)group.size(); ++i) {
-        if (hiddenVertices.count(i))
-            continue;
-        std::vector<int> nexts;
-        if (not dag.count(i)) {
-            nexts = get_next(i, group, maxAnchorDistance);
-            dag[i] = nexts;
-        } else {
-            nexts = dag[i];
+    // Hiding vertices only changes the weights of the vertices after them,
+    // so those are weighed again in order, stopping where weights don't
+    // change
+    void PslDag::hide_path(const std::vector<int> &path) {
+        std::priority_queue<int, std::vector<int>, std::greater<int>> dirty;
+        for (int v : path) {
+            _hidden[v] = true;
         }
-        // If this vertex was never visited then its weight equals to its size.
-        // Intuition: otherwise we will never count its size
-        if (not weightedDag.count(i))
-            weightedDag[i] = std::make_pair(-1, group[i].size);
-        for (auto j : nexts) {
-            if (hiddenVertices.count(j))
-                continue;
-            auto alternativeWeight = weightedDag[i].second + group[j].size;
-            if (not weightedDag.count(j) or weightedDag[j].second < alternativeWeight)
-                // Remembers previous vertex itself and
-                // its corresponding weight:
-                // previous vertex w_i + weight of the next edge
-                weightedDag[j] = std::make_pair(i, alternativeWeight);
+        for (int v : path) {
+            for (int e = _nextOffsets[v]; e < _nextOffsets[v + 1]; ++e) {
+                int j = _nexts[e];
+                if (not _hidden[j] && not _dirty[j]) {
+                    _dirty[j] = true;
+                    dirty.push(j);
+                }
+            }
+        }
+        while (not dirty.empty()) {
+            int v = dirty.top();
+            dirty.pop();
+            _dirty[v] = false;
+            hal_size_t oldWeight = _weights[v];
+            weigh(v);
+            if (_weights[v] != oldWeight) {
+                _heaviest.push(std::make_pair(_weights[v], v));
+                for (int e = _nextOffsets[v]; e < _nextOffsets[v + 1]; ++e) {
+                    int j = _nexts[e];
+                    if (not _hidden[j] && not _dirty[j]) {
+                        _dirty[j] = true;
+                        dirty.push(j);
+                    }
+                }
+            }
         }
     }
-    return weightedDag;
-}
 
-int get_maxed_vertex(const std::map<int, std::pair<int, hal_size_t>> &weightedDag) {
-    hal_size_t maxWeight = weightedDag.cbegin()->second.second;
-    int maxPos = weightedDag.cbegin()->first;
-    for (auto it = weightedDag.cbegin(); it != weightedDag.cend(); ++it) {
-        if (it->second.second >= maxWeight) {
-            maxWeight = it->second.second;
-            maxPos = it->first;
+    void PslDag::merge_paths(const hal_size_t minBlockBreath, std::vector<MergedPath> &paths) {
+        std::vector<int> path;
+        for (;;) {
+            while (not _heaviest.empty() &&
+                   (_hidden[_heaviest.top().second] || _weights[_heaviest.top().second] != _heaviest.top().first)) {
+                _heaviest.pop();
+            }
+            if (_heaviest.empty()) {
+                break;
+            }
+            // Chooses the path of the heaviest weight
+            int startVertex = _heaviest.top().second;
+            path.clear();
+            for (int v = startVertex; v != -1; v = _from[v]) {
+                path.push_back(v);
+            }
+            std::reverse(path.begin(), path.end());
+            const PslBlock &first = block(path[0]);
+            const PslBlock &last = block(startVertex);
+            auto qLen = last.qEnd - first.qStart;
+            auto tLen = last.tEnd - first.tStart;
+            if (qLen >= minBlockBreath && tLen >= minBlockBreath) {
+                MergedPath merged = {_weights[startVertex], _members[startVertex], std::vector<PslBlock>()};
+                for (int v : path) {
+                    merged.blocks.push_back(block(v));
+                }
+                paths.push_back(std::move(merged));
+            }
+            hide_path(path);
         }
     }
-    return maxPos;
-}
 
-std::vector<PslBlock> traceback(std::map<int, std::pair<int, hal_size_t>> &weightedDag, std::set<int> &hiddenVertices,
-                                const std::vector<PslBlock> &group) {
-    // Chooses the path of the heaviest weight
-    auto startVertex = get_maxed_vertex(weightedDag);
-    std::vector<int> path = {startVertex};
-    auto prevVertex = weightedDag[startVertex].first;
-    while (prevVertex != -1) {
-        path.push_back(prevVertex);
-        prevVertex = weightedDag[prevVertex].first;
-    }
-    hiddenVertices.insert(path.begin(), path.end());
-    std::vector<PslBlock> pslBlockPath;
-    std::transform(path.begin(), path.end(), std::back_inserter(pslBlockPath), [group](int x) -> PslBlock { return group[x]; });
-    std::reverse(pslBlockPath.begin(), pslBlockPath.end());
-    return pslBlockPath;
-}
-struct {
-    bool operator()(PslBlock a, PslBlock b) const {
-        if (a.qStart < b.qStart)
-            return true;
-        else if (a.qStart == b.qStart) {
-            return a.tStart < b.tStart;
+    struct {
+        bool operator()(const PslBlock &a, const PslBlock &b) const {
+            if (a.qStart < b.qStart)
+                return true;
+            else if (a.qStart == b.qStart) {
+                return a.tStart < b.tStart;
+            }
+            return false;
         }
-        return false;
-    }
-} qStartLess;
+    } qStartLess;
+
+    // blocks of one query chromosome to one target chromosome and strand
+    struct PairGroup {
+        size_t group;
+        std::vector<int> members;
+        std::vector<MergedPath> paths;
+    };
+}
 
 std::vector<std::vector<PslBlock>> dag_merge(const std::vector<PslBlock> &blocks, const hal_size_t minBlockBreath,
-                                             const hal_size_t maxAnchorDistance) {
+                                             const hal_size_t maxAnchorDistance, const hal_size_t numThreads) {
     std::map<std::string, std::vector<PslBlock>> blocksByQName;
-    for (auto block : blocks)
+    for (const auto &block : blocks)
         blocksByQName[block.qName].push_back(block);
-    std::vector<std::vector<PslBlock>> paths;
-    for (auto pairs : blocksByQName) {
-        std::vector<PslBlock> group = pairs.second;
-        std::string qName = pairs.first;
-        std::map<int, std::vector<int>> dag;
-        std::set<int> hiddenVertices;
+    std::vector<std::vector<PslBlock>> groups;
+    std::vector<PairGroup> pairGroups;
+    for (auto &pairs : blocksByQName) {
+        std::vector<PslBlock> &group = pairs.second;
         std::sort(group.begin(), group.end(), qStartLess);
-        while (hiddenVertices.size() != group.size()) {
-            auto weightedDag = weigh_dag(group, dag, hiddenVertices, maxAnchorDistance);
-            auto path = traceback(weightedDag, hiddenVertices, group);
-            if (path.empty()) {
-                break;
-            }
-            auto qLen = path.back().qEnd - path[0].qStart;
-            auto tLen = path.back().tEnd - path[0].tStart;
-            if (qLen >= minBlockBreath && tLen >= minBlockBreath) {
-                // if (qLen >= minBlockBreath && tLen >= minBlockBreath){
-                paths.push_back(path);
+        std::map<std::pair<std::string, std::string>, size_t> pairIndex;
+        for (int i = 0; i < (int)group.size(); ++i) {
+            auto key = std::make_pair(group[i].tName, group[i].strand);
+            auto it = pairIndex.find(key);
+            if (it == pairIndex.end()) {
+                it = pairIndex.insert(std::make_pair(key, pairGroups.size())).first;
+                pairGroups.push_back(PairGroup());
+                pairGroups.back().group = groups.size();
             }
+            pairGroups[it->second].members.push_back(i);
+        }
+        groups.push_back(std::move(group));
+    }
+
+    // biggest first so a large pair doesn't start last
+    std::vector<size_t> order(pairGroups.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return pairGroups[a].members.size() > pairGroups[b].members.size();
+    });
+    std::atomic<size_t> nextPair(0);
+    hal::runThreads(std::max<hal_size_t>(1, std::min<hal_size_t>(numThreads, pairGroups.size())), [&](hal_size_t) {
+        for (size_t i = nextPair++; i < order.size(); i = nextPair++) {
+            PairGroup &pairGroup = pairGroups[order[i]];
+            PslDag dag(groups[pairGroup.group], pairGroup.members, maxAnchorDistance);
+            dag.merge_paths(minBlockBreath, pairGroup.paths);
+        }
+    });
+
+    // The DAGs of the pairs are independent, so taking the heaviest path of
+    // a query chromosome at a time, as if they were one, orders them by
+    // weight, and then by the position of their last block
+    std::vector<std::vector<MergedPath>> groupPaths(groups.size());
+    for (auto &pairGroup : pairGroups) {
+        for (auto &path : pairGroup.paths) {
+            groupPaths[pairGroup.group].push_back(std::move(path));
+        }
+    }
+    std::vector<std::vector<PslBlock>> paths;
+    for (auto &mergedPaths : groupPaths) {
+        std::sort(mergedPaths.begin(), mergedPaths.end(), [](const MergedPath &a, const MergedPath &b) {
+            return a.weight > b.weight || (a.weight == b.weight && a.lastIndex > b.lastIndex);
+        });
+        for (auto &path : mergedPaths) {
+            paths.push_back(std::move(path.blocks));
         }
     }
     return paths;
@@ -21,6 +21,7 @@
 namespace hal {
     class Hal2Psl : public BlockLiftover {
 
+        void convertSequence(const Sequence *sequence, std::vector<PslBlock> &pslBlocks);
         void storePslResults(std::vector<PslBlock> &pslBlocks);
         void makeUpPsl(const std::vector<PSLInfo> &vpsl, const std::vector<BedBlock> &blocks, const char strand,
                        const hal_index_t start, const std::string chrName, std::vector<PslBlock> &pslBlocks);
@@ -119,15 +119,6 @@ class Psl {
         parseBlocks(row[18], row[19], row[20], qSize, tSize, (haveSeqs ? row[21] : ""), (haveSeqs ? row[22] : ""));
     }
 
-    std::string vector_join(std::vector<std::string> v, std::string sep) const {
-        std::string s = "";
-        for (int i = 0; i < (int)v.size(); ++i) {
-            s += v[i];
-            s += (i < int(v.size()) - 1 ? sep : "");
-        }
-        return s;
-    }
-
   public:
     Psl(const std::string &line) {
         auto v = split(line, '\t');
@@ -143,43 +134,27 @@ class Psl {
         return blocks;
     }
 
-    friend std::ostream &operator<<(std::ostream &strm, const Psl &a);
+    friend hal::TextWriter &operator<<(hal::TextWriter &out, const Psl &a);
 };
 
-inline std::ostream &operator<<(std::ostream &strm, const Psl &a) {
-
-    std::vector<std::string> v;
-    v.push_back(std::to_string(a.match));
-    v.push_back(std::to_string(a.misMatch));
-    v.push_back(std::to_string(a.repMatch));
-    v.push_back(std::to_string(a.nCount));
-    v.push_back(std::to_string(a.qNumInsert));
-    v.push_back(std::to_string(a.qBaseInsert));
-    v.push_back(std::to_string(a.tNumInsert));
-    v.push_back(std::to_string(a.tBaseInsert));
-    v.push_back(a.strand);
-    v.push_back(a.qName);
-    v.push_back(std::to_string(a.qSize));
-    v.push_back(std::to_string(a.qStart));
-    v.push_back(std::to_string(a.qEnd));
-    v.push_back(a.tName);
-    v.push_back(std::to_string(a.tSize));
-    v.push_back(std::to_string(a.tStart));
-    v.push_back(std::to_string(a.tEnd));
-    v.push_back(std::to_string(a.blockCount));
-    std::vector<std::string> ints;
-    std::vector<std::string> qstarts;
-    std::vector<std::string> tstarts;
-    for (auto b : a.blocks) {
-        ints.push_back(std::to_string(b.size));
-        qstarts.push_back(std::to_string(b.qStart));
-        tstarts.push_back(std::to_string(b.tStart));
+inline hal::TextWriter &operator<<(hal::TextWriter &out, const Psl &a) {
+    out << a.match << '\t' << a.misMatch << '\t' << a.repMatch << '\t' << a.nCount << '\t' << a.qNumInsert << '\t'
+        << a.qBaseInsert << '\t' << a.tNumInsert << '\t' << a.tBaseInsert << '\t' << a.strand << '\t' << a.qName << '\t'
+        << a.qSize << '\t' << a.qStart << '\t' << a.qEnd << '\t' << a.tName << '\t' << a.tSize << '\t' << a.tStart << '\t'
+        << a.tEnd << '\t' << a.blockCount << '\t';
+    for (const auto &b : a.blocks) {
+        out << b.size << ',';
+    }
+    out << '\t';
+    for (const auto &b : a.blocks) {
+        out << b.qStart << ',';
+    }
+    out << '\t';
+    for (const auto &b : a.blocks) {
+        out << b.tStart << ',';
     }
-    v.push_back(a.vector_join(ints, ",") + ",");
-    v.push_back(a.vector_join(qstarts, ",") + ",");
-    v.push_back(a.vector_join(tstarts, ",") + ",");
     // TODO: add qseqs and tseqs!
-    return strm << a.vector_join(v, "\t");
+    return out;
 }
 
 #endif /*PSL_H*/
@@ -27,18 +27,13 @@ bool are_syntenic(const PslBlock &a, const PslBlock &b);
 
 bool is_not_overlapping_ordered_pair(const PslBlock &a, const PslBlock &b, const hal_size_t threshold = 5000);
 
-std::vector<int> get_next(const int pos, const std::vector<PslBlock> &queryGroup, const hal_size_t maxAnchorDistance = 5000);
-
-std::map<int, std::pair<int, hal_size_t>> weigh_dag(const std::vector<PslBlock> &group, std::map<int, std::vector<int>> &dag,
-                                                    const std::set<int> &hiddenVertices, const hal_size_t maxAnchorDistance);
-
-int get_maxed_vertex(const std::map<int, std::pair<int, int>> &weightedDag);
-
-std::vector<PslBlock> traceback(std::map<int, std::pair<int, hal_size_t>> &weightedDag, std::set<int> &hiddenVertices,
-                                const std::vector<PslBlock> &group);
-
+/* Chain the blocks into synteny blocks, taking the heaviest path through
+ * the DAG of the blocks of each query chromosome to each target chromosome
+ * and strand until all blocks are used, and keeping the paths spanning at
+ * least minBlockBreath.  The DAGs are independent, so numThreads of them
+ * are merged at once. */
 std::vector<std::vector<PslBlock>> dag_merge(const std::vector<PslBlock> &blocks, const hal_size_t minBlockBreath,
-                                             const hal_size_t maxAnchorDistance);
+                                             const hal_size_t maxAnchorDistance, const hal_size_t numThreads = 1);
 
 #endif /* PSL_MERGER_H */
 
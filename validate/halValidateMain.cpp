@@ -16,24 +16,60 @@ int main(int argc, char **argv) {
     CLParser optionsParser;
     optionsParser.addArgument("halFile", "path to hal file to validate");
     optionsParser.addOption("genome", "specific genome to validate instead of entire file", "");
+    optionsParser.addOption("numThreads", "number of genomes to validate at once", 1);
+    optionsParser.addOption("maxViolations", "number of problems to report before giving up", 10);
+    optionsParser.addOptionFlag("timings", "print the number of seconds taken to validate each genome", false);
     optionsParser.setDescription("Check if hal database is valid");
     string path, genomeName;
+    hal_size_t numThreads, maxViolations;
+    bool timings;
     try {
         optionsParser.parseOptions(argc, argv);
         path = optionsParser.getArgument<string>("halFile");
         genomeName = optionsParser.getOption<string>("genome");
+        numThreads = optionsParser.getOption<hal_size_t>("numThreads");
+        maxViolations = optionsParser.getOption<hal_size_t>("maxViolations");
+        timings = optionsParser.getFlag("timings");
+        if (numThreads == 0) {
+            throw hal_exception("--numThreads must be at least 1");
+        }
+        if (maxViolations == 0) {
+            throw hal_exception("--maxViolations must be at least 1");
+        }
     } catch (exception &e) {
         cerr << e.what() << endl;
         optionsParser.printUsage(cerr);
         exit(1);
     }
+    hal_size_t numViolations = 0;
     try {
         AlignmentConstPtr alignment(openHalAlignment(path, &optionsParser));
+        vector<GenomeValidation> validations;
         if (genomeName == "") {
-            validateAlignment(alignment.get());
+            vector<AlignmentConstPtr> alignments = openHalAlignmentPerThread(alignment, path, &optionsParser, numThreads);
+            if (alignments.size() < numThreads) {
+                cerr << "Warning [halValidate]: HDF5 library is not thread-safe, ignoring --numThreads" << endl;
+            }
+            validations = checkAlignment(alignments, maxViolations);
         } else {
             const Genome *genome = alignment->openGenome(genomeName);
-            validateGenome(genome);
+            if (genome == NULL) {
+                throw hal_exception("Genome " + genomeName + " not found");
+            }
+            validations.push_back(checkGenome(genome, maxViolations));
+        }
+        // violations are reported in breadth-first order, up to the limit
+        // over the whole alignment
+        for (const GenomeValidation &validation : validations) {
+            if (timings) {
+                cout << validation._genomeName << "\t" << validation._seconds << endl;
+            }
+            for (const string &violation : validation._violations) {
+                if (numViolations < maxViolations) {
+                    cerr << validation._genomeName << ": " << violation << endl;
+                }
+                ++numViolations;
+            }
         }
     } catch (hal_exception &e) {
         cerr << "hal exception caught: " << e.what() << endl;
@@ -42,6 +78,10 @@ int main(int argc, char **argv) {
         cerr << "Exception caught: " << e.what() << endl;
         return 1;
     }
+    if (numViolations > 0) {
+        cerr << "\nFile invalid" << endl;
+        return 1;
+    }
     cout << "\nFile valid" << endl;
 
     return 0;